@@ -265,7 +265,10 @@ inline void createFunction(T fn) {
       });
 }
 
-template <const auto &db_name>
+// #HDD changes start; open_flags allows for eg. read-only instantiations that sit alongside the default read/write one,
+// each with their own set of thread-local connections and prepared statement caches
+template <const auto &db_name, int open_flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE>
+// #HDD changes end
 class Database {
  public:
   // This hook is called every time a connection is made, taking as argument
@@ -294,7 +297,7 @@ class Database {
         }
       } while (0);
       static const auto saved_db_name = detail::maybe_invoke(db_name);
-      auto ret = sqlite3_open(&saved_db_name[0], &db_handle);
+      auto ret = sqlite3_open_v2(&saved_db_name[0], &db_handle, open_flags, nullptr);
       if (ret != SQLITE_OK) {
         throw error{ret};
       }
@@ -594,7 +597,7 @@ class Database {
     int ret = -1;
     bool first_invocation = true;
 
-    friend class Database<db_name>;
+    friend class Database<db_name, open_flags>;
   };
 
   // A TransactionGuard object starts a SQLite transaction when constructed,
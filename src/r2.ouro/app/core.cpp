@@ -12,8 +12,15 @@
 #include "base/instrumentation.h"
 #include "base/operations.h"
 
+#include "buffer/mix.h"
+
+#include "ssp/async.processor.h"
+#include "ssp/ssp.file.flac.h"
+
 #include "data/uuid.h"
 
+#include "spacetime/chronicle.h"
+
 #include "config/base.h"
 #include "config/frontend.h"
 #include "config/data.h"
@@ -23,6 +30,7 @@
 #include "app/module.frontend.h"
 #include "app/module.frontend.fonts.h"
 #include "app/module.audio.h"
+#include "app/module.audio.offline.h"
 #include "app/module.midi.h"
 
 #include "filesys/fsutil.h"
@@ -254,6 +262,9 @@ int Core::Run()
     blog::core( FMTX( " + {} primary worker threads" ), m_taskExecutor.num_workers() );
     blog::core( FMTX( " + {} plugin pool threads" ), m_taskExecutorPlugins.num_workers() );
 
+    // audio kernels
+    blog::core( FMTX( "mix kernels : {}" ), buffer::getMixKernelName( buffer::getMixKernel() ) );
+
     // configure app event bus
     {
         m_appEventBus       = std::make_shared<base::EventBus>();
@@ -387,6 +398,73 @@ int Core::Run()
 
     // try and load performance tuning; okay if this fails, we'll use defaults
     const auto perfLoad = config::load( *this, m_configPerf );
+    applyPerformanceConfig();
+
+    if ( m_configPerf.enableTraceCapture )
+    {
+        blog::core( "trace capture enabled from boot" );
+        base::instr::trace::setCaptureEnabled( true );
+    }
+
+    if ( m_configPerf.runMixKernelBenchmark )
+    {
+        // check that all available kernel sets agree with the scalar reference, and how long they take doing it
+        blog::core( "running mix kernel benchmark ..." );
+        for ( const auto& benchmark : buffer::benchmarkMixKernels( 4096, 16 ) )
+        {
+            blog::core( FMTX( " + {:8} | downmix {:.3f}ms | interleave {:.3f}ms | quantise {:.3f}ms | {}" ),
+                buffer::getMixKernelName( benchmark.m_kernel ),
+                benchmark.m_downmixMs,
+                benchmark.m_interleaveMs,
+                benchmark.m_quantiseMs,
+                benchmark.m_matchesScalar ? "matches scalar" : "MISMATCH" );
+        }
+    }
+    if ( m_configPerf.runSampleProcessorStressTest )
+    {
+        blog::core( "running sample processor stress test ..." );
+        for ( const auto& result : ssp::stressTestAsyncBufferProcessor( 48000, 1.0 ) )
+        {
+            blog::core( FMTX( " + {:14} | block {:4} | {} processed, {} dropped over {} overflows | append avg {:.2f}us max {:.1f}us | {}" ),
+                result.m_name,
+                result.m_blockSize,
+                result.m_samplesProcessed,
+                result.m_samplesDropped,
+                result.m_overflowEvents,
+                result.m_appendAverageUs,
+                result.m_appendMaximumUs,
+                result.m_passed ? "ok" : "FAILED" );
+        }
+    }
+    if ( m_configPerf.runOfflineRenderCheck )
+    {
+        blog::core( "running offline render check ..." );
+        const auto result = app::module::checkOfflineRender( 48000, 10.0 );
+
+        blog::core( FMTX( " + {} rendered, {} processed, {} dropped, {} out of sequence | {:.1f}x realtime | policy {} | {}" ),
+            result.m_samplesRendered,
+            result.m_samplesProcessed,
+            result.m_samplesDropped,
+            result.m_sequenceErrors,
+            result.m_speedFactor,
+            result.m_policyRestored ? "restored" : "NOT RESTORED",
+            result.m_passed ? "ok" : "FAILED" );
+    }
+    if ( m_configPerf.runEventBusBenchmark )
+    {
+        blog::core( "running event bus benchmark ..." );
+        for ( const auto& result : base::benchmarkEventBus( 300000 ) )
+        {
+            blog::core( FMTX( " + {:2} listeners | {} events | legacy send {:.2f}ms dispatch {:.2f}ms | current send {:.2f}ms dispatch {:.2f}ms | {}" ),
+                result.m_listenersPerEvent,
+                result.m_eventsSent,
+                result.m_legacySendMs,
+                result.m_legacyDispatchMs,
+                result.m_currentSendMs,
+                result.m_currentDispatchMs,
+                result.m_resultsMatch ? "ok" : "MISMATCH" );
+        }
+    }
 
 
     blog::core( "initial Endlesss setup ..." );
@@ -530,6 +608,16 @@ int Core::Run()
 
     m_appEventBusClient = std::nullopt;
 
+    // write out whatever the built-in trace capture picked up this session
+    if ( base::instr::trace::hasCapturedData() )
+    {
+        base::instr::trace::setCaptureEnabled( false );
+
+        const auto traceStatus = base::instr::trace::writeCapture( getTraceCaptureFile() );
+        if ( !traceStatus.ok() )
+            blog::error::core( FMTX( "unable to write trace capture : {}" ), traceStatus.ToString() );
+    }
+
     // HDD hack to stop D++ leaking global memory
     dpp::delete_eventmap();
 
@@ -545,6 +633,33 @@ void Core::waitForConsoleKey()
 #endif
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+void Core::applyPerformanceConfig()
+{
+    ssp::FLACWriter::EncoderOptions flacOptions;
+    flacOptions.m_compressionLevel  = static_cast<uint32_t>( m_configPerf.flacCompressionLevel );
+    flacOptions.m_verify            = m_configPerf.flacVerifyEncoding;
+    flacOptions.m_chunked           = m_configPerf.flacChunkedEncoding;
+
+    ssp::FLACWriter::setDefaultEncoderOptions( flacOptions );
+
+    base::EventBus::DispatchBudget eventBudget;
+    eventBudget.m_maximumEvents         = static_cast<uint32_t>( m_configPerf.eventDispatchBudgetEvents );
+    eventBudget.m_maximumMicroseconds   = static_cast<uint32_t>( m_configPerf.eventDispatchBudgetUs );
+
+    m_appEventBus->setDispatchBudget( eventBudget );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Core::getTraceCaptureFile() const
+{
+    fs::path outputRoot = getPath( PathFor::PerAppConfig );
+    if ( m_configData.has_value() )
+        outputRoot = StoragePaths( m_configData.value(), GetAppCacheName() ).outputApp;
+
+    return outputRoot / fmt::format( FMTX( "{}trace.json" ), spacetime::createPrefixTimestampForFile() );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 void Core::encodeExchangeData(
     const endlesss::live::RiffPtr& riffInstance,
@@ -1200,6 +1315,8 @@ void CoreGUI::finishInterfaceLayoutAndRender()
     // update networking averages #HDD move to Core:: main tick 
     tickActivityUpdate();
 
+    base::instr::counter( "Audio Engine Load %", m_mdAudio->getAudioEngineCPULoadPercent() );
+
     m_perfData.m_uiEventBus = m_perfData.m_moment.delta< std::chrono::milliseconds >();
     m_perfData.m_moment.setToNow();
 
@@ -1356,6 +1473,65 @@ void CoreGUI::ImGuiPerformanceTracker()
 
             ImGui::EndTable();
         }
+
+        // per-event traffic through the app event bus
+        static std::vector< base::EventBus::EventStatistics > eventStatistics;
+        m_appEventBus->getStatistics( eventStatistics );
+
+        if ( ImGui::BeginTable( "##perf_stats_events", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg ) )
+        {
+            ImGui::PushStyleColor( ImGuiCol_Text, ImGui::GetStyleColorVec4( ImGuiCol_ResizeGripHovered ) );
+            ImGui::TableSetupColumn( "EVENTS", ImGuiTableColumnFlags_WidthFixed, column0size * 2.0f );
+            ImGui::TableSetupColumn( "Sent", ImGuiTableColumnFlags_None );
+            ImGui::TableSetupColumn( "Queue Peak", ImGuiTableColumnFlags_None );
+            ImGui::TableSetupColumn( "Avg / Peak us", ImGuiTableColumnFlags_None );
+            ImGui::TableHeadersRow();
+            ImGui::PopStyleColor();
+
+            for ( const auto& stats : eventStatistics )
+            {
+                const double averageUs = ( stats.m_dispatched > 0 ) ? ( static_cast<double>( stats.m_dispatchTotalNs ) / static_cast<double>( stats.m_dispatched ) ) * 0.001 : 0.0;
+
+                ImGui::TableNextColumn(); ImGui::TextUnformatted( stats.m_name );
+                ImGui::TableNextColumn();
+                if ( stats.m_dropped > 0 )
+                    ImGui::Text( "%" PRIu64 " (%" PRIu64 " lost)", stats.m_sent, stats.m_dropped );
+                else
+                    ImGui::Text( "%" PRIu64, stats.m_sent );
+                ImGui::TableNextColumn(); ImGui::Text( "%u", stats.m_queueDepthPeak );
+                ImGui::TableNextColumn(); ImGui::Text( "%.1f / %.1f", averageUs, static_cast<double>( stats.m_dispatchPeakNs ) * 0.001 );
+            }
+
+            ImGui::EndTable();
+        }
+        if ( m_appEventBus->getDeferredOnLastDispatch() > 0 )
+            ImGui::Text( "%u events deferred by dispatch budget", m_appEventBus->getDeferredOnLastDispatch() );
+
+        // built-in trace capture
+        {
+            bool traceCapture = base::instr::trace::isCaptureEnabled();
+            if ( ImGui::Checkbox( "Record Trace", &traceCapture ) )
+                base::instr::trace::setCaptureEnabled( traceCapture );
+
+            ImGui::SameLine();
+            ImGui::BeginDisabled( !base::instr::trace::hasCapturedData() );
+            if ( ImGui::Button( "Save Trace" ) )
+            {
+                const fs::path traceFile = getTraceCaptureFile();
+                const auto traceStatus = base::instr::trace::writeCapture( traceFile );
+                if ( traceStatus.ok() )
+                {
+                    m_appEventBus->send<::events::AddToastNotification>( ::events::AddToastNotification::Type::Info,
+                        ICON_FA_CLOCK " Trace Saved",
+                        traceFile.filename().string() );
+                }
+                else
+                {
+                    m_appEventBus->send<::events::AddErrorPopup>( "Trace Capture Failed", traceStatus.ToString() );
+                }
+            }
+            ImGui::EndDisabled();
+        }
     }
     ImGui::End();
 }
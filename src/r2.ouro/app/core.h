@@ -187,6 +187,13 @@ protected:
     }
 
 
+    // push any performance options that live outside of the app (encoder defaults, etc) out to their systems;
+    // called once the config is loaded and again if it has been edited
+    void applyPerformanceConfig();
+
+    // where the built-in trace capture gets written; app output folder if storage is configured, per-app config otherwise
+    ouro_nodiscard fs::path getTraceCaptureFile() const;
+
     void encodeExchangeData(
         const endlesss::live::RiffPtr& riffInstance,
         std::string_view jamName,
@@ -269,6 +276,8 @@ protected:
     std::array< uint8_t, 20 >               m_avgNetPulseHistory;
     float                                   m_avgNetRollingPerSecTimer = 0;
     float                                   m_avgNetPulseUpdateTimer = 0;
+    uint64_t                                m_netConnectionsOpened = 0;     // running totals from the http client pool
+    uint64_t                                m_netConnectionsReused = 0;
 
     void event_NetworkActivity( const events::NetworkActivity* eventData )
     {
@@ -276,6 +285,9 @@ protected:
         m_avgNetPayloadValue += eventData->m_bytes;
         if ( eventData->m_bFailure )
             m_avgNetErrorCount++;
+
+        m_netConnectionsOpened += eventData->m_connectionsOpened;
+        m_netConnectionsReused += eventData->m_connectionsReused;
     }
 
     // async task tracing
@@ -838,6 +838,9 @@ AsyncCommandCounter Audio::installMixer( MixerInterface* mixIf )
 // ---------------------------------------------------------------------------------------------------------------------
 AsyncCommandCounter Audio::attachSampleProcessor( ssp::SampleStreamProcessorInstance sspInstance )
 {
+    // the audio callback must never block on a processor, whatever it was last used for
+    sspInstance->setOverflowPolicy( ssp::OverflowPolicy::Drop );
+
     const uint32_t commandCounter = m_mixThreadCommandsIssued++;
     m_sampleProcessorsToInstall.enqueue( sspInstance );
     m_mixThreadCommandQueue.emplace( MixThreadCommand::AttachSampleProcessor, commandCounter );
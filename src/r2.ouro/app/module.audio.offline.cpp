@@ -0,0 +1,270 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//
+//
+
+#include "pch.h"
+
+#include "app/module.audio.offline.h"
+
+#include "base/instrumentation.h"
+#include "spacetime/moment.h"
+#include "ssp/async.processor.h"
+
+
+namespace app {
+namespace module {
+
+// ---------------------------------------------------------------------------------------------------------------------
+OfflineAudio::OfflineAudio( const uint32_t sampleRate, const uint32_t blockSize )
+    : m_sampleRate( sampleRate )
+    , m_blockSize( blockSize )
+    , m_outputBuffer( blockSize )
+{
+    ABSL_ASSERT( m_sampleRate > 0 );
+    ABSL_ASSERT( m_blockSize > 0 );
+
+    // match the default gain the realtime Audio module starts with
+    m_outputSignal.m_linearGain = cycfi::q::lin_float( { -6.0f } );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+OfflineAudio::~OfflineAudio()
+{
+    detachAllSampleProcessors();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void OfflineAudio::attachSampleProcessor( ssp::SampleStreamProcessorInstance sspInstance )
+{
+    ABSL_ASSERT( sspInstance != nullptr );
+
+    blog::mix( "[offline] attaching SSP [{}]", sspInstance->getInstanceID().get() );
+
+    // we can render far faster than realtime, so have the processor hold us up rather than drop anything
+    sspInstance->setOverflowPolicy( ssp::OverflowPolicy::Wait );
+    m_sampleProcessors.emplace_back( std::move( sspInstance ) );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void OfflineAudio::detachSampleProcessor( ssp::StreamProcessorInstanceID sspID )
+{
+    const std::size_t processorsBefore = m_sampleProcessors.size();
+
+    base::erase_where( m_sampleProcessors, [=]( const ssp::SampleStreamProcessorInstance& ssp )
+        {
+            if ( ssp->getInstanceID() != sspID )
+                return false;
+
+            // put back the non-blocking default in case this processor is handed on to the realtime Audio module
+            ssp->setOverflowPolicy( ssp::OverflowPolicy::Drop );
+            return true;
+        });
+
+    if ( m_sampleProcessors.size() != processorsBefore )
+        blog::mix( "[offline] detaching SSP [{}]", sspID.get() );
+    else
+        blog::error::mix( "[offline] unable to detach SSP [{}]", sspID.get() );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void OfflineAudio::detachAllSampleProcessors()
+{
+    for ( auto& ssp : m_sampleProcessors )
+        ssp->setOverflowPolicy( ssp::OverflowPolicy::Drop );
+
+    m_sampleProcessors.clear();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t OfflineAudio::render(
+    MixerInterface& mixer,
+    const uint64_t samplesToRender,
+    const ProgressCallback& progressCallback )
+{
+    base::instr::ScopedEvent se( "OfflineAudio", "render", base::instr::PresetColour::Orange );
+
+    spacetime::Moment renderTimer;
+
+    uint64_t samplesRendered = 0;
+    while ( samplesRendered < samplesToRender )
+    {
+        const uint32_t blockSamples = static_cast<uint32_t>( std::min< uint64_t >( m_blockSize, samplesToRender - samplesRendered ) );
+
+        // same sequence as the realtime callback, minus the plugin stages and device interleave
+        mixer.update( m_outputBuffer, m_outputSignal, blockSamples, m_samplePos );
+
+        for ( auto& ssp : m_sampleProcessors )
+        {
+            ssp->appendSamples( m_outputBuffer.m_workingLR[0], m_outputBuffer.m_workingLR[1], blockSamples );
+        }
+
+        m_samplePos     += blockSamples;
+        samplesRendered += blockSamples;
+
+        if ( progressCallback && !progressCallback( samplesRendered ) )
+            break;
+    }
+
+    const double renderedSeconds = static_cast<double>( samplesRendered ) / static_cast<double>( m_sampleRate );
+    const double elapsedSeconds  = static_cast<double>( renderTimer.delta< std::chrono::microseconds >().count() ) * 1.0e-6;
+
+    m_lastRenderSpeedFactor = ( elapsedSeconds > 0 ) ? ( renderedSeconds / elapsedSeconds ) : 0;
+
+    return samplesRendered;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t OfflineAudio::renderSeconds(
+    MixerInterface& mixer,
+    const double secondsToRender,
+    const ProgressCallback& progressCallback )
+{
+    const uint64_t samplesToRender = static_cast<uint64_t>( std::llround( std::max( 0.0, secondsToRender ) * static_cast<double>( m_sampleRate ) ) );
+    return render( mixer, samplesToRender, progressCallback );
+}
+
+
+namespace {
+
+// samples carry their position in the stream, kept well inside the range of integers a float holds exactly
+static constexpr uint32_t cSequenceMask = ( 1U << 23 ) - 1;
+
+inline float sequenceToSample( const uint64_t position ) { return static_cast<float>( position & cSequenceMask ); }
+
+// ---------------------------------------------------------------------------------------------------------------------
+// writes the running sample position into the left channel and its negation into the right
+struct SequenceMixer final : public MixerInterface
+{
+    void update(
+        const Audio::OutputBuffer& outputBuffer,
+        const Audio::OutputSignal& outputSignal,
+        const uint32_t             samplesToWrite,
+        const uint64_t             samplePosition ) override
+    {
+        for ( uint32_t sI = 0; sI < samplesToWrite; sI++ )
+        {
+            outputBuffer.m_workingLR[0][sI] =  sequenceToSample( samplePosition + sI );
+            outputBuffer.m_workingLR[1][sI] = -outputBuffer.m_workingLR[0][sI];
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// buffered processor with a deliberately sluggish worker that checks every sample it is handed
+struct SequenceCheckingProcessor final : public ssp::ISampleStreamProcessor
+                                       , public ssp::AsyncBufferProcessorIQ24
+{
+    SequenceCheckingProcessor( const uint32_t bufferSampleSize, const std::chrono::microseconds simulatedWorkload )
+        : ssp::ISampleStreamProcessor( ssp::ISampleStreamProcessor::allocateNewInstanceID() )
+        , ssp::AsyncBufferProcessorIQ24( bufferSampleSize, "OfflineCheck" )
+        , m_simulatedWorkload( simulatedWorkload )
+    {
+        launchProcessorThread();
+    }
+
+    ~SequenceCheckingProcessor() override
+    {
+        terminateProcessorThread();
+    }
+
+    void appendSamples( float* buffer0, float* buffer1, const uint32_t sampleCount ) override
+    {
+        appendStereoSamples( buffer0, buffer1, sampleCount );
+    }
+
+    uint64_t getStorageUsageInBytes() const override { return 0; }
+
+    void setOverflowPolicy( const ssp::OverflowPolicy policy ) override
+    {
+        m_lastPolicy = policy;
+        ssp::AsyncBufferProcessorIQ24::setOverflowPolicy( policy );
+    }
+    uint64_t getOverflowSampleCount() const override { return ssp::AsyncBufferProcessorIQ24::getOverflowSampleCount(); }
+
+    // stop the worker and account for whatever was left sitting in the final partial page
+    void finish()
+    {
+        terminateProcessorThread();
+
+        auto* activeBuffer = getActiveBuffer();
+        if ( activeBuffer->m_currentSamples > 0 )
+            checkSequence( *activeBuffer );
+    }
+
+    void processBufferedSamplesFromThread( const base::IQ24Buffer& buffer ) override
+    {
+        checkSequence( buffer );
+        std::this_thread::sleep_for( m_simulatedWorkload );
+    }
+
+    void checkSequence( const base::IQ24Buffer& buffer )
+    {
+        for ( uint32_t sI = 0; sI < buffer.m_currentSamples; sI++ )
+        {
+            const float left  = buffer.m_interleavedFloat[( sI * 2 ) + 0];
+            const float right = buffer.m_interleavedFloat[( sI * 2 ) + 1];
+
+            if ( left != sequenceToSample( m_samplesProcessed ) || right != -left )
+                m_sequenceErrors++;
+
+            m_samplesProcessed++;
+        }
+    }
+
+    const std::chrono::microseconds m_simulatedWorkload;
+    ssp::OverflowPolicy             m_lastPolicy        = ssp::OverflowPolicy::Drop;
+
+    // worker-side accounting, only read once the worker has been stopped
+    uint64_t                        m_samplesProcessed  = 0;
+    uint64_t                        m_sequenceErrors    = 0;
+};
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+OfflineRenderCheckResult checkOfflineRender( const uint32_t sampleRate, const double secondsToRender )
+{
+    ABSL_ASSERT( sampleRate > 0 );
+
+    // a tenth of a second per page and a few ms of fake work on each; far quicker than realtime but far slower than
+    // the trivial mixer can produce samples, so the render is bound to spend time waiting on the ring
+    static constexpr uint32_t cBlockSize        = 512;
+    static constexpr auto     cWorkerWorkload   = std::chrono::microseconds( 4 * 1000 );
+
+    OfflineRenderCheckResult result;
+
+    auto processor = std::make_shared< SequenceCheckingProcessor >( sampleRate / 10, cWorkerWorkload );
+    {
+        SequenceMixer mixer;
+        OfflineAudio offlineAudio( sampleRate, cBlockSize );
+
+        offlineAudio.attachSampleProcessor( processor );
+
+        result.m_samplesRendered = offlineAudio.renderSeconds( mixer, secondsToRender );
+        result.m_speedFactor     = offlineAudio.getLastRenderSpeedFactor();
+
+        offlineAudio.detachSampleProcessor( processor->getInstanceID() );
+    }
+    processor->finish();
+
+    result.m_samplesProcessed   = processor->m_samplesProcessed;
+    result.m_samplesDropped     = processor->getOverflowSampleCount();
+    result.m_sequenceErrors     = processor->m_sequenceErrors;
+    result.m_policyRestored     = ( processor->m_lastPolicy == ssp::OverflowPolicy::Drop );
+
+    result.m_passed = ( result.m_samplesRendered > 0 ) &&
+                      ( result.m_samplesProcessed == result.m_samplesRendered ) &&
+                      ( result.m_samplesDropped == 0 ) &&
+                      ( result.m_sequenceErrors == 0 ) &&
+                      ( result.m_policyRestored );
+
+    return result;
+}
+
+} // namespace module
+} // namespace app
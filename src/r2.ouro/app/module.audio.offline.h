@@ -0,0 +1,98 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//  offline render host; drives a MixerInterface directly from the calling thread with no audio device
+//  involved, pushing results to attached sample processors as fast as the mixer can produce them
+//
+
+#pragma once
+
+#include "app/module.audio.h"
+
+namespace app {
+namespace module {
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct OfflineAudio
+{
+    DECLARE_NO_COPY_NO_MOVE( OfflineAudio );
+
+    // blockSize is the number of samples asked of the mixer per update(); this must not be larger than the
+    // maximum buffer size the mixer itself was created with
+    OfflineAudio( const uint32_t sampleRate, const uint32_t blockSize );
+    ~OfflineAudio();
+
+    // called after each block is rendered with the total number of samples produced so far;
+    // return false to stop rendering early
+    using ProgressCallback = std::function< bool( const uint64_t samplesRendered ) >;
+
+
+    ouro_nodiscard constexpr uint32_t getSampleRate() const { return m_sampleRate; }
+    ouro_nodiscard constexpr uint32_t getBlockSize() const { return m_blockSize; }
+
+    // running total of samples rendered, passed to the mixer as the sample position
+    ouro_nodiscard constexpr uint64_t getSamplePosition() const { return m_samplePos; }
+
+    ouro_nodiscard inline float getOutputSignalGain() const { return m_outputSignal.m_linearGain; }
+    inline void setOutputSignalGain( const float gain ) { m_outputSignal.m_linearGain = gain; }
+
+    // unlike the realtime Audio module, no command queue is required here; processors are attached directly
+    void attachSampleProcessor( ssp::SampleStreamProcessorInstance sspInstance );
+    void detachSampleProcessor( ssp::StreamProcessorInstanceID sspID );
+    void detachAllSampleProcessors();
+
+    // run the mixer for the given number of samples, blocks at a time; the final block will be shortened to land
+    // exactly on the requested count. returns the number of samples actually rendered
+    uint64_t render(
+        MixerInterface& mixer,
+        const uint64_t samplesToRender,
+        const ProgressCallback& progressCallback = nullptr );
+
+    // convenience version of the above, working in seconds
+    uint64_t renderSeconds(
+        MixerInterface& mixer,
+        const double secondsToRender,
+        const ProgressCallback& progressCallback = nullptr );
+
+    // how much faster than realtime the last render() call ran, eg. 40.0 == 40x realtime
+    ouro_nodiscard constexpr double getLastRenderSpeedFactor() const { return m_lastRenderSpeedFactor; }
+
+    // the most recently rendered block, for callers that want to inspect the output directly
+    ouro_nodiscard constexpr const Audio::OutputBuffer& getOutputBuffer() const { return m_outputBuffer; }
+
+private:
+
+    uint32_t                            m_sampleRate;
+    uint32_t                            m_blockSize;
+    uint64_t                            m_samplePos = 0;
+    double                              m_lastRenderSpeedFactor = 0;
+
+    Audio::OutputBuffer                 m_outputBuffer;
+    Audio::OutputSignal                 m_outputSignal;
+
+    Audio::SampleProcessorInstances     m_sampleProcessors;
+};
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// developer check; renders a synthetic sample-counting mixer through OfflineAudio into a buffered processor whose
+// worker is much slower than the render, so the producer has to wait on it. every sample is checked on arrival,
+// and the processor must be back on OverflowPolicy::Drop once detached so it is safe to hand to the audio callback
+//
+struct OfflineRenderCheckResult
+{
+    uint64_t    m_samplesRendered       = 0;
+    uint64_t    m_samplesProcessed      = 0;
+    uint64_t    m_samplesDropped        = 0;
+    uint64_t    m_sequenceErrors        = 0;
+    double      m_speedFactor           = 0;        // render speed vs realtime, eg. 40.0 == 40x realtime
+    bool        m_policyRestored        = false;    // processor was returned to OverflowPolicy::Drop on detach
+    bool        m_passed                = false;
+};
+OfflineRenderCheckResult checkOfflineRender( const uint32_t sampleRate, const double secondsToRender );
+
+} // namespace module
+} // namespace app
@@ -0,0 +1,259 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//
+
+#include "pch.h"
+
+#include "base/eventbus.h"
+
+namespace base {
+
+namespace {
+
+CREATE_EVENT_BEGIN( BenchmarkEventA )
+    BenchmarkEventA( const uint64_t value ) : m_value( value ) {}
+    uint64_t m_value;
+CREATE_EVENT_END()
+
+CREATE_EVENT_BEGIN( BenchmarkEventB )
+    BenchmarkEventB( const uint64_t value ) : m_value( value ) {}
+    uint64_t m_value;
+    std::array< uint64_t, 4 > m_padding;
+CREATE_EVENT_END()
+
+CREATE_EVENT_BEGIN( BenchmarkEventC )
+    BenchmarkEventC( const uint64_t value ) : m_value( value ) {}
+    uint64_t m_value;
+    std::string_view m_label;
+CREATE_EVENT_END()
+
+// ---------------------------------------------------------------------------------------------------------------------
+// the event bus as it was before the pipe table / listener array rework; pipes and listeners in hash maps, listeners
+// copied out per dispatch and events recovered via dynamic_cast
+//
+struct LegacyEventBus
+{
+    using EventListenerFn = std::function< void( const IEvent& ) >;
+    using EventQueue      = mcc::ConcurrentQueue< IEvent* >;
+    using ListenerMap     = absl::flat_hash_map< EventListenerID, EventListenerFn >;
+
+    struct EventPipe
+    {
+        EventPipe( const EventID& id, const std::size_t eventSize, const std::size_t maxEvents )
+            : m_id( id )
+            , m_eventMemoryQueue( maxEvents )
+        {
+            m_eventMemoryBlock = mem::alloc16To<uint8_t>( maxEvents * eventSize, 0 );
+
+            uint8_t* blockAddress = m_eventMemoryBlock;
+            for ( std::size_t evI = 0; evI < maxEvents; evI++ )
+            {
+                m_eventMemoryQueue.enqueue( blockAddress );
+                blockAddress += eventSize;
+            }
+        }
+        ~EventPipe()
+        {
+            mem::free16( m_eventMemoryBlock );
+        }
+
+        EventID                             m_id;
+        EventQueue                          m_queue;
+        ListenerMap                         m_listeners;
+        mcc::ConcurrentQueue< uint8_t* >    m_eventMemoryQueue;
+        uint8_t*                            m_eventMemoryBlock;
+    };
+
+    ~LegacyEventBus()
+    {
+        flushQueues( false );
+        for ( auto kv : m_pipes )
+            delete kv.second;
+    }
+
+    void registerEventID( const EventID& id, const std::size_t eventSize, const std::size_t maxEvents )
+    {
+        m_pipes.emplace( id, new EventPipe( id, eventSize, maxEvents ) );
+    }
+
+    template< typename _eventType, typename... Args >
+    bool send( Args&&... args )
+    {
+        auto it = m_pipes.find( _eventType::ID );
+        if ( it == m_pipes.end() )
+            return false;
+
+        EventPipe* pipe = it->second;
+
+        uint8_t* eventMemoryBlock = nullptr;
+        if ( !pipe->m_eventMemoryQueue.try_dequeue( eventMemoryBlock ) )
+            return false;
+
+        memset( eventMemoryBlock, 0, sizeof( _eventType ) );
+        _eventType* eventInstance = new (eventMemoryBlock) _eventType( std::forward<Args>( args )... );
+
+        pipe->m_queue.enqueue( eventInstance );
+        return true;
+    }
+
+    void addListener( const EventID& id, const EventListenerFn& mainThreadFn )
+    {
+        m_pipes[id]->m_listeners.emplace( EventListenerID( m_listenerUID++ ), mainThreadFn );
+    }
+
+    void flushQueues( bool notifyListeners )
+    {
+        for ( auto kv : m_pipes )
+        {
+            EventPipe* pipe = kv.second;
+
+            IEvent* eventInstance;
+            while ( pipe->m_queue.try_dequeue( eventInstance ) )
+            {
+                if ( notifyListeners )
+                {
+                    for ( auto lst : pipe->m_listeners )
+                    {
+                        lst.second( *eventInstance );
+                    }
+                }
+                eventInstance->~IEvent();
+                pipe->m_eventMemoryQueue.enqueue( (uint8_t*)eventInstance );
+            }
+        }
+    }
+
+    absl::flat_hash_map< EventID, EventPipe* >  m_pipes;
+    uint32_t                                    m_listenerUID = 0;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// per-type sums of everything the listeners were handed, so the two buses can be checked against each other
+struct DeliveryTotals
+{
+    uint64_t    m_a = 0;
+    uint64_t    m_b = 0;
+    uint64_t    m_c = 0;
+
+    bool operator == ( const DeliveryTotals& rhs ) const = default;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+template< typename _busType, typename _sendFn >
+void sendBenchmarkEvents( _busType& bus, const uint64_t eventCount, _sendFn&& sendFn )
+{
+    for ( uint64_t eI = 0; eI < eventCount; eI++ )
+    {
+        switch ( eI % 3 )
+        {
+            case 0: sendFn.template operator()< events::BenchmarkEventA >( bus, eI ); break;
+            case 1: sendFn.template operator()< events::BenchmarkEventB >( bus, eI ); break;
+            case 2: sendFn.template operator()< events::BenchmarkEventC >( bus, eI ); break;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+EventBusBenchmarkResult runBenchmarkPass( const uint32_t listenersPerEvent, const uint64_t eventsPerPass )
+{
+    using Clock = std::chrono::steady_clock;
+
+    const auto elapsedMs = []( const Clock::time_point& since )
+    {
+        return std::chrono::duration< double, std::milli >( Clock::now() - since ).count();
+    };
+
+    // every event has to fit in the pools at once as the whole batch is sent before anything is dispatched
+    const std::size_t poolSize = static_cast<std::size_t>( eventsPerPass / 3 ) + 1;
+
+    const auto sendToBus = []< typename _eventType, typename _busType >( _busType& bus, const uint64_t value )
+    {
+        bus.template send< _eventType >( value );
+    };
+
+    EventBusBenchmarkResult result;
+    result.m_listenersPerEvent  = listenersPerEvent;
+    result.m_eventsSent         = eventsPerPass;
+
+    DeliveryTotals legacyTotals;
+    {
+        LegacyEventBus legacyBus;
+        legacyBus.registerEventID( events::BenchmarkEventA::ID, sizeof( events::BenchmarkEventA ), poolSize );
+        legacyBus.registerEventID( events::BenchmarkEventB::ID, sizeof( events::BenchmarkEventB ), poolSize );
+        legacyBus.registerEventID( events::BenchmarkEventC::ID, sizeof( events::BenchmarkEventC ), poolSize );
+
+        for ( uint32_t lI = 0; lI < listenersPerEvent; lI++ )
+        {
+            legacyBus.addListener( events::BenchmarkEventA::ID, [&]( const IEvent& eventRef )
+                {
+                    legacyTotals.m_a += dynamic_cast<const events::BenchmarkEventA*>( &eventRef )->m_value;
+                });
+            legacyBus.addListener( events::BenchmarkEventB::ID, [&]( const IEvent& eventRef )
+                {
+                    legacyTotals.m_b += dynamic_cast<const events::BenchmarkEventB*>( &eventRef )->m_value;
+                });
+            legacyBus.addListener( events::BenchmarkEventC::ID, [&]( const IEvent& eventRef )
+                {
+                    legacyTotals.m_c += dynamic_cast<const events::BenchmarkEventC*>( &eventRef )->m_value;
+                });
+        }
+
+        const auto sendStart = Clock::now();
+        sendBenchmarkEvents( legacyBus, eventsPerPass, sendToBus );
+        result.m_legacySendMs = elapsedMs( sendStart );
+
+        const auto dispatchStart = Clock::now();
+        legacyBus.flushQueues( true );
+        result.m_legacyDispatchMs = elapsedMs( dispatchStart );
+    }
+
+    DeliveryTotals currentTotals;
+    {
+        EventBus currentBus;
+
+        // registration log spam is fine, this only runs on request
+        std::ignore = currentBus.registerEventID( events::BenchmarkEventA::ID, sizeof( events::BenchmarkEventA ), poolSize );
+        std::ignore = currentBus.registerEventID( events::BenchmarkEventB::ID, sizeof( events::BenchmarkEventB ), poolSize );
+        std::ignore = currentBus.registerEventID( events::BenchmarkEventC::ID, sizeof( events::BenchmarkEventC ), poolSize );
+
+        for ( uint32_t lI = 0; lI < listenersPerEvent; lI++ )
+        {
+            std::ignore = currentBus.addListener< events::BenchmarkEventA >( [&]( const events::BenchmarkEventA& evt ) { currentTotals.m_a += evt.m_value; } );
+            std::ignore = currentBus.addListener< events::BenchmarkEventB >( [&]( const events::BenchmarkEventB& evt ) { currentTotals.m_b += evt.m_value; } );
+            std::ignore = currentBus.addListener< events::BenchmarkEventC >( [&]( const events::BenchmarkEventC& evt ) { currentTotals.m_c += evt.m_value; } );
+        }
+
+        const auto sendStart = Clock::now();
+        sendBenchmarkEvents( currentBus, eventsPerPass, sendToBus );
+        result.m_currentSendMs = elapsedMs( sendStart );
+
+        const auto dispatchStart = Clock::now();
+        currentBus.mainThreadDispatch();
+        result.m_currentDispatchMs = elapsedMs( dispatchStart );
+    }
+
+    result.m_resultsMatch = ( legacyTotals == currentTotals );
+    return result;
+}
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+std::vector< EventBusBenchmarkResult > benchmarkEventBus( const uint64_t eventsPerPass )
+{
+    static constexpr uint32_t cListenerCounts[] = { 1, 4, 16 };
+
+    std::vector< EventBusBenchmarkResult > results;
+    results.reserve( std::size( cListenerCounts ) );
+
+    for ( const uint32_t listenerCount : cListenerCounts )
+        results.emplace_back( runBenchmarkPass( listenerCount, eventsPerPass ) );
+
+    return results;
+}
+
+} // namespace base
@@ -9,6 +9,7 @@
 #include "pch.h"
 
 #include "base/eventbus.h"
+#include "base/instrumentation.h"
 
 
 namespace base {
@@ -16,6 +17,9 @@ namespace base {
 // ---------------------------------------------------------------------------------------------------------------------
 EventBus::EventBus()
 {
+    for ( auto& slot : m_pipeTable )
+        slot.store( nullptr, std::memory_order_relaxed );
+
     m_pipes.reserve( 32 );
     m_alive = true;
 }
@@ -29,9 +33,9 @@ EventBus::~EventBus()
     flushQueues( false );
 
     // rip down pipes
-    for ( auto kv : m_pipes )
+    for ( EventPipe* pipe : m_pipes )
     {
-        delete kv.second;
+        delete pipe;
     }
 
     m_pipes.clear();
@@ -40,15 +44,30 @@ EventBus::~EventBus()
 // ---------------------------------------------------------------------------------------------------------------------
 absl::Status EventBus::registerEventID( const EventID& id, const std::size_t eventSize, const std::size_t maxEvents )
 {
-    if ( m_pipes.contains( id ) )
+    // find the first free slot along this ID's probe sequence, checking for duplicates on the way
+    std::size_t slot = ( id.uid() & cPipeTableMask );
+    for ( std::size_t probe = 0; probe < cMaxEventTypes; probe++, slot = ( slot + 1 ) & cPipeTableMask )
+    {
+        const EventPipe* existingPipe = m_pipeTable[slot].load( std::memory_order_relaxed );
+        if ( existingPipe == nullptr )
+            break;
+
+        if ( existingPipe->m_id == id )
+        {
+            return absl::AlreadyExistsError(
+                fmt::format( FMTX( "EventBus::Register with multiple ids ({}, [{}])" ), id.name(), id.uid() ) );
+        }
+    }
+    if ( m_pipes.size() >= cMaxEventTypes )
     {
-        return absl::AlreadyExistsError(
-            fmt::format( FMTX( "EventBus::Register with multiple ids ({}, [{}])" ), id.name(), id.uid() ) );
+        return absl::ResourceExhaustedError(
+            fmt::format( FMTX( "EventBus::Register cannot add ({}), all {} event slots are in use" ), id.name(), cMaxEventTypes ) );
     }
 
     EventPipe* pipe = new EventPipe( id, eventSize, maxEvents );
 
-    m_pipes.emplace( id, pipe );
+    m_pipes.emplace_back( pipe );
+    m_pipeTable[slot].store( pipe, std::memory_order_release );
     return absl::OkStatus();
 }
 
@@ -59,8 +78,14 @@ EventListenerID EventBus::addListener( const EventID& id, const EventListenerFn&
     if ( pipe )
     {
         EventListenerID newListenerID = EventListenerID( m_listenerUID++ );
-        pipe->m_listeners.emplace( newListenerID, mainThreadFn );
-        m_registeredListenerIDs.emplace( newListenerID, id );
+
+        // can't grow the listener array while it is being walked
+        if ( m_dispatching )
+            m_pendingListeners.emplace_back( pipe, Listener{ newListenerID, mainThreadFn } );
+        else
+            pipe->m_listeners.emplace_back( Listener{ newListenerID, mainThreadFn } );
+
+        m_registeredListenerIDs.emplace( newListenerID, pipe );
         return newListenerID;
     }
     return EventListenerID::invalid();
@@ -73,15 +98,30 @@ absl::Status EventBus::removeListener( const EventListenerID& listener )
     if ( it == m_registeredListenerIDs.end() )
         return absl::NotFoundError( "EventBus::RemoveListener - no registered listener found" );
 
-    EventID listenerEventID = it->second;
-    EventPipe* pipe = getPipeByID( listenerEventID );
-    if ( !pipe )
+    EventPipe* pipe = it->second;
+    m_registeredListenerIDs.erase( it );
+
+    // might still be waiting to be added
+    const auto pendingIt = std::find_if( m_pendingListeners.begin(), m_pendingListeners.end(),
+        [&]( const auto& pending ) { return pending.second.m_id == listener; } );
+    if ( pendingIt != m_pendingListeners.end() )
     {
-        return absl::NotFoundError( fmt::format( FMTX( "EventBus::RemoveListener - event ID [{}] not found" ), listenerEventID.name() ) );
+        m_pendingListeners.erase( pendingIt );
+        return absl::OkStatus();
     }
 
-    pipe->m_listeners.erase( listener );
-    m_registeredListenerIDs.erase( listener );
+    for ( Listener& entry : pipe->m_listeners )
+    {
+        if ( entry.m_id == listener )
+        {
+            // mid-dispatch the array has to stay put; mark the entry dead and tidy up afterwards
+            entry.m_removed = true;
+            pipe->m_listenersNeedCompacting = true;
+            break;
+        }
+    }
+    if ( !m_dispatching )
+        compactListeners( *pipe );
 
     return absl::OkStatus();
 }
@@ -92,44 +132,156 @@ void EventBus::mainThreadDispatch()
     flushQueues( true );
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+void EventBus::getStatistics( std::vector< EventStatistics >& statistics ) const
+{
+    statistics.clear();
+    statistics.reserve( m_pipes.size() );
+
+    for ( const EventPipe* pipe : m_pipes )
+    {
+        EventStatistics& stats = statistics.emplace_back();
+
+        stats.m_name            = pipe->m_id.name();
+        stats.m_dropped         = pipe->m_statDropped.load( std::memory_order_relaxed );
+        stats.m_dispatched      = pipe->m_statDispatched;
+        stats.m_queueDepth      = pipe->m_statQueueDepth.load( std::memory_order_relaxed );
+        stats.m_sent            = stats.m_dispatched + stats.m_queueDepth;
+        stats.m_queueDepthPeak  = pipe->m_statQueueDepthPeak.load( std::memory_order_relaxed );
+        stats.m_listenerCount   = static_cast<uint32_t>( pipe->m_listeners.size() );
+        stats.m_dispatchTotalNs = pipe->m_statDispatchTotalNs;
+        stats.m_dispatchPeakNs  = pipe->m_statDispatchPeakNs;
+    }
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 void EventBus::flushQueues( bool notifyListeners )
 {
-    for ( auto kv : m_pipes )
+    // events are pulled out of each pipe this many at a time
+    static constexpr std::size_t cDispatchBatchSize = 32;
+
+    using Clock = std::chrono::steady_clock;
+
+    if ( m_pipes.empty() )
+        return;
+
+    // budgets only apply to real dispatches; a flush on shutdown has to empty everything
+    const uint32_t maximumEvents = notifyListeners ? m_dispatchBudget.m_maximumEvents : 0;
+    const uint32_t maximumUs     = notifyListeners ? m_dispatchBudget.m_maximumMicroseconds : 0;
+
+    const auto dispatchStart    = Clock::now();
+    const auto dispatchDeadline = dispatchStart + std::chrono::microseconds( maximumUs );
+
+    std::array< IEvent*, cDispatchBatchSize > eventBatch;
+    uint32_t eventsDispatched = 0;
+    bool budgetExhausted = false;
+
+    m_dispatching = true;
+
+    const std::size_t pipeCount = m_pipes.size();
+    std::size_t pipesVisited = 0;
+    for ( ; pipesVisited < pipeCount && !budgetExhausted; pipesVisited++ )
     {
-        EventPipe* pipe = kv.second;
+        EventPipe* pipe = m_pipes[( m_dispatchNextPipe + pipesVisited ) % pipeCount];
 
-        IEvent* eventInstance;
-        while ( pipe->m_queue.try_dequeue( eventInstance ) )
+        for ( ;; )
         {
-            if ( notifyListeners )
+            std::size_t batchSize = cDispatchBatchSize;
+            if ( maximumEvents > 0 )
+                batchSize = std::min< std::size_t >( batchSize, maximumEvents - eventsDispatched );
+
+            const std::size_t dequeued = pipe->m_queue.try_dequeue_bulk( eventBatch.data(), batchSize );
+            if ( dequeued == 0 )
+                break;
+
+            dispatchBatch( *pipe, eventBatch.data(), dequeued, notifyListeners );
+            eventsDispatched += static_cast<uint32_t>( dequeued );
+
+            if ( ( maximumEvents > 0 && eventsDispatched >= maximumEvents ) ||
+                 ( maximumUs > 0 && Clock::now() >= dispatchDeadline ) )
             {
-                for ( auto lst : pipe->m_listeners )
-                {
-                    lst.second( *eventInstance );
-                }
+                budgetExhausted = true;
+                break;
             }
-            eventInstance->~IEvent();
-            pipe->m_eventMemoryQueue.enqueue( (uint8_t*)eventInstance );
         }
     }
+
+    m_dispatching = false;
+
+    if ( notifyListeners )
+        base::instr::counter( "Events Dispatched", static_cast<double>( eventsDispatched ) );
+
+    // if we ran out of budget, pick up next time with the pipe *after* the one that used it up (pipesVisited already
+    // counts that one); starting on it again would let a single flooded pipe eat every budget while the rest starve,
+    // this way its leftovers wait their turn in the rotation like everything else
+    if ( budgetExhausted )
+    {
+        m_dispatchNextPipe = ( m_dispatchNextPipe + pipesVisited ) % pipeCount;
+
+        m_deferredOnLastDispatch = 0;
+        for ( const EventPipe* pipe : m_pipes )
+            m_deferredOnLastDispatch += pipe->m_statQueueDepth.load( std::memory_order_relaxed );
+    }
+    else
+    {
+        m_dispatchNextPipe = ( m_dispatchNextPipe + 1 ) % pipeCount;
+        m_deferredOnLastDispatch = 0;
+    }
+
+    // apply any listener changes made from inside callbacks
+    for ( EventPipe* pipe : m_pipes )
+    {
+        if ( pipe->m_listenersNeedCompacting )
+            compactListeners( *pipe );
+    }
+    for ( auto& pending : m_pendingListeners )
+    {
+        pending.first->m_listeners.emplace_back( std::move( pending.second ) );
+    }
+    m_pendingListeners.clear();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-base::EventBus::EventPipe* EventBus::getPipeByID( const EventID& id )
+void EventBus::dispatchBatch( EventPipe& pipe, IEvent** events, const std::size_t eventCount, const bool notifyListeners )
 {
-    if ( !m_alive )
-        return nullptr;
+    using Clock = std::chrono::steady_clock;
+
+    if ( notifyListeners )
+    {
+        const auto listenersStart = Clock::now();
 
-    auto it = m_pipes.find( id );
+        for ( std::size_t eI = 0; eI < eventCount; eI++ )
+        {
+            // walk by index; the array won't reallocate mid-dispatch but entries may be marked removed
+            const std::size_t listenerCount = pipe.m_listeners.size();
+            for ( std::size_t lI = 0; lI < listenerCount; lI++ )
+            {
+                const Listener& listener = pipe.m_listeners[lI];
+                if ( !listener.m_removed )
+                    listener.m_fn( *events[eI] );
+            }
+        }
 
-    // assuming it was registered properly, this shouldn't fail - if it breaks, check the event ID has been registered
-    ABSL_ASSERT( it != m_pipes.end() );
-    if ( it == m_pipes.end() )
-        return nullptr;
+        const uint64_t listenersNs = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - listenersStart ).count() );
+        pipe.m_statDispatchTotalNs += listenersNs;
+        pipe.m_statDispatchPeakNs   = std::max( pipe.m_statDispatchPeakNs, listenersNs / eventCount );
+        pipe.m_statDispatched      += eventCount;
+    }
 
-    EventPipe* pipe = it->second;
-    return pipe;
+    for ( std::size_t eI = 0; eI < eventCount; eI++ )
+    {
+        events[eI]->~IEvent();
+        pipe.m_eventMemoryQueue.enqueue( (uint8_t*)events[eI] );
+    }
+
+    pipe.m_statQueueDepth.fetch_sub( static_cast<uint32_t>( eventCount ), std::memory_order_relaxed );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void EventBus::compactListeners( EventPipe& pipe )
+{
+    std::erase_if( pipe.m_listeners, []( const Listener& entry ) { return entry.m_removed; } );
+    pipe.m_listenersNeedCompacting = false;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -157,4 +309,3 @@ EventBus::EventPipe::~EventPipe()
 }
 
 } // namespace base
-
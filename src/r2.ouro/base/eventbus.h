@@ -67,6 +67,15 @@ struct IEvent
 
 #define CREATE_EVENT_END()              }; }
 
+// listeners are only ever handed events from the pipe matching their ID, so the concrete type is known without
+// needing RTTI to go and check
+template< typename _eventType >
+ouro_nodiscard inline const _eventType& event_cast( const IEvent& eventRef )
+{
+    ABSL_ASSERT( eventRef.getID() == _eventType::ID );
+    return static_cast<const _eventType&>( eventRef );
+}
+
 // register the given event type, reporting to the log if it fails
 #define APP_EVENT_REGISTER_SPECIFIC( _evtname, _maxQueuedEvents )                                                                    \
         checkedCoreCall( fmt::format( "{{{}}} register [{}]", std::source_location::current().function_name(), #_evtname), [this]    \
@@ -81,10 +90,7 @@ struct IEvent
         events::_eventType::ID,                                                                                     \
         [this]( const base::IEvent& eventPtr )                                                                      \
         {                                                                                                           \
-            ABSL_ASSERT( eventPtr.getID() == events::_eventType::ID );                                              \
-            const events::_eventType* riffChangeEvent = dynamic_cast<const events::_eventType*>(&eventPtr);         \
-            ABSL_ASSERT( riffChangeEvent != nullptr );                                                              \
-            event_##_eventType( riffChangeEvent );                                                                  \
+            event_##_eventType( &base::event_cast< events::_eventType >( eventPtr ) );                              \
         })
 
 #define APP_EVENT_UNBIND( _eventType )                                                                                   \
@@ -97,6 +103,10 @@ struct IEvent
 // ---------------------------------------------------------------------------------------------------------------------
 // the controlling class for marshalling events
 //
+// each registered event ID gets a pipe holding a fixed pool of event-sized memory blocks, a lockfree queue of sent
+// events and a flat array of listeners. pipes live in a fixed open-addressed table keyed off the compile-time ID hash,
+// so send() finds its pipe in (almost always) one probe with no locking or allocation
+//
 struct EventBus
 {
     DECLARE_NO_COPY_NO_MOVE( EventBus );
@@ -106,13 +116,17 @@ struct EventBus
 
     using EventListenerFn = std::function< void( const IEvent& ) >;
 
+    // upper limit on the number of distinct event IDs a bus can carry
+    static constexpr std::size_t cMaxEventTypes = 256;
+
     // any event ID intending to be used needs to be registered upfront so 
     // that the appropriate data-structures are all prepared in advance;
     // returns false if it was already registered
     absl::Status registerEventID( const EventID& id, const std::size_t eventSize, const std::size_t maxEvents );
 
 
-    // can send from any thread; returns false if bus is not alive (in process of terminating)
+    // can send from any thread; returns false if bus is not alive (in process of terminating) or the event's
+    // pool is exhausted because the main thread has fallen too far behind
     template< typename _eventType, typename... Args >
     bool send( Args&&... args )
     {
@@ -121,12 +135,16 @@ struct EventBus
         if ( pipe )
         {
             uint8_t* eventMemoryBlock = nullptr;
-            const bool eventMemoryOk = pipe->m_eventMemoryQueue.try_dequeue( eventMemoryBlock );
-            ABSL_ASSERT( eventMemoryOk );
+            if ( !pipe->m_eventMemoryQueue.try_dequeue( eventMemoryBlock ) )
+            {
+                pipe->m_statDropped.fetch_add( 1, std::memory_order_relaxed );
+                return false;
+            }
 
             memset( eventMemoryBlock, 0, sizeof( _eventType ) );
             _eventType* eventInstance = new (eventMemoryBlock) _eventType( std::forward<Args>( args )... );
 
+            pipe->noteSent();
             pipe->m_queue.enqueue( eventInstance );
             return true;
         }
@@ -138,9 +156,50 @@ struct EventBus
     ouro_nodiscard EventListenerID addListener( const EventID& id, const EventListenerFn& mainThreadFn );
     absl::Status removeListener( const EventListenerID& listener );
 
+    // typed listener; the event arrives already cast to its concrete type
+    template< typename _eventType >
+    ouro_nodiscard EventListenerID addListener( std::function< void( const _eventType& ) > mainThreadFn )
+    {
+        return addListener( _eventType::ID, [fn = std::move( mainThreadFn )]( const IEvent& eventRef )
+            {
+                fn( event_cast< _eventType >( eventRef ) );
+            });
+    }
+
+
+    // limits on how much work a single mainThreadDispatch() call will do; anything left over stays queued for the
+    // next call. zero means unlimited. the limits are checked between batches so may overshoot by a batch's worth
+    struct DispatchBudget
+    {
+        uint32_t    m_maximumEvents         = 0;
+        uint32_t    m_maximumMicroseconds   = 0;
+    };
+
+    void setDispatchBudget( const DispatchBudget& budget ) { m_dispatchBudget = budget; }
+    ouro_nodiscard const DispatchBudget& getDispatchBudget() const { return m_dispatchBudget; }
+
     // call from main thread to pump any waiting messages
     void mainThreadDispatch();
 
+    // number of events that were still queued when the last dispatch ran out of budget
+    ouro_nodiscard uint32_t getDeferredOnLastDispatch() const { return m_deferredOnLastDispatch; }
+
+
+    // per-event-ID running totals; safe to read from the main thread while other threads are sending
+    struct EventStatistics
+    {
+        const char*     m_name              = nullptr;
+        uint64_t        m_sent              = 0;
+        uint64_t        m_dropped           = 0;    // send() calls that failed due to the event pool being empty
+        uint64_t        m_dispatched        = 0;
+        uint32_t        m_queueDepth        = 0;    // events sent but not yet dispatched
+        uint32_t        m_queueDepthPeak    = 0;
+        uint32_t        m_listenerCount     = 0;
+        uint64_t        m_dispatchTotalNs   = 0;    // time spent in listeners
+        uint64_t        m_dispatchPeakNs    = 0;    // per-event cost of the slowest batch; events are timed a batch at a time
+    };
+    void getStatistics( std::vector< EventStatistics >& statistics ) const;
+
 private:
 
     void flushQueues( bool notifyListeners );
@@ -153,7 +212,15 @@ private:
 
 
     using EventQueue   = mcc::ConcurrentQueue< IEvent* >;
-    using ListenerMap  = absl::flat_hash_map< EventListenerID, EventListenerFn >;
+
+    struct Listener
+    {
+        EventListenerID     m_id;
+        EventListenerFn     m_fn;
+        bool                m_removed = false;      // set if removed during dispatch, the entry goes on the next compaction;
+                                                    // the function is kept alive as it may be the one currently running
+    };
+    using ListenerArray = std::vector< Listener >;
 
     // structure created on Register() to manage a single ID
     // holds all data for event dispatch and is guaranteed to exist until bus dtor
@@ -167,27 +234,100 @@ private:
         EventPipe( const EventID& id, const std::size_t eventSize, const std::size_t maxEvents );
         ~EventPipe();
 
+        // sends are counted implicitly as dispatched + still-queued, so this is the only counter a sender has to bump
+        inline void noteSent()
+        {
+            const uint32_t depth = m_statQueueDepth.fetch_add( 1, std::memory_order_relaxed ) + 1;
+            uint32_t peak = m_statQueueDepthPeak.load( std::memory_order_relaxed );
+            while ( depth > peak && !m_statQueueDepthPeak.compare_exchange_weak( peak, depth, std::memory_order_relaxed ) ) {}
+        }
+
         EventID             m_id;
         EventQueue          m_queue;
-        ListenerMap         m_listeners;
+        ListenerArray       m_listeners;
+        bool                m_listenersNeedCompacting = false;
 
         MemoryBlockQueue    m_eventMemoryQueue;
         uint8_t*            m_eventMemoryBlock;
+
+        // counters touched by senders
+        std::atomic_uint64_t    m_statDropped           = 0;
+        std::atomic_uint32_t    m_statQueueDepth        = 0;
+        std::atomic_uint32_t    m_statQueueDepthPeak    = 0;
+
+        // counters only touched on the main thread
+        uint64_t                m_statDispatched        = 0;
+        uint64_t                m_statDispatchTotalNs   = 0;
+        uint64_t                m_statDispatchPeakNs    = 0;
     };
 
-    EventPipe* getPipeByID( const EventID& id );
+    // table of pipes, indexed by the bottom bits of the event ID hash with linear probing on collision
+    static constexpr std::size_t cPipeTableMask = cMaxEventTypes - 1;
+    static_assert( ( cMaxEventTypes & cPipeTableMask ) == 0, "pipe table size must be a power of two" );
+
+    inline EventPipe* getPipeByID( const EventID& id )
+    {
+        if ( !m_alive.load( std::memory_order_acquire ) )
+            return nullptr;
 
-    using EventPipeByID       = absl::flat_hash_map< EventID, EventPipe* >;
-    using EventIDByListenerID = absl::flat_hash_map< EventListenerID, EventID >;
+        for ( std::size_t probe = 0, slot = ( id.uid() & cPipeTableMask ); probe < cMaxEventTypes; probe++, slot = ( slot + 1 ) & cPipeTableMask )
+        {
+            EventPipe* pipe = m_pipeTable[slot].load( std::memory_order_acquire );
+
+            // assuming it was registered properly, this shouldn't fail - if it breaks, check the event ID has been registered
+            ABSL_ASSERT( pipe != nullptr );
+            if ( pipe == nullptr )
+                return nullptr;
+
+            if ( pipe->m_id == id )
+                return pipe;
+        }
+        return nullptr;
+    }
 
-    EventPipeByID           m_pipes;
-    EventIDByListenerID     m_registeredListenerIDs;
+    // run listeners for a batch of events pulled from a pipe, returning them to the pool afterwards
+    void dispatchBatch( EventPipe& pipe, IEvent** events, std::size_t eventCount, bool notifyListeners );
 
+    void compactListeners( EventPipe& pipe );
+
+
+    using EventPipeTable        = std::array< std::atomic< EventPipe* >, cMaxEventTypes >;
+    using EventPipeList         = std::vector< EventPipe* >;
+    using EventPipeByListenerID = absl::flat_hash_map< EventListenerID, EventPipe* >;
+    using PendingListeners      = std::vector< std::pair< EventPipe*, Listener > >;
+
+    EventPipeTable          m_pipeTable;
+    EventPipeList           m_pipes;                    // every registered pipe, in registration order
+    EventPipeByListenerID   m_registeredListenerIDs;
+
+    // listeners added from inside a callback are held back until the dispatch loop is done with the arrays
+    bool                    m_dispatching = false;
+    PendingListeners        m_pendingListeners;
+
+    DispatchBudget          m_dispatchBudget;
+    std::size_t             m_dispatchNextPipe = 0;     // round-robin start point, so a budget doesn't starve later pipes
+    uint32_t                m_deferredOnLastDispatch = 0;
 };
 using EventBusPtr = std::shared_ptr<EventBus>;
 using EventBusWeakPtr = std::weak_ptr<EventBus>;
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// developer check; time the same synthetic workload through the EventBus and through a replica of the original
+// map-of-std::function / dynamic_cast design it replaced
+struct EventBusBenchmarkResult
+{
+    uint32_t    m_listenersPerEvent     = 0;
+    uint64_t    m_eventsSent            = 0;
+    double      m_legacySendMs          = 0;
+    double      m_legacyDispatchMs      = 0;
+    double      m_currentSendMs         = 0;
+    double      m_currentDispatchMs     = 0;
+    bool        m_resultsMatch          = false;    // both buses delivered the same events to the same listeners
+};
+std::vector< EventBusBenchmarkResult > benchmarkEventBus( uint64_t eventsPerPass );
+
+
 
 // ---------------------------------------------------------------------------------------------------------------------
 // 'client' wrapper for the bus that only allows for Send'ing, designed for passing around to 
@@ -18,41 +18,404 @@
 
 #include "Superluminal/PerformanceAPI_capi.h"
 
+#endif // OURO_FEATURE_SUPERLUMINAL
+
+
 namespace base {
 namespace instr {
 
+namespace {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// built-in trace capture internals
+
+// the only thing the instrumentation calls look at when capture is off
+std::atomic_bool gCaptureEnabled = false;
+
+using TraceClock = std::chrono::steady_clock;
+
+enum class RecordType : uint8_t
+{
+    Begin,
+    End,
+    Counter
+};
+
+struct TraceRecord
+{
+    // Begin contexts are copied inline, filling the rest of a cache line; they tend to be short dynamic labels (sample
+    // counts, IDs) built on the stack, so they can't be kept by pointer like the names are
+    static constexpr std::size_t cContextCapacity = 64 - ( sizeof( int64_t ) + sizeof( const char* ) + sizeof( double ) + sizeof( RecordType ) );
+
+    int64_t             m_timestampNs;
+    const char*         m_name;
+    double              m_value;                        // Counter
+    RecordType          m_type;
+    char                m_context[cContextCapacity];    // Begin, nul-terminated and possibly truncated; empty if none
+};
+static_assert( sizeof( TraceRecord ) == 64 );
+
+// ---------------------------------------------------------------------------------------------------------------------
+// single-producer single-consumer record buffer for one thread; the owning thread writes, writeCapture() reads
+struct ThreadTrace
+{
+    DECLARE_NO_COPY_NO_MOVE( ThreadTrace );
+
+    static constexpr uint64_t cRecordCapacity   = 1 << 16;      // 4mb of records per thread, allocated on first use
+    static constexpr uint64_t cRecordMask       = cRecordCapacity - 1;
+
+    ThreadTrace( const uint32_t traceThreadID )
+        : m_traceThreadID( traceThreadID )
+    {}
+
+    ~ThreadTrace()
+    {
+        delete[] m_records.load( std::memory_order_relaxed );
+    }
+
+    const uint32_t                  m_traceThreadID;
+    std::string                     m_name;                         // guarded by the registry mutex
+
+    std::atomic< TraceRecord* >     m_records           = nullptr;
+    alignas(64) std::atomic_uint64_t m_writeIndex       = 0;
+    alignas(64) std::atomic_uint64_t m_readIndex        = 0;
+    std::atomic_uint64_t            m_droppedRecords    = 0;
+    std::atomic_bool                m_retired           = false;    // owning thread has exited
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct TraceRegistry
+{
+    std::mutex                                  m_mutex;
+    std::vector< std::unique_ptr< ThreadTrace > > m_threads;
+    uint32_t                                    m_nextTraceThreadID = 1;
+
+    std::atomic_int64_t                         m_epochNs           = 0;
+
+    std::mutex                                  m_internMutex;
+    std::unordered_set< std::string >           m_internedNames;    // node-based, so pointers into it stay put
+};
+
+// deliberately never destroyed; threads can still be winding down and touching their trace data during static teardown
+TraceRegistry& getTraceRegistry()
+{
+    static TraceRegistry* registry = new TraceRegistry();
+    return *registry;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// per-thread link to its ThreadTrace, flagging it as retired when the thread goes away
+struct ThreadTraceHandle
+{
+    ~ThreadTraceHandle()
+    {
+        if ( m_trace != nullptr )
+            m_trace->m_retired.store( true, std::memory_order_release );
+    }
+
+    ThreadTrace*    m_trace = nullptr;
+};
+thread_local ThreadTraceHandle tlsThreadTrace;
+
+ThreadTrace& getCurrentThreadTrace()
+{
+    if ( tlsThreadTrace.m_trace == nullptr )
+    {
+        TraceRegistry& registry = getTraceRegistry();
+        std::scoped_lock< std::mutex > registryLock( registry.m_mutex );
+
+        // take the opportunity to drop any exited threads that have nothing left to write
+        std::erase_if( registry.m_threads, []( const std::unique_ptr< ThreadTrace >& threadTrace )
+            {
+                return threadTrace->m_retired.load( std::memory_order_acquire ) &&
+                       threadTrace->m_readIndex.load( std::memory_order_relaxed ) == threadTrace->m_writeIndex.load( std::memory_order_acquire );
+            });
+
+        tlsThreadTrace.m_trace = registry.m_threads.emplace_back( std::make_unique< ThreadTrace >( registry.m_nextTraceThreadID++ ) ).get();
+    }
+    return *tlsThreadTrace.m_trace;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void record( const RecordType type, const char* name, const char* context, const double value )
+{
+    ThreadTrace& threadTrace = getCurrentThreadTrace();
+
+    TraceRecord* records = threadTrace.m_records.load( std::memory_order_relaxed );
+    if ( records == nullptr )
+    {
+        // plain new rather than the rpmalloc-backed helpers, as this can be hit on threads that never set rpmalloc up
+        records = new TraceRecord[ThreadTrace::cRecordCapacity];
+        threadTrace.m_records.store( records, std::memory_order_release );
+    }
+
+    const uint64_t writeIndex = threadTrace.m_writeIndex.load( std::memory_order_relaxed );
+    if ( writeIndex - threadTrace.m_readIndex.load( std::memory_order_acquire ) >= ThreadTrace::cRecordCapacity )
+    {
+        threadTrace.m_droppedRecords.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+
+    TraceRecord& newRecord = records[writeIndex & ThreadTrace::cRecordMask];
+    newRecord.m_timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>( TraceClock::now().time_since_epoch() ).count();
+    newRecord.m_name        = name;
+    newRecord.m_type        = type;
+    newRecord.m_value       = value;
+
+    std::size_t contextLength = 0;
+    if ( context != nullptr )
+    {
+        contextLength = strnlen( context, TraceRecord::cContextCapacity - 1 );
+
+        // don't leave half a UTF-8 sequence at the end if we had to cut it short
+        while ( contextLength > 0 && ( static_cast<uint8_t>( context[contextLength] ) & 0xC0 ) == 0x80 )
+            contextLength--;
+
+        memcpy( newRecord.m_context, context, contextLength );
+    }
+    newRecord.m_context[contextLength] = 0;
+
+    threadTrace.m_writeIndex.store( writeIndex + 1, std::memory_order_release );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void appendJsonString( std::string& output, const char* text )
+{
+    output.push_back( '"' );
+    for ( const char* c = text; *c != 0; c++ )
+    {
+        switch ( *c )
+        {
+            case '"':   output += "\\\""; break;
+            case '\\':  output += "\\\\"; break;
+            case '\n':  output += "\\n";  break;
+            case '\t':  output += "\\t";  break;
+            default:
+                if ( static_cast<uint8_t>( *c ) < 0x20 )
+                    fmt::format_to( std::back_inserter( output ), FMTX( "\\u{:04x}" ), static_cast<uint32_t>( *c ) );
+                else
+                    output.push_back( *c );
+                break;
+        }
+    }
+    output.push_back( '"' );
+}
+
+} // anonymous namespace
+
+
+// ---------------------------------------------------------------------------------------------------------------------
 void setThreadName( const char* name )
 {
+#ifdef OURO_FEATURE_SUPERLUMINAL
     PerformanceAPI_SetCurrentThreadName( name );
+#endif // OURO_FEATURE_SUPERLUMINAL
+
+    // always noted down, so threads that started before a capture was enabled still get labelled
+    ThreadTrace& threadTrace = getCurrentThreadTrace();
+
+    std::scoped_lock< std::mutex > registryLock( getTraceRegistry().m_mutex );
+    threadTrace.m_name = name;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
 void eventBegin( const char* name, const char* context, uint8_t colorR, uint8_t colorG, uint8_t colorB )
 {
+#ifdef OURO_FEATURE_SUPERLUMINAL
     PerformanceAPI_BeginEvent( name, context, PERFORMANCEAPI_MAKE_COLOR( colorR, colorG, colorB ) );
+#endif // OURO_FEATURE_SUPERLUMINAL
+
+    if ( gCaptureEnabled.load( std::memory_order_relaxed ) )
+        record( RecordType::Begin, name, context, 0 );
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
 void eventEnd()
 {
+#ifdef OURO_FEATURE_SUPERLUMINAL
     PerformanceAPI_EndEvent();
+#endif // OURO_FEATURE_SUPERLUMINAL
+
+    if ( gCaptureEnabled.load( std::memory_order_relaxed ) )
+        record( RecordType::End, nullptr, nullptr, 0 );
 }
 
-} // namespace instr
-} // namespace base
+// ---------------------------------------------------------------------------------------------------------------------
+void counter( const char* name, double value )
+{
+    if ( gCaptureEnabled.load( std::memory_order_relaxed ) )
+        record( RecordType::Counter, name, nullptr, value );
+}
 
+// ---------------------------------------------------------------------------------------------------------------------
+const char* internName( std::string_view name )
+{
+    TraceRegistry& registry = getTraceRegistry();
+    std::scoped_lock< std::mutex > internLock( registry.m_internMutex );
+
+    return registry.m_internedNames.emplace( name ).first->c_str();
+}
+
+
+namespace trace {
 
 // ---------------------------------------------------------------------------------------------------------------------
-// NOP instrumentation
-#else
+void setCaptureEnabled( bool enabled )
+{
+    // timestamps in the output are relative to the first time capture was switched on
+    if ( enabled )
+    {
+        int64_t unsetEpoch = 0;
+        getTraceRegistry().m_epochNs.compare_exchange_strong( unsetEpoch,
+            std::chrono::duration_cast<std::chrono::nanoseconds>( TraceClock::now().time_since_epoch() ).count() );
+    }
 
-namespace base {
-namespace instr {
+    gCaptureEnabled.store( enabled, std::memory_order_relaxed );
+}
 
-// null stubs for no profiler
-void setThreadName( const char* name ) {}
-void eventBegin( const char* name, const char* context, uint8_t colorR, uint8_t colorG, uint8_t colorB ) {}
-void eventEnd() {}
+// ---------------------------------------------------------------------------------------------------------------------
+bool isCaptureEnabled()
+{
+    return gCaptureEnabled.load( std::memory_order_relaxed );
+}
 
+// ---------------------------------------------------------------------------------------------------------------------
+bool hasCapturedData()
+{
+    TraceRegistry& registry = getTraceRegistry();
+    std::scoped_lock< std::mutex > registryLock( registry.m_mutex );
+
+    for ( const auto& threadTrace : registry.m_threads )
+    {
+        if ( threadTrace->m_writeIndex.load( std::memory_order_acquire ) != threadTrace->m_readIndex.load( std::memory_order_relaxed ) )
+            return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status writeCapture( const fs::path& outputFile )
+{
+    // chrome trace-event format, https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    static constexpr uint32_t cProcessID = 1;
+
+    TraceRegistry& registry = getTraceRegistry();
+    const int64_t epochNs = registry.m_epochNs.load();
+
+    const auto toMicroseconds = [epochNs]( const int64_t timestampNs )
+    {
+        return static_cast<double>( timestampNs - epochNs ) * 0.001;
+    };
+
+    std::string traceJson;
+    traceJson.reserve( 1024 * 1024 );
+    traceJson += "{\"traceEvents\":[\n";
+    fmt::format_to( std::back_inserter( traceJson ), FMTX( "{{\"ph\":\"M\",\"pid\":{},\"name\":\"process_name\",\"args\":{{\"name\":\"OUROVEON\"}}}}" ), cProcessID );
+
+    uint64_t recordsWritten = 0;
+    uint64_t recordsDropped = 0;
+    {
+        std::scoped_lock< std::mutex > registryLock( registry.m_mutex );
+
+        for ( const auto& threadTrace : registry.m_threads )
+        {
+            const uint32_t tid = threadTrace->m_traceThreadID;
+
+            if ( !threadTrace->m_name.empty() )
+            {
+                fmt::format_to( std::back_inserter( traceJson ), FMTX( ",\n{{\"ph\":\"M\",\"pid\":{},\"tid\":{},\"name\":\"thread_name\",\"args\":{{\"name\":" ), cProcessID, tid );
+                appendJsonString( traceJson, threadTrace->m_name.c_str() );
+                traceJson += "}}";
+            }
+
+            recordsDropped += threadTrace->m_droppedRecords.exchange( 0, std::memory_order_relaxed );
+
+            const uint64_t readIndex  = threadTrace->m_readIndex.load( std::memory_order_relaxed );
+            const uint64_t writeIndex = threadTrace->m_writeIndex.load( std::memory_order_acquire );
+            if ( readIndex == writeIndex )
+                continue;
+
+            const TraceRecord* records = threadTrace->m_records.load( std::memory_order_acquire );
+
+            // each file should stand on its own; ends with no matching begin (from a scope that was already open
+            // when recording began) are skipped, and anything left open is closed off at the last timestamp seen
+            uint32_t openEvents = 0;
+            int64_t lastTimestampNs = epochNs;
+
+            for ( uint64_t index = readIndex; index < writeIndex; index++ )
+            {
+                const TraceRecord& traceRecord = records[index & ThreadTrace::cRecordMask];
+                const double timestampUs = toMicroseconds( traceRecord.m_timestampNs );
+                lastTimestampNs = traceRecord.m_timestampNs;
+
+                switch ( traceRecord.m_type )
+                {
+                    case RecordType::Begin:
+                    {
+                        openEvents++;
+                        fmt::format_to( std::back_inserter( traceJson ), FMTX( ",\n{{\"ph\":\"B\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},\"name\":" ), cProcessID, tid, timestampUs );
+                        appendJsonString( traceJson, traceRecord.m_name );
+                        if ( traceRecord.m_context[0] != 0 )
+                        {
+                            traceJson += ",\"args\":{\"context\":";
+                            appendJsonString( traceJson, traceRecord.m_context );
+                            traceJson += "}";
+                        }
+                        traceJson += "}";
+                    }
+                    break;
+
+                    case RecordType::End:
+                    {
+                        if ( openEvents == 0 )
+                            continue;
+
+                        openEvents--;
+                        fmt::format_to( std::back_inserter( traceJson ), FMTX( ",\n{{\"ph\":\"E\",\"pid\":{},\"tid\":{},\"ts\":{:.3f}}}" ), cProcessID, tid, timestampUs );
+                    }
+                    break;
+
+                    case RecordType::Counter:
+                    {
+                        fmt::format_to( std::back_inserter( traceJson ), FMTX( ",\n{{\"ph\":\"C\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},\"name\":" ), cProcessID, tid, timestampUs );
+                        appendJsonString( traceJson, traceRecord.m_name );
+                        fmt::format_to( std::back_inserter( traceJson ), FMTX( ",\"args\":{{\"value\":{}}}}}" ), traceRecord.m_value );
+                    }
+                    break;
+                }
+                recordsWritten++;
+            }
+            for ( ; openEvents > 0; openEvents-- )
+            {
+                fmt::format_to( std::back_inserter( traceJson ), FMTX( ",\n{{\"ph\":\"E\",\"pid\":{},\"tid\":{},\"ts\":{:.3f}}}" ), cProcessID, tid, toMicroseconds( lastTimestampNs ) );
+            }
+
+            // hand the space back to the thread
+            threadTrace->m_readIndex.store( writeIndex, std::memory_order_release );
+        }
+    }
+
+    fmt::format_to( std::back_inserter( traceJson ), FMTX( "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{{\"droppedRecords\":{}}}}}\n" ), recordsDropped );
+
+    std::error_code createDirError;
+    fs::create_directories( outputFile.parent_path(), createDirError );
+
+    std::ofstream traceFile( outputFile, std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( !traceFile.is_open() )
+        return absl::UnavailableError( fmt::format( FMTX( "unable to open [{}] to write trace capture" ), outputFile.string() ) );
+
+    traceFile.write( traceJson.data(), static_cast<std::streamsize>( traceJson.size() ) );
+    if ( !traceFile.good() )
+        return absl::DataLossError( fmt::format( FMTX( "failed writing trace capture to [{}]" ), outputFile.string() ) );
+
+    blog::core( FMTX( "wrote {} trace records to [{}]{}" ),
+        recordsWritten,
+        outputFile.string(),
+        ( recordsDropped > 0 ) ? fmt::format( FMTX( ", {} dropped as buffers were full" ), recordsDropped ) : "" );
+
+    return absl::OkStatus();
+}
+
+} // namespace trace
 } // namespace instr
 } // namespace base
-
-#endif
@@ -26,6 +26,38 @@ void setThreadName( const char* name );
 void eventBegin( const char* name, const char* context = nullptr, uint8_t colorR = 255, uint8_t colorG = 220, uint8_t colorB = 170 );
 void eventEnd();
 
+// ---------------------------------------------------------------------------------------------------------------------
+// plot a named value over time; only recorded by the built-in trace capture
+void counter( const char* name, double value );
+
+// ---------------------------------------------------------------------------------------------------------------------
+// event / counter names are recorded by pointer and only read back when a capture is written out; any that aren't
+// string literals should be passed through here first to get a copy that lives as long as the process. event contexts
+// are copied (and truncated) as they are recorded, so those can come from anywhere, stack buffers included
+const char* internName( std::string_view name );
+
+// ---------------------------------------------------------------------------------------------------------------------
+// built-in trace capture, available on all platforms and running alongside any external profiler hooked up above.
+// while enabled, events and counters are written into lock-free per-thread buffers; writeCapture() drains those into
+// a Chrome trace-event JSON file, viewable in ui.perfetto.dev or chrome://tracing. while disabled, each
+// instrumentation call costs a single relaxed atomic load
+//
+// per-thread buffers hold a fixed number of records; once one fills, that thread's records are dropped (and counted)
+// until the next writeCapture() makes room again
+//
+namespace trace {
+
+void setCaptureEnabled( bool enabled );
+ouro_nodiscard bool isCaptureEnabled();
+
+// true if anything has been recorded since the last write
+ouro_nodiscard bool hasCapturedData();
+
+// drain everything recorded so far out to the given file, overwriting it
+absl::Status writeCapture( const fs::path& outputFile );
+
+} // namespace trace
+
 // ---------------------------------------------------------------------------------------------------------------------
 enum class PresetColour
 {
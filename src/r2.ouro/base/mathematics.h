@@ -59,6 +59,14 @@ inline float wrapMax( const float x, const float max )
     return std::fmod( max + std::fmod( x, max ), max );
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+// wrap x -> [0,max), integer variant; correct for negative x, unlike plain %
+constexpr int64_t wrapMax( const int64_t x, const int64_t max )
+{
+    const int64_t result = x % max;
+    return ( result < 0 ) ? ( result + max ) : result;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 // wrap x -> [min,max) 
 inline float wrapMinMax( const float x, const float min, const float max )
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "base/utils.h"
+#include "buffer/mix.h"
 
 namespace base {
 
@@ -60,15 +61,7 @@ struct InterleavingQuantiseBuffer
 template<>
 inline void InterleavingQuantiseBuffer<int16_t, 16>::quantise()
 {
-    static constexpr float   fScaler16  = (float)0x7fffL;
-    static constexpr int32_t fInt16Max  = ( 0x7fffL        );
-    static constexpr int32_t fInt16Min  = ( -fInt16Max - 1 );
-
-    const auto totalStereoSamples = m_currentSamples * 2;
-    for ( size_t i = 0; i < totalStereoSamples; i++ )
-    {
-        m_interleavedQuant[i] = (int16_t)std::clamp( (int32_t)(m_interleavedFloat[i] * fScaler16), fInt16Min, fInt16Max );
-    }
+    buffer::quantise_float_to_int16( m_currentSamples * 2, m_interleavedFloat, m_interleavedQuant );
 }
 using IQ16Buffer = InterleavingQuantiseBuffer< int16_t, 16 >;
 
@@ -76,15 +69,7 @@ using IQ16Buffer = InterleavingQuantiseBuffer< int16_t, 16 >;
 template<>
 inline void InterleavingQuantiseBuffer<int32_t, 24>::quantise()
 {
-    static constexpr float   fScaler24  = (float)0x7fffffL;
-    static constexpr int32_t fInt24Max  = (  0x7fffffL     );
-    static constexpr int32_t fInt24Min  = ( -fInt24Max - 1 );
-
-    const auto totalStereoSamples = m_currentSamples * 2;
-    for ( size_t i = 0; i < totalStereoSamples; i++ )
-    {
-        m_interleavedQuant[i] = (int32_t)std::clamp( (int32_t)(m_interleavedFloat[i] * fScaler24), fInt24Min, fInt24Max );
-    }
+    buffer::quantise_float_to_int24( m_currentSamples * 2, m_interleavedFloat, m_interleavedQuant );
 }
 using IQ24Buffer = InterleavingQuantiseBuffer< int32_t, 24 >;
 
@@ -0,0 +1,695 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//
+//
+
+#include "pch.h"
+
+#include "buffer/mix.h"
+#include "base/utils.h"
+#include "dsp/simd.h"
+#include "spacetime/moment.h"
+
+#if OURO_SIMD_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define OURO_TARGET_AVX2
+#else
+#define OURO_TARGET_AVX2    __attribute__((target("avx2")))
+#endif
+#endif // OURO_SIMD_SSE2
+
+#if OURO_HAS_ISPC
+#include "ispc/.gen/mix_ispc.gen.h"
+#endif
+
+namespace buffer {
+
+namespace {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// the 8 input channels gathered up, to keep the vector kernels' signatures sane
+struct ChannelSet
+{
+    const float* m_channel[8];
+
+    ChannelSet( float* c0, float* c1, float* c2, float* c3, float* c4, float* c5, float* c6, float* c7 )
+        : m_channel{ c0, c1, c2, c3, c4, c5, c6, c7 }
+    {}
+};
+
+using DownmixSideFn     = void (*)( const float, const int, const ChannelSet&, float[] );
+using DownmixFn         = void (*)( const float, const int, const ChannelSet&, const ChannelSet&, float[], float[] );
+using InterleaveFn      = void (*)( const int, const float[], const float[], int[] );
+using QuantiseI16Fn     = void (*)( const int, const float[], int16_t[] );
+using QuantiseI24Fn     = void (*)( const int, const float[], int32_t[] );
+
+struct KernelTable
+{
+    MixKernel       m_kernel;
+    DownmixFn       m_downmix;          // both channel sets -> left/right outputs
+    InterleaveFn    m_interleave;
+    QuantiseI16Fn   m_quantiseI16;
+    QuantiseI24Fn   m_quantiseI24;
+};
+
+// most kernels work one side at a time, this runs one of those over the pair
+template< DownmixSideFn _sideFn >
+void downmixBothSides( const float gain, const int count, const ChannelSet& left, const ChannelSet& right, float outLeft[], float outRight[] )
+{
+    _sideFn( gain, count, left,  outLeft );
+    _sideFn( gain, count, right, outRight );
+}
+
+static constexpr float   cScaler16  = (float)0x7fffL;
+static constexpr float   cScaler24  = (float)0x7fffffL;
+static constexpr float   cInt16MaxF = (float)(  0x7fffL );
+static constexpr float   cInt16MinF = (float)( -0x7fffL - 1 );
+static constexpr float   cInt24MaxF = (float)(  0x7fffffL );
+static constexpr float   cInt24MinF = (float)( -0x7fffffL - 1 );
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// scalar reference
+namespace kscalar {
+
+void downmix( const float gain, const int count, const ChannelSet& in, float out[] )
+{
+    for ( auto i = 0; i < count; i++ )
+    {
+        out[i] = ( in.m_channel[0][i] +
+                   in.m_channel[1][i] +
+                   in.m_channel[2][i] +
+                   in.m_channel[3][i] +
+                   in.m_channel[4][i] +
+                   in.m_channel[5][i] +
+                   in.m_channel[6][i] +
+                   in.m_channel[7][i] ) * gain;
+    }
+}
+
+void interleave( const int count, const float left[], const float right[], int out[] )
+{
+    scalar::interleave_float_to_int24( count, const_cast<float*>( left ), const_cast<float*>( right ), out );
+}
+
+void quantiseI16( const int count, const float in[], int16_t out[] )
+{
+    scalar::quantise_float_to_int16( count, in, out );
+}
+
+void quantiseI24( const int count, const float in[], int32_t out[] )
+{
+    scalar::quantise_float_to_int24( count, in, out );
+}
+
+static constexpr KernelTable Table { MixKernel::Scalar, &downmixBothSides< &downmix >, &interleave, &quantiseI16, &quantiseI24 };
+
+} // namespace kscalar
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// SSE2 / NEON baseline; summation order matches the scalar code so results are bit-identical. conversions clamp in
+// float space before truncating, which is the same as the scalar clamp-after-truncate for every in-range value
+namespace kvector {
+
+#if OURO_SIMD_SSE2
+
+void downmix( const float gain, const int count, const ChannelSet& in, float out[] )
+{
+    const __m128 vGain = _mm_set1_ps( gain );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128 sum = _mm_loadu_ps( in.m_channel[0] + i );
+        sum = _mm_add_ps( sum, _mm_loadu_ps( in.m_channel[1] + i ) );
+        sum = _mm_add_ps( sum, _mm_loadu_ps( in.m_channel[2] + i ) );
+        sum = _mm_add_ps( sum, _mm_loadu_ps( in.m_channel[3] + i ) );
+        sum = _mm_add_ps( sum, _mm_loadu_ps( in.m_channel[4] + i ) );
+        sum = _mm_add_ps( sum, _mm_loadu_ps( in.m_channel[5] + i ) );
+        sum = _mm_add_ps( sum, _mm_loadu_ps( in.m_channel[6] + i ) );
+        sum = _mm_add_ps( sum, _mm_loadu_ps( in.m_channel[7] + i ) );
+        _mm_storeu_ps( out + i, _mm_mul_ps( sum, vGain ) );
+    }
+    if ( i < count )
+    {
+        const ChannelSet tail(
+            const_cast<float*>( in.m_channel[0] + i ), const_cast<float*>( in.m_channel[1] + i ),
+            const_cast<float*>( in.m_channel[2] + i ), const_cast<float*>( in.m_channel[3] + i ),
+            const_cast<float*>( in.m_channel[4] + i ), const_cast<float*>( in.m_channel[5] + i ),
+            const_cast<float*>( in.m_channel[6] + i ), const_cast<float*>( in.m_channel[7] + i ) );
+        kscalar::downmix( gain, count - i, tail, out + i );
+    }
+}
+
+inline __m128i clampAndConvert( const __m128 input, const __m128 scale, const __m128 minF, const __m128 maxF )
+{
+    return _mm_cvttps_epi32( _mm_max_ps( _mm_min_ps( _mm_mul_ps( input, scale ), maxF ), minF ) );
+}
+
+void interleave( const int count, const float left[], const float right[], int out[] )
+{
+    const __m128 vScale = _mm_set1_ps( cScaler24 );
+    const __m128 vMin   = _mm_set1_ps( cInt24MinF );
+    const __m128 vMax   = _mm_set1_ps( cInt24MaxF );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        const __m128i iL = clampAndConvert( _mm_loadu_ps( left  + i ), vScale, vMin, vMax );
+        const __m128i iR = clampAndConvert( _mm_loadu_ps( right + i ), vScale, vMin, vMax );
+
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + ( i * 2 ) + 0 ), _mm_unpacklo_epi32( iL, iR ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + ( i * 2 ) + 4 ), _mm_unpackhi_epi32( iL, iR ) );
+    }
+    if ( i < count )
+        kscalar::interleave( count - i, left + i, right + i, out + ( i * 2 ) );
+}
+
+void quantiseI16( const int count, const float in[], int16_t out[] )
+{
+    const __m128 vScale = _mm_set1_ps( cScaler16 );
+    const __m128 vMin   = _mm_set1_ps( cInt16MinF );
+    const __m128 vMax   = _mm_set1_ps( cInt16MaxF );
+
+    int i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        const __m128i i0 = clampAndConvert( _mm_loadu_ps( in + i + 0 ), vScale, vMin, vMax );
+        const __m128i i1 = clampAndConvert( _mm_loadu_ps( in + i + 4 ), vScale, vMin, vMax );
+
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), _mm_packs_epi32( i0, i1 ) );
+    }
+    if ( i < count )
+        kscalar::quantiseI16( count - i, in + i, out + i );
+}
+
+void quantiseI24( const int count, const float in[], int32_t out[] )
+{
+    const __m128 vScale = _mm_set1_ps( cScaler24 );
+    const __m128 vMin   = _mm_set1_ps( cInt24MinF );
+    const __m128 vMax   = _mm_set1_ps( cInt24MaxF );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), clampAndConvert( _mm_loadu_ps( in + i ), vScale, vMin, vMax ) );
+    if ( i < count )
+        kscalar::quantiseI24( count - i, in + i, out + i );
+}
+
+static constexpr KernelTable Table { MixKernel::Vector, &downmixBothSides< &downmix >, &interleave, &quantiseI16, &quantiseI24 };
+
+#elif OURO_SIMD_NEON
+
+void downmix( const float gain, const int count, const ChannelSet& in, float out[] )
+{
+    const float32x4_t vGain = vdupq_n_f32( gain );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        float32x4_t sum = vld1q_f32( in.m_channel[0] + i );
+        sum = vaddq_f32( sum, vld1q_f32( in.m_channel[1] + i ) );
+        sum = vaddq_f32( sum, vld1q_f32( in.m_channel[2] + i ) );
+        sum = vaddq_f32( sum, vld1q_f32( in.m_channel[3] + i ) );
+        sum = vaddq_f32( sum, vld1q_f32( in.m_channel[4] + i ) );
+        sum = vaddq_f32( sum, vld1q_f32( in.m_channel[5] + i ) );
+        sum = vaddq_f32( sum, vld1q_f32( in.m_channel[6] + i ) );
+        sum = vaddq_f32( sum, vld1q_f32( in.m_channel[7] + i ) );
+        vst1q_f32( out + i, vmulq_f32( sum, vGain ) );
+    }
+    if ( i < count )
+    {
+        const ChannelSet tail(
+            const_cast<float*>( in.m_channel[0] + i ), const_cast<float*>( in.m_channel[1] + i ),
+            const_cast<float*>( in.m_channel[2] + i ), const_cast<float*>( in.m_channel[3] + i ),
+            const_cast<float*>( in.m_channel[4] + i ), const_cast<float*>( in.m_channel[5] + i ),
+            const_cast<float*>( in.m_channel[6] + i ), const_cast<float*>( in.m_channel[7] + i ) );
+        kscalar::downmix( gain, count - i, tail, out + i );
+    }
+}
+
+inline int32x4_t clampAndConvert( const float32x4_t input, const float32x4_t scale, const float32x4_t minF, const float32x4_t maxF )
+{
+    // vcvtq_s32_f32 truncates toward zero, as the scalar cast does
+    return vcvtq_s32_f32( vmaxq_f32( vminq_f32( vmulq_f32( input, scale ), maxF ), minF ) );
+}
+
+void interleave( const int count, const float left[], const float right[], int out[] )
+{
+    const float32x4_t vScale = vdupq_n_f32( cScaler24 );
+    const float32x4_t vMin   = vdupq_n_f32( cInt24MinF );
+    const float32x4_t vMax   = vdupq_n_f32( cInt24MaxF );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        int32x4x2_t lr;
+        lr.val[0] = clampAndConvert( vld1q_f32( left  + i ), vScale, vMin, vMax );
+        lr.val[1] = clampAndConvert( vld1q_f32( right + i ), vScale, vMin, vMax );
+
+        // vst2 interleaves the pair for us
+        vst2q_s32( out + ( i * 2 ), lr );
+    }
+    if ( i < count )
+        kscalar::interleave( count - i, left + i, right + i, out + ( i * 2 ) );
+}
+
+void quantiseI16( const int count, const float in[], int16_t out[] )
+{
+    const float32x4_t vScale = vdupq_n_f32( cScaler16 );
+    const float32x4_t vMin   = vdupq_n_f32( cInt16MinF );
+    const float32x4_t vMax   = vdupq_n_f32( cInt16MaxF );
+
+    int i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        const int32x4_t i0 = clampAndConvert( vld1q_f32( in + i + 0 ), vScale, vMin, vMax );
+        const int32x4_t i1 = clampAndConvert( vld1q_f32( in + i + 4 ), vScale, vMin, vMax );
+
+        vst1q_s16( out + i, vcombine_s16( vmovn_s32( i0 ), vmovn_s32( i1 ) ) );
+    }
+    if ( i < count )
+        kscalar::quantiseI16( count - i, in + i, out + i );
+}
+
+void quantiseI24( const int count, const float in[], int32_t out[] )
+{
+    const float32x4_t vScale = vdupq_n_f32( cScaler24 );
+    const float32x4_t vMin   = vdupq_n_f32( cInt24MinF );
+    const float32x4_t vMax   = vdupq_n_f32( cInt24MaxF );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+        vst1q_s32( out + i, clampAndConvert( vld1q_f32( in + i ), vScale, vMin, vMax ) );
+    if ( i < count )
+        kscalar::quantiseI24( count - i, in + i, out + i );
+}
+
+static constexpr KernelTable Table { MixKernel::Vector, &downmixBothSides< &downmix >, &interleave, &quantiseI16, &quantiseI24 };
+
+#endif
+
+} // namespace kvector
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// AVX2, compiled per-function so the rest of the binary keeps its baseline ISA; only selected after a CPU check
+namespace kavx2 {
+
+#if OURO_SIMD_SSE2
+
+bool isSupported()
+{
+#if defined(_MSC_VER)
+    int cpuInfo[4];
+    __cpuid( cpuInfo, 0 );
+    if ( cpuInfo[0] < 7 )
+        return false;
+
+    // AVX + OSXSAVE, then check the OS is preserving YMM state
+    __cpuid( cpuInfo, 1 );
+    const bool hasAVX     = ( cpuInfo[2] & ( 1 << 28 ) ) != 0;
+    const bool hasOSXSAVE = ( cpuInfo[2] & ( 1 << 27 ) ) != 0;
+    if ( !hasAVX || !hasOSXSAVE )
+        return false;
+    if ( ( _xgetbv( 0 ) & 0x6 ) != 0x6 )
+        return false;
+
+    __cpuidex( cpuInfo, 7, 0 );
+    return ( cpuInfo[1] & ( 1 << 5 ) ) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" );
+#endif
+}
+
+OURO_TARGET_AVX2 void downmix( const float gain, const int count, const ChannelSet& in, float out[] )
+{
+    const __m256 vGain = _mm256_set1_ps( gain );
+
+    int i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256 sum = _mm256_loadu_ps( in.m_channel[0] + i );
+        sum = _mm256_add_ps( sum, _mm256_loadu_ps( in.m_channel[1] + i ) );
+        sum = _mm256_add_ps( sum, _mm256_loadu_ps( in.m_channel[2] + i ) );
+        sum = _mm256_add_ps( sum, _mm256_loadu_ps( in.m_channel[3] + i ) );
+        sum = _mm256_add_ps( sum, _mm256_loadu_ps( in.m_channel[4] + i ) );
+        sum = _mm256_add_ps( sum, _mm256_loadu_ps( in.m_channel[5] + i ) );
+        sum = _mm256_add_ps( sum, _mm256_loadu_ps( in.m_channel[6] + i ) );
+        sum = _mm256_add_ps( sum, _mm256_loadu_ps( in.m_channel[7] + i ) );
+        _mm256_storeu_ps( out + i, _mm256_mul_ps( sum, vGain ) );
+    }
+    if ( i < count )
+    {
+        const ChannelSet tail(
+            const_cast<float*>( in.m_channel[0] + i ), const_cast<float*>( in.m_channel[1] + i ),
+            const_cast<float*>( in.m_channel[2] + i ), const_cast<float*>( in.m_channel[3] + i ),
+            const_cast<float*>( in.m_channel[4] + i ), const_cast<float*>( in.m_channel[5] + i ),
+            const_cast<float*>( in.m_channel[6] + i ), const_cast<float*>( in.m_channel[7] + i ) );
+        kvector::downmix( gain, count - i, tail, out + i );
+    }
+}
+
+OURO_TARGET_AVX2 inline __m256i clampAndConvert( const __m256 input, const __m256 scale, const __m256 minF, const __m256 maxF )
+{
+    return _mm256_cvttps_epi32( _mm256_max_ps( _mm256_min_ps( _mm256_mul_ps( input, scale ), maxF ), minF ) );
+}
+
+OURO_TARGET_AVX2 void interleave( const int count, const float left[], const float right[], int out[] )
+{
+    const __m256 vScale = _mm256_set1_ps( cScaler24 );
+    const __m256 vMin   = _mm256_set1_ps( cInt24MinF );
+    const __m256 vMax   = _mm256_set1_ps( cInt24MaxF );
+
+    int i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        const __m256i iL = clampAndConvert( _mm256_loadu_ps( left  + i ), vScale, vMin, vMax );
+        const __m256i iR = clampAndConvert( _mm256_loadu_ps( right + i ), vScale, vMin, vMax );
+
+        // unpacks work within 128-bit lanes; { L0 R0 L1 R1 | L4 R4 L5 R5 } and { L2 R2 L3 R3 | L6 R6 L7 R7 }
+        const __m256i lo = _mm256_unpacklo_epi32( iL, iR );
+        const __m256i hi = _mm256_unpackhi_epi32( iL, iR );
+
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + ( i * 2 ) + 0 ), _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + ( i * 2 ) + 8 ), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+    }
+    if ( i < count )
+        kvector::interleave( count - i, left + i, right + i, out + ( i * 2 ) );
+}
+
+OURO_TARGET_AVX2 void quantiseI16( const int count, const float in[], int16_t out[] )
+{
+    const __m256 vScale = _mm256_set1_ps( cScaler16 );
+    const __m256 vMin   = _mm256_set1_ps( cInt16MinF );
+    const __m256 vMax   = _mm256_set1_ps( cInt16MaxF );
+
+    int i = 0;
+    for ( ; i + 16 <= count; i += 16 )
+    {
+        const __m256i i0 = clampAndConvert( _mm256_loadu_ps( in + i + 0 ), vScale, vMin, vMax );
+        const __m256i i1 = clampAndConvert( _mm256_loadu_ps( in + i + 8 ), vScale, vMin, vMax );
+
+        // packs also work within lanes, fix up the qword order afterwards
+        const __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi32( i0, i1 ), 0xD8 );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ), packed );
+    }
+    if ( i < count )
+        kvector::quantiseI16( count - i, in + i, out + i );
+}
+
+OURO_TARGET_AVX2 void quantiseI24( const int count, const float in[], int32_t out[] )
+{
+    const __m256 vScale = _mm256_set1_ps( cScaler24 );
+    const __m256 vMin   = _mm256_set1_ps( cInt24MinF );
+    const __m256 vMax   = _mm256_set1_ps( cInt24MaxF );
+
+    int i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ), clampAndConvert( _mm256_loadu_ps( in + i ), vScale, vMin, vMax ) );
+    if ( i < count )
+        kvector::quantiseI24( count - i, in + i, out + i );
+}
+
+static constexpr KernelTable Table { MixKernel::VectorAVX2, &downmixBothSides< &downmix >, &interleave, &quantiseI16, &quantiseI24 };
+
+#else
+
+bool isSupported() { return false; }
+
+#endif // OURO_SIMD_SSE2
+
+} // namespace kavx2
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ISPC, Windows builds; the quantise kernels don't have ISPC versions and use the best vector path instead
+#if OURO_HAS_ISPC
+namespace kispc {
+
+void downmix( const float gain, const int count, const ChannelSet& left, const ChannelSet& right, float outLeft[], float outRight[] )
+{
+    // the ISPC kernel mixes both sides in one go
+    ispc::downmix_8channel_stereo(
+        gain,
+        count,
+        const_cast<float*>( left.m_channel[0] ),  const_cast<float*>( left.m_channel[1] ),
+        const_cast<float*>( left.m_channel[2] ),  const_cast<float*>( left.m_channel[3] ),
+        const_cast<float*>( left.m_channel[4] ),  const_cast<float*>( left.m_channel[5] ),
+        const_cast<float*>( left.m_channel[6] ),  const_cast<float*>( left.m_channel[7] ),
+        const_cast<float*>( right.m_channel[0] ), const_cast<float*>( right.m_channel[1] ),
+        const_cast<float*>( right.m_channel[2] ), const_cast<float*>( right.m_channel[3] ),
+        const_cast<float*>( right.m_channel[4] ), const_cast<float*>( right.m_channel[5] ),
+        const_cast<float*>( right.m_channel[6] ), const_cast<float*>( right.m_channel[7] ),
+        outLeft,
+        outRight );
+}
+
+void interleave( const int count, const float left[], const float right[], int out[] )
+{
+    ispc::interleave_float_to_int24( count, const_cast<float*>( left ), const_cast<float*>( right ), out );
+}
+
+static constexpr KernelTable Table { MixKernel::ISPC, &downmix, &interleave, &kvector::quantiseI16, &kvector::quantiseI24 };
+
+} // namespace kispc
+#endif // OURO_HAS_ISPC
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+const KernelTable* findKernelTable( const MixKernel kernel )
+{
+    switch ( kernel )
+    {
+        case MixKernel::Scalar:
+            return &kscalar::Table;
+
+        case MixKernel::Vector:
+#if OURO_SIMD_SSE2 || OURO_SIMD_NEON
+            return &kvector::Table;
+#else
+            return nullptr;
+#endif
+
+        case MixKernel::VectorAVX2:
+#if OURO_SIMD_SSE2
+            if ( kavx2::isSupported() )
+                return &kavx2::Table;
+#endif
+            return nullptr;
+
+        case MixKernel::ISPC:
+#if OURO_HAS_ISPC
+            return &kispc::Table;
+#else
+            return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+const KernelTable* findBestKernelTable()
+{
+    for ( const auto kernel : { MixKernel::ISPC, MixKernel::VectorAVX2, MixKernel::Vector } )
+    {
+        if ( const KernelTable* table = findKernelTable( kernel ) )
+            return table;
+    }
+    return &kscalar::Table;
+}
+
+std::atomic< const KernelTable* >& activeKernelTable()
+{
+    static std::atomic< const KernelTable* > activeTable{ findBestKernelTable() };
+    return activeTable;
+}
+
+} // anonymous namespace
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+const char* getMixKernelName( const MixKernel kernel )
+{
+    switch ( kernel )
+    {
+        case MixKernel::Scalar:     return "scalar";
+        case MixKernel::Vector:     return dsp::simd::backendName();
+        case MixKernel::VectorAVX2: return "AVX2";
+        case MixKernel::ISPC:       return "ISPC";
+    }
+    return "unknown";
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool isMixKernelAvailable( const MixKernel kernel )
+{
+    return findKernelTable( kernel ) != nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+MixKernel getMixKernel()
+{
+    return activeKernelTable().load( std::memory_order_relaxed )->m_kernel;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool setMixKernel( const MixKernel kernel )
+{
+    const KernelTable* table = findKernelTable( kernel );
+    if ( table == nullptr )
+        return false;
+
+    activeKernelTable().store( table, std::memory_order_relaxed );
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void downmix_8channel_stereo(
+    const float  global_gain,
+    const int    sample_count,
+    float        input_left_channel_0[],
+    float        input_left_channel_1[],
+    float        input_left_channel_2[],
+    float        input_left_channel_3[],
+    float        input_left_channel_4[],
+    float        input_left_channel_5[],
+    float        input_left_channel_6[],
+    float        input_left_channel_7[],
+    float        input_right_channel_0[],
+    float        input_right_channel_1[],
+    float        input_right_channel_2[],
+    float        input_right_channel_3[],
+    float        input_right_channel_4[],
+    float        input_right_channel_5[],
+    float        input_right_channel_6[],
+    float        input_right_channel_7[],
+    float        output_left[],
+    float        output_right[] )
+{
+    const ChannelSet leftSet(
+        input_left_channel_0,  input_left_channel_1,  input_left_channel_2,  input_left_channel_3,
+        input_left_channel_4,  input_left_channel_5,  input_left_channel_6,  input_left_channel_7 );
+    const ChannelSet rightSet(
+        input_right_channel_0, input_right_channel_1, input_right_channel_2, input_right_channel_3,
+        input_right_channel_4, input_right_channel_5, input_right_channel_6, input_right_channel_7 );
+
+    activeKernelTable().load( std::memory_order_relaxed )->m_downmix( global_gain, sample_count, leftSet, rightSet, output_left, output_right );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void interleave_float_to_int24(
+    const int    sample_count,
+    float        input_left[],
+    float        input_right[],
+    int          output_int24_stride32[] )
+{
+    activeKernelTable().load( std::memory_order_relaxed )->m_interleave( sample_count, input_left, input_right, output_int24_stride32 );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void quantise_float_to_int16(
+    const int    sample_count,
+    const float  input[],
+    int16_t      output[] )
+{
+    activeKernelTable().load( std::memory_order_relaxed )->m_quantiseI16( sample_count, input, output );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void quantise_float_to_int24(
+    const int    sample_count,
+    const float  input[],
+    int32_t      output[] )
+{
+    activeKernelTable().load( std::memory_order_relaxed )->m_quantiseI24( sample_count, input, output );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+std::vector< MixKernelBenchmark > benchmarkMixKernels( const int sampleCount, const int iterations )
+{
+    std::vector< MixKernelBenchmark > results;
+
+    // deterministic test signal, deliberately pushing outside -1..1 to exercise the clamping
+    std::array< float*, 16 > inputs;
+    for ( std::size_t cI = 0; cI < inputs.size(); cI++ )
+    {
+        inputs[cI] = mem::alloc16<float>( sampleCount );
+        for ( int sI = 0; sI < sampleCount; sI++ )
+            inputs[cI][sI] = std::sin( static_cast<float>( sI * ( cI + 1 ) ) * 0.001f ) * 0.3f;
+    }
+
+    float*   referenceLR[2]   = { mem::alloc16<float>( sampleCount ), mem::alloc16<float>( sampleCount ) };
+    int32_t* referenceI24     = mem::alloc16<int32_t>( sampleCount * 2 );
+    int16_t* referenceI16     = mem::alloc16<int16_t>( sampleCount );
+
+    float*   outputLR[2]      = { mem::alloc16<float>( sampleCount ), mem::alloc16<float>( sampleCount ) };
+    int32_t* outputI24        = mem::alloc16<int32_t>( sampleCount * 2 );
+    int16_t* outputI16        = mem::alloc16<int16_t>( sampleCount );
+
+    const ChannelSet leftSet(  inputs[0], inputs[1], inputs[2],  inputs[3],  inputs[4],  inputs[5],  inputs[6],  inputs[7] );
+    const ChannelSet rightSet( inputs[8], inputs[9], inputs[10], inputs[11], inputs[12], inputs[13], inputs[14], inputs[15] );
+
+    // fill the reference buffers
+    kscalar::downmix( 0.9f, sampleCount, leftSet,  referenceLR[0] );
+    kscalar::downmix( 0.9f, sampleCount, rightSet, referenceLR[1] );
+    kscalar::interleave( sampleCount, referenceLR[0], referenceLR[1], referenceI24 );
+    kscalar::quantiseI16( sampleCount, referenceLR[0], referenceI16 );
+
+    for ( const auto kernel : { MixKernel::Scalar, MixKernel::Vector, MixKernel::VectorAVX2, MixKernel::ISPC } )
+    {
+        const KernelTable* table = findKernelTable( kernel );
+        if ( table == nullptr )
+            continue;
+
+        MixKernelBenchmark& result = results.emplace_back();
+        result.m_kernel = kernel;
+
+        {
+            spacetime::Moment timer;
+            for ( int iter = 0; iter < iterations; iter++ )
+                table->m_downmix( 0.9f, sampleCount, leftSet, rightSet, outputLR[0], outputLR[1] );
+            result.m_downmixMs = static_cast<double>( timer.delta< std::chrono::microseconds >().count() ) * 0.001;
+        }
+        {
+            spacetime::Moment timer;
+            for ( int iter = 0; iter < iterations; iter++ )
+                table->m_interleave( sampleCount, outputLR[0], outputLR[1], outputI24 );
+            result.m_interleaveMs = static_cast<double>( timer.delta< std::chrono::microseconds >().count() ) * 0.001;
+        }
+        {
+            spacetime::Moment timer;
+            for ( int iter = 0; iter < iterations; iter++ )
+                table->m_quantiseI16( sampleCount, outputLR[0], outputI16 );
+            result.m_quantiseMs = static_cast<double>( timer.delta< std::chrono::microseconds >().count() ) * 0.001;
+        }
+
+        result.m_matchesScalar =
+            ( memcmp( outputLR[0], referenceLR[0], sizeof( float ) * sampleCount ) == 0 ) &&
+            ( memcmp( outputLR[1], referenceLR[1], sizeof( float ) * sampleCount ) == 0 ) &&
+            ( memcmp( outputI24,   referenceI24,   sizeof( int32_t ) * sampleCount * 2 ) == 0 ) &&
+            ( memcmp( outputI16,   referenceI16,   sizeof( int16_t ) * sampleCount ) == 0 );
+    }
+
+    mem::free16( outputI16 );
+    mem::free16( outputI24 );
+    mem::free16( outputLR[1] );
+    mem::free16( outputLR[0] );
+    mem::free16( referenceI16 );
+    mem::free16( referenceI24 );
+    mem::free16( referenceLR[1] );
+    mem::free16( referenceLR[0] );
+    for ( float* input : inputs )
+        mem::free16( input );
+
+    return results;
+}
+
+} // namespace buffer
@@ -1,21 +1,108 @@
-//   _______ _______ ______ _______ ___ ___ _______ _______ _______ 
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
 //  |       |   |   |   __ \       |   |   |    ___|       |    |  |
 //  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
 //  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
 //  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
 //
-//  
+//  mixdown / quantise kernels; the entry points at the top dispatch to the fastest available implementation,
+//  chosen once at runtime - ISPC on Windows, AVX2 where the CPU supports it, SSE2/NEON otherwise.
+//  the original serial ports are kept in buffer::scalar for reference & benchmarking
 //
 
-// serial ports for ISPC code originally written on Win; holding here until we sort x-platform ISPC etc
-
 #pragma once
 
 namespace buffer {
 
 // ---------------------------------------------------------------------------------------------------------------------
-// 
-constexpr void downmix_8channel_stereo( 
+enum class MixKernel
+{
+    Scalar,
+    Vector,         // SSE2 on x64, NEON on arm64; compile-time baseline
+    VectorAVX2,     // x64 only, requires runtime CPU support
+    ISPC,           // only when built with OURO_HAS_ISPC
+};
+
+const char* getMixKernelName( const MixKernel kernel );
+bool isMixKernelAvailable( const MixKernel kernel );
+
+// the kernel set used by the dispatching functions below; defaults to the best available
+MixKernel getMixKernel();
+// force a particular kernel set, returns false (and changes nothing) if it isn't available on this machine
+bool setMixKernel( const MixKernel kernel );
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// sum 8 stereo channels into a single stereo output, applying global gain
+//
+void downmix_8channel_stereo(
+    const float  global_gain,
+    const int    sample_count,
+    float        input_left_channel_0[],
+    float        input_left_channel_1[],
+    float        input_left_channel_2[],
+    float        input_left_channel_3[],
+    float        input_left_channel_4[],
+    float        input_left_channel_5[],
+    float        input_left_channel_6[],
+    float        input_left_channel_7[],
+    float        input_right_channel_0[],
+    float        input_right_channel_1[],
+    float        input_right_channel_2[],
+    float        input_right_channel_3[],
+    float        input_right_channel_4[],
+    float        input_right_channel_5[],
+    float        input_right_channel_6[],
+    float        input_right_channel_7[],
+    float        output_left[],
+    float        output_right[]
+    );
+
+// ---------------------------------------------------------------------------------------------------------------------
+// convert two channels of float samples, clamp to -1..1, convert to 24-bit int, store interleaved in a 32-bit int output stream
+//
+void interleave_float_to_int24(
+    const int    sample_count,
+    float        input_left[],
+    float        input_right[],
+    int          output_int24_stride32[]
+    );
+
+// ---------------------------------------------------------------------------------------------------------------------
+// clamp and convert a stream of float samples to 16-bit or 24-bit (in 32-bit) ints; used by the interleaved quantise buffers
+//
+void quantise_float_to_int16(
+    const int    sample_count,
+    const float  input[],
+    int16_t      output[]
+    );
+
+void quantise_float_to_int24(
+    const int    sample_count,
+    const float  input[],
+    int32_t      output[]
+    );
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// compare all available kernel sets against the scalar reference on identical buffers; returns one entry per kernel
+//
+struct MixKernelBenchmark
+{
+    MixKernel   m_kernel;
+    double      m_downmixMs;            // total time spent across all iterations
+    double      m_interleaveMs;
+    double      m_quantiseMs;
+    bool        m_matchesScalar;        // output was bit-identical to the scalar kernels
+};
+std::vector< MixKernelBenchmark > benchmarkMixKernels( const int sampleCount, const int iterations );
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// serial ports for ISPC code originally written on Win
+//
+namespace scalar {
+
+inline void downmix_8channel_stereo(
     const float  global_gain,
     const int    sample_count,
     float        input_left_channel_0[],
@@ -40,13 +127,13 @@ constexpr void downmix_8channel_stereo(
 {
     for ( auto i = 0; i < sample_count; i++ )
     {
-        const float sV  = ( input_left_channel_0[i] + 
-                            input_left_channel_1[i] + 
-                            input_left_channel_2[i] + 
-                            input_left_channel_3[i] + 
-                            input_left_channel_4[i] + 
-                            input_left_channel_5[i] + 
-                            input_left_channel_6[i] + 
+        const float sV  = ( input_left_channel_0[i] +
+                            input_left_channel_1[i] +
+                            input_left_channel_2[i] +
+                            input_left_channel_3[i] +
+                            input_left_channel_4[i] +
+                            input_left_channel_5[i] +
+                            input_left_channel_6[i] +
                             input_left_channel_7[i] ) * global_gain;
 
         output_left[i] = sV;
@@ -55,28 +142,24 @@ constexpr void downmix_8channel_stereo(
     for ( auto i = 0; i < sample_count; i++ )
     {
         const float sV  = ( input_right_channel_0[i] +
-                            input_right_channel_1[i] + 
-                            input_right_channel_2[i] + 
-                            input_right_channel_3[i] + 
-                            input_right_channel_4[i] + 
-                            input_right_channel_5[i] + 
-                            input_right_channel_6[i] + 
+                            input_right_channel_1[i] +
+                            input_right_channel_2[i] +
+                            input_right_channel_3[i] +
+                            input_right_channel_4[i] +
+                            input_right_channel_5[i] +
+                            input_right_channel_6[i] +
                             input_right_channel_7[i] ) * global_gain;
 
         output_right[i] = sV;
     }
 }
 
-
-// ---------------------------------------------------------------------------------------------------------------------
-// convert two channels of float samples, clamp to 0..1, convert to 24-bit int, store interleaved in a 32-bit int output stream
-//
-constexpr void interleave_float_to_int24(
+inline void interleave_float_to_int24(
     const int    sample_count,
     float        input_left[],
     float        input_right[],
     int          output_int24_stride32[]
-)
+    )
 {
     const float fScaler24 = (float)0x7fffffL;
     const int fInt24Max   = (  0x7fffffL );
@@ -89,4 +172,37 @@ constexpr void interleave_float_to_int24(
     }
 }
 
+inline void quantise_float_to_int16(
+    const int    sample_count,
+    const float  input[],
+    int16_t      output[]
+    )
+{
+    static constexpr float   fScaler16  = (float)0x7fffL;
+    static constexpr int32_t fInt16Max  = ( 0x7fffL        );
+    static constexpr int32_t fInt16Min  = ( -fInt16Max - 1 );
+
+    for ( auto i = 0; i < sample_count; i++ )
+    {
+        output[i] = (int16_t)std::clamp( (int32_t)(input[i] * fScaler16), fInt16Min, fInt16Max );
+    }
+}
+
+inline void quantise_float_to_int24(
+    const int    sample_count,
+    const float  input[],
+    int32_t      output[]
+    )
+{
+    static constexpr float   fScaler24  = (float)0x7fffffL;
+    static constexpr int32_t fInt24Max  = (  0x7fffffL     );
+    static constexpr int32_t fInt24Min  = ( -fInt24Max - 1 );
+
+    for ( auto i = 0; i < sample_count; i++ )
+    {
+        output[i] = (int32_t)std::clamp( (int32_t)(input[i] * fScaler24), fInt24Min, fInt24Max );
+    }
+}
+
+} // namespace scalar
 } // namespace buffer
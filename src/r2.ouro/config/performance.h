@@ -32,6 +32,9 @@ OURO_CONFIG( Performance )
     // when possible viable, keep this number of live full riff instances alive once they are fully loaded
     int32_t         liveRiffInstancePoolSize = 64;
 
+    // .. and also cap the live riff pool by the approximate memory those riffs keep alive (in Mb); 0 to disable
+    int32_t         liveRiffInstancePoolMemoryMb = 1024;
+
     // for people connecting over less reliable networks that may be lossy or take a few persistent bumps to make
     // API calls land, enabling this will ramp up the retry rates in the network layer, bump up the timeouts
     bool            enableUnstableNetworkCompensation = false;
@@ -39,14 +42,71 @@ OURO_CONFIG( Performance )
     // optionally enable/disable the Vibes rendering system at the root to avoid burning any memory or GPU if desired
     bool            enableVibesRenderer = true;
 
+    // keep a second on-disk copy of every stem fully decoded at the mixer sample rate; makes re-loading stems
+    // much cheaper at the cost of roughly 4-5x more disk space than the original compressed stem cache
+    bool            enableDecodedStemCache = false;
+
+    // FLAC encoding for recordings and riff export; compression level from 0 (fastest) to 8 (smallest), whether each
+    // frame is decoded again and checked as it is written, and whether to split the work across a pool of workers
+    int32_t         flacCompressionLevel = 4;
+    bool            flacVerifyEncoding = true;
+    bool            flacChunkedEncoding = false;
+
+    // cap on how much of the main thread's frame is spent handing out app events; anything past either limit waits
+    // for the next frame. zero for no limit
+    int32_t         eventDispatchBudgetEvents = 0;
+    int32_t         eventDispatchBudgetUs = 0;
+
+    // record instrumented events and counters from boot using the built-in trace capture, written out as Chrome
+    // trace JSON into the app output folder on exit; capture can also be toggled from the profiling window
+    bool            enableTraceCapture = false;
+
+    // developer option; instead of starting a session, a fresh scratch warehouse is filled with this many synthetic riffs
+    // and used to time the main warehouse operations, results written as JSON to the app output folder. the real
+    // warehouse database is never opened; the option switches itself back off so the next launch runs as normal
+    bool            runWarehouseBenchmark = false;
+    int32_t         warehouseBenchmarkJams = 8;
+    int32_t         warehouseBenchmarkRiffsPerJam = 250000;
+
+    // developer option; on boot, run every available mix kernel set over the same buffers and log their timings
+    // along with whether they matched the scalar reference
+    bool            runMixKernelBenchmark = false;
+
+    // developer option; on boot, hammer the background sample processor (used by the FLAC/Opus writers) from a
+    // simulated audio callback and log whether every sample made it through. adds a few seconds to startup
+    bool            runSampleProcessorStressTest = false;
+
+    // developer option; on boot, render a few seconds of a synthetic mixer through the offline audio host into a
+    // deliberately slow buffered processor and log whether every sample arrived
+    bool            runOfflineRenderCheck = false;
+
+    // developer option; on boot, time a synthetic event workload through the event bus and a replica of the
+    // previous implementation, logging both
+    bool            runEventBusBenchmark = false;
+
 
     template<class Archive>
     void serialize( Archive& archive )
     {
         archive( CEREAL_NVP( stemCacheAutoPruneAtMemoryUsageMb )
                , CEREAL_NVP( liveRiffInstancePoolSize )
+               , CEREAL_OPTIONAL_NVP( liveRiffInstancePoolMemoryMb )
                , CEREAL_OPTIONAL_NVP( enableUnstableNetworkCompensation )
                , CEREAL_OPTIONAL_NVP( enableVibesRenderer )
+               , CEREAL_OPTIONAL_NVP( enableDecodedStemCache )
+               , CEREAL_OPTIONAL_NVP( flacCompressionLevel )
+               , CEREAL_OPTIONAL_NVP( flacVerifyEncoding )
+               , CEREAL_OPTIONAL_NVP( flacChunkedEncoding )
+               , CEREAL_OPTIONAL_NVP( eventDispatchBudgetEvents )
+               , CEREAL_OPTIONAL_NVP( eventDispatchBudgetUs )
+               , CEREAL_OPTIONAL_NVP( enableTraceCapture )
+               , CEREAL_OPTIONAL_NVP( runWarehouseBenchmark )
+               , CEREAL_OPTIONAL_NVP( warehouseBenchmarkJams )
+               , CEREAL_OPTIONAL_NVP( warehouseBenchmarkRiffsPerJam )
+               , CEREAL_OPTIONAL_NVP( runMixKernelBenchmark )
+               , CEREAL_OPTIONAL_NVP( runSampleProcessorStressTest )
+               , CEREAL_OPTIONAL_NVP( runOfflineRenderCheck )
+               , CEREAL_OPTIONAL_NVP( runEventBusBenchmark )
         );
     }
 
@@ -54,6 +114,12 @@ OURO_CONFIG( Performance )
     {
         stemCacheAutoPruneAtMemoryUsageMb   = std::max( stemCacheAutoPruneAtMemoryUsageMb, stemCachePruneLevelMinimumMb );
         liveRiffInstancePoolSize            = std::max( liveRiffInstancePoolSize, 1 );
+        liveRiffInstancePoolMemoryMb        = std::max( liveRiffInstancePoolMemoryMb, 0 );
+        flacCompressionLevel                = std::clamp( flacCompressionLevel, 0, 8 );
+        eventDispatchBudgetEvents           = std::max( eventDispatchBudgetEvents, 0 );
+        eventDispatchBudgetUs               = std::max( eventDispatchBudgetUs, 0 );
+        warehouseBenchmarkJams              = std::max( warehouseBenchmarkJams, 1 );
+        warehouseBenchmarkRiffsPerJam       = std::max( warehouseBenchmarkRiffsPerJam, 1 );
     }
 
     // ensure nothing weird arriving
@@ -26,6 +26,15 @@ OURO_CONFIG( Spectrum )
     bool            applyHannWindow = true;
     float           minDb = -8.0f;
     float           maxDb = 50.0f;
+    uint32_t        analysisOverlap = 2;        // FFTs run per window's worth of samples; 1 = back-to-back, 2 = 50% overlap, ..
+    bool            bucketPeakHold = false;     // combine multiple FFTs per update by taking the peak rather than the mean
+
+    // hop between successive FFTs, in samples
+    ouro_nodiscard inline uint32_t hopSizeFor( const uint32_t fftWindowSize ) const
+    {
+        const uint32_t overlap = std::clamp( analysisOverlap, 1U, 8U );
+        return std::max( 1U, fftWindowSize / overlap );
+    }
 
     template<class Archive>
     void serialize( Archive& archive )
@@ -33,6 +42,8 @@ OURO_CONFIG( Spectrum )
         archive( CEREAL_NVP( applyHannWindow )
                , CEREAL_NVP( minDb )
                , CEREAL_NVP( maxDb )
+               , CEREAL_OPTIONAL_NVP( analysisOverlap )
+               , CEREAL_OPTIONAL_NVP( bucketPeakHold )
         );
     }
 
@@ -0,0 +1,333 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//
+//
+
+#include "pch.h"
+
+#include "data/json.sax.h"
+
+#include "cereal/external/rapidjson/reader.h"
+#include "cereal/external/rapidjson/memorystream.h"
+#include "cereal/external/rapidjson/error/en.h"
+
+namespace data {
+namespace sax {
+
+namespace {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// rapidjson SAX handler; walks a stack of open objects / arrays alongside the reader, routing each token through the
+// schema for whatever is currently open. unknown keys and tolerated mismatches are skipped wholesale
+struct Decoder : public CEREAL_RAPIDJSON_NAMESPACE::BaseReaderHandler< CEREAL_RAPIDJSON_NAMESPACE::UTF8<>, Decoder >
+{
+    struct Frame
+    {
+        const Object*   schema      = nullptr;  // set for objects
+        const Field*    arrayField  = nullptr;  // set for arrays
+        void*           target      = nullptr;
+        uint64_t        seenFields  = 0;
+
+        // true once we are beneath an optional field; as with cereal's optional NVPs, a failure in here just
+        // abandons that part of the data rather than the whole decode
+        bool            lenient     = false;
+    };
+
+    Decoder( const Object& rootSchema, void* rootTarget )
+        : m_rootSchema( rootSchema )
+        , m_rootTarget( rootTarget )
+    {
+        m_stack.reserve( 16 );
+    }
+
+    const Object&           m_rootSchema;
+    void*                   m_rootTarget;
+
+    std::vector< Frame >    m_stack;
+    const Field*            m_pendingField  = nullptr;
+    bool                    m_skipNextValue = false;
+    uint32_t                m_skipDepth     = 0;
+    bool                    m_rootSeen      = false;
+
+    std::string             m_error;
+
+
+    bool fail( std::string message )
+    {
+        m_error = std::move( message );
+        return false;
+    }
+
+    // the field a value is about to be written through, for error reporting
+    std::string_view currentFieldName() const
+    {
+        if ( !m_stack.empty() && m_stack.back().arrayField != nullptr )
+            return m_stack.back().arrayField->name;
+        if ( m_pendingField != nullptr )
+            return m_pendingField->name;
+        return "<root>";
+    }
+
+    // returns true if the next value should be consumed without being decoded
+    bool consumeSkip()
+    {
+        if ( m_skipDepth > 0 )
+            return true;
+        if ( m_skipNextValue )
+        {
+            m_skipNextValue = false;
+            return true;
+        }
+        return false;
+    }
+
+    // called when a value can't be used; either fails the decode or quietly leaves the default in place
+    bool mismatch( const bool isContainer, std::string_view problem )
+    {
+        const Frame& frame = m_stack.back();
+        const bool isRequired = ( frame.arrayField != nullptr ) ? ( frame.arrayField->presence == Presence::Required ) :
+                                ( m_pendingField != nullptr && m_pendingField->presence == Presence::Required );
+
+        if ( isRequired && !frame.lenient )
+            return fail( fmt::format( FMTX( "[{}] {}" ), currentFieldName(), problem ) );
+
+        if ( isContainer )
+            m_skipDepth = 1;
+        return true;
+    }
+
+    bool onScalar( const Scalar& value )
+    {
+        if ( consumeSkip() )
+            return true;
+
+        if ( m_stack.empty() )
+            return fail( "document root is not an object" );
+
+        Frame& frame = m_stack.back();
+
+        if ( frame.arrayField != nullptr )
+        {
+            if ( frame.arrayField->kind != Field::Kind::ValueArray )
+                return mismatch( false, "expected object in array" );
+            if ( !frame.arrayField->assign( frame.target, value ) )
+                return mismatch( false, "array value has unexpected type" );
+            return true;
+        }
+
+        if ( m_pendingField->kind != Field::Kind::Value )
+            return mismatch( false, "expected object or array" );
+        if ( !m_pendingField->assign( frame.target, value ) )
+            return mismatch( false, "value has unexpected type" );
+        return true;
+    }
+
+    bool Null()
+    {
+        if ( consumeSkip() )
+            return true;
+        if ( m_stack.empty() )
+            return fail( "document root is not an object" );
+
+        return mismatch( false, "unexpected null" );
+    }
+
+    bool Bool( bool b )                 { return onScalar( Scalar{ Scalar::Type::Bool, b } ); }
+    bool Int( int i )                   { return onScalar( Scalar{ Scalar::Type::Int, false, i } ); }
+    bool Uint( unsigned u )             { return onScalar( Scalar{ Scalar::Type::Uint, false, 0, u } ); }
+    bool Int64( int64_t i )             { return onScalar( Scalar{ Scalar::Type::Int, false, i } ); }
+    bool Uint64( uint64_t u )           { return onScalar( Scalar{ Scalar::Type::Uint, false, 0, u } ); }
+    bool Double( double d )             { return onScalar( Scalar{ Scalar::Type::Double, false, 0, 0, d } ); }
+
+    bool String( const char* str, CEREAL_RAPIDJSON_NAMESPACE::SizeType length, bool )
+    {
+        return onScalar( Scalar{ Scalar::Type::String, false, 0, 0, 0, std::string_view( str, length ) } );
+    }
+
+    bool Key( const char* str, CEREAL_RAPIDJSON_NAMESPACE::SizeType length, bool )
+    {
+        if ( m_skipDepth > 0 )
+            return true;
+
+        Frame& frame = m_stack.back();
+        const std::string_view keyName( str, length );
+
+        const auto& fields = frame.schema->fields;
+        for ( std::size_t fieldIndex = 0; fieldIndex < fields.size(); fieldIndex++ )
+        {
+            if ( fields[fieldIndex].name == keyName )
+            {
+                m_pendingField = &fields[fieldIndex];
+                frame.seenFields |= ( 1ULL << fieldIndex );
+                return true;
+            }
+        }
+
+        // not something we care about
+        m_pendingField  = nullptr;
+        m_skipNextValue = true;
+        return true;
+    }
+
+    bool StartObject()
+    {
+        if ( m_skipDepth > 0 )
+        {
+            m_skipDepth++;
+            return true;
+        }
+        if ( m_skipNextValue )
+        {
+            m_skipNextValue = false;
+            m_skipDepth     = 1;
+            return true;
+        }
+
+        if ( m_stack.empty() )
+        {
+            if ( m_rootSeen )
+                return fail( "multiple root values" );
+
+            m_rootSeen = true;
+            m_stack.emplace_back( Frame{ &m_rootSchema, nullptr, m_rootTarget } );
+            return true;
+        }
+
+        const Frame& frame = m_stack.back();
+
+        if ( frame.arrayField != nullptr )
+        {
+            if ( frame.arrayField->kind != Field::Kind::ObjectArray )
+                return mismatch( true, "unexpected object in array" );
+
+            m_stack.emplace_back( Frame{ frame.arrayField->schema, nullptr, frame.arrayField->enter( frame.target ), 0, frame.lenient } );
+            return true;
+        }
+
+        if ( m_pendingField->kind != Field::Kind::Object )
+            return mismatch( true, "unexpected object" );
+
+        const bool lenient = frame.lenient || m_pendingField->presence == Presence::Optional;
+        m_stack.emplace_back( Frame{ m_pendingField->schema, nullptr, m_pendingField->enter( frame.target ), 0, lenient } );
+        return true;
+    }
+
+    bool EndObject( CEREAL_RAPIDJSON_NAMESPACE::SizeType )
+    {
+        if ( m_skipDepth > 0 )
+        {
+            m_skipDepth--;
+            return true;
+        }
+
+        const Frame frame = m_stack.back();
+        m_stack.pop_back();
+
+        if ( !frame.lenient )
+        {
+            const auto& fields = frame.schema->fields;
+            for ( std::size_t fieldIndex = 0; fieldIndex < fields.size(); fieldIndex++ )
+            {
+                if ( fields[fieldIndex].presence == Presence::Required &&
+                     ( frame.seenFields & ( 1ULL << fieldIndex ) ) == 0 )
+                {
+                    return fail( fmt::format( FMTX( "missing required key [{}]" ), fields[fieldIndex].name ) );
+                }
+            }
+        }
+
+        if ( frame.schema->complete != nullptr &&
+             !frame.schema->complete( frame.target ) &&
+             !frame.lenient )
+        {
+            return fail( "object rejected during post-decode fix-up" );
+        }
+
+        return true;
+    }
+
+    bool StartArray()
+    {
+        if ( m_skipDepth > 0 )
+        {
+            m_skipDepth++;
+            return true;
+        }
+        if ( m_skipNextValue )
+        {
+            m_skipNextValue = false;
+            m_skipDepth     = 1;
+            return true;
+        }
+
+        if ( m_stack.empty() )
+            return fail( "document root is not an object" );
+
+        const Frame& frame = m_stack.back();
+
+        // we have no use for nested arrays
+        if ( frame.arrayField != nullptr )
+            return mismatch( true, "unexpected nested array" );
+
+        if ( m_pendingField->kind != Field::Kind::ObjectArray &&
+             m_pendingField->kind != Field::Kind::ValueArray )
+        {
+            return mismatch( true, "unexpected array" );
+        }
+
+        m_pendingField->clear( frame.target );
+
+        const bool lenient = frame.lenient || m_pendingField->presence == Presence::Optional;
+        m_stack.emplace_back( Frame{ nullptr, m_pendingField, frame.target, 0, lenient } );
+        return true;
+    }
+
+    bool EndArray( CEREAL_RAPIDJSON_NAMESPACE::SizeType )
+    {
+        if ( m_skipDepth > 0 )
+        {
+            m_skipDepth--;
+            return true;
+        }
+
+        m_stack.pop_back();
+        return true;
+    }
+};
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status decode( std::string_view jsonText, const Object& schema, void* root )
+{
+    ABSL_ASSERT( root != nullptr );
+
+    using namespace CEREAL_RAPIDJSON_NAMESPACE;
+
+    // MemoryStream reads the caller's buffer directly; the only copies made are of individual string values,
+    // into the reader's reusable scratch stack, on their way to the destination fields
+    MemoryStream jsonStream( jsonText.data(), jsonText.size() );
+
+    Decoder decoder( schema, root );
+    Reader reader;
+
+    const ParseResult parseResult = reader.Parse< kParseFullPrecisionFlag | kParseNanAndInfFlag >( jsonStream, decoder );
+    if ( parseResult.IsError() )
+    {
+        if ( !decoder.m_error.empty() )
+        {
+            return absl::InvalidArgumentError( fmt::format( FMTX( "{} (at offset {})" ), decoder.m_error, parseResult.Offset() ) );
+        }
+
+        return absl::InvalidArgumentError( fmt::format( FMTX( "{} (at offset {})" ), GetParseError_En( parseResult.Code() ), parseResult.Offset() ) );
+    }
+
+    return absl::OkStatus();
+}
+
+} // namespace sax
+} // namespace data
@@ -0,0 +1,286 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//  streaming JSON decoder; binds a static description of a type's fields to rapidjson's SAX reader so
+//  a document can be written straight into a struct as it is read, without building a DOM or copying the
+//  source text first. types opt in by providing a saxSchema() built with data::sax::Schema<T>
+//
+
+#pragma once
+
+#include <charconv>
+
+#include "base/id.couch.h"
+
+namespace data {
+namespace sax {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// a single value token handed up from the reader; string views are only valid for the duration of the callback
+struct Scalar
+{
+    enum class Type : uint8_t
+    {
+        Bool,
+        Int,
+        Uint,
+        Double,
+        String
+    };
+
+    Type                type;
+    bool                b = false;
+    int64_t             i = 0;
+    uint64_t            u = 0;
+    double              d = 0;
+    std::string_view    s;
+};
+
+template< typename _Type >
+struct is_string_wrapper : std::false_type {};
+template< typename _Identity >
+struct is_string_wrapper< base::id::StringWrapper<_Identity> > : std::true_type {};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// write a scalar into a typed value; returns false on a type mismatch. this is also where the known quirks in
+// Endlesss data get absorbed - numbers that arrive as strings ("length":"13") and bools that arrive as 0 / 1
+template< typename _ValueType >
+inline bool assignScalar( _ValueType& out, const Scalar& value )
+{
+    if constexpr ( std::is_same_v<_ValueType, bool> )
+    {
+        switch ( value.type )
+        {
+            case Scalar::Type::Bool: out = value.b;  return true;
+            case Scalar::Type::Int:  if ( value.i == 0 || value.i == 1 ) { out = ( value.i == 1 ); return true; } break;
+            case Scalar::Type::Uint: if ( value.u <= 1 )                 { out = ( value.u == 1 ); return true; } break;
+            default:
+                break;
+        }
+        return false;
+    }
+    else if constexpr ( std::is_integral_v<_ValueType> )
+    {
+        switch ( value.type )
+        {
+            case Scalar::Type::Int:
+                if ( !std::in_range<_ValueType>( value.i ) )
+                    return false;
+                out = static_cast<_ValueType>( value.i );
+                return true;
+
+            case Scalar::Type::Uint:
+                if ( !std::in_range<_ValueType>( value.u ) )
+                    return false;
+                out = static_cast<_ValueType>( value.u );
+                return true;
+
+            case Scalar::Type::String:
+            {
+                _ValueType parsed;
+                const char* strEnd = value.s.data() + value.s.size();
+                auto [ptr, errorCode] = std::from_chars( value.s.data(), strEnd, parsed );
+                if ( errorCode != std::errc() || ptr != strEnd )
+                    return false;
+                out = parsed;
+                return true;
+            }
+
+            default:
+                break;
+        }
+        return false;
+    }
+    else if constexpr ( std::is_floating_point_v<_ValueType> )
+    {
+        switch ( value.type )
+        {
+            case Scalar::Type::Double: out = static_cast<_ValueType>( value.d ); return true;
+            case Scalar::Type::Int:    out = static_cast<_ValueType>( value.i ); return true;
+            case Scalar::Type::Uint:   out = static_cast<_ValueType>( value.u ); return true;
+            default:
+                break;
+        }
+        return false;
+    }
+    else if constexpr ( std::is_same_v<_ValueType, std::string> )
+    {
+        if ( value.type != Scalar::Type::String )
+            return false;
+        out.assign( value.s.data(), value.s.size() );
+        return true;
+    }
+    else if constexpr ( is_string_wrapper<_ValueType>::value )
+    {
+        return assignScalar( out.value(), value );
+    }
+    else
+    {
+        static_assert( sizeof( _ValueType ) == 0, "no scalar conversion for this type" );
+    }
+}
+
+
+struct Object;
+
+enum class Presence : uint8_t
+{
+    Required,       // missing key, null or mismatched value fails the decode
+    Optional        // as per CEREAL_OPTIONAL_NVP; anything unusable is skipped and the default left in place
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct Field
+{
+    enum class Kind : uint8_t
+    {
+        Value,
+        Object,
+        ObjectArray,
+        ValueArray
+    };
+
+    std::string_view    name;
+    Kind                kind;
+    Presence            presence;
+
+    // Value       : write the scalar into the member
+    // ValueArray  : append the scalar to the member vector
+    bool                (*assign)( void* owner, const Scalar& value ) = nullptr;
+
+    // Object      : return the address of the sub-object member
+    // ObjectArray : append a new element to the member vector and return its address
+    void*               (*enter)( void* owner ) = nullptr;
+
+    // ObjectArray / ValueArray : empty the member vector as the array opens, matching cereal's load behaviour
+    void                (*clear)( void* owner ) = nullptr;
+
+    // for Object / ObjectArray, how to decode the contents
+    const Object*       schema = nullptr;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct Object
+{
+    const std::type_info*   owner = nullptr;
+    std::vector< Field >    fields;
+
+    // optional post-decode hook, run once the closing brace is read; return false to reject the object
+    bool                    (*complete)( void* owner ) = nullptr;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// typed builders for Object / Field; the member pointers are baked into small thunks so the decoder itself
+// stays type-erased and lives in one translation unit
+//
+//  using S = data::sax::Schema< Thing >;
+//  static const data::sax::Object schema = S::object( {
+//      S::value< &Thing::name >( "name" ),
+//      S::value< &Thing::count >( "count", data::sax::Presence::Optional ),
+//  });
+//
+template< typename _Owner >
+struct Schema
+{
+    using CompleteHook = bool (*)( _Owner& );
+
+    template< CompleteHook _complete = nullptr >
+    static Object object( std::initializer_list< Field > fields )
+    {
+        Object result;
+        result.owner  = &typeid( _Owner );
+        result.fields = fields;
+
+        if constexpr ( _complete != nullptr )
+        {
+            result.complete = []( void* owner ) -> bool { return _complete( *static_cast<_Owner*>( owner ) ); };
+        }
+
+        // required-key tracking is a 64-bit mask per open object
+        ABSL_ASSERT( result.fields.size() <= 64 );
+        return result;
+    }
+
+    template< auto _member >
+    static Field value( std::string_view name, const Presence presence = Presence::Required )
+    {
+        return Field{ name, Field::Kind::Value, presence,
+            []( void* owner, const Scalar& value ) -> bool
+            {
+                return assignScalar( static_cast<_Owner*>( owner )->*_member, value );
+            } };
+    }
+
+    template< auto _member >
+    static Field nested( std::string_view name, const Object& schema, const Presence presence = Presence::Required )
+    {
+        return Field{ name, Field::Kind::Object, presence, nullptr,
+            []( void* owner ) -> void*
+            {
+                return &( static_cast<_Owner*>( owner )->*_member );
+            },
+            nullptr,
+            &schema };
+    }
+
+    template< auto _member >
+    static Field nestedArray( std::string_view name, const Object& schema, const Presence presence = Presence::Required )
+    {
+        return Field{ name, Field::Kind::ObjectArray, presence, nullptr,
+            []( void* owner ) -> void*
+            {
+                return &( static_cast<_Owner*>( owner )->*_member ).emplace_back();
+            },
+            []( void* owner )
+            {
+                ( static_cast<_Owner*>( owner )->*_member ).clear();
+            },
+            &schema };
+    }
+
+    template< auto _member >
+    static Field valueArray( std::string_view name, const Presence presence = Presence::Required )
+    {
+        return Field{ name, Field::Kind::ValueArray, presence,
+            []( void* owner, const Scalar& value ) -> bool
+            {
+                auto& target = static_cast<_Owner*>( owner )->*_member;
+                if ( assignScalar( target.emplace_back(), value ) )
+                    return true;
+
+                target.pop_back();
+                return false;
+            },
+            nullptr,
+            []( void* owner )
+            {
+                ( static_cast<_Owner*>( owner )->*_member ).clear();
+            } };
+    }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+template< typename _Type >
+concept Decodable = requires
+{
+    { _Type::saxSchema() } -> std::same_as< const Object& >;
+};
+
+// decode the given text into a root object described by schema; the text is read directly from the
+// caller's buffer. on failure the status message includes the byte offset the reader stopped at
+absl::Status decode( std::string_view jsonText, const Object& schema, void* root );
+
+template< Decodable _Type >
+inline absl::Status decode( std::string_view jsonText, _Type& root )
+{
+    const Object& schema = _Type::saxSchema();
+    ABSL_ASSERT( schema.owner != nullptr && *schema.owner == typeid( _Type ) );
+
+    return decode( jsonText, schema, &root );
+}
+
+} // namespace sax
+} // namespace data
@@ -111,6 +111,18 @@ namespace dsp {
                     m_bucketIndices[s] = m_bucketIndices[previousSample - 1];
                 }
             }
+
+            // bucket indices only ever increase across the window, so each bucket also maps to a single contiguous
+            // range of FFT indices; record those so that callers can sum whole ranges in one go
+            m_bucketRangeStart.fill( 0 );
+            m_bucketRangeEnd.fill( 0 );
+            for ( uint32_t s = frequencyBinSize; s > 0; s-- )
+            {
+                const uint8_t bucketAtS = m_bucketIndices[s - 1];
+                if ( m_bucketRangeEnd[bucketAtS] == 0 )
+                    m_bucketRangeEnd[bucketAtS] = s;
+                m_bucketRangeStart[bucketAtS] = s - 1;
+            }
         }
 
         constexpr uint32_t getSizeOfBucketAt( const std::size_t index ) const
@@ -123,6 +135,17 @@ namespace dsp {
             return m_countPerBucketRecpF[index];
         }
 
+        // [start, end) range of FFT indices that feed into the given bucket
+        constexpr uint32_t getBucketRangeStart( const std::size_t index ) const
+        {
+            return m_bucketRangeStart[index];
+        }
+
+        constexpr uint32_t getBucketRangeEnd( const std::size_t index ) const
+        {
+            return m_bucketRangeEnd[index];
+        }
+
         constexpr uint8_t getBucketForFFTIndex( const std::size_t fftIndex ) const
         {
             ABSL_ASSERT( fftIndex < m_bucketIndicesSize );
@@ -133,6 +156,8 @@ namespace dsp {
 
         CountPerBucket      m_countPerBucket;           // how many entries from the FFT block are funneled into each frequency bucket
         RecpFCountPerBucket m_countPerBucketRecpF;
+        CountPerBucket      m_bucketRangeStart;         // first FFT index for each bucket
+        CountPerBucket      m_bucketRangeEnd;           // one-past-last FFT index for each bucket
         uint8_t*            m_bucketIndices = nullptr;  // per entry in the FFT block, which frequency bucket should it
                                                         // be shunted into; precalculated during init
         std::size_t         m_bucketIndicesSize = 0;
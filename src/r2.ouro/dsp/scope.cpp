@@ -13,10 +13,13 @@
 #include "base/mathematics.h"
 #include "dsp/scope.h"
 #include "dsp/octave.h"
+#include "dsp/simd.h"
 
 // fft
 #include "pffft.h"
 
+#include <q/synth/hann_gen.hpp>
+
 using namespace cycfi::q::literals;
 
 namespace dsp {
@@ -24,7 +27,6 @@ namespace dsp {
 // ---------------------------------------------------------------------------------------------------------------------
 Scope8::Scope8( const float measurementLengthSeconds, const uint32_t sampleRate, const config::Spectrum& config )
     : m_sampleRate( sampleRate )
-    , m_hannGenerator( cycfi::q::duration(1.0), 1.0f ) // this has no default ctor, so this is a dummy, it gets reconfigured below
 {
     // stash default config
     setConfiguration( config );
@@ -33,26 +35,30 @@ Scope8::Scope8( const float measurementLengthSeconds, const uint32_t sampleRate,
     const uint32_t samplesPerMeasurement = static_cast<uint32_t>( measurementLengthSeconds * static_cast<float>(m_sampleRate) );
     m_fftWindowSize = base::nextPow2( samplesPerMeasurement );
 
-    blog::core( "Allocating FFT scope with {} samples", m_fftWindowSize );
+    blog::core( "Allocating FFT scope with {} samples, {} hop", m_fftWindowSize, m_config.hopSizeFor( m_fftWindowSize ) );
 
     // create a pffft plan for the chosen size
     m_pffftPlan = pffft_new_setup( m_fftWindowSize, PFFFT_REAL );
 
-    // configure hann window with chosen size
-    m_hannGenerator.config( cycfi::q::duration( (double)m_fftWindowSize / (double)m_sampleRate ), static_cast<float>( m_sampleRate ) );
-
-
-    const uint32_t frequencyBinSize  = m_fftWindowSize / 2;
-    const double frequencyBinSizeDbl = static_cast<double>(frequencyBinSize);
-    const double frequencyResolution = static_cast<double>(m_sampleRate) / frequencyBinSizeDbl;
-
-
     // allocate all worker buffers, reset everything ready
-    m_inputL        = mem::alloc16<float>( m_fftWindowSize );
-    m_inputR        = mem::alloc16<float>( m_fftWindowSize );
+    m_historyL      = mem::alloc16<float>( m_fftWindowSize );
+    m_historyR      = mem::alloc16<float>( m_fftWindowSize );
+    m_windowTable   = mem::alloc16<float>( m_fftWindowSize );
+    m_windowedL     = mem::alloc16<float>( m_fftWindowSize );
+    m_windowedR     = mem::alloc16<float>( m_fftWindowSize );
+    m_fftWork       = mem::alloc16<float>( m_fftWindowSize );
     m_outputL       = mem::alloc16<complexf>( m_fftWindowSize );
     m_outputR       = mem::alloc16<complexf>( m_fftWindowSize );
 
+    // bake the hann window once rather than regenerating it for every FFT
+    {
+        cycfi::q::hann_gen hannGenerator( cycfi::q::duration( (double)m_fftWindowSize / (double)m_sampleRate ), static_cast<float>( m_sampleRate ) );
+        for ( uint32_t sI = 0; sI < m_fftWindowSize; sI++ )
+            m_windowTable[sI] = hannGenerator();
+    }
+
+    m_hopAccumulator.fill( 0.0f );
+
     m_outputBucketsIndex = 0;
     m_outputBuckets[0].fill( 0.0f );
     m_outputBuckets[1].fill( 0.0f );
@@ -68,94 +74,126 @@ Scope8::~Scope8()
 {
     mem::free16( m_outputR );
     mem::free16( m_outputL );
-    mem::free16( m_inputR );
-    mem::free16( m_inputL );
+    mem::free16( m_fftWork );
+    mem::free16( m_windowedR );
+    mem::free16( m_windowedL );
+    mem::free16( m_windowTable );
+    mem::free16( m_historyR );
+    mem::free16( m_historyL );
 
     pffft_destroy_setup( m_pffftPlan );
 }
 
-// if enabled, can ingest multiple fft-blocks' worth of samples in a single append, potentially running fft execute multiple times
-#define SCOPE_ALLOW_MULTI_FFT_PER_APPEND    0
-
 // ---------------------------------------------------------------------------------------------------------------------
 void Scope8::append( const float* samplesLeft, const float* samplesRight, uint32_t sampleCount )
 {
-    // emergency bail on overflow
-    ABSL_ASSERT( m_inputWriteIndex <= m_fftWindowSize );
-    if ( m_inputWriteIndex > m_fftWindowSize )
-        return;
-
-#if SCOPE_ALLOW_MULTI_FFT_PER_APPEND
-    for ( ;; )
-#endif // SCOPE_ALLOW_MULTI_FFT_PER_APPEND
+    // sampled once per append; the config can be swapped out from elsewhere
+    const uint32_t hopSize = m_config.hopSizeFor( m_fftWindowSize );
+
+    while ( sampleCount > 0 )
     {
-        const uint32_t samplesUntilProcess = m_fftWindowSize - m_inputWriteIndex;
+        // copy in as many samples as we can without crossing either a hop boundary or the end of the history ring;
+        // if the hop size shrank underneath us, this will be a single sample before the next analysis
+        const uint32_t samplesUntilHop  = hopSize - std::min( m_samplesSinceHop, hopSize - 1 );
+        const uint32_t samplesUntilWrap = m_fftWindowSize - m_historyWriteIndex;
+        const uint32_t samplesToCopy    = std::min( { sampleCount, samplesUntilHop, samplesUntilWrap } );
 
-        // copy in as many new samples as we can, up to the fill of the fft input buffer
-        const uint32_t samplesToCopy = std::min( samplesUntilProcess, sampleCount );
-        if ( samplesToCopy > 0 )
-        {
-            memcpy( &m_inputL[m_inputWriteIndex], samplesLeft,  samplesToCopy * sizeof( float ) );
-            memcpy( &m_inputR[m_inputWriteIndex], samplesRight, samplesToCopy * sizeof( float ) );
+        memcpy( &m_historyL[m_historyWriteIndex], samplesLeft,  samplesToCopy * sizeof( float ) );
+        memcpy( &m_historyR[m_historyWriteIndex], samplesRight, samplesToCopy * sizeof( float ) );
 
-            m_inputWriteIndex += samplesToCopy;
-            sampleCount  -= samplesToCopy;
-        }
-        // if we filled the buffer, execute the fft and extract the frequency data we want
-        if ( m_inputWriteIndex == m_fftWindowSize )
+        samplesLeft         += samplesToCopy;
+        samplesRight        += samplesToCopy;
+        sampleCount         -= samplesToCopy;
+
+        m_historyWriteIndex += samplesToCopy;
+        if ( m_historyWriteIndex == m_fftWindowSize )
+            m_historyWriteIndex = 0;
+
+        m_historyFill        = std::min( m_historyFill + samplesToCopy, m_fftWindowSize );
+        m_samplesSinceHop   += samplesToCopy;
+
+        if ( m_samplesSinceHop >= hopSize )
         {
-            // optionally apply Hann window which reduces spectral leakage 
-            // https://tinyurl.com/fft-windowing
-            if ( m_config.applyHannWindow )
-            {
-                m_hannGenerator.reset();
-                for ( std::size_t freqBin = 0; freqBin < m_fftWindowSize; freqBin++ )
-                {
-                    const float windowFactor = m_hannGenerator();
-                    m_inputL[freqBin] *= windowFactor;
-                    m_inputR[freqBin] *= windowFactor;
-                }
-            }
-
-            pffft_transform_ordered( m_pffftPlan, m_inputL, reinterpret_cast<float*>(m_outputL), nullptr, PFFFT_FORWARD );
-            pffft_transform_ordered( m_pffftPlan, m_inputR, reinterpret_cast<float*>(m_outputR), nullptr, PFFFT_FORWARD );
-
-            // grab which of the double-buffer arrays we should write into - !the current one
-            const std::size_t currentBufferIdx = m_outputBucketsIndex.load();
-            const std::size_t writeBufferIdx = !currentBufferIdx;
-
-            // reset buckets
-            Result& bucketResult = m_outputBuckets[writeBufferIdx];
-            bucketResult.fill( 0 );
-
-            // sum magnitudes into the chosen buckets
-            for ( std::size_t freqBin = 0; freqBin < m_fftWindowSize / 2; freqBin++ )
-            {
-                const float fftMagL = m_outputL[freqBin].hypot();
-                const float fftMagR = m_outputR[freqBin].hypot();
-
-                bucketResult[ m_octaves.getBucketForFFTIndex(freqBin) ] += (fftMagL + fftMagR) * 0.5f; // #hdd average of magnitudes 'correct' here?
-            }
-
-            // .. then process each bucket
-            for ( std::size_t bucketIndex = 0; bucketIndex < bucketResult.size(); bucketIndex++ )
-            {
-                bucketResult[bucketIndex] *= m_octaves.getRecpSizeOfBucketAt(bucketIndex);
-                bucketResult[bucketIndex]  = m_config.headroomNormaliseDb( bucketResult[bucketIndex] );
-            }
-
-            // flip buffers by updating the current index with the one we just wrote into
-            m_outputBucketsIndex.store( writeBufferIdx );
-
-            // reset the buffer write position ready for the next batch
-            m_inputWriteIndex = 0;
+            m_samplesSinceHop = 0;
+
+            // nothing to analyse until we've seen a full window of input
+            if ( m_historyFill == m_fftWindowSize )
+                analyseHop();
         }
+    }
+
+    if ( m_hopsAccumulated > 0 )
+        publishAccumulatedHops();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Scope8::analyseHop()
+{
+    // the history is full, so the oldest sample sits at the write index; unroll the ring into the FFT input buffers
+    const uint32_t olderSamples = m_fftWindowSize - m_historyWriteIndex;
+    const uint32_t newerSamples = m_historyWriteIndex;
 
-#if SCOPE_ALLOW_MULTI_FFT_PER_APPEND
-        if ( sampleCount == 0 )
-            break;
-#endif // SCOPE_ALLOW_MULTI_FFT_PER_APPEND
+    // optionally apply Hann window which reduces spectral leakage 
+    // https://tinyurl.com/fft-windowing
+    if ( m_config.applyHannWindow )
+    {
+        simd::multiply( m_historyL + m_historyWriteIndex, m_windowTable,                m_windowedL,                olderSamples );
+        simd::multiply( m_historyL,                       m_windowTable + olderSamples, m_windowedL + olderSamples, newerSamples );
+        simd::multiply( m_historyR + m_historyWriteIndex, m_windowTable,                m_windowedR,                olderSamples );
+        simd::multiply( m_historyR,                       m_windowTable + olderSamples, m_windowedR + olderSamples, newerSamples );
     }
+    else
+    {
+        memcpy( m_windowedL,                m_historyL + m_historyWriteIndex, olderSamples * sizeof( float ) );
+        memcpy( m_windowedL + olderSamples, m_historyL,                       newerSamples * sizeof( float ) );
+        memcpy( m_windowedR,                m_historyR + m_historyWriteIndex, olderSamples * sizeof( float ) );
+        memcpy( m_windowedR + olderSamples, m_historyR,                       newerSamples * sizeof( float ) );
+    }
+
+    pffft_transform_ordered( m_pffftPlan, m_windowedL, reinterpret_cast<float*>(m_outputL), m_fftWork, PFFFT_FORWARD );
+    pffft_transform_ordered( m_pffftPlan, m_windowedR, reinterpret_cast<float*>(m_outputR), m_fftWork, PFFFT_FORWARD );
+
+    const float* complexL = reinterpret_cast<const float*>( m_outputL );
+    const float* complexR = reinterpret_cast<const float*>( m_outputR );
+
+    // average the magnitudes across each bucket's contiguous run of FFT bins
+    for ( std::size_t bucketIndex = 0; bucketIndex < FrequencyBucketCount; bucketIndex++ )
+    {
+        const float bucketMagnitude = simd::sumStereoMagnitudes(
+            complexL,
+            complexR,
+            m_octaves.getBucketRangeStart( bucketIndex ),
+            m_octaves.getBucketRangeEnd( bucketIndex ) ) * m_octaves.getRecpSizeOfBucketAt( bucketIndex );
+
+        if ( m_config.bucketPeakHold )
+            m_hopAccumulator[bucketIndex] = std::max( m_hopAccumulator[bucketIndex], bucketMagnitude );
+        else
+            m_hopAccumulator[bucketIndex] += bucketMagnitude;
+    }
+
+    m_hopsAccumulated++;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Scope8::publishAccumulatedHops()
+{
+    // grab which of the double-buffer arrays we should write into - !the current one
+    const std::size_t currentBufferIdx = m_outputBucketsIndex.load();
+    const std::size_t writeBufferIdx = !currentBufferIdx;
+
+    Result& bucketResult = m_outputBuckets[writeBufferIdx];
+
+    const float hopScale = m_config.bucketPeakHold ? 1.0f : ( 1.0f / static_cast<float>( m_hopsAccumulated ) );
+    for ( std::size_t bucketIndex = 0; bucketIndex < bucketResult.size(); bucketIndex++ )
+    {
+        bucketResult[bucketIndex] = m_config.headroomNormaliseDb( m_hopAccumulator[bucketIndex] * hopScale );
+    }
+
+    // flip buffers by updating the current index with the one we just wrote into
+    m_outputBucketsIndex.store( writeBufferIdx );
+
+    m_hopAccumulator.fill( 0.0f );
+    m_hopsAccumulated = 0;
 }
 
 } // namespace dsp
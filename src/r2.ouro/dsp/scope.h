@@ -13,8 +13,6 @@
 #include "dsp/octave.h"
 #include "config/spectrum.h"
 
-#include <q/synth/hann_gen.hpp>
-
 // pffft
 struct PFFFT_Setup;
 
@@ -22,7 +20,9 @@ namespace dsp {
 
 // ---------------------------------------------------------------------------------------------------------------------
 // the 8-bucket fft scope accepts a continual stream of samples; once it has enough, it extracts frequency buckets
-// for visualisation elsewhere
+// for visualisation elsewhere. incoming audio is kept in a rolling window and an FFT is run every hop (see
+// config::Spectrum::analysisOverlap), no matter how many samples arrive per append; all the hops completed during
+// one append are then averaged or peak-held into a single published result
 //
 struct Scope8
 {
@@ -38,8 +38,8 @@ struct Scope8
     inline const config::Spectrum& getConfiguration() const { return m_config; }
     void setConfiguration( const config::Spectrum& config ) { m_config = config; }
 
-    // add sampleCount number of samples from left/right buffers given, potentially running the extraction if the
-    // FFT block is filled
+    // add sampleCount number of samples from left/right buffers given, running the extraction once for every hop
+    // boundary crossed
     void append( const float* samplesLeft, const float* samplesRight, uint32_t sampleCount );
 
     // fetch a copy of the current analysis
@@ -55,7 +55,12 @@ private:
     using FFTOctaves     = dsp::FFTOctaveBuckets< 8 >;
     using ResultBuffers  = std::array< Result, 2 >;
     using ResultIndex    = std::atomic< std::size_t >;
-    using HannGen        = cycfi::q::hann_gen;
+
+    // window + FFT the current history, folding the bucket magnitudes into m_hopAccumulator
+    void analyseHop();
+
+    // combine the accumulated hops into a new result and flip it into view
+    void publishAccumulatedHops();
 
 
     config::Spectrum    m_config;
@@ -65,20 +70,27 @@ private:
 
     PFFFT_Setup*        m_pffftPlan         = nullptr;
 
-    uint32_t            m_inputWriteIndex   = 0;        // point we're actively writing into the input buffers
-    float*              m_inputL            = nullptr;  // accumulation buffer building FFT input data
-    float*              m_inputR            = nullptr;
+    uint32_t            m_historyWriteIndex = 0;        // next write position in the history ring; also the oldest sample once full
+    uint32_t            m_historyFill       = 0;        // how much of the history holds real data, up to m_fftWindowSize
+    uint32_t            m_samplesSinceHop   = 0;        // new samples taken since the last FFT
+    float*              m_historyL          = nullptr;  // rolling window of the most recent input
+    float*              m_historyR          = nullptr;
+    float*              m_windowTable       = nullptr;  // precomputed Hann coefficients
+    float*              m_windowedL         = nullptr;  // FFT input, unrolled from the history and windowed
+    float*              m_windowedR         = nullptr;
+    float*              m_fftWork           = nullptr;  // pffft scratch, so it doesn't have to find its own
     complexf*           m_outputL           = nullptr;  // FFT output stages
     complexf*           m_outputR           = nullptr;
 
+    Result              m_hopAccumulator;               // sum or peak of per-hop bucket magnitudes since the last publish
+    uint32_t            m_hopsAccumulated   = 0;
+
 
     // double-buffered outputs to help avoid other bits of the tool fetching buffers while they are being modified
     ResultIndex         m_outputBucketsIndex;
     ResultBuffers       m_outputBuckets;
 
     FFTOctaves          m_octaves;
-
-    HannGen             m_hannGenerator;
 };
 
 } // namespace dsp
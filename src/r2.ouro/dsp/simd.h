@@ -0,0 +1,195 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//  small set of vectorised helpers for the hot loops that ISPC doesn't cover on every platform;
+//  SSE2 on x64 (always available), NEON on arm64 (eg. the arm half of a universal macOS build), scalar otherwise
+//
+
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define OURO_SIMD_SSE2      1
+#define OURO_SIMD_NEON      0
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OURO_SIMD_SSE2      0
+#define OURO_SIMD_NEON      1
+#include <arm_neon.h>
+#else
+#define OURO_SIMD_SSE2      0
+#define OURO_SIMD_NEON      0
+#endif
+
+namespace dsp {
+namespace simd {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// the name of the active backend, for logging / diagnostics
+constexpr const char* backendName()
+{
+#if OURO_SIMD_SSE2
+    return "SSE2";
+#elif OURO_SIMD_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// given two interleaved (real, imag) complex FFT outputs, return the sum over [binStart, binEnd) of the averaged
+// stereo magnitudes, ie. sum( ( |L[i]| + |R[i]| ) * 0.5 )
+//
+inline float sumStereoMagnitudes( const float* complexL, const float* complexR, const std::size_t binStart, const std::size_t binEnd )
+{
+    std::size_t bin = binStart;
+    float result = 0;
+
+#if OURO_SIMD_SSE2
+
+    __m128 accumulator = _mm_setzero_ps();
+
+    // 4 complex bins per iteration, deinterleaving real/imag pairs out of two loads per channel
+    for ( ; bin + 4 <= binEnd; bin += 4 )
+    {
+        const __m128 l0 = _mm_loadu_ps( complexL + (bin * 2) );
+        const __m128 l1 = _mm_loadu_ps( complexL + (bin * 2) + 4 );
+        const __m128 r0 = _mm_loadu_ps( complexR + (bin * 2) );
+        const __m128 r1 = _mm_loadu_ps( complexR + (bin * 2) + 4 );
+
+        const __m128 lRe = _mm_shuffle_ps( l0, l1, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        const __m128 lIm = _mm_shuffle_ps( l0, l1, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+        const __m128 rRe = _mm_shuffle_ps( r0, r1, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+        const __m128 rIm = _mm_shuffle_ps( r0, r1, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+
+        const __m128 magL = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( lRe, lRe ), _mm_mul_ps( lIm, lIm ) ) );
+        const __m128 magR = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( rRe, rRe ), _mm_mul_ps( rIm, rIm ) ) );
+
+        accumulator = _mm_add_ps( accumulator, _mm_add_ps( magL, magR ) );
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps( lanes, accumulator );
+    result = ( ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] ) ) * 0.5f;
+
+#elif OURO_SIMD_NEON
+
+    float32x4_t accumulator = vdupq_n_f32( 0 );
+
+    for ( ; bin + 4 <= binEnd; bin += 4 )
+    {
+        // vld2 deinterleaves the (real, imag) pairs for us
+        const float32x4x2_t l = vld2q_f32( complexL + (bin * 2) );
+        const float32x4x2_t r = vld2q_f32( complexR + (bin * 2) );
+
+        const float32x4_t magL = vsqrtq_f32( vmlaq_f32( vmulq_f32( l.val[0], l.val[0] ), l.val[1], l.val[1] ) );
+        const float32x4_t magR = vsqrtq_f32( vmlaq_f32( vmulq_f32( r.val[0], r.val[0] ), r.val[1], r.val[1] ) );
+
+        accumulator = vaddq_f32( accumulator, vaddq_f32( magL, magR ) );
+    }
+
+    result = vaddvq_f32( accumulator ) * 0.5f;
+
+#endif
+
+    for ( ; bin < binEnd; bin++ )
+    {
+        const float lRe = complexL[(bin * 2) + 0];
+        const float lIm = complexL[(bin * 2) + 1];
+        const float rRe = complexR[(bin * 2) + 0];
+        const float rIm = complexR[(bin * 2) + 1];
+
+        result += ( std::sqrt( (lRe * lRe) + (lIm * lIm) ) + std::sqrt( (rRe * rRe) + (rIm * rIm) ) ) * 0.5f;
+    }
+
+    return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// output[i] = input[i] * factors[i]; used to apply precomputed window functions
+//
+inline void multiply( const float* input, const float* factors, float* output, const std::size_t count )
+{
+    std::size_t i = 0;
+
+#if OURO_SIMD_SSE2
+    for ( ; i + 4 <= count; i += 4 )
+        _mm_storeu_ps( output + i, _mm_mul_ps( _mm_loadu_ps( input + i ), _mm_loadu_ps( factors + i ) ) );
+#elif OURO_SIMD_NEON
+    for ( ; i + 4 <= count; i += 4 )
+        vst1q_f32( output + i, vmulq_f32( vld1q_f32( input + i ), vld1q_f32( factors + i ) ) );
+#endif
+
+    for ( ; i < count; i++ )
+        output[i] = input[i] * factors[i];
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// output[i] = max( inputA[i], inputB[i] )
+//
+inline void maxOf2( const float* inputA, const float* inputB, float* output, const std::size_t count )
+{
+    std::size_t i = 0;
+
+#if OURO_SIMD_SSE2
+    for ( ; i + 4 <= count; i += 4 )
+        _mm_storeu_ps( output + i, _mm_max_ps( _mm_loadu_ps( inputA + i ), _mm_loadu_ps( inputB + i ) ) );
+#elif OURO_SIMD_NEON
+    for ( ; i + 4 <= count; i += 4 )
+        vst1q_f32( output + i, vmaxq_f32( vld1q_f32( inputA + i ), vld1q_f32( inputB + i ) ) );
+#endif
+
+    for ( ; i < count; i++ )
+        output[i] = std::max( inputA[i], inputB[i] );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// quantise 0..1 floats into 0..255 bytes, truncating like a static_cast<uint8_t>( min( v * 255, 255 ) ); values
+// below zero are clamped to 0
+//
+inline void quantiseUnitToU8( const float* input, uint8_t* output, const std::size_t count )
+{
+    std::size_t i = 0;
+
+#if OURO_SIMD_SSE2
+
+    const __m128 scale   = _mm_set1_ps( 255.0f );
+    const __m128 zero    = _mm_setzero_ps();
+
+    for ( ; i + 16 <= count; i += 16 )
+    {
+        // clamp in float space, then truncate; the saturating packs below are then exact
+        const __m128i i0 = _mm_cvttps_epi32( _mm_max_ps( zero, _mm_min_ps( _mm_mul_ps( _mm_loadu_ps( input + i + 0  ), scale ), scale ) ) );
+        const __m128i i1 = _mm_cvttps_epi32( _mm_max_ps( zero, _mm_min_ps( _mm_mul_ps( _mm_loadu_ps( input + i + 4  ), scale ), scale ) ) );
+        const __m128i i2 = _mm_cvttps_epi32( _mm_max_ps( zero, _mm_min_ps( _mm_mul_ps( _mm_loadu_ps( input + i + 8  ), scale ), scale ) ) );
+        const __m128i i3 = _mm_cvttps_epi32( _mm_max_ps( zero, _mm_min_ps( _mm_mul_ps( _mm_loadu_ps( input + i + 12 ), scale ), scale ) ) );
+
+        const __m128i packed = _mm_packus_epi16( _mm_packs_epi32( i0, i1 ), _mm_packs_epi32( i2, i3 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( output + i ), packed );
+    }
+
+#elif OURO_SIMD_NEON
+
+    const float32x4_t scale = vdupq_n_f32( 255.0f );
+
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        // vcvtq_u32_f32 truncates and saturates negatives to zero
+        const uint32x4_t u0 = vcvtq_u32_f32( vminq_f32( vmulq_f32( vld1q_f32( input + i + 0 ), scale ), scale ) );
+        const uint32x4_t u1 = vcvtq_u32_f32( vminq_f32( vmulq_f32( vld1q_f32( input + i + 4 ), scale ), scale ) );
+
+        const uint16x8_t u16 = vcombine_u16( vmovn_u32( u0 ), vmovn_u32( u1 ) );
+        vst1_u8( output + i, vmovn_u16( u16 ) );
+    }
+
+#endif
+
+    for ( ; i < count; i++ )
+        output[i] = static_cast<uint8_t>( std::clamp( input[i] * 255.0f, 0.0f, 255.0f ) );
+}
+
+} // namespace simd
+} // namespace dsp
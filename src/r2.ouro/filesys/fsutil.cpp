@@ -69,5 +69,14 @@ absl::Status ensureDirectoryExists( const fs::path& path )
     return absl::OkStatus();
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path getThreadTempFileFor( const fs::path& destinationFile )
+{
+    // one writer per thread at any one time, so the thread ID is enough to keep them apart
+    fs::path tempFile = destinationFile;
+    tempFile += fmt::format( FMTX( ".{:x}.tmp" ), std::hash< std::thread::id >{}( std::this_thread::get_id() ) );
+    return tempFile;
+}
+
 } // namespace filesys
 
@@ -15,5 +15,9 @@ bool recursiveSearchBackwards( const char* filenameToFind, fs::path& resultPath
 
 absl::Status ensureDirectoryExists( const fs::path& path );
 
+// a per-thread temporary to stage a write into before moving it over destinationFile; for cache files that more than
+// one thread may be producing at once, where a single shared .tmp would let writers truncate each other's output
+fs::path getThreadTempFileFor( const fs::path& destinationFile );
+
 } // namespace filesys
 
@@ -0,0 +1,139 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//
+//
+
+#include "pch.h"
+
+#include "net/http.pool.h"
+
+namespace base {
+
+// ---------------------------------------------------------------------------------------------------------------------
+HttpClientPool::Lease::Lease( HttpClientPool* pool, std::string key, ClientPtr client, const uint64_t generation, const bool reused )
+    : m_pool( pool )
+    , m_key( std::move( key ) )
+    , m_client( std::move( client ) )
+    , m_generation( generation )
+    , m_reused( reused )
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+HttpClientPool::Lease::Lease( Lease&& rhs ) noexcept
+    : m_pool( rhs.m_pool )
+    , m_key( std::move( rhs.m_key ) )
+    , m_client( std::move( rhs.m_client ) )
+    , m_generation( rhs.m_generation )
+    , m_reused( rhs.m_reused )
+    , m_discard( rhs.m_discard )
+{
+    rhs.m_pool = nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+HttpClientPool::Lease::~Lease()
+{
+    if ( m_pool != nullptr && m_client != nullptr )
+        m_pool->release( std::move( m_key ), std::move( m_client ), m_generation, m_discard );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void HttpClientPool::configure( const std::chrono::seconds idleTimeout, const std::size_t maxIdlePerKey )
+{
+    std::scoped_lock<std::mutex> poolLock( m_mutex );
+
+    m_idleTimeout   = idleTimeout;
+    m_maxIdlePerKey = maxIdlePerKey;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+HttpClientPool::Lease HttpClientPool::acquire( std::string_view key, const ClientFactory& factory )
+{
+    uint64_t generation;
+    {
+        // stale clients are closed after the lock is released
+        IdleClients expiredClients;
+
+        std::scoped_lock<std::mutex> poolLock( m_mutex );
+
+        auto idleIt = m_idle.find( key );
+        if ( idleIt != m_idle.end() )
+        {
+            IdleClients& idleClients = idleIt->second;
+            const auto timeNow = Clock::now();
+
+            // most recently returned clients are at the back, and the most likely to still be connected
+            while ( !idleClients.empty() )
+            {
+                IdleClient idleClient = std::move( idleClients.back() );
+                idleClients.pop_back();
+
+                if ( timeNow - idleClient.m_idleSince > m_idleTimeout )
+                {
+                    expiredClients.emplace_back( std::move( idleClient ) );
+                    m_stats.expired++;
+                    continue;
+                }
+
+                m_stats.reuses++;
+                return Lease( this, std::string( key ), std::move( idleClient.m_client ), m_generation, true );
+            }
+        }
+
+        m_stats.handshakes++;
+
+        // taken before the factory runs; a clear() while it's building means it may have picked up old settings
+        generation = m_generation;
+    }
+
+    // build outside of the lock, SSL client setup is not free
+    return Lease( this, std::string( key ), factory(), generation, false );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void HttpClientPool::release( std::string&& key, ClientPtr&& client, const uint64_t generation, const bool discard )
+{
+    // a closed socket means the last request failed or the server didn't want to keep the connection,
+    // either way there's nothing worth keeping
+    const bool isRecyclable = !discard && client->is_socket_open();
+
+    std::scoped_lock<std::mutex> poolLock( m_mutex );
+
+    if ( isRecyclable && generation == m_generation )
+    {
+        IdleClients& idleClients = m_idle[key];
+        if ( idleClients.size() < m_maxIdlePerKey )
+        {
+            idleClients.emplace_back( IdleClient{ std::move( client ), Clock::now() } );
+            return;
+        }
+    }
+
+    m_stats.discards++;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void HttpClientPool::clear()
+{
+    // close connections outside of the lock
+    absl::flat_hash_map< std::string, IdleClients > idleClients;
+    {
+        std::scoped_lock<std::mutex> poolLock( m_mutex );
+        std::swap( idleClients, m_idle );
+        m_generation++;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+HttpClientPool::Stats HttpClientPool::getStats() const
+{
+    std::scoped_lock<std::mutex> poolLock( m_mutex );
+    return m_stats;
+}
+
+} // namespace base
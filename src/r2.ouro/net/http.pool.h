@@ -0,0 +1,109 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//  pool of keep-alive httplib clients, grouped by an arbitrary key (usually host:port plus whatever else
+//  changes how the client is configured). a client is leased to one thread at a time and handed back when the
+//  lease dies; if its socket was closed during use (transport error, or the server asked to close) it is
+//  dropped instead, so only live connections are ever recycled. clear() starts a new generation, and anything
+//  leased from an older one is dropped on return too, so clients built under old settings never come back
+//
+
+#pragma once
+
+#include "base/construction.h"
+
+namespace base {
+
+class HttpClientPool
+{
+public:
+
+    using ClientPtr     = std::unique_ptr< httplib::ClientImpl >;
+    using ClientFactory = std::function< ClientPtr() >;
+
+    struct Stats
+    {
+        uint64_t    handshakes  = 0;    // leases that had to create a fresh client + connection
+        uint64_t    reuses      = 0;    // leases served from an idle, still-connected client
+        uint64_t    discards    = 0;    // clients thrown away on return; closed, explicitly discarded or from before a clear()
+        uint64_t    expired     = 0;    // idle clients dropped for sitting unused longer than the idle timeout
+    };
+
+    // ---------------------------------------------------------------------------------------------------------------------
+    class Lease
+    {
+    public:
+        DECLARE_NO_COPY( Lease );
+
+        Lease( Lease&& rhs ) noexcept;
+        Lease& operator=( Lease&& rhs ) = delete;
+        ~Lease();
+
+        ouro_nodiscard httplib::ClientImpl* operator->() const { return m_client.get(); }
+        ouro_nodiscard httplib::ClientImpl& operator*() const  { return *m_client; }
+        ouro_nodiscard httplib::ClientImpl* get() const        { return m_client.get(); }
+
+        // true if this client came out of the pool with a connection already established
+        ouro_nodiscard constexpr bool wasReused() const { return m_reused; }
+
+        // don't return this client to the pool, regardless of socket state; eg. after receiving data that
+        // suggests the connection is in a bad way
+        void discard() { m_discard = true; }
+
+    private:
+        friend class HttpClientPool;
+
+        Lease( HttpClientPool* pool, std::string key, ClientPtr client, const uint64_t generation, const bool reused );
+
+        HttpClientPool*     m_pool;
+        std::string         m_key;
+        ClientPtr           m_client;
+        uint64_t            m_generation;
+        bool                m_reused;
+        bool                m_discard = false;
+    };
+
+
+    HttpClientPool() = default;
+    DECLARE_NO_COPY_NO_MOVE( HttpClientPool );
+
+    // idleTimeout ; connections left unused longer than this are not trusted to still be open server-side
+    // maxIdlePerKey ; cap on clients kept waiting per key, should cover the number of threads hitting one host
+    void configure( const std::chrono::seconds idleTimeout, const std::size_t maxIdlePerKey );
+
+    // take an idle client for the given key, or create one with the factory if none are available.
+    // the factory should set up the client completely, including set_keep_alive( true ) if it is to be recycled
+    ouro_nodiscard Lease acquire( std::string_view key, const ClientFactory& factory );
+
+    // drop all idle clients; outstanding leases can finish what they are doing but are discarded on return rather
+    // than recycled, as whatever prompted the clear (eg. new credentials) has probably made them stale
+    void clear();
+
+    ouro_nodiscard Stats getStats() const;
+
+private:
+
+    void release( std::string&& key, ClientPtr&& client, const uint64_t generation, const bool discard );
+
+    using Clock = std::chrono::steady_clock;
+
+    struct IdleClient
+    {
+        ClientPtr           m_client;
+        Clock::time_point   m_idleSince;
+    };
+    using IdleClients = std::vector< IdleClient >;
+
+    mutable std::mutex                              m_mutex;
+    absl::flat_hash_map< std::string, IdleClients > m_idle;
+    Stats                                           m_stats;
+    uint64_t                                        m_generation    = 0;    // bumped by clear()
+
+    std::chrono::seconds                            m_idleTimeout   = std::chrono::seconds( 20 );
+    std::size_t                                     m_maxIdlePerKey = 8;
+};
+
+} // namespace base
@@ -24,6 +24,7 @@
 #include <regex>
 #include <array>
 #include <deque>
+#include <list>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
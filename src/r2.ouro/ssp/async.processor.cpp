@@ -0,0 +1,206 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//
+//
+
+#include "pch.h"
+
+#include "ssp/async.processor.h"
+
+namespace ssp {
+
+namespace {
+
+// samples carry their own position in the stream so the worker can check nothing was lost, repeated or reordered;
+// kept well inside the range of integers a float holds exactly
+static constexpr uint32_t cSequenceMask = ( 1U << 23 ) - 1;
+
+inline float sequenceToSample( const uint64_t position ) { return static_cast<float>( position & cSequenceMask ); }
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct SequenceCheckingProcessor final : public AsyncBufferProcessorIQ24
+{
+    SequenceCheckingProcessor( const uint32_t bufferSampleSize, const std::chrono::microseconds simulatedWorkload )
+        : AsyncBufferProcessorIQ24( bufferSampleSize, "StressTest" )
+        , m_simulatedWorkload( simulatedWorkload )
+    {
+        launchProcessorThread();
+    }
+
+    ~SequenceCheckingProcessor() override
+    {
+        terminateProcessorThread();
+    }
+
+    // stop the worker and account for whatever was left sitting in the final partial page
+    void finish()
+    {
+        terminateProcessorThread();
+
+        auto* activeBuffer = getActiveBuffer();
+        if ( activeBuffer->m_currentSamples > 0 )
+            checkSequence( *activeBuffer );
+    }
+
+    void processBufferedSamplesFromThread( const base::IQ24Buffer& buffer ) override
+    {
+        checkSequence( buffer );
+
+        if ( m_simulatedWorkload.count() > 0 )
+            std::this_thread::sleep_for( m_simulatedWorkload );
+    }
+
+    void checkSequence( const base::IQ24Buffer& buffer )
+    {
+        for ( uint32_t sI = 0; sI < buffer.m_currentSamples; sI++ )
+        {
+            const float left  = buffer.m_interleavedFloat[( sI * 2 ) + 0];
+            const float right = buffer.m_interleavedFloat[( sI * 2 ) + 1];
+
+            // when dropping, gaps are expected; we can only check that the stream never goes backwards
+            // and that the channels stayed paired up
+            const uint64_t position = static_cast<uint64_t>( left );
+            const bool bInOrder = m_bAllowGaps ?
+                ( m_samplesProcessed == 0 || position > m_lastPosition ) :
+                ( left == sequenceToSample( m_samplesProcessed ) );
+
+            if ( !bInOrder || right != -left )
+                m_sequenceErrors++;
+
+            m_lastPosition = position;
+            m_samplesProcessed++;
+        }
+    }
+
+    const std::chrono::microseconds m_simulatedWorkload;
+    bool                            m_bAllowGaps        = false;
+
+    // worker-side accounting, only read once the worker has been stopped
+    uint64_t                        m_samplesProcessed  = 0;
+    uint64_t                        m_lastPosition      = 0;
+    uint64_t                        m_sequenceErrors    = 0;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct StressPass
+{
+    const char*                 m_name;
+    uint32_t                    m_blockSize;
+    OverflowPolicy              m_policy;
+    bool                        m_realtimePaced;        // sleep between blocks as an audio callback would
+    bool                        m_starveWorker;         // make the worker slow enough that the ring overflows
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+AsyncBufferProcessorStressResult runStressPass( const StressPass& pass, const uint32_t sampleRate, const double secondsPerPass )
+{
+    // a worker that takes longer to chew through a page than the page lasts in realtime
+    static constexpr auto cStarvedWorkload = std::chrono::microseconds( 150 * 1000 );
+
+    using Clock = std::chrono::steady_clock;
+
+    AsyncBufferProcessorStressResult result;
+    result.m_name       = pass.m_name;
+    result.m_blockSize  = pass.m_blockSize;
+    result.m_policy     = pass.m_policy;
+
+    // a tenth of a second per page, on the short side compared to the real writers to exercise the ring wrapping
+    const uint32_t pageSamples  = std::max( sampleRate / 10, pass.m_blockSize );
+    const uint64_t totalSamples = static_cast<uint64_t>( secondsPerPass * static_cast<double>( sampleRate ) );
+
+    std::vector< float > blockLeft( pass.m_blockSize );
+    std::vector< float > blockRight( pass.m_blockSize );
+
+    SequenceCheckingProcessor processor( pageSamples, pass.m_starveWorker ? cStarvedWorkload : std::chrono::microseconds::zero() );
+    processor.setOverflowPolicy( pass.m_policy );
+    processor.m_bAllowGaps = ( pass.m_policy == OverflowPolicy::Drop );
+
+    // play the part of the audio callback on its own thread
+    double appendTotalUs = 0;
+    uint64_t blocksAppended = 0;
+
+    std::thread callbackThread( [&]()
+    {
+        OuroveonThreadScope ots( OURO_THREAD_PREFIX "SSP::StressTest" );
+
+        const auto blockDuration = std::chrono::duration< double >( static_cast<double>( pass.m_blockSize ) / static_cast<double>( sampleRate ) );
+        const auto startTime     = Clock::now();
+
+        while ( result.m_samplesProduced < totalSamples )
+        {
+            const uint32_t blockSamples = static_cast<uint32_t>( std::min< uint64_t >( pass.m_blockSize, totalSamples - result.m_samplesProduced ) );
+            for ( uint32_t sI = 0; sI < blockSamples; sI++ )
+            {
+                blockLeft[sI]  =  sequenceToSample( result.m_samplesProduced + sI );
+                blockRight[sI] = -blockLeft[sI];
+            }
+
+            const auto appendStart = Clock::now();
+            processor.appendStereoSamples( blockLeft.data(), blockRight.data(), blockSamples );
+            const double appendUs = std::chrono::duration< double, std::micro >( Clock::now() - appendStart ).count();
+
+            appendTotalUs += appendUs;
+            result.m_appendMaximumUs = std::max( result.m_appendMaximumUs, appendUs );
+            blocksAppended++;
+
+            result.m_samplesProduced += blockSamples;
+
+            if ( pass.m_realtimePaced )
+            {
+                std::this_thread::sleep_until( startTime + std::chrono::duration_cast<Clock::duration>( blockDuration * static_cast<double>( blocksAppended ) ) );
+            }
+        }
+    });
+    callbackThread.join();
+
+    processor.finish();
+
+    result.m_samplesProcessed   = processor.m_samplesProcessed;
+    result.m_samplesDropped     = processor.getOverflowSampleCount();
+    result.m_overflowEvents     = processor.getOverflowEventCount();
+    result.m_sequenceErrors     = processor.m_sequenceErrors;
+    result.m_appendAverageUs    = ( blocksAppended > 0 ) ? ( appendTotalUs / static_cast<double>( blocksAppended ) ) : 0;
+
+    // every sample has to be accounted for one way or the other; beyond that, only the deliberately
+    // starved drop pass is allowed to lose anything
+    const bool bExpectDrops = ( pass.m_starveWorker && pass.m_policy == OverflowPolicy::Drop );
+
+    result.m_passed = ( result.m_sequenceErrors == 0 ) &&
+                      ( result.m_samplesProcessed + result.m_samplesDropped == result.m_samplesProduced ) &&
+                      ( bExpectDrops || result.m_samplesDropped == 0 );
+
+    return result;
+}
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+std::vector< AsyncBufferProcessorStressResult > stressTestAsyncBufferProcessor( const uint32_t sampleRate, const double secondsPerPass )
+{
+    ABSL_ASSERT( sampleRate > 0 );
+
+    // odd block size on the flat-out passes so block and ring boundaries rarely line up
+    static constexpr StressPass cPasses[] =
+    {
+        { "realtime-32",        32, OverflowPolicy::Drop, true,  false },
+        { "realtime-64",        64, OverflowPolicy::Drop, true,  false },
+        { "realtime-128",      128, OverflowPolicy::Drop, true,  false },
+        { "flat-out-wait",      37, OverflowPolicy::Wait, false, false },
+        { "starved-wait",       37, OverflowPolicy::Wait, false, true  },
+        { "starved-drop",       37, OverflowPolicy::Drop, false, true  },
+    };
+
+    std::vector< AsyncBufferProcessorStressResult > results;
+    results.reserve( std::size( cPasses ) );
+
+    for ( const StressPass& pass : cPasses )
+        results.emplace_back( runStressPass( pass, sampleRate, secondsPerPass ) );
+
+    return results;
+}
+
+} // namespace ssp
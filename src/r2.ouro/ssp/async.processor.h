@@ -1,12 +1,16 @@
-//   _______ _______ ______ _______ ___ ___ _______ _______ _______ 
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
 //  |       |   |   |   __ \       |   |   |    ___|       |    |  |
 //  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
 //  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
 //  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
 //
 //  a buffer manager built to help sample processors offload more expensive encoding/compression tasks
-//  to a background worker thread; samples are added via appendStereoSamples() until the active buffer is expended, 
-//  at which point the worker thread is woken up and the buffer pointers exchanged so that the audio thread is not interrupted
+//  to a background worker thread; the audio thread hands planar blocks to appendStereoSamples(), which copies them
+//  into a single-producer / single-consumer ring and returns without taking any locks. the worker drains the ring,
+//  interleaving into a page buffer, and each time the page fills it is quantised and handed on for processing
+//
+//  if the worker falls far enough behind that the ring fills up, the default is to drop the incoming samples (and
+//  count them) rather than stall the audio callback; offline producers can switch to OverflowPolicy::Wait instead
 //
 //  it is intended that an ssp inherits from this processor with a chosen interleaved buffer type and
 //  implements processBufferedSamplesFromThread() that will be called (as you can imagine) from the worker thread
@@ -14,10 +18,14 @@
 
 #pragma once
 
+#include "base/construction.h"
+
 #include "buffer/buffer.iquant.h"
 
 #include "base/instrumentation.h"
 
+#include "ssp/isamplestreamprocessor.h"
+
 
 namespace ssp {
 
@@ -27,17 +35,24 @@ struct AsyncBufferProcessor
     // choose a maximum buffer size and give profile points / diagnostics an identifier
     AsyncBufferProcessor( const uint32_t bufferSampleSize, const char* identifier )
         : m_identifier( identifier )
+        , m_instrEventName( base::instr::internName( identifier ) )
+        , m_ringCapacity( ringCapacityFor( bufferSampleSize ) )
+        , m_ringMask( m_ringCapacity - 1 )
     {
-        m_activePage    = new _bufferType( bufferSampleSize );
-        m_reservePage   = new _bufferType( bufferSampleSize );
+        m_page      = new _bufferType( bufferSampleSize );
+
+        m_ring[0]   = mem::alloc16< float >( m_ringCapacity );
+        m_ring[1]   = mem::alloc16< float >( m_ringCapacity );
     }
 
     virtual ~AsyncBufferProcessor()
     {
         terminateProcessorThread();
 
-        delete m_reservePage;
-        delete m_activePage;
+        mem::free16( m_ring[1] );
+        mem::free16( m_ring[0] );
+
+        delete m_page;
     }
 
     inline void launchProcessorThread()
@@ -55,82 +70,187 @@ struct AsyncBufferProcessor
 #endif // OURO_PLATFORM_WIN
     }
 
+    // stop the worker; anything still in the ring is drained first, so once this returns the only unprocessed
+    // samples are the partial page left in getActiveBuffer()
     inline void terminateProcessorThread()
     {
-        // terminate compressor thread
         if ( m_processorThread )
         {
-            {
-                std::unique_lock<std::mutex> lock( m_processorMutex );
-                m_processorThreadRun = false;
-            }
-            m_processorCVar.notify_one(); // unblock
+            m_processorThreadRun.store( false, std::memory_order_release );
+            m_processorSema.signal();
+
             m_processorThread->join();
             m_processorThread = nullptr;
         }
     }
 
-    // 
-    inline void appendStereoSamples( float* buffer0, float* buffer1, const uint32_t sampleCount )
+    // Drop by default; switch to Wait before feeding samples from a non-realtime source
+    inline void setOverflowPolicy( const OverflowPolicy policy ) { m_overflowPolicy.store( policy, std::memory_order_relaxed ); }
+
+    ouro_nodiscard inline uint64_t getOverflowSampleCount() const { return m_overflowSamples.load( std::memory_order_relaxed ); }
+    ouro_nodiscard inline uint64_t getOverflowEventCount() const  { return m_overflowEvents.load( std::memory_order_relaxed ); }
+
+    // producer side; only ever call from a single thread
+    inline void appendStereoSamples( const float* buffer0, const float* buffer1, const uint32_t sampleCount )
     {
-        if ( m_activePage == nullptr )
-            return;
-
-        size_t   readOffset         = 0;
-        uint32_t samplesRemaining   = sampleCount;
-        uint32_t pageRemaining      = ( m_activePage->m_maximumSamples - m_activePage->m_currentSamples );
-        
-        // if the remaining number of samples would overrun the buffer : 
-        // first take all the samples we can, then flip buffers and trigger the background worker thread
-        if ( samplesRemaining > pageRemaining )
+        uint64_t writeIndex     = m_writeIndex.load( std::memory_order_relaxed );
+        uint32_t samplesWritten = 0;
+        bool     bWorkerWoken   = false;
+
+        while ( samplesWritten < sampleCount )
         {
-            float* currentFpPos = &m_activePage->m_interleavedFloat[m_activePage->m_currentSamples * 2];
-            for ( size_t idxIn = 0, idxOut = 0; idxIn < pageRemaining; idxIn++, idxOut +=2 )
+            // work from our cached view of the consumer's position, only touching its cache line when we seem to be out of room
+            uint64_t ringFree = m_ringCapacity - ( writeIndex - m_producerReadIndex );
+            if ( ringFree == 0 )
             {
-                currentFpPos[idxOut + 0] = buffer0[idxIn];
-                currentFpPos[idxOut + 1] = buffer1[idxIn];
+                m_producerReadIndex = m_readIndex.load( std::memory_order_acquire );
+                ringFree = m_ringCapacity - ( writeIndex - m_producerReadIndex );
             }
 
-            m_activePage->m_currentSamples += pageRemaining;
+            if ( ringFree == 0 )
+            {
+                if ( m_overflowPolicy.load( std::memory_order_relaxed ) == OverflowPolicy::Wait &&
+                     m_processorThreadRun.load( std::memory_order_relaxed ) )
+                {
+                    // make sure the worker is awake to free some space; it drains everything it can see before sleeping again,
+                    // so one signal per stall is enough. once we've made progress it may have gone back to sleep, see below
+                    if ( !bWorkerWoken )
+                    {
+                        m_processorSema.signal();
+                        bWorkerWoken = true;
+                    }
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // no room and no waiting; the rest of this block is lost
+                m_overflowSamples.fetch_add( sampleCount - samplesWritten, std::memory_order_relaxed );
+                m_overflowEvents.fetch_add( 1, std::memory_order_relaxed );
+                break;
+            }
 
-            // offset the initial values for how many samples to read and where to read from for the remaining
-            // copy code outside of this block
-            samplesRemaining -= pageRemaining;
-            readOffset       += pageRemaining;
+            const uint32_t samplesToCopy = static_cast<uint32_t>( std::min< uint64_t >( ringFree, sampleCount - samplesWritten ) );
 
+            // copy planar, split in two if we cross the end of the ring
+            const uint32_t ringStart    = static_cast<uint32_t>( writeIndex & m_ringMask );
+            const uint32_t firstSpan    = std::min( samplesToCopy, m_ringCapacity - ringStart );
+            const uint32_t secondSpan   = samplesToCopy - firstSpan;
 
-            // buffer complete - launch processor stage on background thread and swap to other buffer to continue work
+            memcpy( m_ring[0] + ringStart, buffer0 + samplesWritten, sizeof( float ) * firstSpan );
+            memcpy( m_ring[1] + ringStart, buffer1 + samplesWritten, sizeof( float ) * firstSpan );
+            if ( secondSpan > 0 )
             {
-                // #HDD remove this lock
-                std::unique_lock<std::mutex> lock( m_processorMutex );
-
-                std::swap( m_activePage, m_reservePage );
-                m_activePage->m_currentSamples = 0;
+                memcpy( m_ring[0], buffer0 + samplesWritten + firstSpan, sizeof( float ) * secondSpan );
+                memcpy( m_ring[1], buffer1 + samplesWritten + firstSpan, sizeof( float ) * secondSpan );
             }
-            m_processorCVar.notify_one();
+
+            writeIndex     += samplesToCopy;
+            samplesWritten += samplesToCopy;
+
+            // publish the block to the worker
+            m_writeIndex.store( writeIndex, std::memory_order_release );
+
+            // the signal from any earlier stall has been spent; if the ring fills up again it needs another one
+            bWorkerWoken = false;
         }
 
-        float* currentFpPos = &m_activePage->m_interleavedFloat[m_activePage->m_currentSamples * 2];
-        for ( size_t idxIn = 0, idxOut = 0; idxIn < samplesRemaining; idxIn++, idxOut +=2 )
+        // the worker can sleep until there's a page worth of data for it (or its poll timeout elapses); avoids
+        // paying for a semaphore signal on every tiny callback block
+        if ( writeIndex - m_producerSignalIndex >= m_page->m_maximumSamples )
         {
-            currentFpPos[idxOut + 0] = buffer0[readOffset + idxIn];
-            currentFpPos[idxOut + 1] = buffer1[readOffset + idxIn];
+            m_producerSignalIndex = writeIndex;
+            m_processorSema.signal();
         }
-
-        m_activePage->m_currentSamples += samplesRemaining;
-        m_activePage->m_committed = false;
     }
 
 
 protected:
 
-    _bufferType* getActiveBuffer() { return m_activePage; }
+    // only valid to inspect once the processor thread has been terminated
+    _bufferType* getActiveBuffer() { return m_page; }
 
     virtual void processBufferedSamplesFromThread( const _bufferType& buffer ) = 0;
 
 
 private:
 
+    // smallest power-of-two ring that holds at least one full page, with a floor so tiny pages still have
+    // a reasonable amount of slack for the producer
+    static uint32_t ringCapacityFor( const uint32_t bufferSampleSize )
+    {
+        static constexpr uint32_t cMinimumRingSamples = 8192;
+
+        uint32_t capacity = cMinimumRingSamples;
+        while ( capacity < bufferSampleSize )
+            capacity <<= 1;
+
+        return capacity;
+    }
+
+    // move everything currently published in the ring into the page, processing each time it fills
+    inline void drainRing()
+    {
+        uint64_t       readIndex  = m_readIndex.load( std::memory_order_relaxed );
+        const uint64_t writeIndex = m_writeIndex.load( std::memory_order_acquire );
+
+        while ( readIndex < writeIndex )
+        {
+            const uint32_t pageFree     = m_page->m_maximumSamples - m_page->m_currentSamples;
+            const uint32_t samplesToUse = static_cast<uint32_t>( std::min< uint64_t >( writeIndex - readIndex, pageFree ) );
+
+            const uint32_t ringStart    = static_cast<uint32_t>( readIndex & m_ringMask );
+            const uint32_t firstSpan    = std::min( samplesToUse, m_ringCapacity - ringStart );
+            const uint32_t secondSpan   = samplesToUse - firstSpan;
+
+            float* pageOutput = &m_page->m_interleavedFloat[m_page->m_currentSamples * 2];
+            interleave( m_ring[0] + ringStart, m_ring[1] + ringStart, firstSpan, pageOutput );
+            if ( secondSpan > 0 )
+                interleave( m_ring[0], m_ring[1], secondSpan, pageOutput + ( firstSpan * 2 ) );
+
+            m_page->m_currentSamples += samplesToUse;
+            m_page->m_committed = false;
+
+            // hand the space back to the producer before we go off and do any encoding
+            readIndex += samplesToUse;
+            m_readIndex.store( readIndex, std::memory_order_release );
+
+            if ( m_page->m_currentSamples == m_page->m_maximumSamples )
+            {
+                base::instr::ScopedEvent se( m_instrEventName, "process-samples", base::instr::PresetColour::Orange );
+
+                m_page->quantise();
+                processBufferedSamplesFromThread( *m_page );
+                m_page->m_committed = true;
+                m_page->m_currentSamples = 0;
+            }
+        }
+    }
+
+    static inline void interleave( const float* input0, const float* input1, const uint32_t sampleCount, float* output )
+    {
+        for ( uint32_t idxIn = 0, idxOut = 0; idxIn < sampleCount; idxIn++, idxOut += 2 )
+        {
+            output[idxOut + 0] = input0[idxIn];
+            output[idxOut + 1] = input1[idxIn];
+        }
+    }
+
+    // logging is left to the worker so the audio thread never has to
+    inline void reportOverflow()
+    {
+        const uint64_t overflowSamples = m_overflowSamples.load( std::memory_order_relaxed );
+        if ( overflowSamples != m_overflowSamplesReported )
+        {
+            blog::error::core( FMTX( "[{}] processor fell behind, dropped {} samples ({} total over {} events)" ),
+                m_identifier,
+                overflowSamples - m_overflowSamplesReported,
+                overflowSamples,
+                m_overflowEvents.load( std::memory_order_relaxed ) );
+
+            m_overflowSamplesReported = overflowSamples;
+        }
+    }
+
     inline void processorThreadWorker()
     {
         const auto threadName = fmt::format( "{}{}:Processor", OURO_THREAD_PREFIX, m_identifier );
@@ -138,42 +258,73 @@ private:
 
         blog::core( "[{}] processor thread launched", m_identifier );
 
-        ABSL_ASSERT( m_reservePage != nullptr );
+        static constexpr std::int64_t cWorkerPollTimeoutUs = 100 * 1000;
+
         for ( ;; )
         {
-            std::unique_lock<std::mutex> lock( m_processorMutex );
-            m_processorCVar.wait( lock );
-
-            if ( !m_processorThreadRun )
-                break;
+            m_processorSema.wait( cWorkerPollTimeoutUs );
 
-            {
-                base::instr::ScopedEvent se( m_identifier.c_str(), "process-samples", base::instr::PresetColour::Orange );
+            // sample the run flag before draining so that anything appended prior to a stop request is always picked up
+            const bool bKeepRunning = m_processorThreadRun.load( std::memory_order_acquire );
 
-                m_reservePage->quantise();
-                processBufferedSamplesFromThread( *m_reservePage );
-                m_reservePage->m_committed = true;
-            }
+            drainRing();
+            reportOverflow();
 
-            lock.unlock();
+            if ( !bKeepRunning )
+                break;
         }
     }
 
 
+    std::string                     m_identifier;
+    const char*                     m_instrEventName;                   // interned copy, outlives us for trace capture
+
     std::unique_ptr< std::thread >  m_processorThread;
     std::atomic_bool                m_processorThreadRun    = false;
+    mcc::LightweightSemaphore       m_processorSema;                    // producer -> worker wake-up
 
-    // inter-thread communication to signal compression jobs ready
-    std::mutex                      m_processorMutex;
-    std::condition_variable         m_processorCVar;
+    std::atomic< OverflowPolicy >   m_overflowPolicy        = OverflowPolicy::Drop;
+    std::atomic_uint64_t            m_overflowSamples       = 0;
+    std::atomic_uint64_t            m_overflowEvents        = 0;
+    uint64_t                        m_overflowSamplesReported = 0;      // worker only
 
-    std::string                     m_identifier;
+    // planar sample ring; indices increase forever and are masked on access
+    const uint32_t                  m_ringCapacity;
+    const uint32_t                  m_ringMask;
+    float*                          m_ring[2]               = { nullptr, nullptr };
+
+    alignas( 64 ) std::atomic_uint64_t m_writeIndex         = 0;        // written by the producer
+    uint64_t                        m_producerReadIndex     = 0;        // producer's last view of m_readIndex
+    uint64_t                        m_producerSignalIndex   = 0;        // write position at the last worker wake-up
 
-    _bufferType*                    m_activePage            = nullptr;
-    _bufferType*                    m_reservePage           = nullptr;
+    alignas( 64 ) std::atomic_uint64_t m_readIndex          = 0;        // written by the worker
+
+    _bufferType*                    m_page                  = nullptr;  // owned by the worker while it is running
 };
 
 using AsyncBufferProcessorIQ16 = AsyncBufferProcessor< base::IQ16Buffer >;
 using AsyncBufferProcessorIQ24 = AsyncBufferProcessor< base::IQ24Buffer >;
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// runs an AsyncBufferProcessor against a simulated audio callback - small blocks at realtime pace, then flat-out with
+// a deliberately slow worker under both overflow policies - checking every sample arrives in order and that drops are
+// accounted for exactly. returns one entry per pass
+//
+struct AsyncBufferProcessorStressResult
+{
+    std::string     m_name;
+    uint32_t        m_blockSize             = 0;
+    OverflowPolicy  m_policy                = OverflowPolicy::Drop;
+    uint64_t        m_samplesProduced       = 0;
+    uint64_t        m_samplesProcessed      = 0;
+    uint64_t        m_samplesDropped        = 0;
+    uint64_t        m_overflowEvents        = 0;
+    uint64_t        m_sequenceErrors        = 0;    // samples that arrived out of order or corrupted
+    double          m_appendAverageUs       = 0;
+    double          m_appendMaximumUs       = 0;
+    bool            m_passed                = false;
+};
+std::vector< AsyncBufferProcessorStressResult > stressTestAsyncBufferProcessor( const uint32_t sampleRate, const double secondsPerPass );
+
 } // namespace ssp
@@ -17,6 +17,13 @@ namespace ssp {
 struct _stream_processor_id {};
 using StreamProcessorInstanceID = base::id::Simple<_stream_processor_id, uint32_t, 1, 0>;
 
+// what a processor does when samples arrive faster than it can deal with them
+enum class OverflowPolicy
+{
+    Drop,       // discard and count them; never block the caller. the only sane choice on the audio thread
+    Wait,       // block the caller until there is room, for offline rendering where every sample matters
+};
+
 // ---------------------------------------------------------------------------------------------------------------------
 struct ISampleStreamProcessor
 {
@@ -31,6 +38,13 @@ struct ISampleStreamProcessor
     // for UI feedback; general 'data storage' estimate, could be bytes on disk, could be memory usage, could be both
     virtual uint64_t getStorageUsageInBytes() const = 0;
 
+    // processors that buffer work onto another thread can choose how to handle falling behind; set this before
+    // appending any samples. processors that do their work inline ignore it
+    virtual void setOverflowPolicy( const OverflowPolicy policy ) {}
+
+    // total samples discarded so far under OverflowPolicy::Drop
+    virtual uint64_t getOverflowSampleCount() const { return 0; }
+
 
 protected:
     StreamProcessorInstanceID m_streamProcessorInstanceID;
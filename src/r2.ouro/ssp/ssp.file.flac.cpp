@@ -1,10 +1,10 @@
-//   _______ _______ ______ _______ ___ ___ _______ _______ _______ 
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
 //  |       |   |   |   __ \       |   |   |    ___|       |    |  |
 //  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
 //  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
 //  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
 //
-//  
+//
 //
 
 #include "pch.h"
@@ -22,12 +22,205 @@
 
 #include "FLAC++/encoder.h"
 
+#include <openssl/evp.h>
+
 
 namespace ssp {
 
+namespace {
+
+std::mutex                  gDefaultEncoderOptionsMutex;
+FLACWriter::EncoderOptions  gDefaultEncoderOptions;
+
+// ---------------------------------------------------------------------------------------------------------------------
+FILE* openOutputFile( const std::u16string& outputFileU16, const std::string& outputFileU8 )
+{
+#if OURO_PLATFORM_WIN
+    // wchar_t is 2 bytes on Windows and expects utf16, so pass it that
+    return _wfopen( reinterpret_cast<const wchar_t*>(outputFileU16.c_str()), L"w+b" );
+#else
+    // elsewhere ... the OS is hopefully on board by default, just pass the utf8-capable 8-bit string
+    // https://stackoverflow.com/questions/396567/is-there-a-standard-way-to-do-an-fopen-with-a-unicode-string-file-path
+    return fopen( outputFileU8.c_str(), "w+b" );
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// the two checksums carried in every FLAC frame; CRC-8 (poly 0x07) over the header, CRC-16 (poly 0x8005) over the lot
+//
+template< typename _crcType, _crcType _polynomial >
+struct CRCTable
+{
+    constexpr CRCTable()
+    {
+        constexpr int shift = ( sizeof( _crcType ) - 1 ) * 8;
+        for ( uint32_t byte = 0; byte < 256; byte++ )
+        {
+            _crcType crc = static_cast<_crcType>( byte << shift );
+            for ( int bit = 0; bit < 8; bit++ )
+                crc = static_cast<_crcType>( ( crc & ( 1U << ( shift + 7 ) ) ) ? ( ( crc << 1 ) ^ _polynomial ) : ( crc << 1 ) );
+            m_table[byte] = crc;
+        }
+    }
+
+    _crcType compute( const uint8_t* data, const std::size_t bytes ) const
+    {
+        constexpr int shift = ( sizeof( _crcType ) - 1 ) * 8;
+        _crcType crc = 0;
+        for ( std::size_t i = 0; i < bytes; i++ )
+            crc = static_cast<_crcType>( ( crc << 8 ) ^ m_table[ ( ( crc >> shift ) ^ data[i] ) & 0xFF ] );
+        return crc;
+    }
+
+    _crcType m_table[256] = {};
+};
+static constexpr CRCTable< uint8_t,  0x07 >   cFrameCRC8;
+static constexpr CRCTable< uint16_t, 0x8005 > cFrameCRC16;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// copy a frame, replacing the frame number in its header and fixing up both CRCs to match. frames are numbered from
+// zero by each chunk's encoder; the number is stored in a variable-length UTF-8 style encoding, so the header can
+// change size. returns false if the frame doesn't look like one libFLAC wrote for a fixed-blocksize stream
+//
+bool renumberFrame( const uint8_t* frame, const std::size_t frameBytes, const uint64_t frameNumber, std::vector< uint8_t >& output )
+{
+    // sync code, blocking strategy, block size / rate / channel / depth codes, first byte of the number, CRC-8, CRC-16
+    if ( frameBytes < 7 || frame[0] != 0xFF || frame[1] != 0xF8 )
+        return false;
+
+    const uint8_t leadingNumberByte = frame[4];
+    std::size_t   numberBytes       = 1;
+    if ( leadingNumberByte & 0x80 )
+    {
+        // count of leading 1 bits gives the total length
+        numberBytes = 0;
+        while ( numberBytes < 8 && ( leadingNumberByte & ( 0x80 >> numberBytes ) ) )
+            numberBytes++;
+
+        if ( numberBytes < 2 || numberBytes > 7 )
+            return false;
+    }
+
+    const uint8_t blockSizeCode  = frame[2] >> 4;
+    const uint8_t sampleRateCode = frame[2] & 0x0F;
+
+    std::size_t trailingHeaderBytes = 0;
+    if ( blockSizeCode == 6 )                           trailingHeaderBytes += 1;
+    if ( blockSizeCode == 7 )                           trailingHeaderBytes += 2;
+    if ( sampleRateCode == 12 )                         trailingHeaderBytes += 1;
+    if ( sampleRateCode == 13 || sampleRateCode == 14 ) trailingHeaderBytes += 2;
+
+    const std::size_t oldHeaderBytes = 4 + numberBytes + trailingHeaderBytes;    // up to but not including the CRC-8
+    if ( oldHeaderBytes + 1 + 2 > frameBytes )
+        return false;
+
+    output.clear();
+    output.insert( output.end(), frame, frame + 4 );
+
+    // a 31-bit frame number takes at most 6 bytes
+    ABSL_ASSERT( frameNumber < ( 1ULL << 31 ) );
+    if ( frameNumber < 0x80 )
+    {
+        output.push_back( static_cast<uint8_t>( frameNumber ) );
+    }
+    else
+    {
+        int continuationBytes = 1;
+        while ( frameNumber >= ( 1ULL << ( 5 * continuationBytes + 6 ) ) )
+            continuationBytes++;
+
+        const uint8_t leadingMask = static_cast<uint8_t>( 0xFF00 >> ( continuationBytes + 1 ) );
+        output.push_back( static_cast<uint8_t>( leadingMask | ( frameNumber >> ( 6 * continuationBytes ) ) ) );
+        for ( int i = continuationBytes - 1; i >= 0; i-- )
+            output.push_back( static_cast<uint8_t>( 0x80 | ( ( frameNumber >> ( 6 * i ) ) & 0x3F ) ) );
+    }
+
+    output.insert( output.end(), frame + 4 + numberBytes, frame + oldHeaderBytes );
+    output.push_back( cFrameCRC8.compute( output.data(), output.size() ) );
+
+    // subframes are byte-aligned after the header and don't refer to it, so carry them over untouched
+    output.insert( output.end(), frame + oldHeaderBytes + 1, frame + frameBytes - 2 );
+
+    const uint16_t frameCRC = cFrameCRC16.compute( output.data(), output.size() );
+    output.push_back( static_cast<uint8_t>( frameCRC >> 8 ) );
+    output.push_back( static_cast<uint8_t>( frameCRC & 0xFF ) );
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// shared by all chunked writers, so eight multitrack outputs plus the final mix don't each spin up their own set
+//
+tf::Executor& getChunkEncoderPool()
+{
+    static tf::Executor chunkEncoderPool( std::clamp( std::thread::hardware_concurrency() / 2, 2U, OURO_THREAD_LIMIT ) );
+    return chunkEncoderPool;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// a run of whole frames, encoded as if it were a stream of its own
+//
+struct EncodedChunk
+{
+    uint64_t                    m_firstSample       = 0;
+    uint64_t                    m_firstFrame        = 0;
+    uint32_t                    m_sampleCount       = 0;
+
+    std::vector< int32_t >      m_interleaved;                  // quantised input, released once encoded
+
+    std::vector< uint8_t >      m_frameData;                    // frames as the encoder wrote them, numbered from 0
+    std::vector< std::size_t >  m_frameOffsets;                 // where each frame begins in m_frameData
+    bool                        m_encodedOk         = false;
+
+    std::atomic_bool            m_complete          = false;
+};
+using EncodedChunkPtr = std::shared_ptr< EncodedChunk >;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// captures encoded frames into memory, dropping the stream header & metadata that libFLAC writes at the start
+//
+struct ChunkEncoder final : public FLAC::Encoder::Stream
+{
+    ChunkEncoder( EncodedChunk& chunk )
+        : m_chunk( chunk )
+    {}
+
+    ::FLAC__StreamEncoderWriteStatus write_callback( const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame ) override
+    {
+        // frames arrive whole, one call each; anything with no samples attached is metadata
+        if ( samples > 0 )
+        {
+            m_chunk.m_frameOffsets.push_back( m_chunk.m_frameData.size() );
+            m_chunk.m_frameData.insert( m_chunk.m_frameData.end(), buffer, buffer + bytes );
+        }
+        return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+    }
+
+    EncodedChunk&   m_chunk;
+};
+
+} // anonymous namespace
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct FLACWriter::StreamInstance
+{
+    virtual ~StreamInstance() {}
+
+    // called from audio thread
+    virtual void appendStereo( const float* buffer0, const float* buffer1, const uint32_t sampleCount ) = 0;
+
+    virtual uint64_t getBytesWritten() const = 0;
+
+    virtual void setOverflowPolicy( const OverflowPolicy policy ) = 0;
+    virtual uint64_t getOverflowSampleCount() const = 0;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
 // represents the live FLAC output stream with our own pre-buffering / float-to-int conversion stage infront
-struct FLACWriter::StreamInstance final : public FLAC::Encoder::File,
-                                          public AsyncBufferProcessorIQ24
+struct FLACWriter::SerialStreamInstance final : public FLACWriter::StreamInstance,
+                                                public FLAC::Encoder::File,
+                                                public AsyncBufferProcessorIQ24
 {
     // FLAC::Encoder::File
     virtual void progress_callback(
@@ -39,14 +232,14 @@ struct FLACWriter::StreamInstance final : public FLAC::Encoder::File,
         m_flacFileBytesWritten = bytes_written;
     }
 
-    StreamInstance( const uint32_t bufferSizeInSamples )
+    SerialStreamInstance( const uint32_t bufferSizeInSamples )
         : FLAC::Encoder::File()
         , AsyncBufferProcessorIQ24( bufferSizeInSamples, "FLAC" )
     {
         launchProcessorThread();
     }
 
-    ~StreamInstance() override
+    ~SerialStreamInstance() override
     {
         // slam the breaks on the thread, allowing any active processing to finish
         terminateProcessorThread();
@@ -102,12 +295,17 @@ struct FLACWriter::StreamInstance final : public FLAC::Encoder::File,
         }
     }
 
-    // called from audio thread
-    void appendStereo( float* buffer0, float* buffer1, const uint32_t sampleCount )
+    // FLACWriter::StreamInstance
+    void appendStereo( const float* buffer0, const float* buffer1, const uint32_t sampleCount ) override
     {
         appendStereoSamples( buffer0, buffer1, sampleCount );
     }
 
+    uint64_t getBytesWritten() const override { return m_flacFileBytesWritten; }
+
+    void setOverflowPolicy( const OverflowPolicy policy ) override { AsyncBufferProcessorIQ24::setOverflowPolicy( policy ); }
+    uint64_t getOverflowSampleCount() const override { return AsyncBufferProcessorIQ24::getOverflowSampleCount(); }
+
 
     FILE*                   m_flacFileHandle            = nullptr;
     FLAC__uint64            m_flacFileBytesWritten      = 0;            // updated in overridden component of the stream encoder (post process_interleaved)
@@ -115,23 +313,431 @@ struct FLACWriter::StreamInstance final : public FLAC::Encoder::File,
     uint32_t                m_commitsBeforeFlush        = 0;
 };
 
+// ---------------------------------------------------------------------------------------------------------------------
+// FLAC frames are independent of one another, so the stream can be cut into runs of whole frames that are each fed
+// through their own encoder on the worker pool. the processor thread hands out chunks as its pages fill, then writes
+// the results back in order, renumbering each frame to its place in the full stream. each page is split across the
+// pool rather than being a chunk of its own, so that short streams (like riff export stems, which are mostly less than
+// a page long and arrive all at once) still spread over several workers. as we're writing the file
+// ourselves, STREAMINFO (including the MD5 of the audio, computed here as the chunks go out) and a seek table with a
+// point per chunk are reserved up front and filled in once the stream is finished
+//
+struct FLACWriter::ChunkedStreamInstance final : public FLACWriter::StreamInstance,
+                                                 public AsyncBufferProcessorIQ24
+{
+    static constexpr uint32_t   cBlockSize              = 4096;     // samples per frame, the libFLAC default for levels 3+
+    static constexpr uint32_t   cBlocksPerPage          = 64;       // ~5.5s at 48kHz per processor page
+    static constexpr uint32_t   cPageSamples            = cBlockSize * cBlocksPerPage;
+    static constexpr uint32_t   cMinimumBlocksPerChunk  = 8;        // ~0.7s at 48kHz; below this, encoder setup starts to show
+    static constexpr uint32_t   cSeekPointCapacity      = 1024;     // space reserved for the seek table, as we don't know the final length
+    static constexpr uint32_t   cBitsPerSample          = 24;
+    static constexpr uint32_t   cChannels               = 2;
+
+    static constexpr std::size_t cStreamInfoBytes       = 34;
+    static constexpr std::size_t cSeekPointBytes        = 18;
+    static constexpr std::size_t cStreamInfoOffset      = 4 + 4;                                            // after "fLaC" and its block header
+    static constexpr std::size_t cSeekTableOffset       = cStreamInfoOffset + cStreamInfoBytes + 4;
+    static constexpr std::size_t cHeaderBytes           = cSeekTableOffset + ( cSeekPointCapacity * cSeekPointBytes );
+
+    struct SeekPoint
+    {
+        uint64_t    m_sampleNumber;
+        uint64_t    m_streamOffset;     // bytes from the first frame
+        uint32_t    m_frameSamples;
+    };
+
+    ChunkedStreamInstance( FILE* outputFile, const uint32_t sampleRate, const EncoderOptions& options )
+        : AsyncBufferProcessorIQ24( cPageSamples, "FLAC" )
+        , m_outputFile( outputFile )
+        , m_sampleRate( sampleRate )
+        , m_options( options )
+        , m_workerCount( std::max( static_cast<uint32_t>( getChunkEncoderPool().num_workers() ), 1U ) )
+        , m_maximumChunksInFlight( m_workerCount * 2 )                 // enough for one page to be encoding while the next is handed out
+        , m_chunkCompleteSema( std::make_shared< mcc::LightweightSemaphore >() )
+    {
+        m_md5Context = EVP_MD_CTX_new();
+        EVP_DigestInit_ex( m_md5Context, EVP_md5(), nullptr );
+
+        launchProcessorThread();
+    }
+
+    ~ChunkedStreamInstance() override
+    {
+        terminateProcessorThread();
+
+        // the partial page left behind becomes the final (short) chunk
+        auto* activeBuffer = getActiveBuffer();
+        if ( activeBuffer &&
+             activeBuffer->m_currentSamples > 0 )
+        {
+            ABSL_ASSERT( activeBuffer->m_committed == false );
+
+            activeBuffer->quantise();
+            processBufferedSamplesFromThread( *activeBuffer );
+        }
+
+        // everything still out on the pool must come back before we can finish the file
+        writeCompletedChunks( true );
+
+        finishStream();
+
+        EVP_MD_CTX_free( m_md5Context );
+    }
+
+    // reserve the header; called once before any samples arrive, the contents are filled in by finishStream()
+    static bool writeStreamHeader( FILE* outputFile, const uint32_t sampleRate )
+    {
+        std::vector< uint8_t > header;
+        header.reserve( cHeaderBytes );
+
+        header.insert( header.end(), { 'f', 'L', 'a', 'C' } );
+
+        appendBlockHeader( header, false, 0, cStreamInfoBytes );
+        appendStreamInfo( header, sampleRate, 0, 0, 0, nullptr );
+
+        appendBlockHeader( header, true, 3, cSeekPointCapacity * cSeekPointBytes );
+        for ( uint32_t sI = 0; sI < cSeekPointCapacity; sI++ )
+            appendSeekPoint( header, { std::numeric_limits<uint64_t>::max(), 0, 0 } );
+
+        ABSL_ASSERT( header.size() == cHeaderBytes );
+        return fwrite( header.data(), 1, header.size(), outputFile ) == header.size();
+    }
+
+    // buffer will already be quantised ready for reading; the page is cut into whole-frame chunks, one per worker where
+    // there's enough audio to go round
+    void processBufferedSamplesFromThread( const base::IQ24Buffer& buffer ) override
+    {
+        const uint32_t sampleCount = buffer.m_currentSamples;
+        const uint32_t valueCount  = sampleCount * cChannels;
+
+        // checksum runs over the samples in order, so has to happen here rather than out on the pool
+        {
+            m_md5Scratch.resize( valueCount * 3 );
+            for ( uint32_t vI = 0, bI = 0; vI < valueCount; vI++, bI += 3 )
+            {
+                const uint32_t value = static_cast<uint32_t>( buffer.m_interleavedQuant[vI] );
+                m_md5Scratch[bI + 0] = static_cast<uint8_t>( value );
+                m_md5Scratch[bI + 1] = static_cast<uint8_t>( value >> 8 );
+                m_md5Scratch[bI + 2] = static_cast<uint8_t>( value >> 16 );
+            }
+            EVP_DigestUpdate( m_md5Context, m_md5Scratch.data(), m_md5Scratch.size() );
+        }
+
+        const uint32_t pageBlocks       = ( sampleCount + cBlockSize - 1 ) / cBlockSize;
+        const uint32_t chunkCount       = std::clamp( pageBlocks / cMinimumBlocksPerChunk, 1U, m_workerCount );
+        const uint32_t blocksPerChunk   = ( pageBlocks + chunkCount - 1 ) / chunkCount;
+
+        for ( uint32_t pageOffset = 0; pageOffset < sampleCount; )
+        {
+            const uint32_t chunkSamples = std::min( blocksPerChunk * cBlockSize, sampleCount - pageOffset );
+
+            auto chunk = std::make_shared< EncodedChunk >();
+            chunk->m_firstSample    = m_samplesSubmitted;
+            chunk->m_firstFrame     = m_samplesSubmitted / cBlockSize;
+            chunk->m_sampleCount    = chunkSamples;
+            chunk->m_interleaved.assign(
+                buffer.m_interleavedQuant + ( pageOffset * cChannels ),
+                buffer.m_interleavedQuant + ( ( pageOffset + chunkSamples ) * cChannels ) );
+
+            // all chunks apart from the last are whole frames, which keeps the frame numbering simple
+            ABSL_ASSERT( m_samplesSubmitted % cBlockSize == 0 );
+            m_samplesSubmitted += chunkSamples;
+            pageOffset         += chunkSamples;
+
+            m_chunksInFlight.push_back( chunk );
+
+            // the task keeps its own references so it never has to touch this instance
+            getChunkEncoderPool().silent_async( [chunk, completion = m_chunkCompleteSema, sampleRate = m_sampleRate, options = m_options]()
+            {
+                encodeChunk( *chunk, sampleRate, options );
+
+                chunk->m_complete.store( true, std::memory_order_release );
+                completion->signal();
+            });
+        }
+
+        writeCompletedChunks( false );
+    }
+
+    // FLACWriter::StreamInstance
+    void appendStereo( const float* buffer0, const float* buffer1, const uint32_t sampleCount ) override
+    {
+        appendStereoSamples( buffer0, buffer1, sampleCount );
+    }
+
+    uint64_t getBytesWritten() const override { return m_bytesWritten.load( std::memory_order_relaxed ); }
+
+    void setOverflowPolicy( const OverflowPolicy policy ) override { AsyncBufferProcessorIQ24::setOverflowPolicy( policy ); }
+    uint64_t getOverflowSampleCount() const override { return AsyncBufferProcessorIQ24::getOverflowSampleCount(); }
+
+
+private:
+
+    static void encodeChunk( EncodedChunk& chunk, const uint32_t sampleRate, const EncoderOptions& options )
+    {
+        base::instr::ScopedEvent se( "FLAC", "encode-chunk", base::instr::PresetColour::Orange );
+
+        ChunkEncoder encoder( chunk );
+
+        bool flacConfig = true;
+        flacConfig &= encoder.set_verify( options.m_verify );
+        flacConfig &= encoder.set_compression_level( options.m_compressionLevel );
+        flacConfig &= encoder.set_blocksize( cBlockSize );                 // after the compression level, which also sets it
+        flacConfig &= encoder.set_channels( cChannels );
+        flacConfig &= encoder.set_bits_per_sample( cBitsPerSample );
+        flacConfig &= encoder.set_sample_rate( sampleRate );
+        flacConfig &= encoder.set_total_samples_estimate( chunk.m_sampleCount );
+
+        if ( flacConfig && encoder.init() == FLAC__STREAM_ENCODER_INIT_STATUS_OK )
+        {
+            chunk.m_frameData.reserve( chunk.m_interleaved.size() * 2 );
+
+            chunk.m_encodedOk  = encoder.process_interleaved( chunk.m_interleaved.data(), chunk.m_sampleCount );
+            chunk.m_encodedOk &= encoder.finish();
+        }
+
+        std::vector< int32_t >().swap( chunk.m_interleaved );
+    }
+
+    // write finished chunks out in stream order; if asked to, or if too many are queued up, block until they're done
+    void writeCompletedChunks( const bool bWaitForAll )
+    {
+        while ( !m_chunksInFlight.empty() )
+        {
+            EncodedChunk& oldestChunk = *m_chunksInFlight.front();
+
+            if ( !oldestChunk.m_complete.load( std::memory_order_acquire ) )
+            {
+                if ( !bWaitForAll && m_chunksInFlight.size() <= m_maximumChunksInFlight )
+                    break;
+
+                m_chunkCompleteSema->wait();
+                continue;
+            }
+
+            writeChunk( oldestChunk );
+            m_chunksInFlight.pop_front();
+        }
+    }
+
+    void writeChunk( const EncodedChunk& chunk )
+    {
+        if ( !chunk.m_encodedOk )
+        {
+            // the file stays readable, with a gap in it
+            blog::error::core( "FLAC chunk encoding failed, {} samples lost at sample {}", chunk.m_sampleCount, chunk.m_firstSample );
+            m_audioLost = true;
+            return;
+        }
+
+        m_seekPoints.emplace_back( SeekPoint{ chunk.m_firstSample, m_frameBytesWritten, std::min( chunk.m_sampleCount, cBlockSize ) } );
+
+        for ( std::size_t fI = 0; fI < chunk.m_frameOffsets.size(); fI++ )
+        {
+            const std::size_t frameStart = chunk.m_frameOffsets[fI];
+            const std::size_t frameEnd   = ( fI + 1 < chunk.m_frameOffsets.size() ) ? chunk.m_frameOffsets[fI + 1] : chunk.m_frameData.size();
+
+            if ( !renumberFrame( &chunk.m_frameData[frameStart], frameEnd - frameStart, chunk.m_firstFrame + fI, m_frameScratch ) )
+            {
+                blog::error::core( "FLAC chunk produced an unexpected frame header, frame {} dropped", chunk.m_firstFrame + fI );
+                m_audioLost = true;
+                continue;
+            }
+
+            fwrite( m_frameScratch.data(), 1, m_frameScratch.size(), m_outputFile );
+
+            const uint32_t frameBytes = static_cast<uint32_t>( m_frameScratch.size() );
+            m_minimumFrameBytes  = ( m_minimumFrameBytes == 0 ) ? frameBytes : std::min( m_minimumFrameBytes, frameBytes );
+            m_maximumFrameBytes  = std::max( m_maximumFrameBytes, frameBytes );
+            m_frameBytesWritten += frameBytes;
+        }
+
+        m_samplesWritten += chunk.m_sampleCount;
+
+        fflush( m_outputFile );
+        m_bytesWritten.store( cHeaderBytes + m_frameBytesWritten, std::memory_order_relaxed );
+    }
+
+    // go back and fill in the stream header now that we know how it all turned out
+    void finishStream()
+    {
+        if ( m_outputFile == nullptr )
+            return;
+
+        uint8_t md5[16] = { 0 };
+        EVP_DigestFinal_ex( m_md5Context, md5, nullptr );
+
+        // the checksum covers everything that was submitted, so if any of it never made it into the file it would
+        // only ever fail verification; all-zero is how STREAMINFO says the MD5 is unknown
+        if ( m_audioLost )
+        {
+            blog::error::core( "FLAC stream is missing audio, MD5 signature cleared" );
+            std::fill( std::begin( md5 ), std::end( md5 ), 0 );
+        }
+
+        std::vector< uint8_t > header;
+        appendStreamInfo( header, m_sampleRate, m_samplesWritten, m_minimumFrameBytes, m_maximumFrameBytes, md5 );
+
+        // more chunks than room in the table; keep an evenly spread subset
+        const std::size_t seekPointCount = std::min< std::size_t >( m_seekPoints.size(), cSeekPointCapacity );
+        for ( std::size_t sI = 0; sI < seekPointCount; sI++ )
+            appendSeekPoint( header, m_seekPoints[( sI * m_seekPoints.size() ) / seekPointCount] );
+        for ( std::size_t sI = seekPointCount; sI < cSeekPointCapacity; sI++ )
+            appendSeekPoint( header, { std::numeric_limits<uint64_t>::max(), 0, 0 } );
+
+        // stream info and seek table are separated by the seek table's own block header, which is already correct
+        fseek( m_outputFile, static_cast<long>( cStreamInfoOffset ), SEEK_SET );
+        fwrite( header.data(), 1, cStreamInfoBytes, m_outputFile );
+        fseek( m_outputFile, static_cast<long>( cSeekTableOffset ), SEEK_SET );
+        fwrite( header.data() + cStreamInfoBytes, 1, header.size() - cStreamInfoBytes, m_outputFile );
+
+        fclose( m_outputFile );
+        m_outputFile = nullptr;
+    }
+
+    static void appendBlockHeader( std::vector< uint8_t >& output, const bool bLastBlock, const uint8_t blockType, const std::size_t blockBytes )
+    {
+        output.push_back( static_cast<uint8_t>( ( bLastBlock ? 0x80 : 0x00 ) | blockType ) );
+        output.push_back( static_cast<uint8_t>( blockBytes >> 16 ) );
+        output.push_back( static_cast<uint8_t>( blockBytes >> 8 ) );
+        output.push_back( static_cast<uint8_t>( blockBytes ) );
+    }
+
+    static void appendStreamInfo(
+        std::vector< uint8_t >& output,
+        const uint32_t          sampleRate,
+        const uint64_t          totalSamples,
+        const uint32_t          minimumFrameBytes,
+        const uint32_t          maximumFrameBytes,
+        const uint8_t*          md5 )
+    {
+        // libFLAC reports min == max block size for fixed-blocksize streams, the short final frame notwithstanding
+        output.push_back( static_cast<uint8_t>( cBlockSize >> 8 ) );
+        output.push_back( static_cast<uint8_t>( cBlockSize ) );
+        output.push_back( static_cast<uint8_t>( cBlockSize >> 8 ) );
+        output.push_back( static_cast<uint8_t>( cBlockSize ) );
+
+        output.push_back( static_cast<uint8_t>( minimumFrameBytes >> 16 ) );
+        output.push_back( static_cast<uint8_t>( minimumFrameBytes >> 8 ) );
+        output.push_back( static_cast<uint8_t>( minimumFrameBytes ) );
+        output.push_back( static_cast<uint8_t>( maximumFrameBytes >> 16 ) );
+        output.push_back( static_cast<uint8_t>( maximumFrameBytes >> 8 ) );
+        output.push_back( static_cast<uint8_t>( maximumFrameBytes ) );
+
+        // 20 bits rate, 3 bits channels-1, 5 bits depth-1, 36 bits sample count
+        const uint64_t packed = ( static_cast<uint64_t>( sampleRate & 0xFFFFF ) << 44 ) |
+                                ( static_cast<uint64_t>( cChannels - 1 )        << 41 ) |
+                                ( static_cast<uint64_t>( cBitsPerSample - 1 )   << 36 ) |
+                                ( totalSamples & 0xFFFFFFFFFULL );
+        for ( int shift = 56; shift >= 0; shift -= 8 )
+            output.push_back( static_cast<uint8_t>( packed >> shift ) );
+
+        for ( int i = 0; i < 16; i++ )
+            output.push_back( md5 ? md5[i] : 0 );
+    }
+
+    static void appendSeekPoint( std::vector< uint8_t >& output, const SeekPoint& point )
+    {
+        for ( int shift = 56; shift >= 0; shift -= 8 )
+            output.push_back( static_cast<uint8_t>( point.m_sampleNumber >> shift ) );
+        for ( int shift = 56; shift >= 0; shift -= 8 )
+            output.push_back( static_cast<uint8_t>( point.m_streamOffset >> shift ) );
+        output.push_back( static_cast<uint8_t>( point.m_frameSamples >> 8 ) );
+        output.push_back( static_cast<uint8_t>( point.m_frameSamples ) );
+    }
+
+
+    FILE*                           m_outputFile            = nullptr;
+    const uint32_t                  m_sampleRate;
+    const EncoderOptions            m_options;
+    const uint32_t                  m_workerCount;
+    const uint32_t                  m_maximumChunksInFlight;
+
+    std::deque< EncodedChunkPtr >   m_chunksInFlight;                   // oldest first
+    std::shared_ptr< mcc::LightweightSemaphore >
+                                    m_chunkCompleteSema;                // signalled by the pool as each chunk finishes
+
+    EVP_MD_CTX*                     m_md5Context            = nullptr;
+    std::vector< uint8_t >          m_md5Scratch;
+    std::vector< uint8_t >          m_frameScratch;
+
+    std::vector< SeekPoint >        m_seekPoints;
+
+    uint64_t                        m_samplesSubmitted      = 0;
+    uint64_t                        m_samplesWritten        = 0;
+    uint64_t                        m_frameBytesWritten     = 0;
+    uint32_t                        m_minimumFrameBytes     = 0;
+    uint32_t                        m_maximumFrameBytes     = 0;
+    bool                            m_audioLost             = false;    // a chunk or frame failed, the file has gaps
+
+    std::atomic_uint64_t            m_bytesWritten          = 0;        // for UI, read from other threads
+};
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+void FLACWriter::setDefaultEncoderOptions( const EncoderOptions& options )
+{
+    std::scoped_lock<std::mutex> optionsLock( gDefaultEncoderOptionsMutex );
+    gDefaultEncoderOptions = options;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+FLACWriter::EncoderOptions FLACWriter::getDefaultEncoderOptions()
+{
+    std::scoped_lock<std::mutex> optionsLock( gDefaultEncoderOptionsMutex );
+    return gDefaultEncoderOptions;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 std::shared_ptr<FLACWriter> FLACWriter::Create(
     const fs::path&     outputFile,
     const uint32_t      sampleRate,
     const float         writeBufferInSeconds )
+{
+    return Create( outputFile, sampleRate, writeBufferInSeconds, getDefaultEncoderOptions() );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<FLACWriter> FLACWriter::Create(
+    const fs::path&         outputFile,
+    const uint32_t          sampleRate,
+    const float             writeBufferInSeconds,
+    const EncoderOptions&   options )
 {
     // produce a 8 and 16-bit encoded version of the filename, supporting utf8 characters in the input
     const std::u16string outputFileU16 = outputFile.u16string();
     const std::string outputFileU8 = utf8::utf16to8( outputFileU16 );
 
+    EncoderOptions validOptions = options;
+    validOptions.m_compressionLevel = std::min( validOptions.m_compressionLevel, 8U );
+
+    if ( validOptions.m_chunked )
+    {
+        // page size is fixed by the frame layout rather than the requested write buffer
+        FILE* fpFLAC = openOutputFile( outputFileU16, outputFileU8 );
+        if ( fpFLAC == nullptr )
+        {
+            blog::error::core( "FLAC could not open [{}] for writing ({})\n", outputFileU8, std::strerror(errno) );
+            return nullptr;
+        }
+        if ( !ChunkedStreamInstance::writeStreamHeader( fpFLAC, sampleRate ) )
+        {
+            blog::error::core( "FLAC unable to begin stream for file [{}]", outputFileU8 );
+            fclose( fpFLAC );
+            return nullptr;
+        }
+
+        std::unique_ptr< StreamInstance > newState = std::make_unique< ChunkedStreamInstance >( fpFLAC, sampleRate, validOptions );
+        return base::protected_make_shared<FLACWriter>( ISampleStreamProcessor::allocateNewInstanceID(), newState );
+    }
+
     const uint32_t writeBufferInSamples = (uint32_t)std::ceil( (float)sampleRate * std::max( 0.25f, writeBufferInSeconds ) );
 
-    std::unique_ptr< FLACWriter::StreamInstance > newState = std::make_unique< FLACWriter::StreamInstance >( writeBufferInSamples );
+    std::unique_ptr< FLACWriter::SerialStreamInstance > newState = std::make_unique< FLACWriter::SerialStreamInstance >( writeBufferInSamples );
 
     bool flacConfig = true;
-    flacConfig &= newState->set_verify( true );
-    flacConfig &= newState->set_compression_level( 4 );
+    flacConfig &= newState->set_verify( validOptions.m_verify );
+    flacConfig &= newState->set_compression_level( validOptions.m_compressionLevel );
     flacConfig &= newState->set_channels( 2 );
     flacConfig &= newState->set_bits_per_sample( 24 );
     flacConfig &= newState->set_sample_rate( sampleRate );
@@ -142,14 +748,7 @@ std::shared_ptr<FLACWriter> FLACWriter::Create(
     }
 
     // open a FILE* to pass to the encoder
-#if OURO_PLATFORM_WIN
-    // wchar_t is 2 bytes on Windows and expects utf16, so pass it that
-    FILE* fpFLAC = _wfopen( reinterpret_cast<const wchar_t*>(outputFileU16.c_str()), L"w+b" );
-#else
-    // elsewhere ... the OS is hopefully on board by default, just pass the utf8-capable 8-bit string
-    // https://stackoverflow.com/questions/396567/is-there-a-standard-way-to-do-an-fopen-with-a-unicode-string-file-path
-    FILE* fpFLAC = fopen( outputFileU8.c_str(), "w+b" );
-#endif
+    FILE* fpFLAC = openOutputFile( outputFileU16, outputFileU8 );
 
     newState->m_flacFileHandle = fpFLAC;
     if ( newState->m_flacFileHandle == nullptr )
@@ -159,13 +758,14 @@ std::shared_ptr<FLACWriter> FLACWriter::Create(
     }
 
     FLAC__StreamEncoderInitStatus flacInit = newState->init( newState->m_flacFileHandle );
-    if ( flacInit != FLAC__STREAM_ENCODER_INIT_STATUS_OK ) 
+    if ( flacInit != FLAC__STREAM_ENCODER_INIT_STATUS_OK )
     {
         blog::error::core( "FLAC unable to begin stream ({}) for file [{}]", FLAC__StreamEncoderInitStatusString[flacInit], outputFileU8 );
         return nullptr;
     }
 
-    return base::protected_make_shared<FLACWriter>( ISampleStreamProcessor::allocateNewInstanceID(), newState );
+    std::unique_ptr< StreamInstance > baseState = std::move( newState );
+    return base::protected_make_shared<FLACWriter>( ISampleStreamProcessor::allocateNewInstanceID(), baseState );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -177,7 +777,19 @@ void FLACWriter::appendSamples( float* buffer0, float* buffer1, const uint32_t s
 // ---------------------------------------------------------------------------------------------------------------------
 uint64_t FLACWriter::getStorageUsageInBytes() const
 {
-    return m_state->m_flacFileBytesWritten;
+    return m_state->getBytesWritten();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void FLACWriter::setOverflowPolicy( const OverflowPolicy policy )
+{
+    m_state->setOverflowPolicy( policy );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t FLACWriter::getOverflowSampleCount() const
+{
+    return m_state->getOverflowSampleCount();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -22,17 +22,41 @@ public:
 
     ~FLACWriter();
 
+    struct EncoderOptions
+    {
+        uint32_t    m_compressionLevel  = 4;        // libFLAC presets, 0 (fastest) to 8 (smallest)
+        bool        m_verify            = true;     // decode each frame again as it is encoded and compare; roughly doubles the cost
+        bool        m_chunked           = false;    // split the stream into independent runs of frames, encoded in parallel across
+                                                    // a shared worker pool and stitched back together in order; buffering
+                                                    // is fixed, so the requested write buffer size is ignored
+    };
+
+    // options used by Create() when none are given explicitly; set once on boot from the performance config
+    static void setDefaultEncoderOptions( const EncoderOptions& options );
+    static EncoderOptions getDefaultEncoderOptions();
+
     static std::shared_ptr<FLACWriter> Create(
-        const fs::path&     outputFile,
-        const uint32_t      sampleRate,
-        const float         writeBufferInSeconds );
+        const fs::path&         outputFile,
+        const uint32_t          sampleRate,
+        const float             writeBufferInSeconds );
+
+    static std::shared_ptr<FLACWriter> Create(
+        const fs::path&         outputFile,
+        const uint32_t          sampleRate,
+        const float             writeBufferInSeconds,
+        const EncoderOptions&   options );
 
     void appendSamples( float* buffer0, float* buffer1, const uint32_t sampleCount ) override;
     uint64_t getStorageUsageInBytes() const override;
+    void setOverflowPolicy( const OverflowPolicy policy ) override;
+    uint64_t getOverflowSampleCount() const override;
 
 private:
 
-    struct StreamInstance;
+    struct StreamInstance;          // encoder backend interface
+    struct SerialStreamInstance;    // a single libFLAC encoder running on the processor thread
+    struct ChunkedStreamInstance;   // chunks of frames encoded across the worker pool, stitched together on the processor thread
+
     std::unique_ptr< StreamInstance >  m_state;
 
 protected:
@@ -211,6 +211,18 @@ uint64_t OpusStream::getStorageUsageInBytes() const
     return OpusStream::cFrameSize * OpusStream::cBufferedFrames * 2;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+void OpusStream::setOverflowPolicy( const OverflowPolicy policy )
+{
+    m_state->setOverflowPolicy( policy );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t OpusStream::getOverflowSampleCount() const
+{
+    return m_state->getOverflowSampleCount();
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 OpusStream::CompressionSetup OpusStream::getCurrentCompressionSetup() const
 {
@@ -70,6 +70,8 @@ public:
 
     void appendSamples( float* buffer0, float* buffer1, const uint32_t sampleCount ) override;
     uint64_t getStorageUsageInBytes() const override;
+    void setOverflowPolicy( const OverflowPolicy policy ) override;
+    uint64_t getOverflowSampleCount() const override;
 
 
     struct CompressionSetup
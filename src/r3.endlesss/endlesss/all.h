@@ -21,6 +21,7 @@
 #include "endlesss/toolkit.exchange.h"
 #include "endlesss/toolkit.jam.sentinel.h"
 #include "endlesss/toolkit.population.h"
+#include "endlesss/toolkit.precache.h"
 #include "endlesss/toolkit.riff.export.h"
 #include "endlesss/toolkit.riff.pipeline.h"
 #include "endlesss/toolkit.shares.h"
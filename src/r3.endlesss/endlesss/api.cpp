@@ -12,6 +12,7 @@
 #include "base/hashing.h"
 #include "data/uuid.h"
 #include "spacetime/chronicle.h"
+#include "spacetime/moment.h"
 
 #include "endlesss/api.h"
 
@@ -102,6 +103,13 @@ void NetConfiguration::postInit()
 
     blog::api( FMTX( "NetConfiguration::postInit() with Access::{} user:{}" ), nameForAccess(), m_auth.user_id );
 
+    // pooled clients have the previous credentials baked into them; clearing also stops any still out on lease from
+    // being recycled when they come back
+    m_httpClientPool.configure(
+        std::chrono::seconds( std::max( 1, m_api.connectionPoolIdleSeconds ) ),
+        (std::size_t)std::max( 1, m_api.connectionPoolMaxIdlePerHost ) );
+    m_httpClientPool.clear();
+
     // log out httplib features we've compiled in, for our own references' sake
     blog::api( FMTX( "[httplib] compression {}, engines compiled : {}{}" ),
         m_api.connectionCompressionSupport ? "enabled" : "disabled",
@@ -116,6 +124,11 @@ void NetConfiguration::postInit()
         ""
 #endif
     );
+
+    if ( m_api.debugBenchmarkJsonDecoders && !m_verboseOutputDir.empty() )
+    {
+        benchmarkJsonDecoders( m_verboseOutputDir );
+    }
 }
 
 
@@ -128,14 +141,6 @@ void NetConfiguration::enableFullNetworkDiagnostics()
     m_api.debugVerboseNetLog = true;
 }
 
-// ---------------------------------------------------------------------------------------------------------------------
-void NetConfiguration::enableLastMinuteQuirkFixes()
-{
-    blog::app( FMTX( "NetConfiguration::enableLastMinuteQuirkFixes()" ) );
-
-    m_api.debugLastMinuteQuirkFixes = true;
-}
-
 
 // ---------------------------------------------------------------------------------------------------------------------
 std::string NetConfiguration::generateRandomLoadBalancerCookie() const
@@ -170,6 +175,58 @@ std::string NetConfiguration::getVerboseCaptureFilename( std::string_view contex
     return resultPath.string();
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+void writeVerboseCapture(
+    const NetConfiguration& netConfig,
+    const std::string& functionContext,
+    std::string_view traceContext,
+    std::string_view bodyText )
+{
+    if ( !netConfig.api().debugVerboseNetDataCapture )
+        return;
+
+    const auto verboseFilename = netConfig.getVerboseCaptureFilename( traceContext );
+    if ( !verboseFilename.empty() )
+    {
+        FILE* fExport = fopen( verboseFilename.c_str(), "wt" );
+        fprintf( fExport, "%s\n\n", functionContext.c_str() );
+        fprintf( fExport, "%.*s\n", (int)bodyText.size(), bodyText.data() );
+        fclose( fExport );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void reportParseError(
+    const NetConfiguration& netConfig,
+    const std::string& functionContext,
+    std::string_view errorMessage,
+    std::string_view bodyText )
+{
+    const auto exportFilename = netConfig.getVerboseCaptureFilename( "json_parse_error" );
+    if ( !exportFilename.empty() )
+    {
+        FILE* fExport = fopen( exportFilename.c_str(), "wt" );
+        fprintf( fExport, "%.*s\n", (int)errorMessage.size(), errorMessage.data() );
+        fprintf( fExport, "%s\n\n", functionContext.c_str() );
+        fprintf( fExport, "%.*s\n", (int)bodyText.size(), bodyText.data() );
+        fclose( fExport );
+    }
+
+    blog::error::api( "JSON | {} | {}", functionContext, errorMessage );
+    blog::error::api( "JSON | problematic JSON saved to [{}]", exportFilename );
+    blog::error::api( "JSON | please send it to ishani" );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+base::HttpClientPool::Lease NetConfiguration::leaseHttpClient( std::string_view poolKey, const base::HttpClientPool::ClientFactory& factory ) const
+{
+    base::HttpClientPool::Lease lease = m_httpClientPool.acquire( poolKey, factory );
+
+    metricsConnection( lease.wasReused() );
+
+    return lease;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 // there was an ...
 httplib::Result NetConfiguration::attempt( const std::function<httplib::Result()>& operation ) const
@@ -229,9 +286,9 @@ endlesss::types::JamCouchID NetConfiguration::checkAndSanitizeJamCouchID( const
 
 
 // ---------------------------------------------------------------------------------------------------------------------
-// used by all API calls to create a primed http client instance; seeded with the correct headers, authentication, SSL etc
-// 
-std::unique_ptr<httplib::SSLClient> createEndlesssHttpClient( const NetConfiguration& ncfg, const UserAgent ua )
+// used by all API calls to lease a primed http client instance; seeded with the correct headers, authentication, SSL etc
+// and kept alive between calls via the NetConfiguration connection pool
+base::HttpClientPool::Lease createEndlesssHttpClient( const NetConfiguration& ncfg, const UserAgent ua )
 {
     using namespace std::literals::chrono_literals;
 
@@ -242,8 +299,6 @@ std::unique_ptr<httplib::SSLClient> createEndlesssHttpClient( const NetConfigura
         Bearer
     };
 
-    const std::string loadBalance = ncfg.generateRandomLoadBalancerCookie();
-
     std::string requestDomain = cEndlesssDataDomain;
     AuthHeaders authHeaders = AuthHeaders::Basic;
     const char* userAgent = "";
@@ -271,52 +326,83 @@ std::unique_ptr<httplib::SSLClient> createEndlesssHttpClient( const NetConfigura
             break;
     }
 
-    auto dataClient = std::make_unique< httplib::SSLClient >( requestDomain );
-
-    dataClient->set_ca_cert_path( ncfg.api().certBundleRelative.c_str() );
-    dataClient->enable_server_certificate_verification( true );
-
-    // blanket the timeouts all the same
+    int32_t requestPort = 443;
+    if ( requestDomain == cEndlesssDataDomain && !ncfg.api().debugDataDomainOverride.empty() )
     {
-        const auto timeoutSec = ncfg.getRequestTimeout();
-        dataClient->set_connection_timeout( timeoutSec );
-        dataClient->set_read_timeout( timeoutSec );
-        dataClient->set_write_timeout( timeoutSec );
+        requestDomain = ncfg.api().debugDataDomainOverride;
+        requestPort   = ncfg.api().debugDataPortOverride;
     }
 
-    // most of the API calls expect Basic auth credentials
-    if ( authHeaders == AuthHeaders::Basic )
-    {
-        dataClient->set_basic_auth( ncfg.auth().token.c_str(), ncfg.auth().password.c_str() );
-    }
-    // some of the web APIs can accept Bearer to access per-user private data (eg. private shared riffs), formed out of token:password
-    else if ( authHeaders == AuthHeaders::Bearer )
-    {
-        dataClient->set_bearer_token_auth( fmt::format( FMTX("{}:{}"), ncfg.auth().token, ncfg.auth().password ) );
-    }
+    const bool usePlainHttp = ( requestDomain == ncfg.api().debugDataDomainOverride && ncfg.api().debugDataPlainHttp );
 
-    dataClient->set_compress( ncfg.api().connectionCompressionSupport );
-    dataClient->set_decompress( ncfg.api().connectionCompressionSupport );
+    // clients are pooled per host and per user-agent flavour, as the latter decides the headers and auth baked into them
+    const std::string poolKey = fmt::format( FMTX( "{}:{}/{}" ), requestDomain, requestPort, (int32_t)ua );
 
-    if ( ncfg.api().debugVerboseNetLog )
+    auto dataClient = ncfg.leaseHttpClient( poolKey, [&]() -> base::HttpClientPool::ClientPtr
     {
-        dataClient->set_logger( []( const httplib::Request& req, const httplib::Response& rsp ) 
+        std::unique_ptr< httplib::ClientImpl > newClient;
+
+        // plain http is only for talking to a local stand-in server, see debugDataPlainHttp
+        if ( usePlainHttp )
+        {
+            newClient = std::make_unique< httplib::ClientImpl >( requestDomain, requestPort );
+        }
+        else
+        {
+            newClient = std::make_unique< httplib::SSLClient >( requestDomain, requestPort );
+
+            newClient->set_ca_cert_path( ncfg.api().certBundleRelative.c_str() );
+            newClient->enable_server_certificate_verification( true );
+        }
+
+        newClient->set_keep_alive( ncfg.api().connectionKeepAlive );
+
+        // most of the API calls expect Basic auth credentials
+        if ( authHeaders == AuthHeaders::Basic )
+        {
+            newClient->set_basic_auth( ncfg.auth().token.c_str(), ncfg.auth().password.c_str() );
+        }
+        // some of the web APIs can accept Bearer to access per-user private data (eg. private shared riffs), formed out of token:password
+        else if ( authHeaders == AuthHeaders::Bearer )
+        {
+            newClient->set_bearer_token_auth( fmt::format( FMTX("{}:{}"), ncfg.auth().token, ncfg.auth().password ) );
+        }
+
+        newClient->set_compress( ncfg.api().connectionCompressionSupport );
+        newClient->set_decompress( ncfg.api().connectionCompressionSupport );
+
+        if ( ncfg.api().debugVerboseNetLog )
         {
-            blog::api( "VERBOSE | REQ | {} {}", req.method, req.path );
-            blog::api( "VERBOSE | RSP | {} {}", rsp.status, rsp.reason );
+            newClient->set_logger( []( const httplib::Request& req, const httplib::Response& rsp ) 
+            {
+                blog::api( "VERBOSE | REQ | {} {}", req.method, req.path );
+                blog::api( "VERBOSE | RSP | {} {}", rsp.status, rsp.reason );
+            });
+        }
+
+        // the load balancer cookie is chosen once per connection, which keeps each pooled connection sticky
+        // to the backend it first landed on
+        newClient->set_default_headers(
+        {
+            { "Host",               requestDomain                               },
+            { "User-Agent",         userAgent                                   },
+            { "Cookie",             ncfg.generateRandomLoadBalancerCookie()     },
+            { "Accept",             cMimeApplicationJson                        },
+            { "Accept-Encoding",    "gzip, deflate, br"                         },
+            { "Accept-Language",    "en-gb"                                     },
         });
-    }
 
-    dataClient->set_default_headers(
-    {
-        { "Host",               requestDomain          },
-        { "User-Agent",         userAgent              },
-        { "Cookie",             loadBalance            },
-        { "Accept",             cMimeApplicationJson   },
-        { "Accept-Encoding",    "gzip, deflate, br"    },
-        { "Accept-Language",    "en-gb"                },
+        return newClient;
     });
 
+    // blanket the timeouts all the same; applied on every lease as network quality can change while a client is pooled
+    {
+        const auto timeoutSec = ncfg.getRequestTimeout();
+        dataClient->set_connection_timeout( timeoutSec );
+        dataClient->set_read_timeout( timeoutSec );
+        dataClient->set_write_timeout( timeoutSec );
+    }
+
     // log network traffic
     ncfg.metricsActivitySend();
 
@@ -325,6 +411,198 @@ std::unique_ptr<httplib::SSLClient> createEndlesssHttpClient( const NetConfigura
 
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// SAX decoder schemas for the hot-path response types; these mirror the serialize() functions in api.h, with
+// CEREAL_OPTIONAL_NVP entries mapped to Presence::Optional and any post-load fix-ups run as completion hooks
+//
+namespace sax {
+
+using data::sax::Presence;
+using data::sax::Schema;
+
+// ---------------------------------------------------------------------------------------------------------------------
+static bool completeCurrent( ResultRiffDocument::State::Playback::Slot::Current& current )
+{
+    current.fixup();
+    return true;
+}
+
+static bool completeOggAudio( ResultStemDocument::CDNAttachments::OGGAudio& oggAudio )
+{
+    return oggAudio.fixup();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+static const data::sax::Object& riffDocument()
+{
+    using Current   = ResultRiffDocument::State::Playback::Slot::Current;
+    using Slot      = ResultRiffDocument::State::Playback::Slot;
+    using Playback  = ResultRiffDocument::State::Playback;
+    using State     = ResultRiffDocument::State;
+    using S         = Schema< ResultRiffDocument >;
+
+    static const data::sax::Object currentSchema = Schema< Current >::object< &completeCurrent >( {
+        Schema< Current >::value< &Current::on >( "on" ),
+        Schema< Current >::value< &Current::currentLoop >( "currentLoop", Presence::Optional ),
+        Schema< Current >::value< &Current::gain >( "gain" ),
+    });
+    static const data::sax::Object slotSchema = Schema< Slot >::object( {
+        Schema< Slot >::nested< &Slot::current >( "current", currentSchema, Presence::Optional ),
+    });
+    static const data::sax::Object playbackSchema = Schema< Playback >::object( {
+        Schema< Playback >::nested< &Playback::slot >( "slot", slotSchema ),
+    });
+    static const data::sax::Object stateSchema = Schema< State >::object( {
+        Schema< State >::value< &State::bps >( "bps" ),
+        Schema< State >::value< &State::barLength >( "barLength" ),
+        Schema< State >::nestedArray< &State::playback >( "playback", playbackSchema ),
+    });
+    static const data::sax::Object documentSchema = S::object( {
+        S::value< &ResultRiffDocument::_id >( "_id" ),
+        S::nested< &ResultRiffDocument::state >( "state", stateSchema ),
+        S::value< &ResultRiffDocument::userName >( "userName" ),
+        S::value< &ResultRiffDocument::created >( "created" ),
+        S::value< &ResultRiffDocument::root >( "root" ),
+        S::value< &ResultRiffDocument::scale >( "scale" ),
+        S::value< &ResultRiffDocument::app_version >( "app_version", Presence::Optional ),
+        S::value< &ResultRiffDocument::magnitude >( "magnitude", Presence::Optional ),
+    });
+
+    return documentSchema;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+static const data::sax::Object& stemDocument()
+{
+    using OGGAudio          = ResultStemDocument::CDNAttachments::OGGAudio;
+    using FLACAudio         = ResultStemDocument::CDNAttachments::FLACAudio;
+    using CDNAttachments    = ResultStemDocument::CDNAttachments;
+    using S                 = Schema< ResultStemDocument >;
+
+    static const data::sax::Object oggSchema = Schema< OGGAudio >::object< &completeOggAudio >( {
+        Schema< OGGAudio >::value< &OGGAudio::bucket >( "bucket", Presence::Optional ),
+        Schema< OGGAudio >::value< &OGGAudio::endpoint >( "endpoint" ),
+        Schema< OGGAudio >::value< &OGGAudio::key >( "key", Presence::Optional ),
+        Schema< OGGAudio >::value< &OGGAudio::url >( "url" ),
+        Schema< OGGAudio >::value< &OGGAudio::length >( "length" ),
+    });
+    static const data::sax::Object flacSchema = Schema< FLACAudio >::object( {
+        Schema< FLACAudio >::value< &FLACAudio::endpoint >( "endpoint" ),
+        Schema< FLACAudio >::value< &FLACAudio::key >( "key" ),
+        Schema< FLACAudio >::value< &FLACAudio::length >( "length" ),
+        Schema< FLACAudio >::value< &FLACAudio::url >( "url" ),
+    });
+    static const data::sax::Object attachmentsSchema = Schema< CDNAttachments >::object( {
+        Schema< CDNAttachments >::nested< &CDNAttachments::oggAudio >( "oggAudio", oggSchema, Presence::Optional ),
+        Schema< CDNAttachments >::nested< &CDNAttachments::flacAudio >( "flacAudio", flacSchema, Presence::Optional ),
+    });
+    static const data::sax::Object documentSchema = S::object( {
+        S::value< &ResultStemDocument::_id >( "_id" ),
+        S::nested< &ResultStemDocument::cdn_attachments >( "cdn_attachments", attachmentsSchema ),
+        S::value< &ResultStemDocument::bps >( "bps" ),
+        S::value< &ResultStemDocument::length16ths >( "length16ths" ),
+        S::value< &ResultStemDocument::originalPitch >( "originalPitch" ),
+        S::value< &ResultStemDocument::barLength >( "barLength" ),
+        S::value< &ResultStemDocument::presetName >( "presetName" ),
+        S::value< &ResultStemDocument::creatorUserName >( "creatorUserName" ),
+        S::value< &ResultStemDocument::primaryColour >( "primaryColour" ),
+        S::value< &ResultStemDocument::sampleRate >( "sampleRate" ),
+        S::value< &ResultStemDocument::created >( "created" ),
+        S::value< &ResultStemDocument::isDrum >( "isDrum", Presence::Optional ),
+        S::value< &ResultStemDocument::isNote >( "isNote", Presence::Optional ),
+        S::value< &ResultStemDocument::isBass >( "isBass", Presence::Optional ),
+        S::value< &ResultStemDocument::isMic >( "isMic", Presence::Optional ),
+    });
+
+    return documentSchema;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ResultRowHeader< ResultDocsHeader< ... > > as returned by _all_docs?include_docs=true
+template< typename _RowsType, typename _DocType, typename _KeyType >
+static data::sax::Object documentRows( const data::sax::Object& documentSchema )
+{
+    using Row = ResultDocsHeader< _DocType, _KeyType >;
+    using S   = Schema< _RowsType >;
+
+    static const data::sax::Object rowSchema = Schema< Row >::object( {
+        Schema< Row >::template value< &Row::id >( "id" ),
+        Schema< Row >::template nested< &Row::doc >( "doc", documentSchema ),
+    });
+
+    return S::object( {
+        S::template value< &_RowsType::total_rows >( "total_rows" ),
+        S::template nestedArray< &_RowsType::rows >( "rows", rowSchema ),
+    });
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ResultRowHeader< ResultRiffAndStemIDs > as returned by the rifffLoopsByCreateTime view
+template< typename _RowsType >
+static data::sax::Object riffAndStemIDRows()
+{
+    using S = Schema< _RowsType >;
+
+    static const data::sax::Object rowSchema = Schema< ResultRiffAndStemIDs >::object( {
+        Schema< ResultRiffAndStemIDs >::value< &ResultRiffAndStemIDs::id >( "id" ),
+        Schema< ResultRiffAndStemIDs >::value< &ResultRiffAndStemIDs::key >( "key" ),
+        Schema< ResultRiffAndStemIDs >::valueArray< &ResultRiffAndStemIDs::value >( "value" ),
+    });
+
+    return S::object( {
+        S::template value< &_RowsType::total_rows >( "total_rows" ),
+        S::template nestedArray< &_RowsType::rows >( "rows", rowSchema ),
+    });
+}
+
+} // namespace sax
+
+// ---------------------------------------------------------------------------------------------------------------------
+const data::sax::Object& RiffDetails::saxSchema()
+{
+    static const data::sax::Object schema = sax::documentRows< RiffDetails, ResultRiffDocument, endlesss::types::RiffCouchID >( sax::riffDocument() );
+    return schema;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+const data::sax::Object& StemDetails::saxSchema()
+{
+    static const data::sax::Object schema = sax::documentRows< StemDetails, ResultStemDocument, endlesss::types::StemCouchID >( sax::stemDocument() );
+    return schema;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+const data::sax::Object& JamLatestState::saxSchema()
+{
+    static const data::sax::Object schema = sax::riffAndStemIDRows< JamLatestState >();
+    return schema;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+const data::sax::Object& JamFullSnapshot::saxSchema()
+{
+    static const data::sax::Object schema = sax::riffAndStemIDRows< JamFullSnapshot >();
+    return schema;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+const data::sax::Object& JamChanges::saxSchema()
+{
+    using S = data::sax::Schema< JamChanges >;
+
+    static const data::sax::Object entrySchema = data::sax::Schema< Entry >::object( {
+        data::sax::Schema< Entry >::value< &Entry::id >( "id" ),
+        data::sax::Schema< Entry >::value< &Entry::seq >( "seq" ),
+    });
+    static const data::sax::Object schema = S::object( {
+        S::value< &JamChanges::last_seq >( "last_seq" ),
+        S::value< &JamChanges::pending >( "pending" ),
+        S::nestedArray< &JamChanges::results >( "results", entrySchema ),
+    });
+    return schema;
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 bool JamProfile::fetch( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID )
 {
@@ -456,20 +734,9 @@ bool RiffDetails::fetchBatch( const NetConfiguration& ncfg, const endlesss::type
             cMimeApplicationJson );
         });
 
-    if ( ncfg.api().debugLastMinuteQuirkFixes )
-    {
-        // last minute shit found in Ash's solo jam - the stem playback value "on" would - for ONE RIFF - turn up as a 0 or 1 rather than a bool value like
-        // literally everything else aaaaaaaaaaaaaaaaa
-        return deserializeJson< RiffDetails >( ncfg, res, *this, fmt::format( "{}( {} )", __FUNCTION__, jamDatabaseID_Sanitised ), "riff_details_batch", []( std::string& bodyText )
-            {
-                bodyText = std::regex_replace( bodyText, std::regex( "\"on\":0," ), "\"on\":false," );
-                bodyText = std::regex_replace( bodyText, std::regex( "\"on\":1," ), "\"on\":true," );
-            });
-    }
-    else
-    {
-        return deserializeJson< RiffDetails >( ncfg, res, *this, fmt::format( "{}( {} )", __FUNCTION__, jamDatabaseID_Sanitised ), "riff_details_batch" );
-    }
+    // last minute shit found in Ash's solo jam - the stem playback value "on" would - for ONE RIFF - turn up as a 0 or 1 rather than a bool value like
+    // literally everything else aaaaaaaaaaaaaaaaa .. the SAX decoder now accepts 0/1 for bools so no pre-pass is required
+    return deserializeJson< RiffDetails >( ncfg, res, *this, fmt::format( "{}( {} )", __FUNCTION__, jamDatabaseID_Sanitised ), "riff_details_batch" );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -797,6 +1064,204 @@ bool MyClubs::fetch( const NetConfiguration& ncfg )
 }
 
 
+namespace bench {
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct DecoderTally
+{
+    uint32_t        payloads        = 0;
+    uint64_t        bytes           = 0;
+    uint64_t        legacyMicros    = 0;
+    uint64_t        saxMicros       = 0;
+    uint32_t        legacyFailures  = 0;
+    uint32_t        saxFailures     = 0;
+    uint32_t        mismatches      = 0;
+
+    void log( std::string_view name ) const
+    {
+        const auto throughput = []( const uint64_t bytes, const uint64_t micros ) -> double
+            {
+                return ( micros == 0 ) ? 0.0 : ( (double)bytes / (double)micros );   // bytes per us == MB/s
+            };
+
+        blog::api( FMTX( "[json-bench] {:<20} | {:>5} payloads {:>10} bytes | legacy {:>8.1f} MB/s | sax {:>8.1f} MB/s | x{:.2f} | failed {}/{} | mismatched {}" ),
+            name,
+            payloads,
+            bytes,
+            throughput( bytes, legacyMicros ),
+            throughput( bytes, saxMicros ),
+            ( saxMicros == 0 ) ? 0.0 : ( (double)legacyMicros / (double)saxMicros ),
+            legacyFailures,
+            saxFailures,
+            mismatches );
+    }
+
+    DecoderTally& operator += ( const DecoderTally& rhs )
+    {
+        payloads        += rhs.payloads;
+        bytes           += rhs.bytes;
+        legacyMicros    += rhs.legacyMicros;
+        saxMicros       += rhs.saxMicros;
+        legacyFailures  += rhs.legacyFailures;
+        saxFailures     += rhs.saxFailures;
+        mismatches      += rhs.mismatches;
+        return *this;
+    }
+};
+
+// re-serialise a decoded instance so the two decode paths can be compared like-for-like
+template< typename _Type >
+static std::string toComparableJson( _Type& instance )
+{
+    std::ostringstream os;
+    {
+        cereal::JSONOutputArchive archive( os, cereal::JSONOutputArchive::Options::NoIndent() );
+        instance.serialize( archive );
+    }
+    return os.str();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// run one payload through both decoders a few times over, recording the fastest time for each
+template< typename _Type >
+static void runDecoders( const std::string& bodyText, const std::regex& lengthTypeMismatch, DecoderTally& tally )
+{
+    static constexpr int32_t cRepeats = 8;
+
+    uint64_t legacyBest = std::numeric_limits<uint64_t>::max();
+    uint64_t saxBest    = std::numeric_limits<uint64_t>::max();
+
+    _Type legacyResult;
+    _Type saxResult;
+    bool legacyOk = true;
+    bool saxOk    = true;
+
+    for ( int32_t repeat = 0; repeat < cRepeats; repeat++ )
+    {
+        // the original path; regex pass, stream copy, DOM build, then walk
+        {
+            legacyResult = {};
+
+            spacetime::Moment timer;
+            try
+            {
+                const std::string fixedText = std::regex_replace( bodyText, lengthTypeMismatch, "\"length\":$1" );
+
+                std::istringstream is( fixedText );
+                cereal::JSONInputArchive archive( is );
+
+                legacyResult.serialize( archive );
+            }
+            catch ( cereal::Exception& )
+            {
+                legacyOk = false;
+            }
+            legacyBest = std::min< uint64_t >( legacyBest, timer.delta< std::chrono::microseconds >().count() );
+        }
+        {
+            saxResult = {};
+
+            spacetime::Moment timer;
+            saxOk &= data::sax::decode( bodyText, saxResult ).ok();
+            saxBest = std::min< uint64_t >( saxBest, timer.delta< std::chrono::microseconds >().count() );
+        }
+    }
+
+    tally.payloads      ++;
+    tally.bytes         += bodyText.size();
+    tally.legacyMicros  += legacyBest;
+    tally.saxMicros     += saxBest;
+
+    if ( !legacyOk )
+        tally.legacyFailures++;
+    if ( !saxOk )
+        tally.saxFailures++;
+
+    if ( legacyOk && saxOk && toComparableJson( legacyResult ) != toComparableJson( saxResult ) )
+        tally.mismatches++;
+}
+
+} // namespace bench
+
+// ---------------------------------------------------------------------------------------------------------------------
+void benchmarkJsonDecoders( const fs::path& captureDir )
+{
+    std::error_code ec;
+    if ( !fs::is_directory( captureDir, ec ) )
+    {
+        blog::error::api( FMTX( "[json-bench] capture directory [{}] not found" ), captureDir.string() );
+        return;
+    }
+
+    // captures are named debug.<timestamp>.<index>.<trace context>.json, see NetConfiguration::getVerboseCaptureFilename
+    using DecoderFn = void (*)( const std::string&, const std::regex&, bench::DecoderTally& );
+    struct DecoderForContext
+    {
+        std::string_view    traceContext;
+        DecoderFn           decoder;
+    };
+    static constexpr std::array< DecoderForContext, 7 > cDecoders =
+    {{
+        { ".riff_details.json",         &bench::runDecoders< RiffDetails >      },
+        { ".riff_details_batch.json",   &bench::runDecoders< RiffDetails >      },
+        { ".stem_details_batch.json",   &bench::runDecoders< StemDetails >      },
+        { ".jam_full_snapshot.json",    &bench::runDecoders< JamFullSnapshot >  },
+        { ".jam_latest_state.json",     &bench::runDecoders< JamLatestState >   },
+        { ".jam_changes.json",          &bench::runDecoders< JamChanges >       },
+        { ".jam_changes_since.json",    &bench::runDecoders< JamChanges >       },
+    }};
+
+    const std::regex lengthTypeMismatch( "\"length\":\"([0-9]+)\"" );
+
+    absl::flat_hash_map< std::string_view, bench::DecoderTally > tallies;
+
+    for ( const auto& entry : fs::directory_iterator( captureDir, ec ) )
+    {
+        if ( !entry.is_regular_file() )
+            continue;
+
+        const std::string filename = entry.path().filename().string();
+        if ( !filename.starts_with( "debug." ) )
+            continue;
+
+        for ( const auto& decoderForContext : cDecoders )
+        {
+            if ( !filename.ends_with( decoderForContext.traceContext ) )
+                continue;
+
+            std::ifstream captureStream( entry.path(), std::ios::binary );
+            std::string captureText( ( std::istreambuf_iterator<char>( captureStream ) ), std::istreambuf_iterator<char>() );
+
+            // skip the function-context header line and the blank line that follows it
+            const std::size_t bodyStart = captureText.find( "\n\n" );
+            if ( bodyStart == std::string::npos )
+                break;
+
+            decoderForContext.decoder( captureText.substr( bodyStart + 2 ), lengthTypeMismatch, tallies[decoderForContext.traceContext] );
+            break;
+        }
+    }
+
+    if ( tallies.empty() )
+    {
+        blog::api( FMTX( "[json-bench] no usable captures found in [{}]; run with debugVerboseNetDataCapture enabled first" ), captureDir.string() );
+        return;
+    }
+
+    bench::DecoderTally overall;
+    for ( const auto& decoderForContext : cDecoders )
+    {
+        const auto tallyIt = tallies.find( decoderForContext.traceContext );
+        if ( tallyIt == tallies.end() )
+            continue;
+
+        tallyIt->second.log( decoderForContext.traceContext );
+        overall += tallyIt->second;
+    }
+    overall.log( "overall" );
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 namespace push {
 
@@ -10,6 +10,8 @@
 #pragma once
 
 #include "base/construction.h"
+#include "data/json.sax.h"
+#include "net/http.pool.h"
 
 #include "endlesss/config.h"
 #include "endlesss/core.types.h"
@@ -73,7 +75,6 @@ public:
     // modify loaded config::endlesss::rAPI data with advanced option toggles
     // call after init()
     void enableFullNetworkDiagnostics();
-    void enableLastMinuteQuirkFixes();
 
 
     ouro_nodiscard constexpr const config::endlesss::rAPI& api()  const { ABSL_ASSERT( hasAccess( Access::Public ) );        return m_api;  }
@@ -156,6 +157,12 @@ public:
     // on success (or whatever the final failure is otherwise)
     httplib::Result attempt( const std::function<httplib::Result()>& operation ) const;
 
+    // take a keep-alive client out of the shared connection pool, or build a new one with the factory if there are
+    // none idle for this key; the client goes back to the pool when the lease is destroyed
+    ouro_nodiscard base::HttpClientPool::Lease leaseHttpClient( std::string_view poolKey, const base::HttpClientPool::ClientFactory& factory ) const;
+
+    ouro_nodiscard base::HttpClientPool::Stats getHttpClientPoolStats() const { return m_httpClientPool.getStats(); }
+
 
     // metrics functions that dispatch network activity events via mutable event bus
     // used to tell the rest of the app that network stuff is happening
@@ -171,6 +178,10 @@ public:
     {
         m_eventBusClient->Send< ::events::NetworkActivity >( ::events::NetworkActivity::failure() );
     }
+    void metricsConnection( bool bReused ) const
+    {
+        m_eventBusClient->Send< ::events::NetworkActivity >( ::events::NetworkActivity::connection( bReused ) );
+    }
 
 
     endlesss::types::JamCouchID checkAndSanitizeJamCouchID( const endlesss::types::JamCouchID& jamID ) const;
@@ -196,6 +207,9 @@ private:
     // for capture/debug output
     fs::path                    m_verboseOutputDir;
 
+    // keep-alive clients shared between all API calls and stem downloads
+    mutable base::HttpClientPool m_httpClientPool;
+
     // used to precondition incoming data against the version of endless that decided to start writing "Length" values
     // as strings instead of numbers - this regex patches those back to numbers
     std::regex                  m_dataFixRegex_lengthTypeMismatch;
@@ -209,6 +223,22 @@ enum class UserAgent
     WebWithAuth,            // as above but with the user authentication included
 };
 
+// ---------------------------------------------------------------------------------------------------------------------
+// optional heavy debug verbose output option; writes the body text about to be parsed out to the capture folder
+void writeVerboseCapture(
+    const NetConfiguration& netConfig,
+    const std::string& functionContext,
+    std::string_view traceContext,
+    std::string_view bodyText );
+
+// JSON parsers are not very good for actually backtracking to where/what failed; in the case we hit more malformed
+// data, burn it out to disk so someone can send it to me for analysis
+void reportParseError(
+    const NetConfiguration& netConfig,
+    const std::string& functionContext,
+    std::string_view errorMessage,
+    std::string_view bodyText );
+
 // ---------------------------------------------------------------------------------------------------------------------
 // general boilerplate that takes a httplib response and tries to deserialize it from JSON to
 // the given type, returning false and logging the error if parsing bails
@@ -232,6 +262,28 @@ inline static bool deserializeJson(
         return false;
     }
 
+    //
+    // the hot-path types carry a SAX schema and are decoded straight out of the response buffer; the decoder absorbs
+    // the known data quirks itself so none of the regex / stream copying below is needed
+    //
+    if constexpr ( data::sax::Decodable<_Type> )
+    {
+        if ( bodyTextProcessor == nullptr )
+        {
+            writeVerboseCapture( netConfig, functionContext, traceContext, res->body );
+
+            netConfig.metricsActivityRecv( res->body.size() );
+
+            const absl::Status decodeStatus = data::sax::decode( res->body, instance );
+            if ( !decodeStatus.ok() )
+            {
+                reportParseError( netConfig, functionContext, decodeStatus.ToString(), res->body );
+                return false;
+            }
+            return true;
+        }
+    }
+
     //
     // apply horribly inefficient kludge to work around one particular version of Endlesss that decided to start
     // writing out "length" keys as strings rather than numbers :O *shakes fist*
@@ -244,18 +296,7 @@ inline static bool deserializeJson(
         bodyTextProcessor( bodyText );
     }
 
-    // optional heavy debug verbose output option
-    if ( netConfig.api().debugVerboseNetDataCapture )
-    {
-        const auto verboseFilename = netConfig.getVerboseCaptureFilename( traceContext );
-        if ( !verboseFilename.empty() )
-        {
-            FILE* fExport = fopen( verboseFilename.c_str(), "wt" );
-            fprintf( fExport, "%s\n\n", functionContext.c_str() );
-            fprintf( fExport, "%s\n", bodyText.c_str() );
-            fclose( fExport );
-        }
-    }
+    writeVerboseCapture( netConfig, functionContext, traceContext, bodyText );
 
     netConfig.metricsActivityRecv( bodyText.size() );
 
@@ -269,22 +310,7 @@ inline static bool deserializeJson(
     }
     catch ( cereal::Exception& cEx )
     {
-        // cereal is not very good for actually backtracking to where/what failed in JSON parsing
-        // in the case we hit more malformed data, burn it out to disk so someone can send it to me for analysis
-
-        const auto exportFilename = netConfig.getVerboseCaptureFilename( "json_parse_error" );
-        if ( !exportFilename.empty() )
-        {
-            FILE* fExport = fopen( exportFilename.c_str(), "wt" );
-            fprintf( fExport, "%s\n", cEx.what() );
-            fprintf( fExport, "%s\n\n", functionContext.c_str() );
-            fprintf( fExport, "%s\n", bodyText.c_str() );
-            fclose( fExport );
-        }
-
-        blog::error::api( "JSON | {} | {}", functionContext, cEx.what() );
-        blog::error::api( "JSON | problematic JSON saved to [{}]", exportFilename );
-        blog::error::api( "JSON | please send it to ishani" );
+        reportParseError( netConfig, functionContext, cEx.what(), bodyText );
         return false;
     }
 
@@ -536,7 +562,11 @@ struct ResultRiffDocument
                                , CEREAL_OPTIONAL_NVP( currentLoop )
                                , CEREAL_NVP( gain )
                         );
+                        fixup();
+                    }
 
+                    inline void fixup()
+                    {
                         // fix for some data where currentLoop got nulled even though 'on' is true
                         if ( currentLoop.empty() )
                             on = false;
@@ -653,18 +683,24 @@ struct JamChanges
     bool fetch( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID );
 
     bool fetchSince( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID, const std::string& seqSince );
+
+    static const data::sax::Object& saxSchema();
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
 struct JamLatestState final : public ResultRowHeader<ResultRiffAndStemIDs>
 {
     bool fetch( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID );
+
+    static const data::sax::Object& saxSchema();
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
 struct JamFullSnapshot final : public ResultRowHeader<ResultRiffAndStemIDs>
 {
     bool fetch( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID );
+
+    static const data::sax::Object& saxSchema();
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -678,6 +714,8 @@ struct RiffDetails final : public ResultRowHeader<ResultDocsHeader<ResultRiffDoc
 {
     bool fetch( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID, const endlesss::types::RiffCouchID& riffDocumentID );
     bool fetchBatch( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID, const std::vector< endlesss::types::RiffCouchID >& riffDocumentIDs );
+
+    static const data::sax::Object& saxSchema();
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -691,6 +729,8 @@ struct StemTypeCheck final : public ResultRowHeader<ResultDocsSafeHeader<TypeChe
 struct StemDetails final : public ResultRowHeader<ResultDocsHeader<ResultStemDocument, endlesss::types::StemCouchID>>
 {
     bool fetchBatch( const NetConfiguration& ncfg, const endlesss::types::JamCouchID& jamDatabaseID, const std::vector< endlesss::types::StemCouchID >& stemDocumentIDs );
+
+    static const data::sax::Object& saxSchema();
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -1167,6 +1207,12 @@ struct RiffCopy
 
 } // namespace push
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// decode every captured response in captureDir (as written by debugVerboseNetDataCapture) through both the legacy
+// regex + cereal path and the streaming SAX decoder, checking they agree and logging the throughput of each
+void benchmarkJsonDecoders( const fs::path& captureDir );
+
 } // namespace api
 } // namespace endlesss
 
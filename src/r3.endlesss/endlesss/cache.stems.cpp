@@ -53,15 +53,175 @@ fs::path Stems::getCachePathForStemData(
         return (cacheRoot / jamCID.value() / stemRoot);
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Stems::getDecodedCachePathRoot( DecodedCacheVersion dcv )
+{
+    switch ( dcv )
+    {
+        default:
+        case DecodedCacheVersion::Version1: return fmt::format( FMTX( "{}1" ), cDecodedCachePathRootPrefix );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Stems::getAnalysisCachePathRoot()
+{
+    return "stem_psa_v1";
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Stems::getCachePathForDecodedStemData(
+    const fs::path& decodedCacheRoot,
+    const endlesss::types::JamCouchID& jamCID,
+    const endlesss::types::StemCouchID& stemCID )
+{
+    // same layout as the stem cache, keeps it easy to cross-reference the two by eye
+    return getCachePathForStemData( decodedCacheRoot, jamCID, stemCID );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+std::string Stems::getDecodedStemFilename( const endlesss::types::StemCouchID& stemCID, const uint32_t sampleRate )
+{
+    return fmt::format( FMTX( "{}.{}.pcm" ), stemCID.value(), sampleRate );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status Stems::writeDecodedStem(
+    const fs::path& decodedFile,
+    const DecodedStemHeader& header,
+    const std::array< float*, 2 >& channels )
+{
+    ABSL_ASSERT( header.m_channelCount == 2 );
+    ABSL_ASSERT( header.m_sampleCount > 0 );
+
+    const std::size_t channelBytes = static_cast<std::size_t>(header.m_sampleCount) * sizeof( float );
+
+    // write to a temporary file and then swap it into place, so that any other thread (or app instance) that 
+    // goes looking for this stem never sees a half-written file; the temporary is per-thread as the same stem can
+    // be loaded (and so written back here) by several threads at once
+    const fs::path decodedFileTemp = filesys::getThreadTempFileFor( decodedFile );
+    {
+        std::basic_ofstream<char> ofs( decodedFileTemp, std::ios::out | std::ios::binary | std::ios::trunc );
+        if ( !ofs.is_open() )
+        {
+            return absl::PermissionDeniedError( fmt::format( FMTX( "unable to open [{}] for writing" ), decodedFileTemp.string() ) );
+        }
+
+        ofs.write( reinterpret_cast<const char*>( &header ), sizeof( DecodedStemHeader ) );
+        ofs.write( reinterpret_cast<const char*>( channels[0] ), channelBytes );
+        ofs.write( reinterpret_cast<const char*>( channels[1] ), channelBytes );
+
+        if ( !ofs.good() )
+        {
+            ofs.close();
+            std::error_code removeError;
+            fs::remove( decodedFileTemp, removeError );
+
+            return absl::DataLossError( fmt::format( FMTX( "failed while writing [{}]" ), decodedFileTemp.string() ) );
+        }
+    }
+
+    std::error_code renameError;
+    fs::rename( decodedFileTemp, decodedFile, renameError );
+    if ( renameError )
+    {
+        std::error_code removeError;
+        fs::remove( decodedFileTemp, removeError );
+
+        return absl::AbortedError( fmt::format( FMTX( "unable to move [{}] into place, {}" ), decodedFile.string(), renameError.message() ) );
+    }
+
+    return absl::OkStatus();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status Stems::readDecodedStemHeader( const fs::path& decodedFile, DecodedStemHeader& header )
+{
+    std::basic_ifstream<char> ifs( decodedFile, std::ios::in | std::ios::binary );
+    if ( !ifs.is_open() )
+    {
+        return absl::NotFoundError( fmt::format( FMTX( "unable to open [{}]" ), decodedFile.string() ) );
+    }
+
+    ifs.read( reinterpret_cast<char*>( &header ), sizeof( DecodedStemHeader ) );
+    if ( ifs.gcount() != sizeof( DecodedStemHeader ) )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "truncated header in [{}]" ), decodedFile.string() ) );
+    }
+
+    return absl::OkStatus();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status Stems::readDecodedStem(
+    const fs::path& decodedFile,
+    const uint32_t expectedSampleRate,
+    DecodedStemHeader& header,
+    std::array< float*, 2 >& channels )
+{
+    channels.fill( nullptr );
+
+    std::error_code sizeError;
+    const auto fileSize = fs::file_size( decodedFile, sizeError );
+    if ( sizeError )
+    {
+        return absl::NotFoundError( fmt::format( FMTX( "unable to stat [{}], {}" ), decodedFile.string(), sizeError.message() ) );
+    }
+
+    std::basic_ifstream<char> ifs( decodedFile, std::ios::in | std::ios::binary );
+    if ( !ifs.is_open() )
+    {
+        return absl::NotFoundError( fmt::format( FMTX( "unable to open [{}]" ), decodedFile.string() ) );
+    }
+
+    ifs.read( reinterpret_cast<char*>( &header ), sizeof( DecodedStemHeader ) );
+    if ( ifs.gcount() != sizeof( DecodedStemHeader ) )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "truncated header in [{}]" ), decodedFile.string() ) );
+    }
+
+    if ( !header.isValidFor( expectedSampleRate ) )
+    {
+        return absl::FailedPreconditionError( fmt::format( FMTX( "header in [{}] is invalid or outdated (v{}, {}hz)" ),
+            decodedFile.string(),
+            header.m_version,
+            header.m_sampleRate ) );
+    }
+
+    if ( fileSize != header.expectedFileSize() )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "size mismatch in [{}], expected {} got {}" ), decodedFile.string(), header.expectedFileSize(), fileSize ) );
+    }
+
+    const std::size_t channelBytes = static_cast<std::size_t>(header.m_sampleCount) * sizeof( float );
+
+    channels[0] = mem::alloc16<float>( header.m_sampleCount );
+    channels[1] = mem::alloc16<float>( header.m_sampleCount );
+
+    ifs.read( reinterpret_cast<char*>( channels[0] ), channelBytes );
+    ifs.read( reinterpret_cast<char*>( channels[1] ), channelBytes );
+
+    if ( !ifs.good() )
+    {
+        mem::free16( channels[0] );
+        mem::free16( channels[1] );
+        channels.fill( nullptr );
+
+        return absl::DataLossError( fmt::format( FMTX( "failed while reading [{}]" ), decodedFile.string() ) );
+    }
+
+    return absl::OkStatus();
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 Stems::Stems()
+    : m_memoryUsage( std::make_shared< std::atomic< int64_t > >( 0 ) )
 {
     m_stems.reserve( 2048 );
-    m_usages.reserve( 2048 );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-absl::Status Stems::initialise( const fs::path& cachePath, const uint32_t targetSampleRate )
+absl::Status Stems::initialise( const fs::path& cachePath, const uint32_t targetSampleRate, const bool enableDecodedCache )
 {
     const fs::path stemSubdir = getCachePathRoot( CacheVersion::Version2 );
 
@@ -75,10 +235,43 @@ absl::Status Stems::initialise( const fs::path& cachePath, const uint32_t target
             "Failed to create directory inside [{}], {}", m_cacheStemRoot.string(), stemRootStatus.ToString() ) );
     }
 
-    m_stemGeneration = 0;
+    m_cacheDecodedRoot.clear();
+    if ( enableDecodedCache )
+    {
+        const fs::path decodedRoot = cachePath / getDecodedCachePathRoot( cCurrentDecodedCacheVersion );
+
+        // not fatal if this fails, we can always just decode everything from scratch
+        const auto decodedRootStatus = filesys::ensureDirectoryExists( decodedRoot );
+        if ( decodedRootStatus.ok() )
+        {
+            m_cacheDecodedRoot = decodedRoot;
+            blog::cache( FMTX( "decoded stem cache enabled at [{}]" ), m_cacheDecodedRoot.string() );
+        }
+        else
+        {
+            blog::error::cache( FMTX( "decoded stem cache disabled, failed to create [{}], {}" ), decodedRoot.string(), decodedRootStatus.ToString() );
+        }
+    }
 
     // single processing instance, used during post-fetch stem analysis
     m_processing = endlesss::live::Stem::createStemProcessing( targetSampleRate );
+    m_analysisHash = m_processing->computeAnalysisHash();
+
+    // analysis results are persisted by default; they are small and save a lot of work on each stem load
+    m_cacheAnalysisRoot.clear();
+    {
+        const fs::path analysisRoot = cachePath / getAnalysisCachePathRoot();
+
+        const auto analysisRootStatus = filesys::ensureDirectoryExists( analysisRoot );
+        if ( analysisRootStatus.ok() )
+        {
+            m_cacheAnalysisRoot = analysisRoot;
+        }
+        else
+        {
+            blog::error::cache( FMTX( "stem analysis cache disabled, failed to create [{}], {}" ), analysisRoot.string(), analysisRootStatus.ToString() );
+        }
+    }
 
     return absl::OkStatus();
 }
@@ -88,9 +281,7 @@ endlesss::live::StemPtr Stems::request( const endlesss::types::Stem& stemData )
 {
     ABSL_ASSERT( m_targetSampleRate > 0 );  // ensure initialise() has been run
     {
-        std::scoped_lock<std::mutex> lock( m_pruneLock );
-
-        m_stemGeneration++;
+        std::scoped_lock<std::mutex> lock( m_cacheLock );
 
         const auto& stemDocumentID = stemData.couchID;
 
@@ -98,96 +289,91 @@ endlesss::live::StemPtr Stems::request( const endlesss::types::Stem& stemData )
         if ( stemIter == m_stems.end() )
         {
             auto newStem = std::make_shared<endlesss::live::Stem>( stemData, m_targetSampleRate );
+            newStem->setMemoryTracker( m_memoryUsage );
 
-            m_usages.emplace( stemDocumentID, m_stemGeneration );
-            m_stems.emplace( stemDocumentID, newStem );
+            m_recency.emplace_front( newStem );
+            m_stems.emplace( stemDocumentID, m_recency.begin() );
             return newStem;
         }
         else
         {
-            ABSL_ASSERT( m_usages.find( stemDocumentID ) != m_usages.end() );
-            m_usages[stemDocumentID] = m_stemGeneration;
+            // bump to most recently requested
+            m_recency.splice( m_recency.begin(), m_recency, stemIter->second );
 
-            return stemIter->second;
+            return *stemIter->second;
         }
     }
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-ouro_nodiscard std::size_t Stems::estimateMemoryUsageBytes()
+ouro_nodiscard std::size_t Stems::estimateMemoryUsageBytes() const
 {
-    std::size_t total = 0;
-    {
-        std::scoped_lock<std::mutex> lock( m_pruneLock );
-        for ( const auto& stem : m_stems )
-        {
-            total += stem.second->estimateMemoryUsageBytes();
-        }
-    }
-    return total;
+    return static_cast<std::size_t>( std::max< int64_t >( *m_memoryUsage, 0 ) );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-void Stems::lockAndPrune( const bool verbose, const uint32_t generationsToKeep )
+void Stems::pruneToBudget( const std::size_t targetBytes, const bool verbose )
 {
     spacetime::Moment pruneTimer;
 
-    {
-        std::scoped_lock<std::mutex> lock( m_pruneLock );
-
-        if ( m_stemGeneration < generationsToKeep )
-        {
-            if ( verbose )
-                blog::stem( "stem cache pruning aborted, generation index is too low : {} (need at least {})", m_stemGeneration, generationsToKeep );
-
-            return;
-        }
+    const std::size_t beforeBytes = estimateMemoryUsageBytes();
 
-        if ( verbose )
-            blog::stem( "stem cache prune : generation {}", m_stemGeneration );
+    std::size_t candidatesToVisit;
+    std::size_t beforeSize;
+    {
+        std::scoped_lock<std::mutex> lock( m_cacheLock );
+        beforeSize = m_stems.size();
+        candidatesToVisit = ( beforeSize > cPruneKeepRecent ) ? ( beforeSize - cPruneKeepRecent ) : 0;
+    }
 
-        StemDictionary keptStems;
-        StemUsage      keptUsages;
+    if ( verbose )
+        blog::stem( FMTX( "stem cache prune : {} stems, {} bytes (target {})" ), beforeSize, beforeBytes, targetBytes );
 
-        const uint32_t pruneGenerationsTo = m_stemGeneration - generationsToKeep;
+    std::size_t stemsEvicted = 0;
+    std::vector< endlesss::live::StemPtr > stemsToRelease;
+    stemsToRelease.reserve( cPruneStepSize );
 
-        for ( const auto& currentUsage : m_usages )
+    // walk up from the least-recently-requested end at most once; stems that are still held elsewhere (by live riffs,
+    // usually) get bumped to the front as they are evidently still in use, so each step always makes progress
+    while ( candidatesToVisit > 0 && estimateMemoryUsageBytes() > targetBytes )
+    {
         {
-            bool keepThisStem = true;
-
-            auto stemIter = m_stems.find( currentUsage.first );
-            ABSL_ASSERT( stemIter != m_stems.end() );
-
-            if ( currentUsage.second < pruneGenerationsTo )
-            {
-                keepThisStem = false;
-
-                // check that the usage has fallen to 1; otherwise something somewhere is holding onto this
-                const auto stemUsage = stemIter->second.use_count();
-                if ( stemUsage > 1 )
-                    keepThisStem = true;
-            }
+            std::scoped_lock<std::mutex> lock( m_cacheLock );
 
-            if ( keepThisStem )
+            for ( std::size_t step = 0; step < cPruneStepSize && candidatesToVisit > 0; step++, candidatesToVisit-- )
             {
-                keptUsages.emplace( currentUsage );
-                keptStems.emplace( currentUsage.first, stemIter->second );
+                if ( m_recency.size() <= cPruneKeepRecent )
+                {
+                    candidatesToVisit = 0;
+                    break;
+                }
+
+                auto oldestIter = std::prev( m_recency.end() );
+                if ( oldestIter->use_count() > 1 )
+                {
+                    m_recency.splice( m_recency.begin(), m_recency, oldestIter );
+                    continue;
+                }
+
+                m_stems.erase( (*oldestIter)->m_data.couchID );
+                stemsToRelease.emplace_back( std::move( *oldestIter ) );
+                m_recency.erase( oldestIter );
             }
         }
 
-        const std::size_t beforeSize = m_stems.size();
-        if ( verbose )
-            blog::stem( "stem cache prune : had {} stems ...", beforeSize );
-
-        m_stems = std::move( keptStems );
-        m_usages = std::move( keptUsages );
+        // free the audio data outside of the lock; this also updates the memory usage as each stem dies
+        stemsEvicted += stemsToRelease.size();
+        stemsToRelease.clear();
+    }
 
-        const std::size_t afterSize = m_stems.size();
-        if ( verbose )
-            blog::stem( "stem cache prune : ... now has {}", afterSize );
+    const std::size_t afterBytes = estimateMemoryUsageBytes();
+    if ( verbose )
+        blog::stem( FMTX( "stem cache prune : ... now {} bytes" ), afterBytes );
 
-        blog::stem( "stem cache prune trimmed {} entries, took {}", (beforeSize - afterSize), pruneTimer.delta< std::chrono::milliseconds >() );
-    }
+    blog::stem( FMTX( "stem cache prune evicted {} entries, freed ~{} bytes, took {}" ),
+        stemsEvicted,
+        ( beforeBytes > afterBytes ) ? ( beforeBytes - afterBytes ) : 0,
+        pruneTimer.delta< std::chrono::milliseconds >() );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -198,6 +384,26 @@ fs::path Stems::getCachePathForStem( const endlesss::types::Stem& stemData ) con
     return getCachePathForStemData( m_cacheStemRoot, stemData.jamCouchID, stemData.couchID );
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Stems::getDecodedCacheFileForStem( const endlesss::types::Stem& stemData ) const
+{
+    if ( m_cacheDecodedRoot.empty() )
+        return {};
+
+    return getCachePathForDecodedStemData( m_cacheDecodedRoot, stemData.jamCouchID, stemData.couchID ) /
+           getDecodedStemFilename( stemData.couchID, m_targetSampleRate );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Stems::getAnalysisCacheFileForStem( const endlesss::types::Stem& stemData ) const
+{
+    if ( m_cacheAnalysisRoot.empty() )
+        return {};
+
+    return getCachePathForStemData( m_cacheAnalysisRoot, stemData.jamCouchID, stemData.couchID ) /
+           fmt::format( FMTX( "{}.{:016x}.psa" ), stemData.couchID.value(), m_analysisHash );
+}
+
 
 } // namespace cache
 } // namespace endlesss
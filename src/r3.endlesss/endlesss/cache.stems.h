@@ -19,6 +19,43 @@ namespace api  { struct NetConfiguration; }
 
 namespace cache {
 
+// ---------------------------------------------------------------------------------------------------------------------
+// the decoded stem cache holds the final, post-resample audio for a stem at a particular sample rate so that warm loads
+// can skip all the decompression and resampling work. each file is this fixed header followed by the full left channel
+// and then the full right channel as raw float32 samples; the header is padded to keep the sample data 16-byte aligned
+//
+struct DecodedStemHeader
+{
+    static constexpr uint32_t cMagic   = 0x4D43504F;    // 'OPCM'
+    static constexpr uint32_t cVersion = 1;             // bump if the payload layout or the decode/post-process chain changes
+
+    uint32_t    m_magic         = cMagic;
+    uint32_t    m_version       = cVersion;
+    uint32_t    m_sampleRate    = 0;
+    int32_t     m_sampleCount   = 0;
+    uint32_t    m_channelCount  = 2;
+    uint32_t    m_compression   = 0;                    // live::Stem::Compression of the original source data
+    uint64_t    m_sourceBytes   = 0;                    // fileLengthBytes of the stem this was decoded from; must match on load
+
+    // total file size we expect for a file carrying this header
+    ouro_nodiscard constexpr std::size_t expectedFileSize() const
+    {
+        return sizeof( DecodedStemHeader ) + ( static_cast<std::size_t>(m_sampleCount) * m_channelCount * sizeof( float ) );
+    }
+
+    // check the header is one we can load and that it matches the requested sample rate
+    ouro_nodiscard constexpr bool isValidFor( const uint32_t sampleRate ) const
+    {
+        return ( m_magic        == cMagic     &&
+                 m_version      == cVersion   &&
+                 m_sampleRate   == sampleRate &&
+                 m_sampleCount  > 0           &&
+                 m_channelCount == 2 );
+    }
+};
+static_assert( sizeof( DecodedStemHeader ) == 32 );
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // 
 struct Stems
@@ -39,27 +76,87 @@ struct Stems
         const endlesss::types::StemCouchID& stemCID
     );
 
+    // decoded stem cache is versioned separately to the stem cache itself; as it only contains derived data, older versions
+    // are never migrated, they can just be deleted (see ux/cache.trim)
+    enum class DecodedCacheVersion
+    {
+        Version1        // DecodedStemHeader version 1; planar float32
+    };
+    static constexpr DecodedCacheVersion cCurrentDecodedCacheVersion = DecodedCacheVersion::Version1;
+
+    // get decoded-cache path root relative to the ouroveon cache/common path
+    ouro_nodiscard static fs::path getDecodedCachePathRoot( DecodedCacheVersion dcv );
+
+    // decoded cache root directories are all named with this prefix, followed by the version number
+    static constexpr std::string_view cDecodedCachePathRootPrefix = "stem_pcm_v";
+
+    // decoded data is partitioned the same way as the stem cache, with the file named by stem ID and sample rate
+    // so that data for different mixer rates can live side by side
+    ouro_nodiscard static fs::path getCachePathForDecodedStemData(
+        const fs::path& decodedCacheRoot,
+        const endlesss::types::JamCouchID& jamCID,
+        const endlesss::types::StemCouchID& stemCID
+    );
+    ouro_nodiscard static std::string getDecodedStemFilename(
+        const endlesss::types::StemCouchID& stemCID,
+        const uint32_t sampleRate
+    );
+
+    // persisted stem analysis data lives in its own tree, partitioned the same way as the stem cache; files are keyed by 
+    // stem ID and the analysis hash from the stem processing setup so any change in tuning naturally misses the cache
+    ouro_nodiscard static fs::path getAnalysisCachePathRoot();
+
+    // read/write whole decoded-stem files; returned channel buffers are allocated with mem::alloc16 and owned by the caller
+    static absl::Status writeDecodedStem(
+        const fs::path& decodedFile,
+        const DecodedStemHeader& header,
+        const std::array< float*, 2 >& channels );
+
+    static absl::Status readDecodedStemHeader(
+        const fs::path& decodedFile,
+        DecodedStemHeader& header );
+
+    static absl::Status readDecodedStem(
+        const fs::path& decodedFile,
+        const uint32_t expectedSampleRate,
+        DecodedStemHeader& header,
+        std::array< float*, 2 >& channels );
+
 
     Stems();
 
     absl::Status initialise( 
         const fs::path& cachePath,          // the root path of where to build the stored stems
-        const uint32_t targetSampleRate     // the chosen sample rate, stems will be resampled to this if they don't match
+        const uint32_t targetSampleRate,    // the chosen sample rate, stems will be resampled to this if they don't match
+        const bool enableDecodedCache       // if true, also store/load fully decoded stem data at the target sample rate
     );
 
     ouro_nodiscard endlesss::live::StemPtr request( const endlesss::types::Stem& stemData );
 
-    // tot up all live stems' approximate memory usage; not const as it locks the mutex, dont call it every frame
-    ouro_nodiscard std::size_t estimateMemoryUsageBytes();
+    // approximate memory usage of all live stems handed out by the cache; this is tracked incrementally by the stems
+    // themselves as they load, analyse and are released, so it is cheap enough to call whenever
+    ouro_nodiscard std::size_t estimateMemoryUsageBytes() const;
 
     ouro_nodiscard fs::path getCacheRootPath() const { return m_cacheStemRoot; }
 
-    // synchronously lock & garbage collect the cache
-    void lockAndPrune( const bool verbose, const uint32_t generationsToKeep = 64 );
+    // the analysis hash that persisted analysis files must carry to be loaded, see getAnalysisCachePathRoot()
+    ouro_nodiscard uint64_t getAnalysisHash() const { return m_analysisHash; }
+
+    // evict least-recently-requested stems that nothing else is holding on to until memory usage drops to targetBytes
+    // or we run out of candidates; work is done in small steps, only taking the cache lock for a handful of entries at
+    // a time so that request() calls from loading threads are never held up for long
+    void pruneToBudget( const std::size_t targetBytes, const bool verbose );
 
     // given stem data, return a suitable path to write the cached data to
     ouro_nodiscard fs::path getCachePathForStem( const endlesss::types::Stem& stemData ) const;
 
+    // given stem data, return the full path of the decoded-stem file for our target sample rate;
+    // returns an empty path if the decoded cache is disabled
+    ouro_nodiscard fs::path getDecodedCacheFileForStem( const endlesss::types::Stem& stemData ) const;
+
+    // given stem data, return the full path of the file used to persist analysis results
+    ouro_nodiscard fs::path getAnalysisCacheFileForStem( const endlesss::types::Stem& stemData ) const;
+
     // return the single shared instance of read-only stem processing state
     // used by riff resolving code after fetching audio data in
     const endlesss::live::Stem::Processing& getStemProcessing() const
@@ -71,19 +168,28 @@ struct Stems
 private:
 
     using StemProcessing    = endlesss::live::Stem::Processing::UPtr;
-    using StemDictionary    = absl::flat_hash_map< endlesss::types::StemCouchID, endlesss::live::StemPtr >;
-    using StemUsage         = absl::flat_hash_map< endlesss::types::StemCouchID, uint32_t >;
-    
+    using StemRecency       = std::list< endlesss::live::StemPtr >;     // most recently requested at the front
+    using StemDictionary    = absl::flat_hash_map< endlesss::types::StemCouchID, StemRecency::iterator >;
+
+    // number of entries examined per lock during pruning
+    static constexpr std::size_t cPruneStepSize = 16;
+    // this many of the most recently requested stems are never pruned
+    static constexpr std::size_t cPruneKeepRecent = 64;
+
     fs::path            m_cacheStemRoot;
+    fs::path            m_cacheDecodedRoot;     // empty if decoded cache is disabled
+    fs::path            m_cacheAnalysisRoot;
+    uint64_t            m_analysisHash = 0;     // cached result of m_processing->computeAnalysisHash()
 
     StemProcessing      m_processing;
 
+    StemRecency         m_recency;
     StemDictionary      m_stems;
-    StemUsage           m_usages;
+
+    endlesss::live::Stem::MemoryTracker m_memoryUsage;
 
     uint32_t            m_targetSampleRate = 0;
-    uint32_t            m_stemGeneration = 0;
-    std::mutex          m_pruneLock;
+    std::mutex          m_cacheLock;
 };
 
 } // namespace cache
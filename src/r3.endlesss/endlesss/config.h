@@ -107,6 +107,14 @@ OURO_CONFIG( rAPI )
     int32_t                 networkRequestRetryLimitUnstable = 6;       // for 4G / less reliable connections
 
 
+    // warehouse sync; how many batch fetches can be in flight at once and the range the batch size is allowed to
+    // adapt within, aiming for each fetch to take roughly syncBatchTargetSeconds
+    int32_t                 syncConcurrentFetches = 4;
+    int32_t                 syncBatchSizeMinimum = 10;
+    int32_t                 syncBatchSizeMaximum = 200;
+    int32_t                 syncBatchTargetSeconds = 3;
+
+
 
     // BEHAVIOURAL HACKS
     // tweaks to how things should be when harsh reality shows up
@@ -114,6 +122,12 @@ OURO_CONFIG( rAPI )
     // enable http network compression
     bool                    connectionCompressionSupport = true;
 
+    // hold connections open between requests, pooled per host; saves a TCP + TLS handshake on every API call and
+    // stem download. idle connections older than connectionPoolIdleSeconds are assumed closed server-side
+    bool                    connectionKeepAlive = true;
+    int32_t                 connectionPoolIdleSeconds = 20;
+    int32_t                 connectionPoolMaxIdlePerHost = 8;
+
     // set to relax requirements on the database size having to match the CDN actual size for stem data
     // this is basically required for deep diving back more than about 6 months, there is often some strange
     // data lurking in the older archives
@@ -133,8 +147,15 @@ OURO_CONFIG( rAPI )
     // if true, stream all http response body text out to files before they are deserialised. will fill up your drive.
     bool                    debugVerboseNetDataCapture = false;
 
-    // panic mode to enable late fixes to quirks found during the week before service shutdown
-    bool                    debugLastMinuteQuirkFixes = false;
+    // on network init, replay any captured responses found in the verbose capture folder through both the old and
+    // streaming JSON decoders, logging timings and checking the two agree
+    bool                    debugBenchmarkJsonDecoders = false;
+
+    // redirect Couch data requests to a different host, eg. a local stand-in server serving canned responses when
+    // testing the sync pipeline (see xtras/sync-standin, which wants plain http). empty to use the real endpoint
+    std::string             debugDataDomainOverride;
+    int32_t                 debugDataPortOverride = 443;
+    bool                    debugDataPlainHttp = false;     // talk to the override host without TLS
 
     template<class Archive>
     void serialize( Archive& archive )
@@ -148,9 +169,20 @@ OURO_CONFIG( rAPI )
                , CEREAL_OPTIONAL_NVP( networkTimeoutInSecondsUnstable )
                , CEREAL_OPTIONAL_NVP( networkRequestRetryLimitDefault )
                , CEREAL_OPTIONAL_NVP( networkRequestRetryLimitUnstable )
+               , CEREAL_OPTIONAL_NVP( syncConcurrentFetches )
+               , CEREAL_OPTIONAL_NVP( syncBatchSizeMinimum )
+               , CEREAL_OPTIONAL_NVP( syncBatchSizeMaximum )
+               , CEREAL_OPTIONAL_NVP( syncBatchTargetSeconds )
+               , CEREAL_OPTIONAL_NVP( connectionKeepAlive )
+               , CEREAL_OPTIONAL_NVP( connectionPoolIdleSeconds )
+               , CEREAL_OPTIONAL_NVP( connectionPoolMaxIdlePerHost )
                , CEREAL_OPTIONAL_NVP( hackAllowStemSizeMismatch )
                , CEREAL_OPTIONAL_NVP( debugVerboseNetLog )
                , CEREAL_OPTIONAL_NVP( debugVerboseNetDataCapture )
+               , CEREAL_OPTIONAL_NVP( debugBenchmarkJsonDecoders )
+               , CEREAL_OPTIONAL_NVP( debugDataDomainOverride )
+               , CEREAL_OPTIONAL_NVP( debugDataPortOverride )
+               , CEREAL_OPTIONAL_NVP( debugDataPlainHttp )
         );
     }
 };
@@ -60,8 +60,6 @@ struct ResultStemDocument
             std::string_view getBucket() const override { return bucket; }
             CompressionFormat getFormat() const override { return IStemAudioFormat::CompressionFormat::OGG; }
 
-            // OGGAudio blocks have changed a bit over the lifetime of the app and require the most manual 
-            // fix-up and error-correction
             template<class Archive>
             inline void serialize( Archive& archive )
             {
@@ -72,6 +70,14 @@ struct ResultStemDocument
                        , CEREAL_NVP( length )
                 );
 
+                if ( !fixup() )
+                    throw cereal::Exception( "failed to repair ogg attachment data" );
+            }
+
+            // OGGAudio blocks have changed a bit over the lifetime of the app and require the most manual 
+            // fix-up and error-correction; returns false if the data was beyond repair
+            inline bool fixup()
+            {
                 // in the case where this data block is just empty, ignore any fix-up
                 if ( bucket.empty() &&
                      endpoint.empty() &&
@@ -79,7 +85,7 @@ struct ResultStemDocument
                      url.empty() &&
                      length == 0 )
                 {
-                    return;
+                    return true;
                 }
 
                 // -- old jams can contain weird, badly formatted data : fix it as we go --
@@ -91,14 +97,14 @@ struct ResultStemDocument
                     if ( !parser.isValid() )
                     {
                         blog::error::api( "URL Parse fail : {}", url );
-                        throw cereal::Exception( "failed to parse missing key from existing URL" );
+                        return false;
                     }
 
                     key = parser.path().substr(1);   // skip the leading "/"
                     if ( key.empty() )
                     {
                         blog::error::api( "URL Parse fail : {}", url );
-                        throw cereal::Exception( "failed to parse missing key from existing URL" );
+                        return false;
                     }
 
                     blog::api( "Fixed missing [key] in ogg data" );
@@ -111,7 +117,7 @@ struct ResultStemDocument
                     if ( found == 0 || found == std::string::npos )
                     {
                         blog::error::api( "Endpoint fix : {}", endpoint );
-                        throw cereal::Exception( "failed to fix invalid endpoint data" );
+                        return false;
                     }
 
                     endpoint = endpoint.substr( found + 1 ); // +1 to skip the /
@@ -126,6 +132,7 @@ struct ResultStemDocument
 
                     blog::api( "Fixed invalid [bucket] in ogg data" );
                 }
+                return true;
             }
         } oggAudio;
 
@@ -1009,8 +1016,19 @@ static NetworkActivity failure()
     return { 0, true };
 }
 
+// a http client was leased from the connection pool; either reusing a live connection or needing a fresh handshake
+static NetworkActivity connection( bool bReused )
+{
+    NetworkActivity result( 0 );
+    result.m_connectionsReused = bReused ? 1 : 0;
+    result.m_connectionsOpened = bReused ? 0 : 1;
+    return result;
+}
+
 std::size_t    m_bytes;
 bool           m_bFailure;
+uint32_t       m_connectionsOpened = 0;
+uint32_t       m_connectionsReused = 0;
 
 CREATE_EVENT_END()
 
@@ -25,109 +25,128 @@ namespace live {
 
 // simple least-recently-used cache for live Riff instances; ideal for apps that want to keep some recently played
 // bits in memory for faster scheduling rather than pulling back from disk
+//
+// entries live in a recency list (most recent at the front) with a hash map from riff CID hash to list position, so
+// search and store are both O(1). the cache is bounded by entry count and, optionally, by the approximate number of
+// bytes held alive by the cached riffs; whichever limit is hit first evicts from the back of the list
+//
 struct RiffCacheLRU
 {
-    RiffCacheLRU( std::size_t cacheSize )
+    // cacheBudgetBytes of 0 means only the entry count limit applies
+    RiffCacheLRU( std::size_t cacheSize, std::size_t cacheBudgetBytes = 0 )
         : m_cacheSize( cacheSize )
-        , m_used( 0 )
+        , m_cacheBudgetBytes( cacheBudgetBytes )
     {
-        m_cache.reserve( m_cacheSize );
-        m_age.reserve( m_cacheSize );
-
-        for ( auto i = 0; i< m_cacheSize; i++ )
-        {
-            m_cache.emplace_back( nullptr );
-            m_age.emplace_back( 0 );
-        }
+        m_lookup.reserve( m_cacheSize );
     }
 
     inline bool search( const endlesss::types::RiffCouchID& cid, endlesss::live::RiffPtr& result )
     {
         // early out on empty cache
-        if ( m_used == 0 )
+        if ( m_recency.empty() )
             return false;
 
-        // compare CIDs by hash
-        const auto incomingRiffCIDHash = endlesss::live::Riff::computeHashForRiffCID( cid );
-
-        for ( auto idx = 0; idx < m_used; idx++ )
-        {
-            ABSL_ASSERT( m_cache[idx] != nullptr );
-
-            m_age[idx] ++;
-
-            if ( m_cache[idx]->getCIDHash() == incomingRiffCIDHash )
-            {
-                // reset age
-                m_age[idx] = 0;
+        const auto lookupIt = m_lookup.find( endlesss::live::Riff::computeHashForRiffCID( cid ) );
+        if ( lookupIt == m_lookup.end() )
+            return false;
 
-                result = m_cache[idx];
+        // bump to most-recently-used
+        m_recency.splice( m_recency.begin(), m_recency, lookupIt->second );
 
-                // complete rest of run before we're done
-                idx++;
-                for ( ; idx < m_used; idx++ )
-                    m_age[idx] ++;
+        result = lookupIt->second->m_riff;
 
-                riff_verbose_log( "search-hit" );
+        riff_verbose_log( "search-hit" );
 
-                return true;
-            }
-        }
-        return false;
+        return true;
     }
 
     inline void store( endlesss::live::RiffPtr& riffPtr )
     {
-        if ( m_used < m_cacheSize )
-        {
-            // store new value in unused slot
-            m_cache[m_used] = riffPtr;
-            
-            // age all other entries
-            for ( auto prvI = 0; prvI < m_used; prvI++ )
-                m_age[prvI] ++;
+        ABSL_ASSERT( riffPtr != nullptr );
 
-            m_used++;
+        const auto riffHash = riffPtr->getCIDHash();
 
-            riff_verbose_log( "store-unfilled" );
-            return;
-        }
+        // sample the memory cost once on the way in so that the running total stays consistent on the way out,
+        // regardless of any background analysis changing the estimate later on
+        const std::size_t riffBytes = riffPtr->estimateMemoryUsageBytes();
 
-        int32_t oldestAge = -1;
-        int32_t oldestIndex = -1;
-        for ( auto idx = 0; idx < m_cacheSize; idx++ )
+        const auto lookupIt = m_lookup.find( riffHash );
+        if ( lookupIt != m_lookup.end() )
         {
-            if ( m_age[idx] > oldestAge )
-            {
-                oldestAge   = m_age[idx];
-                oldestIndex = idx;
-            }
-
-            // age as we go
-            m_age[idx] ++;
+            // already have this one, replace it and bump to most-recently-used
+            m_usedBytes -= lookupIt->second->m_bytes;
+
+            lookupIt->second->m_riff  = riffPtr;
+            lookupIt->second->m_bytes = riffBytes;
+            m_recency.splice( m_recency.begin(), m_recency, lookupIt->second );
+
+            riff_verbose_log( "store-replaced" );
         }
-        ABSL_ASSERT( oldestIndex >= 0 );
+        else
+        {
+            m_recency.emplace_front( riffPtr, riffBytes );
+            m_lookup.emplace( riffHash, m_recency.begin() );
 
-        m_cache[oldestIndex] = riffPtr;
-        m_age[oldestIndex] = 0;
+            riff_verbose_log( "store-added-new" );
+        }
+        m_usedBytes += riffBytes;
 
-        riff_verbose_log("store-added-new");
+        evictToFit();
     }
 
+    ouro_nodiscard inline std::size_t size() const { return m_recency.size(); }
+    ouro_nodiscard inline std::size_t getUsedBytes() const { return m_usedBytes; }
+
 #if RIFF_CACHE_VERBOSE_DEBUG
     inline void debugLog(const std::string& context)
     {
-        for ( auto idx = 0; idx < m_used; idx++ )
+        std::size_t idx = 0;
+        for ( const auto& entry : m_recency )
         {
-            blog::app( "[R$] [{:30}] {} = {}, {}", context, idx, m_age[idx], (m_cache[idx] == nullptr) ? "NONE" : (m_cache[idx]->m_riffData.riff.couchID) );
+            blog::app( "[R$] [{:30}] {} = {} bytes, {}", context, idx++, entry.m_bytes, entry.m_riff->m_riffData.riff.couchID );
         }
     }
 #endif // RIFF_CACHE_VERBOSE_DEBUG
 
-    std::size_t                              m_cacheSize;
-    std::vector< endlesss::live::RiffPtr >   m_cache;
-    std::vector< int32_t >                   m_age;
-    int32_t                                  m_used = 0;
+private:
+
+    struct Entry
+    {
+        Entry( const endlesss::live::RiffPtr& riff, const std::size_t bytes )
+            : m_riff( riff )
+            , m_bytes( bytes )
+        {}
+
+        endlesss::live::RiffPtr     m_riff;
+        std::size_t                 m_bytes;    // estimate taken when stored
+    };
+
+    using RecencyList   = std::list< Entry >;
+    using LookupMap     = absl::flat_hash_map< endlesss::live::Riff::RiffCIDHash, RecencyList::iterator >;
+
+    // drop least-recently-used entries until we are within limits; the most recent entry is always kept, even if it
+    // alone blows the memory budget, so a freshly stored riff can always be found again
+    inline void evictToFit()
+    {
+        while ( m_recency.size() > 1 &&
+              ( m_recency.size() > m_cacheSize || ( m_cacheBudgetBytes > 0 && m_usedBytes > m_cacheBudgetBytes ) ) )
+        {
+            const Entry& oldest = m_recency.back();
+
+            m_usedBytes -= oldest.m_bytes;
+            m_lookup.erase( oldest.m_riff->getCIDHash() );
+            m_recency.pop_back();
+
+            riff_verbose_log( "evicted" );
+        }
+    }
+
+    std::size_t                 m_cacheSize;
+    std::size_t                 m_cacheBudgetBytes;
+    std::size_t                 m_usedBytes = 0;
+
+    RecencyList                 m_recency;
+    LookupMap                   m_lookup;
 };
 
 #undef riff_verbose_log
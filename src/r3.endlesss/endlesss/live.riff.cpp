@@ -67,7 +67,30 @@ Riff::~Riff()
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-void Riff::fetch( services::RiffFetchProvider& services )
+std::size_t Riff::estimateMemoryUsageBytes() const
+{
+    std::size_t result = sizeof( Riff );
+
+    for ( const auto& stemPtr : m_stemOwnership )
+    {
+        if ( stemPtr != nullptr )
+            result += stemPtr->estimateMemoryUsageBytes();
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Riff::waitForAllStems() const
+{
+    for ( const endlesss::live::Stem* rawStem : m_stemPtrs )
+    {
+        if ( rawStem != nullptr )
+            rawStem->waitForFetch();
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Riff::fetch( services::RiffFetchProvider& services, const bool progressive )
 {
     base::instr::ScopedEvent wte( "Riff::fetch", base::instr::PresetColour::Lime );
 
@@ -133,10 +156,14 @@ void Riff::fetch( services::RiffFetchProvider& services )
 
         blog::riff( FMTX( "[R:{}..] riff stem resolution ..." ), riffCouchSnip );
 
-        tf::Taskflow stemLoadFlow;
-        tf::Taskflow stemAnalysisFlow;
+        // each fresh stem gets a load task followed by its analysis task, all in one graph; the graph may outlive this
+        // function when fetching progressively, so tasks only capture things that are owned elsewhere or copied in
+        tf::Taskflow stemWorkFlow;
+
+        const auto* netConfiguration    = &services->getNetConfiguration();
+        const auto* stemProcessingPtr   = &stemProcessing;
 
-        std::vector< endlesss::live::Stem* > stemsWithAsyncAnalysis;
+        std::vector< endlesss::live::Stem* > stemsWithAsyncWork;
 
         for ( size_t stemI = 0; stemI < 8; stemI++ )
         {
@@ -150,18 +177,24 @@ void Riff::fetch( services::RiffFetchProvider& services )
 
                 endlesss::live::Stem* loopStemRaw = loopStemPtr.get();
 
-                // if this was a fresh stem, enqueue it for loading via task graph
-                if ( loopStemRaw->m_state == endlesss::live::Stem::State::Empty )
+                // if this was a fresh stem, enqueue it for loading via task graph; if another riff fetch already
+                // claimed it, we just wait on that below before looking at the results
+                if ( loopStemRaw->claimFetch() )
                 {
-                    stemLoadFlow.emplace( [&stemData, &services, loopStemRaw]()
+                    auto stemLoadTask = stemWorkFlow.emplace( [netConfiguration, loopStemRaw,
+                                                               cachePath   = services->getStemCache().getCachePathForStem( stemData ),
+                                                               decodedFile = services->getStemCache().getDecodedCacheFileForStem( stemData )]()
                     {
-                        loopStemRaw->fetch( services->getNetConfiguration(), services->getStemCache().getCachePathForStem( stemData ) );
+                        loopStemRaw->fetch( *netConfiguration, cachePath, decodedFile );
+                        loopStemRaw->finishFetch();
                     });
-                    stemAnalysisFlow.emplace( [&stemProcessing, loopStemRaw]()
+                    auto stemAnalysisTask = stemWorkFlow.emplace( [stemProcessingPtr, loopStemRaw, analysisCacheFile = services->getStemCache().getAnalysisCacheFileForStem( stemData )]()
                     {
-                        loopStemRaw->analyse( stemProcessing );
+                        loopStemRaw->analyse( *stemProcessingPtr, analysisCacheFile );
                     });
-                    stemsWithAsyncAnalysis.push_back( loopStemRaw );
+                    stemLoadTask.precede( stemAnalysisTask );
+
+                    stemsWithAsyncWork.push_back( loopStemRaw );
                 }
                 m_stemPtrs[stemI] = loopStemRaw;
 
@@ -172,15 +205,24 @@ void Riff::fetch( services::RiffFetchProvider& services )
             }
         }
 
-        // spread out stem loading across task system
-        auto stemLoadFuture = services->getTaskExecutor().run( stemLoadFlow );
-        stemLoadFuture.wait();
+        // spread out stem loading & analysis across task system; shift ownership of the graph and hand a future to all 
+        // the stems involved that they can wait() on pre-destruction to ensure the underlying data isn't tossed before the tasks complete
+        std::shared_future<void> stemSharedWork( services->getTaskExecutor().run( std::move( stemWorkFlow ) ) );
+        for ( endlesss::live::Stem* rawStem : stemsWithAsyncWork )
+            rawStem->keepFuture( stemSharedWork );
 
-        // with data loaded, enqueue the post-process analysis tasks; shift ownership of the graph and return
-        // a future that all stems can wait() on pre-destruction to ensure the underlying data isn't tossed before the tasks complete
-        std::shared_future<void> stemSharedAnalysis( services->getTaskExecutor().run( std::move(stemAnalysisFlow) ) );
-        for ( endlesss::live::Stem* rawStem : stemsWithAsyncAnalysis )
-            rawStem->keepFuture( stemSharedAnalysis );
+        // wait for every stem, including ones being loaded by other riffs, to either finish loading entirely or - if
+        // we are fetching progressively - just get far enough that the length is known and samples are arriving
+        for ( endlesss::live::Stem* rawStem : m_stemPtrs )
+        {
+            if ( rawStem == nullptr )
+                continue;
+
+            if ( progressive )
+                rawStem->waitForPlayable();
+            else
+                rawStem->waitForFetch();
+        }
 
         // once stems are loaded, work out their final lengths so we can determine the shape of the riff
         for ( std::size_t stemI = 0; stemI < m_stemPtrs.size(); stemI++ )
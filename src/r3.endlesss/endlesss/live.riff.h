@@ -63,7 +63,13 @@ struct Riff
     Riff( const endlesss::types::RiffComplete& riffData );
     ~Riff();
 
-    void fetch( services::RiffFetchProvider& services );
+    // resolve and load all the stems for this riff, blocking until done; if progressive is set, this returns as soon as
+    // all stems know their length and have started decoding - the rest of the audio arrives in the background, tracked
+    // per stem by Stem::getSamplesReady(), so anything consuming the riff must cope with partially decoded stems
+    void fetch( services::RiffFetchProvider& services, const bool progressive = false );
+
+    // block until every stem has been completely loaded; a no-op unless the riff was fetched progressively
+    void waitForAllStems() const;
 
     using streamProcessorFactoryFn = std::function< ssp::SampleStreamProcessorInstance( const uint32_t stemIndex, const endlesss::live::Stem& stemData ) >;
     void exportToDisk( const streamProcessorFactoryFn& diskWriterForStem, const int32_t sampleOffset );
@@ -126,6 +132,10 @@ struct Riff
 
     inline RiffCIDHash getCIDHash() const { return m_computedRiffCouchHash; }
 
+    // approximate memory held alive by this riff, ie. itself plus all the stems it owns; note that stems can be
+    // shared between riffs so summing this across many riffs will over-estimate
+    ouro_nodiscard std::size_t estimateMemoryUsageBytes() const;
+
 
     // export the riff metadata and anything else of vague (debug) interest into a string for dumping out somewhere
     std::string generateMetadataReport() const;
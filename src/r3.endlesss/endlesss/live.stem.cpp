@@ -16,7 +16,9 @@
 
 #include "dsp/fft.util.h"
 #include "dsp/octave.h"
+#include "dsp/simd.h"
 #include "endlesss/live.stem.h"
+#include "endlesss/cache.stems.h"
 #include "filesys/fsutil.h"
 #include "math/rng.h"
 #include "spacetime/moment.h"
@@ -35,6 +37,9 @@
 // r8brain
 #include "CDSPResampler.h"
 
+// zstd, for packing analysis data
+#include "zstd.h"
+
 // q
 #include <q/fx/schmitt_trigger.hpp>
 #include <q/fx/signal_conditioner.hpp>
@@ -56,6 +61,34 @@ Stem::Processing::~Processing()
     }
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t Stem::Processing::computeAnalysisHash() const
+{
+    struct HashInputs
+    {
+        uint32_t    m_analysisVersion;
+        int32_t     m_fftWindowSize;
+        float       m_sampleRateF;
+        float       m_beatFollowDuration;
+        float       m_waveFollowDuration;
+        float       m_trackerSensitivity;
+        float       m_trackerHysteresis;
+        uint32_t    m_padding;
+    } hashInputs
+    {
+        cAnalysisVersion,
+        m_fftWindowSize,
+        m_sampleRateF,
+        m_tuning.m_beatFollowDuration,
+        m_tuning.m_waveFollowDuration,
+        m_tuning.m_trackerSensitivity,
+        m_tuning.m_trackerHysteresis,
+        0
+    };
+
+    return komihash( &hashInputs, sizeof( HashInputs ), 0 );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 Stem::Processing::UPtr Stem::createStemProcessing( const uint32_t targetSampleRate )
 {
@@ -102,6 +135,9 @@ Stem::~Stem()
 
     blog::stem( FMTX( "[s:{}] released" ), m_data.couchID );
 
+    if ( m_memoryTracker )
+        *m_memoryTracker -= static_cast<int64_t>( m_memoryTracked.exchange( 0 ) );
+
     mem::free16( m_channel[0] );
     mem::free16( m_channel[1] );
 
@@ -110,7 +146,28 @@ Stem::~Stem()
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
+void Stem::setMemoryTracker( const MemoryTracker& memoryTracker )
+{
+    ABSL_ASSERT( m_memoryTracker == nullptr );
+    m_memoryTracker = memoryTracker;
+
+    updateTrackedMemory();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Stem::updateTrackedMemory()
+{
+    if ( !m_memoryTracker )
+        return;
+
+    const std::size_t currentBytes  = estimateMemoryUsageBytes();
+    const std::size_t previousBytes = m_memoryTracked.exchange( currentBytes );
+
+    *m_memoryTracker += static_cast<int64_t>( currentBytes ) - static_cast<int64_t>( previousBytes );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath, const fs::path& decodedCacheFile )
 {
     // ensure we have a space to write the stem back out to
     const absl::Status cachePathAvailable = filesys::ensureDirectoryExists( cachePath );
@@ -131,6 +188,18 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
 
     spacetime::ScopedTimer stemTiming( "stem finalize" );
 
+    // quickest route; we already have the final decoded & resampled data on disk
+    if ( !decodedCacheFile.empty() && loadFromDecodedCache( decodedCacheFile, stemCouchSnip ) )
+    {
+        publishSamplesReady( m_sampleCount );
+        m_state = State::Complete;
+
+        blog::stem( FMTX( "[s:{}..] loaded decoded data, took {}" ),
+            stemCouchSnip,
+            stemTiming.stop() );
+        return;
+    }
+
     // prepare download buffer
     RawAudioMemory audioMemory( m_data.fileLengthBytes );
 
@@ -172,51 +241,16 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
         audioMemory.m_rawReceived = fileSize;
     }
 
-    math::RNG32 lRng;
-
     if ( audioMemory.m_rawReceived == 0 )
     {
-        bool stemFetchSuccess = false;
-
-        blog::stem( FMTX( "[s:{}..] downloading [{}/{}] ..." ),
-            stemCouchSnip,
-            m_data.fullEndpoint(),
-            m_data.fileKey );
-
-        // things can take a while to propogate to the CDN; wait longer each cycle and try repeatedly
-        for ( auto remoteFetchAttempst = 0; remoteFetchAttempst < ncfg.getRequestRetries(); remoteFetchAttempst++ )
-        {
-            // extend & jitter fetch delay each time we start a full fetch attempt, up to 1s
-            const auto fetchDelayMs = std::min( lRng.genInt32( 0, 500 ) + ( remoteFetchAttempst * 250 ), 1000 );
-
-            std::this_thread::sleep_for( std::chrono::milliseconds( fetchDelayMs ) );
-
-            if ( !attemptRemoteFetch( ncfg, lRng.genUInt32(), audioMemory ) )
-            {
-                blog::stem( FMTX( "[s:{}..] failed attempt {} for [{}], will retry" ),
-                    stemCouchSnip,
-                    remoteFetchAttempst + 1,
-                    m_data.fileKey );
-            }
-            else
-            {
-                stemFetchSuccess = true;
-                break;
-            }
-        }
-
-        if ( !stemFetchSuccess )
-        {
-            blog::stem( FMTX( "[s:{}..] unable to acquire [{}]"),
-                stemCouchSnip,
-                m_data.fileKey );
+        if ( !fetchRemoteWithRetries( ncfg, audioMemory, stemCouchSnip ) )
             return;
-        }
     }
 
     // luckily we can tell what compression is in play from the first 4 bytes (so far, at least)
-    const bool stemIsFLAC = (audioMemory.m_rawAudio[0] == 'f' && audioMemory.m_rawAudio[1] == 'L' && audioMemory.m_rawAudio[2] == 'a' && audioMemory.m_rawAudio[3] == 'C');
-    const bool stemIsOGG  = (audioMemory.m_rawAudio[0] == 'O' && audioMemory.m_rawAudio[1] == 'g' && audioMemory.m_rawAudio[2] == 'g' && audioMemory.m_rawAudio[3] == 'S');
+    const Compression sourceCompression = identifyCompression( audioMemory.m_rawAudio, audioMemory.m_rawReceived );
+    const bool stemIsFLAC = ( sourceCompression == Compression::FLAC );
+    const bool stemIsOGG  = ( sourceCompression == Compression::OggVorbis );
 
     // header check - do we have a file we know how to decompress?
     if ( !stemIsFLAC && !stemIsOGG )
@@ -261,9 +295,9 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
         m_compressionFormat = Compression::OggVorbis;
 
         // emit a successful capture back to the cache
+        if ( const auto cacheStatus = writeRawToCache( cacheFile, audioMemory ); !cacheStatus.ok() )
         {
-            std::basic_ofstream<char> ofs( cacheFile, std::ios::out | std::ios::binary );
-            ofs.write( (char*)audioMemory.m_rawAudio, audioMemory.m_rawReceived );
+            blog::error::cache( FMTX( "[s:{}..] unable to write to stem cache, {}" ), stemCouchSnip, cacheStatus.ToString() );
         }
 
         static constexpr double shortToDoubleNormalisedRcp = 1.0 / 32768.0;
@@ -344,6 +378,10 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
         flacStreamChannels.fill( nullptr );
         std::size_t flacStreamChannelsWriteIndex = 0;
 
+        // if the stream is already at our sample rate we decode straight into the final channel buffers and make
+        // the stem playable immediately, publishing progress as we go; resampling needs the whole stream up front
+        bool flacStreaming = false;
+
         // inner loop decoder buffer, stack local
         static constexpr std::size_t flacDecoderBufferSize = 1024 * 4;
         int32_t decodeBuffer[flacDecoderBufferSize];
@@ -412,7 +450,7 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
                 case FLAC_END_OF_METADATA:
                 {
                     // check we haven't already seen a metadata block, should just be the one (AFAIK)
-                    ABSL_ASSERT( flacStreamChannels[0] == nullptr );
+                    ABSL_ASSERT( flacStreamChannels[0] == nullptr && m_channel[0] == nullptr );
 
                     flacSampleRate      = fx_flac_get_streaminfo( flac, FLAC_KEY_SAMPLE_RATE );
                     flacChannelCount    = fx_flac_get_streaminfo( flac, FLAC_KEY_N_CHANNELS );
@@ -423,6 +461,7 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
                     {
                         blog::error::stem( FMTX( "[s:{}..] flac decode error - expecting 2 channels, got {}" ), stemCouchSnip, flacChannelCount );
                         m_state = State::Failed_Decompression;
+                        break;
                     }
 
                     blog::stem( FMTX( "[s:{}..] start flac decode : {} samples, {}-bit @ {}" ),
@@ -439,9 +478,24 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
                     conversionNegativeRecp = 1.0 / static_cast<double>(sampleMaxNegativeValue);
                     conversionBitShift = 32 - flacSampleSize;
 
-                    // prepare storage for the decompressed frames
-                    flacStreamChannels[0] = mem::alloc16<double>( flacSampleCount );
-                    flacStreamChannels[1] = mem::alloc16<double>( flacSampleCount );
+                    flacStreaming = ( flacSampleRate == m_sampleRate );
+                    if ( flacStreaming )
+                    {
+                        // final storage, zeroed so that anything reading ahead of the watermark only ever sees silence
+                        m_channel[0] = mem::alloc16<float>( flacSampleCount );
+                        m_channel[1] = mem::alloc16<float>( flacSampleCount );
+                        std::fill_n( m_channel[0], flacSampleCount, 0.0f );
+                        std::fill_n( m_channel[1], flacSampleCount, 0.0f );
+
+                        m_sampleCount = static_cast<int32_t>( flacSampleCount );
+                        markPlayable();
+                    }
+                    else
+                    {
+                        // prepare storage for the decompressed frames
+                        flacStreamChannels[0] = mem::alloc16<double>( flacSampleCount );
+                        flacStreamChannels[1] = mem::alloc16<double>( flacSampleCount );
+                    }
                     break;
                 }
 
@@ -453,7 +507,7 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
                 case FLAC_END_OF_FRAME:
                 {
                     // check we got a metadata block first, otherwise we have nowhere to decode into
-                    if ( flacStreamChannels[0] == nullptr )
+                    if ( flacStreamChannels[0] == nullptr && m_channel[0] == nullptr )
                     {
                         blog::error::stem( FMTX( "[s:{}..] flac decode error - no metadata decoded before frames encountered" ), stemCouchSnip );
                         m_state = State::Failed_Decompression;
@@ -471,8 +525,25 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
                         double sampleDoubleL = static_cast<double>( decodeBuffer[sample+0] >> conversionBitShift ) * conversionNegativeRecp;
                         double sampleDoubleR = static_cast<double>( decodeBuffer[sample+1] >> conversionBitShift ) * conversionNegativeRecp;
 
-                        flacStreamChannels[0][flacStreamChannelsWriteIndex] = sampleDoubleL;
-                        flacStreamChannels[1][flacStreamChannelsWriteIndex] = sampleDoubleR;
+                        if ( flacStreaming )
+                        {
+                            m_channel[0][flacStreamChannelsWriteIndex] = static_cast<float>( sampleDoubleL );
+                            m_channel[1][flacStreamChannelsWriteIndex] = static_cast<float>( sampleDoubleR );
+                        }
+                        else
+                        {
+                            flacStreamChannels[0][flacStreamChannelsWriteIndex] = sampleDoubleL;
+                            flacStreamChannels[1][flacStreamChannelsWriteIndex] = sampleDoubleR;
+                        }
+                    }
+
+                    // let readers in on what we have so far; the tail is held back as the loop sewing will rewrite it
+                    if ( flacStreaming )
+                    {
+                        publishSamplesReady( static_cast<int32_t>( std::clamp< int64_t >(
+                            static_cast<int64_t>( flacSampleCount ) - cLoopSewingWindowSize,
+                            0,
+                            flacStreamChannelsWriteIndex ) ) );
                     }
                     break;
                 }
@@ -489,7 +560,8 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
         // check if we emerged from the loop with errors
         if ( m_state != State::WorkEnqueued )
         {
-            // clean up the channel buffers before leaving
+            // clean up the channel buffers before leaving; if we were streaming, m_channel may already be in use by
+            // a mixer so that is left for the destructor to clean up, readers will see the failed state and stop
             mem::free16( flacStreamChannels[0] );
             mem::free16( flacStreamChannels[1] );
 
@@ -524,21 +596,33 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
                 // .. and 'fix' by just copying the last valid one we have over the gaps to avoid a click
                 for ( std::size_t hackSample = flacStreamChannelsWriteIndex; hackSample < flacSampleCount; hackSample++ )
                 {
-                    flacStreamChannels[0][hackSample] = flacStreamChannels[0][flacStreamChannelsWriteIndex - 1];
-                    flacStreamChannels[1][hackSample] = flacStreamChannels[1][flacStreamChannelsWriteIndex - 1];
+                    if ( flacStreaming )
+                    {
+                        m_channel[0][hackSample] = m_channel[0][flacStreamChannelsWriteIndex - 1];
+                        m_channel[1][hackSample] = m_channel[1][flacStreamChannelsWriteIndex - 1];
+                    }
+                    else
+                    {
+                        flacStreamChannels[0][hackSample] = flacStreamChannels[0][flacStreamChannelsWriteIndex - 1];
+                        flacStreamChannels[1][hackSample] = flacStreamChannels[1][flacStreamChannelsWriteIndex - 1];
+                    }
                 }
                 flacStreamChannelsWriteIndex = flacSampleCount;
             }
             else
             {
+                mem::free16( flacStreamChannels[0] );
+                mem::free16( flacStreamChannels[1] );
+
                 m_state = State::Failed_Decompression;
                 return;
             }
         }
         m_sampleCount = static_cast<int32_t>( flacSampleCount );
 
-        // similar to OGG, handle sample rate conversion as we create the final data buffers
-        if ( flacSampleRate != m_sampleRate )
+        // similar to OGG, handle sample rate conversion as we create the final data buffers; if the sample rate already
+        // matched then we were streaming and everything was decoded directly into place
+        if ( !flacStreaming )
         {
             blog::stem( FMTX( "[s:{}..] resampling flac from {}" ), stemCouchSnip, flacSampleRate );
 
@@ -568,22 +652,6 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
 
             m_sampleCount = outputSampleLength;
         }
-        // if the sample rate already matches, just copy across verbatim
-        else
-        {
-            // blog::stem( FMTX( "[s:{}..] stem already at {}" ), stemCouchSnip, m_sampleRate );
-
-            m_channel[0] = mem::alloc16<float>( m_sampleCount );
-            m_channel[1] = mem::alloc16<float>( m_sampleCount );
-
-            for ( std::size_t channel = 0; channel < 2; channel++ )
-            {
-                for ( std::size_t s = 0; s < m_sampleCount; s++ )
-                {
-                    m_channel[channel][s] = static_cast<float>(flacStreamChannels[channel][s]);
-                }
-            }
-        }
 
         mem::free16( flacStreamChannels[0] );
         mem::free16( flacStreamChannels[1] );
@@ -591,15 +659,23 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
         m_compressionFormat = Compression::FLAC;
 
         // if the decode worked, stash the original data in the cache
+        if ( const auto cacheStatus = writeRawToCache( cacheFile, audioMemory ); !cacheStatus.ok() )
         {
-            std::basic_ofstream<char> ofs( cacheFile, std::ios::out | std::ios::binary );
-            ofs.write( (char*)audioMemory.m_rawAudio, audioMemory.m_rawReceived );
+            blog::error::cache( FMTX( "[s:{}..] unable to write to stem cache, {}" ), stemCouchSnip, cacheStatus.ToString() );
         }
     }
 
     // immediate post-processing steps that modify samples
     applyLoopSewingBlend();
 
+    publishSamplesReady( m_sampleCount );
+
+    // stash the final results so next time we can skip all the work above
+    if ( !decodedCacheFile.empty() )
+    {
+        storeToDecodedCache( decodedCacheFile, stemCouchSnip );
+    }
+
     m_state = State::Complete;
 
     // report on our hard work
@@ -614,26 +690,160 @@ void Stem::fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath )
     }
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+absl::StatusOr< std::size_t > Stem::downloadToCache( const api::NetConfiguration& ncfg, const fs::path& cachePath )
+{
+    const absl::Status cachePathAvailable = filesys::ensureDirectoryExists( cachePath );
+    if ( !cachePathAvailable.ok() )
+    {
+        m_state = State::Failed_CacheDirectory;
+        return cachePathAvailable;
+    }
+
+    m_state = State::WorkEnqueued;
+
+    const std::string stemCouchSnip = m_data.couchID.substr( 8 );
+
+    RawAudioMemory audioMemory( m_data.fileLengthBytes );
+    if ( !fetchRemoteWithRetries( ncfg, audioMemory, stemCouchSnip ) )
+    {
+        return absl::UnavailableError( fmt::format( FMTX( "unable to download [{}/{}]" ), m_data.fullEndpoint(), m_data.fileKey ) );
+    }
+
+    // don't let anything into the cache that the fetch() path wouldn't be able to decode later
+    m_compressionFormat = identifyCompression( audioMemory.m_rawAudio, audioMemory.m_rawReceived );
+    if ( m_compressionFormat == Compression::Unknown )
+    {
+        m_state = State::Failed_Decompression;
+        return absl::DataLossError( fmt::format( FMTX( "[s:{}..] audio compression format not recognised" ), stemCouchSnip ) );
+    }
+
+    const absl::Status writeStatus = writeRawToCache( cachePath / m_data.couchID.value(), audioMemory );
+    if ( !writeStatus.ok() )
+    {
+        m_state = State::Failed_CacheDirectory;
+        return writeStatus;
+    }
+
+    m_state = State::Complete;
+    return audioMemory.m_rawReceived;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Stem::Compression Stem::identifyCompression( const uint8_t* data, const std::size_t dataLength )
+{
+    if ( data == nullptr || dataLength < 4 )
+        return Compression::Unknown;
+
+    if ( data[0] == 'f' && data[1] == 'L' && data[2] == 'a' && data[3] == 'C' )
+        return Compression::FLAC;
+    if ( data[0] == 'O' && data[1] == 'g' && data[2] == 'g' && data[3] == 'S' )
+        return Compression::OggVorbis;
+
+    return Compression::Unknown;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Stem::fetchRemoteWithRetries( const api::NetConfiguration& ncfg, RawAudioMemory& audioMemory, const std::string& stemCouchSnip )
+{
+    math::RNG32 lRng;
+
+    blog::stem( FMTX( "[s:{}..] downloading [{}/{}] ..." ),
+        stemCouchSnip,
+        m_data.fullEndpoint(),
+        m_data.fileKey );
+
+    // things can take a while to propogate to the CDN; wait longer each cycle and try repeatedly
+    for ( auto remoteFetchAttempst = 0; remoteFetchAttempst < ncfg.getRequestRetries(); remoteFetchAttempst++ )
+    {
+        // extend & jitter fetch delay each time we start a full fetch attempt, up to 1s
+        const auto fetchDelayMs = std::min( lRng.genInt32( 0, 500 ) + ( remoteFetchAttempst * 250 ), 1000 );
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( fetchDelayMs ) );
+
+        // start each attempt from scratch, a previous one may have got partway through the body
+        audioMemory.m_rawReceived = 0;
+        m_state = State::WorkEnqueued;
+
+        if ( attemptRemoteFetch( ncfg, lRng.genUInt32(), audioMemory ) )
+            return true;
+
+        blog::stem( FMTX( "[s:{}..] failed attempt {} for [{}], will retry" ),
+            stemCouchSnip,
+            remoteFetchAttempst + 1,
+            m_data.fileKey );
+    }
+
+    blog::stem( FMTX( "[s:{}..] unable to acquire [{}]"),
+        stemCouchSnip,
+        m_data.fileKey );
+
+    return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status Stem::writeRawToCache( const fs::path& cacheFile, const RawAudioMemory& audioMemory )
+{
+    const fs::path cacheFileTemp = filesys::getThreadTempFileFor( cacheFile );
+    {
+        std::basic_ofstream<char> ofs( cacheFileTemp, std::ios::out | std::ios::binary | std::ios::trunc );
+        if ( !ofs.is_open() )
+        {
+            return absl::PermissionDeniedError( fmt::format( FMTX( "unable to open [{}] for writing" ), cacheFileTemp.string() ) );
+        }
+
+        ofs.write( reinterpret_cast<const char*>( audioMemory.m_rawAudio ), audioMemory.m_rawReceived );
+
+        if ( !ofs.good() )
+        {
+            ofs.close();
+            std::error_code removeError;
+            fs::remove( cacheFileTemp, removeError );
+
+            return absl::DataLossError( fmt::format( FMTX( "failed while writing [{}]" ), cacheFileTemp.string() ) );
+        }
+    }
+
+    std::error_code renameError;
+    fs::rename( cacheFileTemp, cacheFile, renameError );
+    if ( renameError )
+    {
+        std::error_code removeError;
+        fs::remove( cacheFileTemp, removeError );
+
+        return absl::AbortedError( fmt::format( FMTX( "unable to move [{}] into place, {}" ), cacheFile.string(), renameError.message() ) );
+    }
+
+    return absl::OkStatus();
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 bool Stem::attemptRemoteFetch( const api::NetConfiguration& ncfg, const uint32_t attemptUID, RawAudioMemory& audioMemory )
 {
     // log network traffic
     ncfg.metricsActivitySend();
 
-    // create client to fetch audio stream from the CDN
+    // lease a client to fetch audio stream from the CDN; these are pooled per host so a run of downloads from the
+    // same bucket can keep reusing one connection
     const auto& httpUrl = m_data.fullEndpoint();
-    auto cdnClient      = std::make_unique< httplib::SSLClient >( httpUrl.c_str() );
+    auto cdnClient      = ncfg.leaseHttpClient( fmt::format( FMTX( "cdn:{}" ), httpUrl ), [&]() -> base::HttpClientPool::ClientPtr
+    {
+        auto newClient = std::make_unique< httplib::SSLClient >( httpUrl );
 
-    cdnClient->set_ca_cert_path( ncfg.api().certBundleRelative.c_str() );
-    cdnClient->enable_server_certificate_verification( true );
+        newClient->set_ca_cert_path( ncfg.api().certBundleRelative.c_str() );
+        newClient->enable_server_certificate_verification( true );
+        newClient->set_keep_alive( ncfg.api().connectionKeepAlive );
 
-    cdnClient->set_default_headers(
-        {
-            { "Host",            httpUrl },
-            { "User-Agent",      ncfg.api().userAgentApp.c_str() },
-            { "Accept",          "audio/ogg" },
-            { "Accept-Encoding", "gzip, deflate, br" }
-        } );
+        newClient->set_default_headers(
+            {
+                { "Host",            httpUrl },
+                { "User-Agent",      ncfg.api().userAgentApp.c_str() },
+                { "Accept",          "audio/ogg" },
+                { "Accept-Encoding", "gzip, deflate, br" }
+            } );
+
+        return newClient;
+    });
 
     auto slashedKey = fmt::format( "/{}", m_data.fileKey );
 
@@ -703,6 +913,9 @@ bool Stem::attemptRemoteFetch( const api::NetConfiguration& ncfg, const uint32_t
     {
         // auto result = cdnClient->get_openssl_verify_result();
 
+        // whatever went wrong, don't hand this connection to the next download
+        cdnClient.discard();
+
         if ( !ncfg.api().hackAllowStemUnderflow )
         {
             blog::error::stem( "ogg data size mismatch [{}{}] (expected {}, got {})", httpUrl, slashedKey, audioMemory.m_rawLength, audioMemory.m_rawReceived );
@@ -737,6 +950,85 @@ bool Stem::attemptRemoteFetch( const api::NetConfiguration& ncfg, const uint32_t
     return true;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+bool Stem::loadFromDecodedCache( const fs::path& decodedCacheFile, const std::string& stemCouchSnip )
+{
+    base::instr::ScopedEvent wte( "Stem::fetch::Decoded", base::instr::PresetColour::Violet );
+
+    std::error_code existsError;
+    if ( !fs::exists( decodedCacheFile, existsError ) )
+        return false;
+
+    cache::DecodedStemHeader decodedHeader;
+    std::array< float*, 2 > decodedChannels;
+
+    const absl::Status readStatus = cache::Stems::readDecodedStem( decodedCacheFile, m_sampleRate, decodedHeader, decodedChannels );
+    if ( !readStatus.ok() )
+    {
+        // not fatal, we will just rebuild it from the original data
+        blog::error::cache( FMTX( "[s:{}..] discarding decoded cache entry, {}" ), stemCouchSnip, readStatus.ToString() );
+        return false;
+    }
+
+    // the stem was decoded from a different version of the source data (or an older build wrote it before the size was
+    // recorded) so the samples can't be trusted; drop the entry and let the full decode replace it
+    if ( decodedHeader.m_sourceBytes != m_data.fileLengthBytes )
+    {
+        blog::error::cache( FMTX( "[s:{}..] discarding decoded cache entry, source size mismatch (expected {}, got {})" ),
+            stemCouchSnip,
+            m_data.fileLengthBytes,
+            decodedHeader.m_sourceBytes );
+
+        mem::free16( decodedChannels[0] );
+        mem::free16( decodedChannels[1] );
+
+        std::error_code removeError;
+        fs::remove( decodedCacheFile, removeError );
+        return false;
+    }
+
+    switch ( decodedHeader.m_compression )
+    {
+        case (uint32_t)Compression::OggVorbis:  m_compressionFormat = Compression::OggVorbis; break;
+        case (uint32_t)Compression::FLAC:       m_compressionFormat = Compression::FLAC;      break;
+        default:                                m_compressionFormat = Compression::Unknown;   break;
+    }
+
+    m_channel     = decodedChannels;
+    m_sampleCount = decodedHeader.m_sampleCount;
+
+    blog::cache( FMTX( "[s:{}..] found decoded in cache" ), stemCouchSnip );
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Stem::storeToDecodedCache( const fs::path& decodedCacheFile, const std::string& stemCouchSnip ) const
+{
+    base::instr::ScopedEvent wte( "Stem::fetch::StoreDecoded", base::instr::PresetColour::Pink );
+
+    if ( m_sampleCount <= 0 )
+        return;
+
+    const absl::Status cachePathAvailable = filesys::ensureDirectoryExists( decodedCacheFile.parent_path() );
+    if ( !cachePathAvailable.ok() )
+    {
+        blog::error::cache( FMTX( "[s:{}..] unable to create decoded cache directory, {}" ), stemCouchSnip, cachePathAvailable.ToString() );
+        return;
+    }
+
+    cache::DecodedStemHeader decodedHeader;
+    decodedHeader.m_sampleRate  = m_sampleRate;
+    decodedHeader.m_sampleCount = m_sampleCount;
+    decodedHeader.m_compression = static_cast<uint32_t>( m_compressionFormat );
+    decodedHeader.m_sourceBytes = m_data.fileLengthBytes;
+
+    const absl::Status writeStatus = cache::Stems::writeDecodedStem( decodedCacheFile, decodedHeader, m_channel );
+    if ( !writeStatus.ok() )
+    {
+        blog::error::cache( FMTX( "[s:{}..] failed to write decoded cache entry, {}" ), stemCouchSnip, writeStatus.ToString() );
+    }
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 // a fairly basic edit applied to each stem that cross-fades it with itself, blending a tiny blob of the front/end samples
 // to avoid trivial clicks that happen when loops don't perfectly loop (which is often). A better version of this would be to mirror 
@@ -744,7 +1036,7 @@ bool Stem::attemptRemoteFetch( const api::NetConfiguration& ncfg, const uint32_t
 //
 void Stem::applyLoopSewingBlend()
 {
-    static constexpr int32_t xfadeWindowSize = 128;
+    static constexpr int32_t xfadeWindowSize = cLoopSewingWindowSize;
     static constexpr double xfadeWindowSizeRecp = 1.0 / (double)xfadeWindowSize;
 
     // 1..0 constant-power blend over the window size
@@ -829,15 +1121,15 @@ bool Stem::analyse( const Processing& processing, StemAnalysisData& result ) con
             std::array< float, 3 > frequencyBuckets;
             frequencyBuckets.fill( 0 );
 
-            // sum the resulting spectrum into the precomputed buckets
-            for ( std::size_t freqBin = 0; freqBin < fftWindowSize / 2; freqBin++ )
+            // sum the resulting spectrum into the precomputed buckets; only the low and high buckets are used, so
+            // don't bother computing magnitudes for the middle range at all
+            for ( std::size_t bucket : { 0, 2 } )
             {
-                const float fftMagL = fftOutputL[freqBin].hypot();
-                const float fftMagR = fftOutputR[freqBin].hypot();
-
-                const float fftMag  = (fftMagL + fftMagR) * 0.5f; // #hdd average of magnitudes 'correct' here?
-
-                frequencyBuckets[processing.m_octaves.getBucketForFFTIndex( freqBin )] += fftMag;
+                frequencyBuckets[bucket] = simd::sumStereoMagnitudes(
+                    reinterpret_cast<const float*>(fftOutputL),
+                    reinterpret_cast<const float*>(fftOutputR),
+                    processing.m_octaves.getBucketRangeStart( bucket ),
+                    processing.m_octaves.getBucketRangeEnd( bucket ) );
             }
 
             // reduce and normalise the buckets we're interested in
@@ -870,7 +1162,16 @@ bool Stem::analyse( const Processing& processing, StemAnalysisData& result ) con
         processing.m_tuning.m_trackerHysteresis );
 
 
-    #define PSA_ENCODE( _v ) static_cast<uint8_t>( std::min( _v * 255.0f, 255.0f ) );
+    // block-based formulation of the signal followers; samples are processed in runs that never straddle an FFT
+    // window (so the band inputs are constant for the whole run), with the stereo max and the u8 quantisation done
+    // in bulk via the SIMD helpers either side of the inherently serial follower recurrences
+    static constexpr std::size_t cSignalBlockSize = 256;
+
+    alignas(16) float blockSignalInput[cSignalBlockSize];
+    alignas(16) float blockFollow[cSignalBlockSize];
+    alignas(16) float blockFollowLF[cSignalBlockSize];
+    alignas(16) float blockFollowHF[cSignalBlockSize];
+    alignas(16) float blockBeat[cSignalBlockSize];
 
     {
         char scBuf[32];
@@ -886,55 +1187,60 @@ bool Stem::analyse( const Processing& processing, StemAnalysisData& result ) con
         {
             base::instr::ScopedEvent wte( "Stem::analyse::signal", scBuf, base::instr::PresetColour::Indigo );
 
-            std::size_t fftBandIndex = 0;
-            for ( int64_t sI = 0, fftI = 0; sI < m_sampleCount; sI++, fftI++ )
+            // first pass only primes the followers; nothing is written out. the beat follower is skipped entirely
+            // as it would only be fed zeroes from a zero state, which leaves it unchanged
+            const bool primingPass = ( cycle == 0 );
+
+            int64_t blockStart = 0;
+            while ( blockStart < m_sampleCount )
             {
-                // increment [fftBandIndex] every [fftWindowSize] samples, matching how they were computed above
-                if ( fftI == fftWindowSize )
-                {
-                    fftBandIndex++;
-                    fftI = 0;
+                // which FFT band we are in; as the last block of samples might not have the FFT process run (as we just
+                // dumbly fit to N x WindowSize) then allow this band index to lock to the top of the allowed limit, 
+                // just copying the final values from the last bucket
+                const int64_t fftBandIndex   = std::min( blockStart / fftWindowSize, static_cast<int64_t>( fftTimeSlices - 1 ) );
+                const int64_t fftWindowEnd   = ( blockStart / fftWindowSize + 1 ) * fftWindowSize;
 
-                    // as the last block of samples might not have the FFT process run (as we just dumbly fit to N x WindowSize)
-                    // then allow this band index to lock to the top of the allowed limit, just copying the final values from the last bucket
-                    if ( fftBandIndex == fftTimeSlices )
-                        fftBandIndex = fftTimeSlices - 1;
-                }
+                const int64_t blockEnd       = std::min( { blockStart + static_cast<int64_t>( cSignalBlockSize ), fftWindowEnd, static_cast<int64_t>( m_sampleCount ) } );
+                const std::size_t blockCount = static_cast<std::size_t>( blockEnd - blockStart );
+
+                const float bandLF = fftOutLowBand[fftBandIndex];
+                const float bandHF = fftOutHighBand[fftBandIndex];
 
                 // don't imagine max() here is terribly scientific
-                const float signalInput     = std::max( m_channel[0][sI], m_channel[1][sI] );
-                const float signalFollow    = waveFollower( signalInput );
-                const float signalFollowLF  = waveFollowerLF( fftOutLowBand[fftBandIndex] );
-                const float signalFollowHF  = waveFollowerHF( fftOutHighBand[fftBandIndex] );
+                simd::maxOf2( &m_channel[0][blockStart], &m_channel[1][blockStart], blockSignalInput, blockCount );
 
-                float beatPeak = 0;
+                for ( std::size_t bI = 0; bI < blockCount; bI++ )
+                    blockFollow[bI]   = waveFollower( blockSignalInput[bI] );
+                for ( std::size_t bI = 0; bI < blockCount; bI++ )
+                    blockFollowLF[bI] = waveFollowerLF( bandLF );
+                for ( std::size_t bI = 0; bI < blockCount; bI++ )
+                    blockFollowHF[bI] = waveFollowerHF( bandHF );
 
-                if ( cycle == 0 )
-                {
-                    // do nothing on the first pass, m_beatBitfield has been cleared before and will only be set
-                    // once we've had the followers primed by the first pass
-                }
-                // run the tracker on second pass
-                else
+                if ( !primingPass )
                 {
-                    result.m_psaWave[sI]     = PSA_ENCODE( signalFollow   );
-                    result.m_psaLowFreq[sI]  = PSA_ENCODE( signalFollowLF );
-                    result.m_psaHighFreq[sI] = PSA_ENCODE( signalFollowHF );
-
-                    if ( peakTracker( signalInput, signalFollow ) )
+                    // run the tracker on second pass
+                    for ( std::size_t bI = 0; bI < blockCount; bI++ )
                     {
-                        result.setBeatAtSample( sI );
-                        beatPeak = 1.0f;
+                        float beatPeak = 0;
+                        if ( peakTracker( blockSignalInput[bI], blockFollow[bI] ) )
+                        {
+                            result.setBeatAtSample( blockStart + bI );
+                            beatPeak = 1.0f;
+                        }
+                        blockBeat[bI] = beatFollower( beatPeak );
                     }
+
+                    simd::quantiseUnitToU8( blockFollow,   &result.m_psaWave[blockStart],     blockCount );
+                    simd::quantiseUnitToU8( blockFollowLF, &result.m_psaLowFreq[blockStart],  blockCount );
+                    simd::quantiseUnitToU8( blockFollowHF, &result.m_psaHighFreq[blockStart], blockCount );
+                    simd::quantiseUnitToU8( blockBeat,     &result.m_psaBeat[blockStart],     blockCount );
                 }
 
-                result.m_psaBeat[sI] = PSA_ENCODE( beatFollower( beatPeak ) );
+                blockStart = blockEnd;
             }
         }
     }
 
-    #undef PSA_ENCODE
-
     mem::free16( fftOutHighBand );
     mem::free16( fftOutLowBand );
 
@@ -942,14 +1248,294 @@ bool Stem::analyse( const Processing& processing, StemAnalysisData& result ) con
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-bool Stem::analyse( const Processing& processing )
+bool Stem::analyse( const Processing& processing, const fs::path& analysisCacheFile )
 {
+    // stem failed to load, nothing to work with
+    if ( m_state != State::Complete )
+    {
+        m_analysisState = AnalysisState::AnalysisEmpty;
+        return false;
+    }
+
+    const uint64_t analysisHash = processing.computeAnalysisHash();
+
+    // try and pull previous results from disk
+    if ( !analysisCacheFile.empty() )
+    {
+        base::instr::ScopedEvent wte( "Stem::analyse::load", base::instr::PresetColour::Emerald );
+
+        std::error_code existsError;
+        if ( fs::exists( analysisCacheFile, existsError ) )
+        {
+            const absl::Status readStatus = m_analysisData.readFromFile( analysisCacheFile, analysisHash, m_sampleCount );
+            if ( readStatus.ok() )
+            {
+                m_analysisState = AnalysisState::AnalysisValid;
+                updateTrackedMemory();
+                return true;
+            }
+
+            blog::error::cache( FMTX( "[s:{}] discarding cached analysis, {}" ), m_data.couchID, readStatus.ToString() );
+        }
+    }
+
     const bool result = analyse( processing, m_analysisData );
+
+    // stash what we made for next time
+    if ( result && !analysisCacheFile.empty() )
+    {
+        base::instr::ScopedEvent wte( "Stem::analyse::store", base::instr::PresetColour::Emerald );
+
+        const absl::Status cachePathAvailable = filesys::ensureDirectoryExists( analysisCacheFile.parent_path() );
+        const absl::Status writeStatus = cachePathAvailable.ok() ? m_analysisData.writeToFile( analysisCacheFile, analysisHash ) : cachePathAvailable;
+        if ( !writeStatus.ok() )
+        {
+            blog::error::cache( FMTX( "[s:{}] failed to store analysis, {}" ), m_data.couchID, writeStatus.ToString() );
+        }
+    }
+
     m_analysisState = result ? AnalysisState::AnalysisValid : AnalysisState::AnalysisEmpty;
+    updateTrackedMemory();
 
     return result;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+// on-disk layout for persisted analysis data; the header is followed by a single zstd frame holding the four per-sample
+// arrays back to back and then the beat bitfield. the followers are smooth enough that this packs down very well
+//
+struct AnalysisFileHeader
+{
+    static constexpr uint32_t cMagic   = 0x4153504F;    // 'OPSA'
+    static constexpr uint32_t cVersion = 1;
+
+    uint32_t    m_magic             = cMagic;
+    uint32_t    m_version           = cVersion;
+    int32_t     m_sampleCount       = 0;
+    uint32_t    m_bitfieldCount     = 0;
+    uint64_t    m_analysisHash      = 0;
+    uint64_t    m_uncompressedBytes = 0;
+    uint64_t    m_compressedBytes   = 0;
+};
+static_assert( sizeof( AnalysisFileHeader ) == 40 );
+
+// ---------------------------------------------------------------------------------------------------------------------
+// sanity-check everything in a header read from disk before any of the sizes in it are trusted for allocations
+static absl::Status validateAnalysisFileHeader( const AnalysisFileHeader& header, const uint64_t analysisHash, const uint64_t fileBytes )
+{
+    if ( header.m_magic   != AnalysisFileHeader::cMagic ||
+         header.m_version != AnalysisFileHeader::cVersion )
+    {
+        return absl::FailedPreconditionError( fmt::format( FMTX( "unknown header (v{})" ), header.m_version ) );
+    }
+    if ( header.m_analysisHash != analysisHash )
+    {
+        return absl::FailedPreconditionError( "analysis settings have changed" );
+    }
+    if ( header.m_sampleCount <= 0 )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "invalid sample count {}" ), header.m_sampleCount ) );
+    }
+
+    const std::size_t sampleCount       = static_cast<std::size_t>( header.m_sampleCount );
+    const std::size_t bitfieldBytes     = static_cast<std::size_t>( header.m_bitfieldCount ) * sizeof( uint64_t );
+    const std::size_t uncompressedBytes = ( sampleCount * 4 ) + bitfieldBytes;
+
+    if ( header.m_uncompressedBytes != uncompressedBytes ||
+         header.m_bitfieldCount != ( sampleCount >> StemAnalysisData::BeatBitsShift ) + 1 )
+    {
+        return absl::DataLossError( "header sizes are inconsistent" );
+    }
+
+    // the payload is exactly the rest of the file, and zstd never emits more than its worst-case bound
+    if ( header.m_compressedBytes == 0 ||
+         header.m_compressedBytes != fileBytes - sizeof( AnalysisFileHeader ) ||
+         header.m_compressedBytes > ZSTD_compressBound( uncompressedBytes ) )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "compressed size {} is invalid for a {} byte file" ), header.m_compressedBytes, fileBytes ) );
+    }
+
+    return absl::OkStatus();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status StemAnalysisData::writeToFile( const fs::path& analysisFile, const uint64_t analysisHash ) const
+{
+    const std::size_t sampleCount       = m_psaWave.size();
+    const std::size_t bitfieldBytes     = m_beatBitfield.size() * sizeof( uint64_t );
+    const std::size_t uncompressedBytes = ( sampleCount * 4 ) + bitfieldBytes;
+
+    ABSL_ASSERT( m_psaBeat.size() == sampleCount && m_psaLowFreq.size() == sampleCount && m_psaHighFreq.size() == sampleCount );
+
+    // pack everything into a single block to compress in one go
+    uint8_t* uncompressedData = mem::alloc16<uint8_t>( uncompressedBytes );
+    {
+        uint8_t* writeHead = uncompressedData;
+        std::memcpy( writeHead, m_psaWave.data(),      sampleCount ); writeHead += sampleCount;
+        std::memcpy( writeHead, m_psaBeat.data(),      sampleCount ); writeHead += sampleCount;
+        std::memcpy( writeHead, m_psaLowFreq.data(),   sampleCount ); writeHead += sampleCount;
+        std::memcpy( writeHead, m_psaHighFreq.data(),  sampleCount ); writeHead += sampleCount;
+        std::memcpy( writeHead, m_beatBitfield.data(), bitfieldBytes );
+    }
+
+    const std::size_t compressedCapacity = ZSTD_compressBound( uncompressedBytes );
+    uint8_t* compressedData = mem::alloc16<uint8_t>( compressedCapacity );
+
+    absl::Cleanup releaseBuffers = [&]()
+    {
+        mem::free16( compressedData );
+        mem::free16( uncompressedData );
+    };
+
+    const std::size_t compressedBytes = ZSTD_compress( compressedData, compressedCapacity, uncompressedData, uncompressedBytes, 3 );
+    if ( ZSTD_isError( compressedBytes ) )
+    {
+        return absl::InternalError( fmt::format( FMTX( "zstd compression failed, {}" ), ZSTD_getErrorName( compressedBytes ) ) );
+    }
+
+    AnalysisFileHeader header;
+    header.m_sampleCount        = static_cast<int32_t>( sampleCount );
+    header.m_bitfieldCount      = static_cast<uint32_t>( m_beatBitfield.size() );
+    header.m_analysisHash       = analysisHash;
+    header.m_uncompressedBytes  = uncompressedBytes;
+    header.m_compressedBytes    = compressedBytes;
+
+    // write to a temporary and then move into place to avoid anyone else reading a partial file
+    const fs::path analysisFileTemp = filesys::getThreadTempFileFor( analysisFile );
+    {
+        std::basic_ofstream<char> ofs( analysisFileTemp, std::ios::out | std::ios::binary | std::ios::trunc );
+        if ( !ofs.is_open() )
+        {
+            return absl::PermissionDeniedError( fmt::format( FMTX( "unable to open [{}] for writing" ), analysisFileTemp.string() ) );
+        }
+
+        ofs.write( reinterpret_cast<const char*>( &header ), sizeof( AnalysisFileHeader ) );
+        ofs.write( reinterpret_cast<const char*>( compressedData ), compressedBytes );
+
+        if ( !ofs.good() )
+        {
+            ofs.close();
+            std::error_code removeError;
+            fs::remove( analysisFileTemp, removeError );
+
+            return absl::DataLossError( fmt::format( FMTX( "failed while writing [{}]" ), analysisFileTemp.string() ) );
+        }
+    }
+
+    std::error_code renameError;
+    fs::rename( analysisFileTemp, analysisFile, renameError );
+    if ( renameError )
+    {
+        std::error_code removeError;
+        fs::remove( analysisFileTemp, removeError );
+
+        return absl::AbortedError( fmt::format( FMTX( "unable to move [{}] into place, {}" ), analysisFile.string(), renameError.message() ) );
+    }
+
+    return absl::OkStatus();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status StemAnalysisData::readFromFile( const fs::path& analysisFile, const uint64_t analysisHash, const int32_t expectedSampleCount )
+{
+    std::error_code sizeError;
+    const uint64_t fileBytes = fs::file_size( analysisFile, sizeError );
+    if ( sizeError || fileBytes < sizeof( AnalysisFileHeader ) )
+    {
+        return absl::DataLossError( "truncated header" );
+    }
+
+    std::basic_ifstream<char> ifs( analysisFile, std::ios::in | std::ios::binary );
+    if ( !ifs.is_open() )
+    {
+        return absl::NotFoundError( fmt::format( FMTX( "unable to open [{}]" ), analysisFile.string() ) );
+    }
+
+    AnalysisFileHeader header;
+    ifs.read( reinterpret_cast<char*>( &header ), sizeof( AnalysisFileHeader ) );
+    if ( ifs.gcount() != sizeof( AnalysisFileHeader ) )
+    {
+        return absl::DataLossError( "truncated header" );
+    }
+
+    const absl::Status headerStatus = validateAnalysisFileHeader( header, analysisHash, fileBytes );
+    if ( !headerStatus.ok() )
+    {
+        return headerStatus;
+    }
+    if ( header.m_sampleCount != expectedSampleCount )
+    {
+        return absl::FailedPreconditionError( fmt::format( FMTX( "sample count mismatch, expected {} got {}" ), expectedSampleCount, header.m_sampleCount ) );
+    }
+
+    const std::size_t sampleCount       = static_cast<std::size_t>( header.m_sampleCount );
+    const std::size_t bitfieldBytes     = static_cast<std::size_t>( header.m_bitfieldCount ) * sizeof( uint64_t );
+    const std::size_t uncompressedBytes = ( sampleCount * 4 ) + bitfieldBytes;
+
+    uint8_t* compressedData   = mem::alloc16<uint8_t>( header.m_compressedBytes );
+    uint8_t* uncompressedData = mem::alloc16<uint8_t>( uncompressedBytes );
+
+    absl::Cleanup releaseBuffers = [&]()
+    {
+        mem::free16( uncompressedData );
+        mem::free16( compressedData );
+    };
+
+    ifs.read( reinterpret_cast<char*>( compressedData ), header.m_compressedBytes );
+    if ( static_cast<uint64_t>( ifs.gcount() ) != header.m_compressedBytes )
+    {
+        return absl::DataLossError( "truncated data" );
+    }
+
+    const std::size_t decompressedBytes = ZSTD_decompress( uncompressedData, uncompressedBytes, compressedData, header.m_compressedBytes );
+    if ( ZSTD_isError( decompressedBytes ) )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "zstd decompression failed, {}" ), ZSTD_getErrorName( decompressedBytes ) ) );
+    }
+    if ( decompressedBytes != uncompressedBytes )
+    {
+        return absl::DataLossError( "decompressed size mismatch" );
+    }
+
+    resize( header.m_sampleCount );
+    {
+        const uint8_t* readHead = uncompressedData;
+        std::memcpy( m_psaWave.data(),      readHead, sampleCount ); readHead += sampleCount;
+        std::memcpy( m_psaBeat.data(),      readHead, sampleCount ); readHead += sampleCount;
+        std::memcpy( m_psaLowFreq.data(),   readHead, sampleCount ); readHead += sampleCount;
+        std::memcpy( m_psaHighFreq.data(),  readHead, sampleCount ); readHead += sampleCount;
+        std::memcpy( m_beatBitfield.data(), readHead, bitfieldBytes );
+    }
+
+    return absl::OkStatus();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status StemAnalysisData::validateFile( const fs::path& analysisFile, const uint64_t analysisHash, uint64_t& fileBytes )
+{
+    std::error_code sizeError;
+    fileBytes = fs::file_size( analysisFile, sizeError );
+    if ( sizeError || fileBytes < sizeof( AnalysisFileHeader ) )
+    {
+        return absl::DataLossError( "truncated header" );
+    }
+
+    std::basic_ifstream<char> ifs( analysisFile, std::ios::in | std::ios::binary );
+    if ( !ifs.is_open() )
+    {
+        return absl::NotFoundError( fmt::format( FMTX( "unable to open [{}]" ), analysisFile.string() ) );
+    }
+
+    AnalysisFileHeader header;
+    ifs.read( reinterpret_cast<char*>( &header ), sizeof( AnalysisFileHeader ) );
+    if ( ifs.gcount() != sizeof( AnalysisFileHeader ) )
+    {
+        return absl::DataLossError( "truncated header" );
+    }
+
+    return validateAnalysisFileHeader( header, analysisHash, fileBytes );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 Stem::RawAudioMemory::RawAudioMemory( size_t size )
     : m_rawLength( size )
@@ -97,6 +97,17 @@ struct StemAnalysisData
 
     // one bit per sample bitfield, talk to it via functions above
     std::vector< uint64_t >         m_beatBitfield;
+
+
+    // analysis results are a pure function of the stem audio and the processing setup, so we can persist them to disk
+    // and skip the (expensive) analysis pass on subsequent loads; the analysisHash should be from Processing::computeAnalysisHash
+    // and is checked on load so that changes to tuning will invalidate old data
+    absl::Status writeToFile( const fs::path& analysisFile, const uint64_t analysisHash ) const;
+    absl::Status readFromFile( const fs::path& analysisFile, const uint64_t analysisHash, const int32_t expectedSampleCount );
+
+    // check the header of a persisted analysis file without loading it; used by cache maintenance to find files that
+    // are damaged or were written with different analysis settings. on success, fileBytes holds the size on disk
+    static absl::Status validateFile( const fs::path& analysisFile, const uint64_t analysisHash, uint64_t& fileBytes );
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -158,6 +169,14 @@ struct Stem
             float       m_trackerHysteresis  = 0.100f;
 
         }               m_tuning;
+
+        // bump if the analysis code changes in a way that would alter the results
+        // v2 : vectorised magnitude sums, different float summation order
+        static constexpr uint32_t cAnalysisVersion = 2;
+
+        // produce a hash of everything that affects the output of Stem::analyse - fft setup, sample rate, tuning values;
+        // used to key persisted StemAnalysisData
+        ouro_nodiscard uint64_t computeAnalysisHash() const;
     };
 
     static Processing::UPtr createStemProcessing( const uint32_t targetSampleRate );
@@ -169,12 +188,30 @@ struct Stem
 
     // instigate a fetch of the stem data from either the cache or the network
     // note this is a blocking call and is designed to be called from a background thread in most cases
-    void fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath );
+    // if decodedCacheFile is provided, we first try to load fully decoded data from it, and write it back out after
+    // any full decode so that subsequent loads can skip decompression & resampling
+    //
+    // where possible (FLAC already at the target sample rate) the decode is streamed; m_sampleCount and the channel
+    // buffers are set up as soon as the stream header is read, the stem is marked playable and getSamplesReady()
+    // then advances as chunks are decoded. otherwise the stem only becomes playable once everything is done
+    void fetch( const api::NetConfiguration& ncfg, const fs::path& cachePath, const fs::path& decodedCacheFile = {} );
+
+    // download-only path for warming the stem cache; pulls the compressed data into cachePath without decoding it.
+    // data is only kept if it carries a FLAC or OGG header, and is written via a temporary file so that an interrupted
+    // download never leaves a partial stem in the cache. returns the number of bytes written
+    absl::StatusOr< std::size_t > downloadToCache( const api::NetConfiguration& ncfg, const fs::path& cachePath );
+
+    // we can tell what compression is in play from the first 4 bytes; Unknown if it's neither FLAC nor OGG
+    ouro_nodiscard static Compression identifyCompression( const uint8_t* data, const std::size_t dataLength );
 
     // run analysis pass, producing things like onsets / peak-following / etc into the given result;
     // this result is passed as an argument so that we can also run this in debug tools to tune the processing
     bool analyse( const Processing& processing, StemAnalysisData& result ) const;
-    bool analyse( const Processing& processing );   // convenience function that calls the above on current instance, also then toggling m_hasValidAnalysis
+
+    // convenience function that calls the above on current instance, also then toggling m_hasValidAnalysis;
+    // if analysisCacheFile is provided, we try to load previously computed results from there first, and store
+    // the results there if we had to compute them
+    bool analyse( const Processing& processing, const fs::path& analysisCacheFile = {} );
 
 
     // stem needs a copy of the analysis task future to ensure that in the unlikely case
@@ -185,6 +222,23 @@ struct Stem
         m_analysisFuture = analysisFuture;
     }
 
+    // riffs fetched concurrently (eg. by the riff pipeline prefetch) can share stems; whoever claims a stem first is
+    // responsible for calling fetch() and then finishFetch(), everyone else must waitForFetch() before touching the data
+    // .. or waitForPlayable() if they are happy to deal with a stem that is still being decoded
+    ouro_nodiscard inline bool claimFetch() { return !m_fetchClaimed.exchange( true ); }
+    inline void finishFetch() { markPlayable(); updateTrackedMemory(); m_fetchFinished = true; m_fetchFinished.notify_all(); }
+    inline void waitForFetch() const { m_fetchFinished.wait( false ); }
+    inline void waitForPlayable() const { m_fetchPlayable.wait( false ); }
+
+    // number of samples from the start of the channel buffers that are decoded and safe to read; equal to m_sampleCount
+    // once the stem is Complete, anything past this should be treated as silence
+    ouro_nodiscard inline int32_t getSamplesReady() const { return m_samplesReady.load( std::memory_order_acquire ); }
+
+    // optional shared counter that this stem keeps up to date with its own estimateMemoryUsageBytes() as it loads,
+    // analyses and is finally destroyed; lets owners like cache::Stems track total usage without walking every stem
+    using MemoryTracker = std::shared_ptr< std::atomic< int64_t > >;
+    void setMemoryTracker( const MemoryTracker& memoryTracker );
+
     ouro_nodiscard constexpr bool hasFailed() const
     {
         return ( m_state == State::Failed_Http           ||
@@ -245,6 +299,33 @@ private:
     // returns false if something broke; sets the m_state appropriately in that case
     ouro_nodiscard bool attemptRemoteFetch( const api::NetConfiguration& ncfg, const uint32_t attemptUID, RawAudioMemory& audioMemory );
 
+    // call attemptRemoteFetch() repeatedly with a growing, jittered delay until it works or we run out of retries
+    ouro_nodiscard bool fetchRemoteWithRetries( const api::NetConfiguration& ncfg, RawAudioMemory& audioMemory, const std::string& stemCouchSnip );
+
+    // write the raw compressed data out to the stem cache, via a temporary file that is swapped into place
+    static absl::Status writeRawToCache( const fs::path& cacheFile, const RawAudioMemory& audioMemory );
+
+    // try to fill the sample buffers from the decoded stem cache; returns false if there was nothing valid to load
+    ouro_nodiscard bool loadFromDecodedCache( const fs::path& decodedCacheFile, const std::string& stemCouchSnip );
+
+    // write our final sample buffers out to the decoded stem cache, tagged with the source size from the stem metadata
+    void storeToDecodedCache( const fs::path& decodedCacheFile, const std::string& stemCouchSnip ) const;
+
+    // push the change in our estimated memory usage since the last call out to the memory tracker, if we have one
+    void updateTrackedMemory();
+
+    // m_sampleCount and m_channel are valid, release anyone waiting in waitForPlayable()
+    inline void markPlayable()
+    {
+        if ( !m_fetchPlayable.exchange( true ) )
+            m_fetchPlayable.notify_all();
+    }
+
+    inline void publishSamplesReady( const int32_t samplesReady ) { m_samplesReady.store( samplesReady, std::memory_order_release ); }
+
+    // number of samples at the end of the stem that get modified by applyLoopSewingBlend()
+    static constexpr int32_t cLoopSewingWindowSize = 128;
+
     // blend a small window of samples at each end of the stem to reduce clicks on looping
     // (as best we can tell Endlesss also does something like this)
     void applyLoopSewingBlend();
@@ -253,6 +334,13 @@ private:
 
     std::shared_future<void>        m_analysisFuture;
     std::atomic< AnalysisState >    m_analysisState; // set in async analysis if analysis data is to be trusted
+    std::atomic_bool                m_fetchClaimed  = false;
+    std::atomic_bool                m_fetchFinished = false;
+    std::atomic_bool                m_fetchPlayable = false;
+    std::atomic< int32_t >          m_samplesReady  = 0;
+
+    MemoryTracker                   m_memoryTracker;
+    std::atomic< std::size_t >      m_memoryTracked = 0;    // the amount last reported to m_memoryTracker
 
     Compression                     m_compressionFormat = Compression::Unknown;
 
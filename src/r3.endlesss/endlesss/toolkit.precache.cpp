@@ -0,0 +1,498 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//
+//
+
+#include "pch.h"
+
+#include "endlesss/toolkit.precache.h"
+#include "endlesss/toolkit.warehouse.h"
+#include "endlesss/cache.stems.h"
+#include "endlesss/live.stem.h"
+#include "endlesss/api.h"
+
+#include "base/instrumentation.h"
+#include "base/text.h"
+#include "filesys/fsutil.h"
+
+using namespace std::chrono_literals;
+
+namespace endlesss {
+namespace toolkit {
+
+// how long threads wait on semaphores before checking if they've been asked to stop
+static constexpr int64_t        cStopCheckTimeoutUs     = 250 * 1000;
+
+// the governor will bank at most this much unused time, so after a quiet spell we don't burst far above the cap
+static constexpr auto           cGovernorBurstAllowance = 1s;
+
+// journal entries are buffered; losing a few on a crash only means those stems get re-checked next time
+static constexpr uint32_t       cJournalFlushInterval   = 64;
+
+static constexpr std::string_view cJournalHeader        = "# ouroveon precache journal v1";
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Precache::Workload::fromJam( const Warehouse& warehouse, const types::JamCouchID& jamCouchID )
+{
+    m_name = jamCouchID.value();
+    return warehouse.fetchAllStemsForJam( jamCouchID, m_stemIDs, m_estimatedBytes );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Precache::Workload::fromEntireWarehouse( const Warehouse& warehouse )
+{
+    m_name = "warehouse";
+    return warehouse.fetchAllStems( m_stemIDs, m_estimatedBytes );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Precache::Precache( const services::RiffFetchProvider& riffFetchProvider, const fs::path& journalRoot )
+    : m_riffFetchProvider( riffFetchProvider )
+    , m_journalRoot( journalRoot )
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Precache::~Precache()
+{
+    requestStop();
+
+    if ( m_dispatchThread != nullptr )
+    {
+        m_dispatchThread->join();
+        m_dispatchThread = nullptr;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::Status Precache::start( const Warehouse& warehouse, Workload&& workload, const Options& options )
+{
+    if ( isActive() )
+        return absl::AlreadyExistsError( fmt::format( FMTX( "precache job [{}] is still running" ), getProgress().m_workloadName ) );
+
+    if ( workload.m_stemIDs.empty() )
+        return absl::InvalidArgumentError( "no stems in workload" );
+
+    // tidy up after any previous job
+    if ( m_dispatchThread != nullptr )
+    {
+        m_dispatchThread->join();
+        m_dispatchThread = nullptr;
+    }
+
+    {
+        std::scoped_lock<std::mutex> progressLock( m_progressMutex );
+
+        m_workload  = std::move( workload );
+        m_options   = options;
+        m_options.m_maximumDownloadsInFlight = std::clamp< uint32_t >( m_options.m_maximumDownloadsInFlight, 1, OURO_THREAD_LIMIT );
+
+        m_startTime = Clock::now();
+    }
+
+    m_stopRequested         = false;
+    m_dispatchFinished      = false;
+    m_stemsExamined         = 0;
+    m_stemsResumed          = 0;
+    m_stemsAlreadyInCache   = 0;
+    m_stemsDamagedInCache   = 0;
+    m_stemsDownloaded       = 0;
+    m_stemsMissingFromDb    = 0;
+    m_stemsFailedToDownload = 0;
+    m_downloadsInFlight     = 0;
+    m_bytesDownloaded       = 0;
+    m_elapsedSeconds        = 0;
+
+    loadJournal();
+
+    if ( !m_options.m_dryRun )
+    {
+        openJournal();
+
+        if ( !m_options.m_failureLogFile.empty() )
+            m_failureLog.open( m_options.m_failureLogFile, std::ios::out | std::ios::app );
+    }
+
+    blog::app( FMTX( "[ PRECACHE ] starting [{}] : {} stems, ~{}, {} resumable from journal" ),
+        m_workload.m_name,
+        m_workload.m_stemIDs.size(),
+        base::humaniseByteSize( "", m_workload.m_estimatedBytes ),
+        m_journalDone.size() );
+
+    m_state          = State::Running;
+    m_dispatchThread = std::make_unique<std::thread>( &Precache::dispatchThread, this, std::cref( warehouse ) );
+
+    return absl::OkStatus();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::requestStop()
+{
+    State expected = State::Running;
+    if ( m_state.compare_exchange_strong( expected, State::Stopping ) )
+    {
+        blog::app( FMTX( "[ PRECACHE ] stop requested, waiting for {} download(s) to finish" ), m_downloadsInFlight.load() );
+    }
+    m_stopRequested = true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Precache::Progress Precache::getProgress() const
+{
+    Progress result;
+
+    result.m_state                  = m_state;
+    result.m_stemsExamined          = m_stemsExamined;
+    result.m_stemsResumed           = m_stemsResumed;
+    result.m_stemsAlreadyInCache    = m_stemsAlreadyInCache;
+    result.m_stemsDamagedInCache    = m_stemsDamagedInCache;
+    result.m_stemsDownloaded        = m_stemsDownloaded;
+    result.m_stemsMissingFromDb     = m_stemsMissingFromDb;
+    result.m_stemsFailedToDownload  = m_stemsFailedToDownload;
+    result.m_downloadsInFlight      = m_downloadsInFlight;
+    result.m_bytesDownloaded        = m_bytesDownloaded;
+
+    {
+        std::scoped_lock<std::mutex> progressLock( m_progressMutex );
+
+        result.m_workloadName   = m_workload.m_name;
+        result.m_stemsTotal     = m_workload.m_stemIDs.size();
+        result.m_estimatedBytes = m_workload.m_estimatedBytes;
+
+        if ( result.isActive() )
+            result.m_elapsed = std::chrono::duration_cast<std::chrono::seconds>( Clock::now() - m_startTime );
+        else
+            result.m_elapsed = std::chrono::seconds( m_elapsedSeconds.load() );
+    }
+
+    return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::dispatchThread( const Warehouse& warehouse )
+{
+    OuroveonThreadScope ots( OURO_THREAD_PREFIX "Precache::Dispatch" );
+
+    const uint32_t workerCount = m_options.m_dryRun ? 0 : m_options.m_maximumDownloadsInFlight;
+
+    m_slotSema      = std::make_unique< mcc::LightweightSemaphore >( static_cast<int>( workerCount ) );
+    m_governorClock = Clock::now();
+
+    for ( uint32_t workerIndex = 0; workerIndex < workerCount; workerIndex++ )
+        m_downloadThreads.emplace_back( &Precache::downloadThread, this );
+
+    auto& stemCache = m_riffFetchProvider->getStemCache();
+
+    // work from the newest stems backwards
+    for ( auto stemIt = m_workload.m_stemIDs.crbegin(); stemIt != m_workload.m_stemIDs.crend(); ++stemIt )
+    {
+        const types::StemCouchID& stemID = *stemIt;
+        if ( m_stopRequested )
+            break;
+
+        m_stemsExamined++;
+
+        // done on a previous run
+        if ( m_journalDone.contains( stemID ) )
+        {
+            m_stemsResumed++;
+            continue;
+        }
+
+        types::Stem stemData;
+        if ( !warehouse.fetchSingleStemByID( stemID, stemData ) )
+        {
+            blog::error::app( FMTX( "[ PRECACHE ] was unable to fetch stem data from warehouse : [{}]" ), stemID );
+            m_stemsMissingFromDb++;
+            continue;
+        }
+
+        const fs::path stemCachePath = stemCache.getCachePathForStem( stemData );
+        const fs::path stemCacheFile = stemCachePath / stemData.couchID.value();
+
+        std::error_code existsError;
+        if ( fs::exists( stemCacheFile, existsError ) )
+        {
+            if ( validateCachedStem( stemCacheFile, stemData ) )
+            {
+                m_stemsAlreadyInCache++;
+                appendJournal( stemID );
+                continue;
+            }
+
+            // the live stem code would just fail on this file forever, so clear it out and fetch a fresh copy
+            m_stemsDamagedInCache++;
+            if ( !m_options.m_dryRun )
+            {
+                blog::error::app( FMTX( "[ PRECACHE ] replacing damaged cache file [{}]" ), stemCacheFile.string() );
+
+                std::error_code removeError;
+                fs::remove( stemCacheFile, removeError );
+            }
+        }
+
+        if ( m_options.m_dryRun )
+            continue;
+
+        if ( !waitForByteBudget( stemData.fileLengthBytes ) )
+            break;
+
+        // wait for a worker to be free
+        bool bHaveSlot = false;
+        while ( !bHaveSlot && !m_stopRequested )
+        {
+            bHaveSlot = m_slotSema->wait( cStopCheckTimeoutUs );
+        }
+        if ( !bHaveSlot )
+            break;
+
+        m_downloadsInFlight++;
+        m_jobs.enqueue( Job{ std::move( stemData ), stemCachePath } );
+        m_jobSema.signal();
+    }
+
+    // let the workers drain what they have and leave
+    m_dispatchFinished = true;
+    m_jobSema.signal( static_cast<int>( m_downloadThreads.size() ) );
+
+    for ( auto& downloadThread : m_downloadThreads )
+        downloadThread.join();
+    m_downloadThreads.clear();
+
+    const bool bStopped = m_stopRequested;
+
+    // keep the journal around if we didn't get through everything, or some stems couldn't be fetched;
+    // otherwise the next run should take a fresh look at the cache
+    closeJournal( !bStopped && m_stemsFailedToDownload == 0 );
+
+    if ( m_failureLog.is_open() )
+        m_failureLog.close();
+
+    {
+        std::scoped_lock<std::mutex> progressLock( m_progressMutex );
+        m_elapsedSeconds = std::chrono::duration_cast<std::chrono::seconds>( Clock::now() - m_startTime ).count();
+    }
+
+    blog::app( FMTX( "[ PRECACHE ] [{}] {} : {} in cache, {} downloaded ({}), {} failed, {} missing from warehouse" ),
+        m_workload.m_name,
+        bStopped ? "stopped" : "complete",
+        m_stemsAlreadyInCache.load() + m_stemsResumed.load(),
+        m_stemsDownloaded.load(),
+        base::humaniseByteSize( "", m_bytesDownloaded.load() ),
+        m_stemsFailedToDownload.load(),
+        m_stemsMissingFromDb.load() );
+
+    m_state = bStopped ? State::Stopped : State::Complete;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::downloadThread()
+{
+    OuroveonThreadScope ots( OURO_THREAD_PREFIX "Precache::Download" );
+
+    for ( ;; )
+    {
+        m_jobSema.wait();
+
+        Job job;
+        if ( m_jobs.try_dequeue( job ) )
+        {
+            // anything still queued when a stop comes in is just dropped
+            if ( !m_stopRequested )
+                processJob( job );
+
+            m_downloadsInFlight--;
+            m_slotSema->signal();
+            continue;
+        }
+
+        if ( m_dispatchFinished )
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::processJob( const Job& job )
+{
+    // the live stem is only used as a vehicle for the download; nothing is decoded and it's tossed straight after
+    endlesss::live::Stem stemDownload( job.m_stemData, 8000 );
+
+    const auto downloadResult = stemDownload.downloadToCache( m_riffFetchProvider->getNetConfiguration(), job.m_cachePath );
+    if ( !downloadResult.ok() )
+    {
+        blog::error::app( FMTX( "[ PRECACHE ] failed to download stem to cache : [{}] {}" ), job.m_stemData.couchID, downloadResult.status().ToString() );
+        m_stemsFailedToDownload++;
+
+        if ( m_failureLog.is_open() )
+        {
+            std::scoped_lock<std::mutex> failureLock( m_failureLogMutex );
+            m_failureLog << job.m_stemData.fullEndpoint() << '/' << job.m_stemData.fileKey << '\n';
+            m_failureLog.flush();
+        }
+        return;
+    }
+
+    m_stemsDownloaded++;
+    m_bytesDownloaded += downloadResult.value();
+
+    appendJournal( job.m_stemData.couchID );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Precache::validateCachedStem( const fs::path& cacheFile, const types::Stem& stemData ) const
+{
+    std::error_code sizeError;
+    const auto fileSize = fs::file_size( cacheFile, sizeError );
+    if ( sizeError || fileSize == 0 )
+        return false;
+
+    // same leniency as live::Stem::fetch() when the database and CDN disagree on sizes
+    if ( fileSize != stemData.fileLengthBytes &&
+         !m_riffFetchProvider->getNetConfiguration().api().hackAllowStemSizeMismatch )
+    {
+        return false;
+    }
+
+    std::array< uint8_t, 4 > fileHeader;
+    std::basic_ifstream<char> ifs( cacheFile, std::ios::in | std::ios::binary );
+    if ( !ifs.read( reinterpret_cast<char*>( fileHeader.data() ), fileHeader.size() ) )
+        return false;
+
+    return live::Stem::identifyCompression( fileHeader.data(), fileHeader.size() ) != live::Stem::Compression::Unknown;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Precache::getJournalFile() const
+{
+    return m_journalRoot / fmt::format( FMTX( "{}.journal" ), m_workload.m_name );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::loadJournal()
+{
+    m_journalDone.clear();
+
+    const fs::path journalFile = getJournalFile();
+
+    std::error_code existsError;
+    if ( !fs::exists( journalFile, existsError ) )
+        return;
+
+    std::basic_ifstream<char> ifs( journalFile, std::ios::in );
+
+    std::string journalLine;
+    if ( !std::getline( ifs, journalLine ) || journalLine != cJournalHeader )
+    {
+        blog::error::app( FMTX( "[ PRECACHE ] ignoring journal [{}], unrecognised format" ), journalFile.string() );
+        return;
+    }
+
+    while ( std::getline( ifs, journalLine ) )
+    {
+        // a torn final line from a crash will just fail to match any stem
+        if ( !journalLine.empty() )
+            m_journalDone.emplace( journalLine );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::openJournal()
+{
+    const absl::Status journalRootAvailable = filesys::ensureDirectoryExists( m_journalRoot );
+    if ( !journalRootAvailable.ok() )
+    {
+        blog::error::app( FMTX( "[ PRECACHE ] unable to create journal directory, progress will not be saved; {}" ), journalRootAvailable.ToString() );
+        return;
+    }
+
+    const fs::path journalFile = getJournalFile();
+
+    std::scoped_lock<std::mutex> journalLock( m_journalMutex );
+
+    // a journal we couldn't parse is rewritten from scratch
+    const bool bAppend = !m_journalDone.empty();
+
+    m_journal.open( journalFile, std::ios::out | ( bAppend ? std::ios::app : std::ios::trunc ) );
+    if ( !m_journal.is_open() )
+    {
+        blog::error::app( FMTX( "[ PRECACHE ] unable to open journal [{}], progress will not be saved" ), journalFile.string() );
+        return;
+    }
+
+    if ( !bAppend )
+        m_journal << cJournalHeader << '\n';
+
+    m_journalUnflushed = 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::appendJournal( const types::StemCouchID& stemID )
+{
+    std::scoped_lock<std::mutex> journalLock( m_journalMutex );
+
+    if ( !m_journal.is_open() )
+        return;
+
+    m_journal << stemID.value() << '\n';
+
+    if ( ++m_journalUnflushed >= cJournalFlushInterval )
+    {
+        m_journal.flush();
+        m_journalUnflushed = 0;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Precache::closeJournal( const bool bDiscard )
+{
+    std::scoped_lock<std::mutex> journalLock( m_journalMutex );
+
+    if ( !m_journal.is_open() )
+        return;
+
+    m_journal.close();
+
+    if ( bDiscard )
+    {
+        std::error_code removeError;
+        fs::remove( getJournalFile(), removeError );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// each download books its expected size against a virtual clock that runs at the configured byte rate; a download
+// can only begin once that clock has caught up with real time
+//
+bool Precache::waitForByteBudget( const std::size_t downloadBytes )
+{
+    if ( m_options.m_maximumKilobytesPerSecond == 0 )
+        return true;
+
+    for ( ;; )
+    {
+        if ( m_stopRequested )
+            return false;
+
+        const auto timeNow = Clock::now();
+        if ( m_governorClock <= timeNow )
+        {
+            m_governorClock = std::max( m_governorClock, timeNow - cGovernorBurstAllowance );
+            break;
+        }
+
+        std::this_thread::sleep_for( std::min< Clock::duration >( m_governorClock - timeNow, 250ms ) );
+    }
+
+    const double bytesPerSecond = static_cast<double>( m_options.m_maximumKilobytesPerSecond ) * 1024.0;
+    m_governorClock += std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>( static_cast<double>( downloadBytes ) / bytesPerSecond ) );
+
+    return true;
+}
+
+} // namespace toolkit
+} // namespace endlesss
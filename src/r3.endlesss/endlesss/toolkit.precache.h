@@ -0,0 +1,171 @@
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
+//  |       |   |   |   __ \       |   |   |    ___|       |    |  |
+//  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
+//  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
+//  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
+//
+//  headless stem cache warming; works through a list of stems pulled from the warehouse on background threads,
+//  downloading anything not already in the stem cache. downloads are throttled by a concurrency limit and an optional
+//  byte-rate cap, and progress is journaled to disk so that a long archival job interrupted part-way (app closed,
+//  network down) can be restarted and pick up roughly where it stopped
+//
+
+#pragma once
+
+#include "base/construction.h"
+
+#include "endlesss/core.types.h"
+#include "endlesss/core.services.h"
+
+namespace endlesss {
+namespace toolkit {
+
+struct Warehouse;
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct Precache
+{
+    DECLARE_NO_COPY_NO_MOVE( Precache );
+
+    // the set of stems to work through; the name is used for logging and to key the journal file, so it should be
+    // stable for the same logical job between runs
+    struct Workload
+    {
+        std::string                     m_name;
+        endlesss::types::StemCouchIDs   m_stemIDs;
+        std::size_t                     m_estimatedBytes = 0;
+
+        // fill from the warehouse with either all stems in a single jam or every stem it knows about
+        ouro_nodiscard bool fromJam( const Warehouse& warehouse, const types::JamCouchID& jamCouchID );
+        ouro_nodiscard bool fromEntireWarehouse( const Warehouse& warehouse );
+    };
+
+    struct Options
+    {
+        uint32_t    m_maximumDownloadsInFlight  = 4;
+        uint32_t    m_maximumKilobytesPerSecond = 0;    // cap on download rate across all workers, 0 for no limit
+        bool        m_dryRun                    = false;// check the cache but don't fetch anything
+        fs::path    m_failureLogFile;                   // if set, the URL of each stem that fails to download is logged here
+    };
+
+    enum class State
+    {
+        Idle,                   // nothing has been started
+        Running,
+        Stopping,               // stop requested, waiting for in-flight downloads to finish
+        Stopped,                // stopped before the end; the journal is kept for next time
+        Complete                // everything was examined
+    };
+
+    // snapshot of a job, safe to take from any thread
+    struct Progress
+    {
+        State                   m_state = State::Idle;
+        std::string             m_workloadName;
+
+        std::size_t             m_stemsTotal            = 0;
+        std::size_t             m_stemsExamined         = 0;    // how far through the workload the dispatcher is
+        uint32_t                m_stemsResumed          = 0;    // skipped as the journal says they were done previously
+        uint32_t                m_stemsAlreadyInCache   = 0;
+        uint32_t                m_stemsDamagedInCache   = 0;    // cache file was the wrong size or had no FLAC/OGG header
+        uint32_t                m_stemsDownloaded       = 0;
+        uint32_t                m_stemsMissingFromDb    = 0;
+        uint32_t                m_stemsFailedToDownload = 0;
+        uint32_t                m_downloadsInFlight     = 0;
+
+        uint64_t                m_bytesDownloaded       = 0;
+        std::size_t             m_estimatedBytes        = 0;
+        std::chrono::seconds    m_elapsed               = std::chrono::seconds::zero();
+
+        ouro_nodiscard constexpr bool isActive() const { return m_state == State::Running || m_state == State::Stopping; }
+    };
+
+
+    Precache( const services::RiffFetchProvider& riffFetchProvider, const fs::path& journalRoot );
+    ~Precache();
+
+    // begin working through a workload in the background; fails if a job is already active. if a journal exists
+    // for a workload of the same name, stems it records as done are skipped without touching the database or disk
+    absl::Status start( const Warehouse& warehouse, Workload&& workload, const Options& options );
+
+    // halt dispatch of any more downloads; returns immediately, the job moves to Stopped once in-flight work is done
+    void requestStop();
+
+    ouro_nodiscard Progress getProgress() const;
+
+    ouro_nodiscard bool isActive() const { return getProgress().isActive(); }
+
+private:
+
+    struct Job
+    {
+        types::Stem     m_stemData;
+        fs::path        m_cachePath;        // directory in the stem cache to write to
+    };
+
+    void dispatchThread( const Warehouse& warehouse );
+    void downloadThread();
+    void processJob( const Job& job );
+
+    // is the given file a plausible cached copy of the stem; right size and starts with a header we can decode
+    ouro_nodiscard bool validateCachedStem( const fs::path& cacheFile, const types::Stem& stemData ) const;
+
+    // journal management; entries are added from the dispatcher and the download workers
+    void loadJournal();
+    void openJournal();
+    void appendJournal( const types::StemCouchID& stemID );
+    void closeJournal( const bool bDiscard );
+
+    ouro_nodiscard fs::path getJournalFile() const;
+
+    // sleep until the byte-rate governor allows a download of this size to begin; false if we're asked to stop meanwhile
+    ouro_nodiscard bool waitForByteBudget( const std::size_t downloadBytes );
+
+
+    using Clock     = std::chrono::steady_clock;
+    using JobQueue  = mcc::ConcurrentQueue< Job >;
+
+    services::RiffFetchProvider         m_riffFetchProvider;
+    fs::path                            m_journalRoot;
+
+    Workload                            m_workload;
+    Options                             m_options;
+
+    std::unique_ptr< std::thread >      m_dispatchThread;
+    std::vector< std::thread >          m_downloadThreads;
+    std::atomic_bool                    m_stopRequested     = false;
+    std::atomic_bool                    m_dispatchFinished  = false;
+
+    JobQueue                            m_jobs;
+    mcc::LightweightSemaphore           m_jobSema;
+    std::unique_ptr< mcc::LightweightSemaphore >
+                                        m_slotSema;         // one count per free download worker
+
+    Clock::time_point                   m_governorClock;    // virtual time at which the byte budget is next available
+    Clock::time_point                   m_startTime;
+
+    types::StemCouchIDSet               m_journalDone;      // loaded at start, read-only once dispatch begins
+    std::mutex                          m_journalMutex;
+    std::ofstream                       m_journal;
+    uint32_t                            m_journalUnflushed  = 0;
+
+    std::mutex                          m_failureLogMutex;
+    std::ofstream                       m_failureLog;
+
+    std::atomic< State >                m_state             = State::Idle;
+    std::atomic_size_t                  m_stemsExamined     = 0;
+    std::atomic_uint32_t                m_stemsResumed      = 0;
+    std::atomic_uint32_t                m_stemsAlreadyInCache = 0;
+    std::atomic_uint32_t                m_stemsDamagedInCache = 0;
+    std::atomic_uint32_t                m_stemsDownloaded   = 0;
+    std::atomic_uint32_t                m_stemsMissingFromDb = 0;
+    std::atomic_uint32_t                m_stemsFailedToDownload = 0;
+    std::atomic_uint32_t                m_downloadsInFlight = 0;
+    std::atomic_uint64_t                m_bytesDownloaded   = 0;
+    std::atomic< int64_t >              m_elapsedSeconds    = 0;    // frozen once the job finishes
+
+    mutable std::mutex                  m_progressMutex;    // guards m_workload name/size reads vs start()
+};
+
+} // namespace toolkit
+} // namespace endlesss
@@ -282,7 +282,14 @@ std::vector<fs::path> exportRiff(
 
                 switch ( destination.m_spec.format )
                 {
-                    case AudioFormat::FLAC: return ssp::FLACWriter::Create( stemPath, exportSampleRate, 60.0f );
+                    case AudioFormat::FLAC:
+                    {
+                        // whole stems are pushed through in one go, so the encoder must be allowed to hold the export up
+                        auto flacWriter = ssp::FLACWriter::Create( stemPath, exportSampleRate, 60.0f );
+                        if ( flacWriter )
+                            flacWriter->setOverflowPolicy( ssp::OverflowPolicy::Wait );
+                        return flacWriter;
+                    }
                     case AudioFormat::WAV:  return ssp::WAVWriter::Create( stemPath, exportSampleRate, 60 );
                     default:
                         ABSL_ASSERT( false );
@@ -20,21 +20,60 @@
 namespace endlesss {
 namespace toolkit {
 
+// ---------------------------------------------------------------------------------------------------------------------
+struct Pipeline::PrefetchJob
+{
+    PrefetchJob( const Request& request )
+        : m_request( request )
+    {}
+
+    ouro_nodiscard inline bool isComplete() const
+    {
+        if ( m_duplicateOf != nullptr )
+            return m_duplicateOf->isComplete();
+        return m_complete;
+    }
+
+    ouro_nodiscard inline const endlesss::live::RiffPtr& getRiff() const
+    {
+        if ( m_duplicateOf != nullptr )
+            return m_duplicateOf->getRiff();
+        return m_riff;
+    }
+
+    Request                     m_request;
+    endlesss::live::RiffPtr     m_riff;                     // result of the fetch, written by the worker before m_complete is set
+    PrefetchJobPtr              m_duplicateOf;              // set if an earlier in-flight job is already fetching the same riff
+    bool                        m_fetchedFresh = false;     // true if m_riff was fetched by a worker rather than pulled from the cache
+    std::atomic_bool            m_cancelled    = false;
+    std::atomic_bool            m_complete     = false;
+};
+
 // ---------------------------------------------------------------------------------------------------------------------
 Pipeline::Pipeline(
     base::EventBusClient eventBus,
     endlesss::services::RiffFetchProvider& riffFetchProvider,
     const std::size_t liveRiffCacheSize,
+    const std::size_t liveRiffCacheBudgetBytes,
     const RiffDataResolver& riffDataResolver,
     const RiffLoadCallback& riffLoadCallback,
-    const QueueClearedCallback& queueClearedCallback )
+    const QueueClearedCallback& queueClearedCallback,
+    const std::size_t prefetchDepth )
     : m_eventBusClient( eventBus )
     , m_riffFetchProvider( riffFetchProvider )
     , m_cacheSize( liveRiffCacheSize )
+    , m_cacheBudgetBytes( liveRiffCacheBudgetBytes )
     , m_resolver( riffDataResolver )
     , m_callbackRiffLoad( riffLoadCallback )
     , m_callbackQueueCleared( queueClearedCallback )
+    , m_prefetchDepth( std::max< std::size_t >( prefetchDepth, 1 ) )
 {
+    // one worker per in-flight slot; the heavy lifting of stem loading is still spread across the task executor
+    // by Riff::fetch, these just allow multiple riffs to be in that state at once
+    m_prefetchThreadRun = true;
+    for ( std::size_t workerIndex = 0; workerIndex < m_prefetchDepth; workerIndex++ )
+        m_prefetchThreads.emplace_back( &Pipeline::prefetchThread, this );
+
     m_pipelineThreadRun = true;
     m_pipelineThread = std::make_unique<std::thread>( &Pipeline::pipelineThread, this );
 }
@@ -45,6 +84,14 @@ Pipeline::~Pipeline()
     m_pipelineThreadRun = false;
     m_pipelineThread->join();
     m_pipelineThread.reset();
+
+    // the pipeline thread cancels anything left in flight on exit, so workers will only be finishing off
+    // whatever fetch they are currently stuck in
+    m_prefetchThreadRun = false;
+    m_prefetchJobSema.signal( static_cast<int>( m_prefetchThreads.size() ) );
+    for ( auto& prefetchThread : m_prefetchThreads )
+        prefetchThread.join();
+    m_prefetchThreads.clear();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -218,6 +265,61 @@ bool Pipeline::defaultNetworkResolver(
     }
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+void Pipeline::runPrefetchJob( PrefetchJob& job )
+{
+    // requestClear() may have binned this job while it was waiting for a worker
+    if ( job.m_cancelled )
+        return;
+
+    base::instr::ScopedEvent se( "riff-prefetch", base::instr::PresetColour::Emerald );
+
+    endlesss::types::RiffComplete riffComplete;
+    if ( !m_resolver( job.m_request.m_riff, riffComplete ) )
+    {
+        blog::error::api( FMTX( "riff pipeline resolver failed to fetch [{}]" ), job.m_request.m_riff.getRiffID() );
+        return;
+    }
+
+    // don't bother pulling stems for something that is going to be thrown away
+    if ( job.m_cancelled )
+        return;
+
+    auto riffToPlay = std::make_shared< endlesss::live::Riff >( riffComplete );
+    riffToPlay->fetch( m_riffFetchProvider, m_progressiveFetch );
+
+    job.m_riff = std::move( riffToPlay );
+    job.m_fetchedFresh = true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Pipeline::prefetchThread()
+{
+    OuroveonThreadScope ots( OURO_THREAD_PREFIX "Riff-Prefetch" );
+
+    PrefetchJobPtr prefetchJob;
+
+    for (;;)
+    {
+        if ( !m_prefetchThreadRun )
+            break;
+
+        if ( m_prefetchJobSema.wait( 100000 ) )
+        {
+            if ( m_prefetchJobs.try_dequeue( prefetchJob ) )
+            {
+                runPrefetchJob( *prefetchJob );
+
+                // publish the result and nudge the pipeline thread to go see if it can report anything
+                prefetchJob->m_complete = true;
+                prefetchJob.reset();
+
+                m_pipelineRequestSema.signal();
+            }
+        }
+    }
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 void Pipeline::pipelineThread()
 {
@@ -227,13 +329,25 @@ void Pipeline::pipelineThread()
 
     if ( m_cacheSize > 0 )
     {
-        liveRiffMiniCache = std::make_unique< endlesss::live::RiffCacheLRU >( m_cacheSize );
+        liveRiffMiniCache = std::make_unique< endlesss::live::RiffCacheLRU >( m_cacheSize, m_cacheBudgetBytes );
     }
     else
     {
         blog::api( FMTX( "pipeline started with no internal cache" ) );
     }
 
+    // requests that have been taken off the queue but not yet reported, in the order they arrived; only the
+    // front of this is ever reported, so callbacks fire in request order regardless of which fetch finishes first
+    std::deque< PrefetchJobPtr > jobsInFlight;
+
+    const auto reportJob = [this]( const PrefetchJob& job, endlesss::live::RiffPtr riffToPlay )
+    {
+        m_callbackRiffLoad( job.m_request.m_riff, riffToPlay, job.m_request.m_playback );
+
+        // emit operation complete
+        m_eventBusClient.Send< ::events::OperationComplete >( job.m_request.m_operationID );
+    };
+
     Request riffRequest;
 
     for (;;)
@@ -241,23 +355,31 @@ void Pipeline::pipelineThread()
         if ( !m_pipelineThreadRun )
             break;
 
-        if ( m_pipelineRequestSema.wait( 100000 ) )
+        // the semaphore is signalled by new requests, clear requests and by workers finishing a job; in all cases we just
+        // go look at what can be done, spurious wakes are harmless. a timeout is treated the same way, as a backstop
+        // for anything that completed without signalling
+        std::ignore = m_pipelineRequestSema.wait( 100000 );
         {
             base::instr::ScopedEvent se( "riff-load", base::instr::PresetColour::Emerald );
 
-            // if a purge was requested, drain the whole queue into the bin
+            // if a purge was requested, drain everything in flight and the whole queue into the bin
             if ( m_pipelineClear )
             {
                 endlesss::live::RiffPtr nullRiff;
 
-                while ( m_requests.try_dequeue( riffRequest ) )
+                // we still report that a request was "processed", just with a null result as it was skipped
+                // systems using the pipeline may need to know outflow of requests even if they weren't loaded;
+                // workers still busy on cancelled jobs will finish on their own time and the results get dropped
+                for ( const auto& inFlight : jobsInFlight )
                 {
-                    // we still report that a request was "processed", just with a null result as it was skipped
-                    // systems using the pipeline may need to know outflow of requests even if they weren't loaded
-                    m_callbackRiffLoad( riffRequest.m_riff, nullRiff, riffRequest.m_playback );
+                    inFlight->m_cancelled = true;
+                    reportJob( *inFlight, nullRiff );
+                }
+                jobsInFlight.clear();
 
-                    // emit operation complete
-                    m_eventBusClient.Send< ::events::OperationComplete >( riffRequest.m_operationID );
+                while ( m_requests.try_dequeue( riffRequest ) )
+                {
+                    reportJob( PrefetchJob( riffRequest ), nullRiff );
                 }
 
                 m_pipelineClear = false;
@@ -269,40 +391,77 @@ void Pipeline::pipelineThread()
                 continue;
             }
 
-            // pick something off the request queue
-            if ( m_requests.try_dequeue( riffRequest ) )
+            // alternate topping up and reporting until neither gets anywhere; reporting frees slots that requests already
+            // waiting in the queue can take, and those may complete immediately (cache hits, duplicates of finished jobs)
+            // without anything else signalling us
+            for (;;)
             {
-                ABSL_ASSERT( riffRequest.m_riff.hasData() );
+                // top up the in-flight jobs from the request queue
+                while ( jobsInFlight.size() < m_prefetchDepth && m_requests.try_dequeue( riffRequest ) )
+                {
+                    ABSL_ASSERT( riffRequest.m_riff.hasData() );
 
-                endlesss::live::RiffPtr riffToPlay;
+                    auto newJob = std::make_shared< PrefetchJob >( riffRequest );
 
-                // rummage through our little local cache of live riff instances to see if we can re-use one
-                if ( liveRiffMiniCache == nullptr || liveRiffMiniCache->search( riffRequest.m_riff.getRiffID(), riffToPlay ) == false )
-                {
-                    endlesss::types::RiffComplete riffComplete;
-                    if ( m_resolver( riffRequest.m_riff, riffComplete ) )
+                    // rummage through our little local cache of live riff instances to see if we can re-use one
+                    if ( liveRiffMiniCache != nullptr && liveRiffMiniCache->search( riffRequest.m_riff.getRiffID(), newJob->m_riff ) )
                     {
-                        riffToPlay = std::make_shared< endlesss::live::Riff >( riffComplete );
-                        riffToPlay->fetch( m_riffFetchProvider );
-
-                        // stash new riff in cache
-                        if ( liveRiffMiniCache != nullptr )
-                            liveRiffMiniCache->store( riffToPlay );
+                        newJob->m_complete = true;
                     }
                     else
                     {
-                        blog::error::api( FMTX( "riff pipeline resolver failed to fetch [{}]" ), riffRequest.m_riff.getRiffID() );
+                        // the same riff may already be on its way, in which case just piggyback on that fetch; only done when
+                        // caching is enabled as otherwise callers expect a fresh instance per request
+                        if ( liveRiffMiniCache != nullptr )
+                        {
+                            for ( const auto& inFlight : jobsInFlight )
+                            {
+                                if ( inFlight->m_duplicateOf == nullptr &&
+                                     inFlight->m_request.m_riff.getRiffID() == riffRequest.m_riff.getRiffID() )
+                                {
+                                    newJob->m_duplicateOf = inFlight;
+                                    break;
+                                }
+                            }
+                        }
+
+                        if ( newJob->m_duplicateOf == nullptr )
+                        {
+                            m_prefetchJobs.enqueue( newJob );
+                            m_prefetchJobSema.signal();
+                        }
                     }
+
+                    jobsInFlight.emplace_back( std::move( newJob ) );
                 }
 
-                m_callbackRiffLoad( riffRequest.m_riff, riffToPlay, riffRequest.m_playback );
+                // report everything at the front that is ready to go
+                std::size_t jobsReported = 0;
+                while ( !jobsInFlight.empty() && jobsInFlight.front()->isComplete() )
+                {
+                    const PrefetchJobPtr completedJob = jobsInFlight.front();
+                    jobsInFlight.pop_front();
+
+                    endlesss::live::RiffPtr riffToPlay = completedJob->getRiff();
 
-                // emit operation complete
-                m_eventBusClient.Send< ::events::OperationComplete >( riffRequest.m_operationID );
+                    // stash new riff in cache
+                    if ( completedJob->m_fetchedFresh && liveRiffMiniCache != nullptr )
+                        liveRiffMiniCache->store( riffToPlay );
+
+                    reportJob( *completedJob, riffToPlay );
+                    jobsReported++;
+                }
+
+                if ( jobsReported == 0 )
+                    break;
             }
         }
         std::this_thread::yield();
     }
+
+    // make sure any workers don't bother continuing with anything left over
+    for ( const auto& inFlight : jobsInFlight )
+        inFlight->m_cancelled = true;
 }
 
 } // namespace toolkit
@@ -48,14 +48,18 @@ struct Pipeline
     using RiffLoadCallback      = std::function<void( const endlesss::types::RiffIdentity&, endlesss::live::RiffPtr&, const endlesss::types::RiffPlaybackPermutationOpt& )>;
     using QueueClearedCallback  = std::function<void()>;
 
+    // how many requests can be resolved & fetched at once by default; results are still reported strictly in request order
+    static constexpr std::size_t cDefaultPrefetchDepth = 3;
 
     Pipeline(
         base::EventBusClient                    eventBus,                   // event bus for sending operation-complete events
         endlesss::services::RiffFetchProvider&  riffFetchProvider,          // api required for riff fetching / caching
         const std::size_t                       liveRiffCacheSize,          // number of live riffs to hold in the local pipeline cache
+        const std::size_t                       liveRiffCacheBudgetBytes,   // approximate memory limit for the local pipeline cache, 0 for no limit
         const RiffDataResolver&                 riffDataResolver,           // resolver function that can process a request into riff data
         const RiffLoadCallback&                 riffLoadCallback,           // callback for when a request is processed (successfully or not)
-        const QueueClearedCallback&             queueClearedCallback );     // callback for when a clear-queue has happened
+        const QueueClearedCallback&             queueClearedCallback,       // callback for when a clear-queue has happened
+        const std::size_t                       prefetchDepth = cDefaultPrefetchDepth ); // max requests in flight at once, 1 == fully serial
 
     ~Pipeline();
 
@@ -66,6 +70,10 @@ struct Pipeline
     // request to purge all currently enqueued pipeline requests
     void requestClear();
 
+    // if enabled, riffs are handed to the RiffLoadCallback as soon as all their stems are playable rather than fully
+    // decoded (see Riff::fetch); only turn this on if the consumer deals with Stem::getSamplesReady()
+    inline void setProgressiveFetch( const bool enabled ) { m_progressiveFetch = enabled; }
+
     // if present, apply IdentityCustomNaming or any other tweaks to the RiffComplete from the RiffIdentity
     static void applyCustomIdentityData(
         const endlesss::types::RiffIdentity& request,
@@ -96,7 +104,16 @@ private:
 
 
 
+    // a request that has been pulled off the queue and is being resolved / fetched by one of the prefetch workers
+    struct PrefetchJob;
+    using PrefetchJobPtr    = std::shared_ptr< PrefetchJob >;
+    using PrefetchJobQueue  = mcc::ConcurrentQueue< PrefetchJobPtr >;
+
     void pipelineThread();
+    void prefetchThread();
+
+    // resolve and fetch the riff for the given job, unless it gets cancelled along the way
+    void runPrefetchJob( PrefetchJob& job );
 
     using RiffIDQueue = mcc::ReaderWriterQueue< Request >;
 
@@ -106,6 +123,7 @@ private:
     RiffIDQueue                     m_requests;         // riffs to fetch & play - written to by main thread, read from worker
 
     std::size_t                     m_cacheSize = 0;
+    std::size_t                     m_cacheBudgetBytes = 0;
     RiffDataResolver                m_resolver;
     RiffLoadCallback                m_callbackRiffLoad;
     QueueClearedCallback            m_callbackQueueCleared;
@@ -115,6 +133,13 @@ private:
     mcc::LightweightSemaphore       m_pipelineRequestSema;
 
     std::atomic_bool                m_pipelineClear = false;
+    std::atomic_bool                m_progressiveFetch = false;
+
+    std::size_t                     m_prefetchDepth = 1;
+    PrefetchJobQueue                m_prefetchJobs;     // written to by the pipeline thread, read by the prefetch workers
+    std::vector< std::thread >      m_prefetchThreads;
+    std::atomic_bool                m_prefetchThreadRun = false;
+    mcc::LightweightSemaphore       m_prefetchJobSema;
 };
 
 } // namespace toolkit
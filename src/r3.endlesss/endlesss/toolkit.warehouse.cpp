@@ -18,6 +18,8 @@
 #include "data/yamlutil.h"
 #include "data/uuid.h"
 
+#include "io/tarch.h"
+
 #include "math/rng.h"
 #include "spacetime/chronicle.h"
 
@@ -31,6 +33,9 @@
 
 #include "app/core.h"
 
+// zstd, for binary jam archive blocks
+#include "zstd.h"
+
 // carray.c
 extern "C" { int sqlite3_carray_init( sqlite3* db, char** pzErrMsg, const sqlite3_api_routines* pApi ); }
 
@@ -50,6 +55,7 @@ std::string Warehouse::createExportFilenameForJam( const types::JamCouchID& jamC
 std::string Warehouse::m_databaseFile;
 
 using StemSet   = absl::flat_hash_set< endlesss::types::StemCouchID >;
+using RiffSet   = absl::flat_hash_set< endlesss::types::RiffCouchID >;
 
 using Task      = std::unique_ptr<Warehouse::ITask>;
 using TaskQueue = mcc::ConcurrentQueue<Task>;
@@ -68,6 +74,9 @@ struct Warehouse::ITask
     // jam views if their own change index no longer matches
     virtual bool shouldIncrementJamChangeIndex( types::JamCouchID& jamID ) const { return false; }
 
+    // called after a successful Work() for tasks that change riff data, to push those changes into the harmonic index
+    virtual void updateHarmonicIndex( Warehouse::HarmonicIndex& harmonicIndex ) const {}
+
     virtual const char* getTag() const = 0;
     virtual std::string Describe() const = 0;
     virtual bool Work( TaskQueue& currentTasks ) = 0;
@@ -89,11 +98,15 @@ struct Warehouse::INetworkTask : Warehouse::ITask
     // some network tasks add in delay to help avoid attacking the endlesss servers too hard
     // TODO data drive these pauses
     void addNetworkPause() const
+    {
+        addNetworkPause( getTag() );
+    }
+    static void addNetworkPause( const std::string_view logTag )
     {
         math::RNG32 rng;
         const auto networkPauseTime = std::chrono::milliseconds( rng.genInt32( 250, 750 ) );
 
-        blog::database( "[{}] pausing for {}", getTag(), networkPauseTime );
+        blog::database( "[{}] pausing for {}", logTag, networkPauseTime );
         std::this_thread::sleep_for( networkPauseTime );
     }
 };
@@ -111,6 +124,31 @@ struct EmptyTask final : Warehouse::ITask
     bool Work( TaskQueue& currentTasks ) override { return true; }
 };
 
+// ---------------------------------------------------------------------------------------------------------------------
+// no work of its own, just bumps the change index for a jam that was written to off the worker thread; the change index
+// map is only ever touched by the worker, so this is how anything else gets an update into it
+struct JamChangedTask final : Warehouse::ITask
+{
+    static constexpr std::string_view Tag = "CHANGED";
+
+    JamChangedTask( const types::JamCouchID& jamCID )
+        : Warehouse::ITask()
+        , m_jamCID( jamCID )
+    {}
+
+    bool shouldIncrementJamChangeIndex( types::JamCouchID& jamID ) const override
+    {
+        jamID = m_jamCID;
+        return true;
+    }
+
+    types::JamCouchID m_jamCID;
+
+    const char* getTag() const override { return Tag.data(); }
+    std::string Describe() const override { return fmt::format( "[{}] marking [{}] as changed", Tag, m_jamCID ); }
+    bool Work( TaskQueue& currentTasks ) override { return true; }
+};
+
 // ---------------------------------------------------------------------------------------------------------------------
 struct ContentsReportTask final : Warehouse::ITask
 {
@@ -133,13 +171,21 @@ struct JamSliceTask final : Warehouse::ITask
 {
     static constexpr std::string_view Tag = "JAMSLICE";
 
-    JamSliceTask( const types::JamCouchID& jamCID, const Warehouse::JamSliceCallback& callbackOnCompletion )
+    JamSliceTask(
+        const types::JamCouchID& jamCID,
+        const Warehouse::ChangeIndex changeIndex,
+        const fs::path& snapshotFile,
+        const Warehouse::JamSliceCallback& callbackOnCompletion )
         : ITask()
         , m_jamCID( jamCID )
+        , m_changeIndex( changeIndex )
+        , m_snapshotFile( snapshotFile )
         , m_reportCallback( callbackOnCompletion )
     {}
 
     types::JamCouchID               m_jamCID;
+    Warehouse::ChangeIndex          m_changeIndex;      // change index of the jam at time of request
+    fs::path                        m_snapshotFile;     // empty if snapshots are not in use
     Warehouse::JamSliceCallback     m_reportCallback;
 
     const char* getTag() const override { return Tag.data(); }
@@ -147,6 +193,23 @@ struct JamSliceTask final : Warehouse::ITask
     bool Work( TaskQueue& currentTasks ) override;
 };
 
+// ---------------------------------------------------------------------------------------------------------------------
+struct HarmonicIndexTask final : Warehouse::ITask
+{
+    static constexpr std::string_view Tag = "INDEX";
+
+    HarmonicIndexTask( Warehouse::HarmonicIndex& harmonicIndex )
+        : ITask()
+        , m_harmonicIndex( harmonicIndex )
+    {}
+
+    Warehouse::HarmonicIndex&   m_harmonicIndex;
+
+    const char* getTag() const override { return Tag.data(); }
+    std::string Describe() const override { return fmt::format( "[{}] building harmonic riff index", Tag ); }
+    bool Work( TaskQueue& currentTasks ) override;
+};
+
 // ---------------------------------------------------------------------------------------------------------------------
 struct JamSnapshotTask final : Warehouse::INetworkTask
 {
@@ -170,6 +233,9 @@ struct JamSnapshotTask final : Warehouse::INetworkTask
         return true;
     }
 
+    // conflict handling may have moved existing riffs over to this jam
+    void updateHarmonicIndex( Warehouse::HarmonicIndex& harmonicIndex ) const override;
+
 
     base::EventBusClient                m_eventBusClient;
     types::JamCouchID                   m_jamCID;
@@ -201,6 +267,8 @@ struct JamPurgeTask final : Warehouse::ITask
         return true;
     }
 
+    void updateHarmonicIndex( Warehouse::HarmonicIndex& harmonicIndex ) const override;
+
 
     types::JamCouchID m_jamCID;
 
@@ -234,24 +302,38 @@ struct JamExportTask final : Warehouse::ITask
 {
     static constexpr std::string_view Tag = "EXPORT";
 
-    JamExportTask( base::EventBusClient& eventBus, const types::JamCouchID& jamCID, const fs::path& exportFolder, std::string_view jamName, const base::OperationID opID )
+    JamExportTask(
+        base::EventBusClient& eventBus,
+        const types::JamCouchID& jamCID,
+        const fs::path& exportFolder,
+        std::string_view jamName,
+        const Warehouse::ExportFormat exportFormat,
+        const fs::path& stemCacheRoot,
+        const base::OperationID opID )
         : Warehouse::ITask()
         , m_eventBusClient( eventBus )
         , m_jamCID( jamCID )
         , m_exportFolder( exportFolder )
         , m_jamName( jamName )
+        , m_exportFormat( exportFormat )
+        , m_stemCacheRoot( stemCacheRoot )
         , m_operationID( opID )
     {}
 
-    base::EventBusClient    m_eventBusClient;
-    types::JamCouchID       m_jamCID;
-    fs::path                m_exportFolder;
-    std::string             m_jamName;
-    base::OperationID       m_operationID;
+    base::EventBusClient        m_eventBusClient;
+    types::JamCouchID           m_jamCID;
+    fs::path                    m_exportFolder;
+    std::string                 m_jamName;
+    Warehouse::ExportFormat     m_exportFormat;
+    fs::path                    m_stemCacheRoot;        // if set, bundle this jam's cached stems into a binary export
+    base::OperationID           m_operationID;
 
     const char* getTag() const override { return Tag.data(); }
     std::string Describe() const override { return fmt::format( "[{}] exporting jam to disk", Tag ); }
     bool Work( TaskQueue& currentTasks ) override;
+
+private:
+    bool writeBinaryArchive();
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -259,65 +341,34 @@ struct JamImportTask final : Warehouse::ITask
 {
     static constexpr std::string_view Tag = "IMPORT";
 
-    JamImportTask( base::EventBusClient& eventBus, const fs::path& fileToImport, const base::OperationID opID )
+    JamImportTask( base::EventBusClient& eventBus, const fs::path& fileToImport, const fs::path& stemCacheRoot, const base::OperationID opID )
         : Warehouse::ITask()
         , m_eventBusClient( eventBus )
         , m_fileToImport( fileToImport )
+        , m_stemCacheRoot( stemCacheRoot )
         , m_operationID( opID )
     {}
 
     base::EventBusClient    m_eventBusClient;
     fs::path                m_fileToImport;
+    fs::path                m_stemCacheRoot;        // where stems bundled in a binary archive are unpacked to, if set
     base::OperationID       m_operationID;
+    types::JamCouchID       m_importedJamCID;       // filled in by Work() once the header is parsed
 
     // rebuild after add
     bool shouldTriggerContentReport() const override { return true; }
 
-    const char* getTag() const override { return Tag.data(); }
-    std::string Describe() const override { return fmt::format( "[{}] importing jam from disk", Tag ); }
-    bool Work( TaskQueue& currentTasks ) override;
-};
-
-// ---------------------------------------------------------------------------------------------------------------------
-struct GetRiffDataTask final : Warehouse::INetworkTask
-{
-    static constexpr std::string_view Tag = "RIFFDATA";
-
-    GetRiffDataTask( const api::NetConfiguration& ncfg, const types::JamCouchID& jamCID, const std::vector< types::RiffCouchID >& riffCIDs )
-        : Warehouse::INetworkTask( ncfg )
-        , m_jamCID( jamCID )
-        , m_riffCIDs( riffCIDs )
-    {}
-
-    types::JamCouchID                 m_jamCID;
-    std::vector< types::RiffCouchID > m_riffCIDs;
+    void updateHarmonicIndex( Warehouse::HarmonicIndex& harmonicIndex ) const override;
 
     const char* getTag() const override { return Tag.data(); }
-    std::string Describe() const override { return fmt::format( "[{}] pulling {} riff details", Tag, m_riffCIDs.size() ); }
+    std::string Describe() const override { return fmt::format( "[{}] importing jam from disk", Tag ); }
     bool Work( TaskQueue& currentTasks ) override;
-};
-
-// ---------------------------------------------------------------------------------------------------------------------
-struct GetStemData final : Warehouse::INetworkTask
-{
-    static constexpr std::string_view Tag = "STEMDATA";
-
-    GetStemData( const api::NetConfiguration& ncfg, const types::JamCouchID& jamCID, const std::vector< types::StemCouchID >& stemCIDs )
-        : Warehouse::INetworkTask( ncfg )
-        , m_jamCID( jamCID )
-        , m_stemCIDs( stemCIDs )
-    {}
-
-    types::JamCouchID                 m_jamCID;
-    std::vector< types::StemCouchID > m_stemCIDs;
 
-    const char* getTag() const override { return Tag.data(); }
-    std::string Describe() const override { return fmt::format( "[{}] pulling {} stem details", Tag, m_stemCIDs.size() ); }
-    bool Work( TaskQueue& currentTasks ) override;
+private:
+    bool readBinaryArchive();
 };
 
 
-
 struct Warehouse::TaskSchedule
 {
     TaskQueue                           m_taskQueue;
@@ -368,13 +419,14 @@ namespace jams {
     }
 
     // -----------------------------------------------------------------------------------------------------------------
+    template< typename _SqlDB = Warehouse::SqlDB >
     static bool getPublicNameForID( const types::JamCouchID& jamCID, std::string& publicName )
     {
         static constexpr char _sqlGetJamByID[] = R"(
             select PublicName from jams where JamCID is ?1;
         )";
 
-        auto query = Warehouse::SqlDB::query<_sqlGetJamByID>( jamCID.value() );
+        auto query = _SqlDB::template query<_sqlGetJamByID>( jamCID.value() );
 
         return query( publicName );
     }
@@ -545,19 +597,25 @@ namespace riffs {
     }
 
     // -----------------------------------------------------------------------------------------------------------------
-    static bool findUnpopulatedBatch( const types::JamCouchID& jamCID, const int32_t maximumRiffsToFind, std::vector<types::RiffCouchID>& riffCIDs )
+    // optionally skip any riffs in the given set, eg. ones that are already being fetched
+    static bool findUnpopulatedBatch( const types::JamCouchID& jamCID, const int32_t maximumRiffsToFind, std::vector<types::RiffCouchID>& riffCIDs, const RiffSet* excluding = nullptr )
     {
         static constexpr char findEmptyRiffsInJam[] = R"(
             select riffCID from riffs where OwnerJamCID is ?1 and AppVersion is null limit ?2 )";
 
-        auto query = Warehouse::SqlDB::query<findEmptyRiffsInJam>( jamCID.value(), maximumRiffsToFind );
+        const int32_t excludingCount = ( excluding == nullptr ) ? 0 : static_cast<int32_t>( excluding->size() );
+
+        auto query = Warehouse::SqlDB::query<findEmptyRiffsInJam>( jamCID.value(), maximumRiffsToFind + excludingCount );
 
         riffCIDs.clear();
         riffCIDs.reserve( maximumRiffsToFind );
 
         std::string_view riffCID;
-        while ( query( riffCID ) )
+        while ( riffCIDs.size() < static_cast<std::size_t>( maximumRiffsToFind ) && query( riffCID ) )
         {
+            if ( excluding != nullptr && excluding->contains( types::RiffCouchID{ riffCID } ) )
+                continue;
+
             riffCIDs.emplace_back( riffCID );
         }
 
@@ -582,9 +640,10 @@ namespace riffs {
     }
 
     // -----------------------------------------------------------------------------------------------------------------
+    template< typename _SqlDB = Warehouse::SqlDB >
     static bool getSingleByID( const types::RiffCouchID& riffCID, endlesss::types::Riff& outRiff )
     {
-        auto query = Warehouse::SqlDB::query<unpackSingleRiff>( riffCID.value() );
+        auto query = _SqlDB::template query<unpackSingleRiff>( riffCID.value() );
 
         std::string_view riffID, jamID;
         std::string_view stem1, stem2, stem3, stem4, stem5, stem6, stem7, stem8, gainsJson;
@@ -991,19 +1050,25 @@ namespace stems {
 
     // -----------------------------------------------------------------------------------------------------------------
     // find a single stem that needs filling
-    static bool findUnpopulatedBatch( const types::JamCouchID& jamCID, const int32_t maximumStemsToFind, std::vector<types::StemCouchID>& stemCIDs )
+    // optionally skip any stems in the given set, eg. ones that are already being fetched
+    static bool findUnpopulatedBatch( const types::JamCouchID& jamCID, const int32_t maximumStemsToFind, std::vector<types::StemCouchID>& stemCIDs, const StemSet* excluding = nullptr )
     {
         static constexpr char findEmptyStems[] = R"(
             select StemCID from stems where OwnerJamCID is ?1 and CreationTime is null limit ?2 )";
 
-        auto query = Warehouse::SqlDB::query<findEmptyStems>( jamCID.value(), maximumStemsToFind );
+        const int32_t excludingCount = ( excluding == nullptr ) ? 0 : static_cast<int32_t>( excluding->size() );
+
+        auto query = Warehouse::SqlDB::query<findEmptyStems>( jamCID.value(), maximumStemsToFind + excludingCount );
 
         stemCIDs.clear();
         stemCIDs.reserve( maximumStemsToFind );
 
         std::string_view stemCID;
-        while ( query( stemCID ) )
+        while ( stemCIDs.size() < static_cast<std::size_t>( maximumStemsToFind ) && query( stemCID ) )
         {
+            if ( excluding != nullptr && excluding->contains( types::StemCouchID{ stemCID } ) )
+                continue;
+
             stemCIDs.emplace_back( stemCID );
         }
 
@@ -1011,9 +1076,10 @@ namespace stems {
     }
 
     // -----------------------------------------------------------------------------------------------------------------
+    template< typename _SqlDB = Warehouse::SqlDB >
     static bool getSingleStemByID( const types::StemCouchID& stemCID, endlesss::types::Stem& outStem )
     {
-        auto query = Warehouse::SqlDB::query<unpackSingleStem>( stemCID.value() );
+        auto query = _SqlDB::template query<unpackSingleStem>( stemCID.value() );
 
         std::string_view riffID, jamID;
         int32_t instrumentFlags;
@@ -1112,158 +1178,2764 @@ namespace ledger {
 
 } // namespace ledger
 
+// ---------------------------------------------------------------------------------------------------------------------
+// per-jam populated / unpopulated riff & stem counts, kept current by triggers on the Riffs and Stems tables so that
+// the contents report is a read of a few hundred rows rather than a GROUP BY across the whole database
+//
+namespace contents {
+
+    static constexpr char createTable[] = R"(
+        CREATE TABLE IF NOT EXISTS "JamContents" (
+            "JamCID"            TEXT NOT NULL UNIQUE,
+            "PopulatedRiffs"    INTEGER NOT NULL DEFAULT 0,
+            "UnpopulatedRiffs"  INTEGER NOT NULL DEFAULT 0,
+            "PopulatedStems"    INTEGER NOT NULL DEFAULT 0,
+            "UnpopulatedStems"  INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY("JamCID")
+        );)";
+
+    // riffs are considered populated once AppVersion is filled in, stems once they have a CreationTime; matching
+    // the original GROUP BY queries used by the contents report
+    static constexpr char createTrigger_RiffInsert[] = R"(
+        CREATE TRIGGER IF NOT EXISTS "JamContents_RiffInsert" AFTER INSERT ON "Riffs"
+        BEGIN
+            INSERT OR IGNORE INTO JamContents( JamCID ) VALUES( new.OwnerJamCID );
+            UPDATE JamContents SET
+                PopulatedRiffs   = PopulatedRiffs   + ( new.AppVersion is not null ),
+                UnpopulatedRiffs = UnpopulatedRiffs + ( new.AppVersion is null )
+            WHERE JamCID = new.OwnerJamCID;
+        END;)";
+    static constexpr char createTrigger_RiffDelete[] = R"(
+        CREATE TRIGGER IF NOT EXISTS "JamContents_RiffDelete" AFTER DELETE ON "Riffs"
+        BEGIN
+            UPDATE JamContents SET
+                PopulatedRiffs   = PopulatedRiffs   - ( old.AppVersion is not null ),
+                UnpopulatedRiffs = UnpopulatedRiffs - ( old.AppVersion is null )
+            WHERE JamCID = old.OwnerJamCID;
+        END;)";
+    static constexpr char createTrigger_RiffUpdate[] = R"(
+        CREATE TRIGGER IF NOT EXISTS "JamContents_RiffUpdate" AFTER UPDATE OF AppVersion, OwnerJamCID ON "Riffs"
+        WHEN ( old.AppVersion is null ) is not ( new.AppVersion is null ) OR old.OwnerJamCID is not new.OwnerJamCID
+        BEGIN
+            UPDATE JamContents SET
+                PopulatedRiffs   = PopulatedRiffs   - ( old.AppVersion is not null ),
+                UnpopulatedRiffs = UnpopulatedRiffs - ( old.AppVersion is null )
+            WHERE JamCID = old.OwnerJamCID;
+            INSERT OR IGNORE INTO JamContents( JamCID ) VALUES( new.OwnerJamCID );
+            UPDATE JamContents SET
+                PopulatedRiffs   = PopulatedRiffs   + ( new.AppVersion is not null ),
+                UnpopulatedRiffs = UnpopulatedRiffs + ( new.AppVersion is null )
+            WHERE JamCID = new.OwnerJamCID;
+        END;)";
+
+    static constexpr char createTrigger_StemInsert[] = R"(
+        CREATE TRIGGER IF NOT EXISTS "JamContents_StemInsert" AFTER INSERT ON "Stems"
+        BEGIN
+            INSERT OR IGNORE INTO JamContents( JamCID ) VALUES( new.OwnerJamCID );
+            UPDATE JamContents SET
+                PopulatedStems   = PopulatedStems   + ( new.CreationTime is not null ),
+                UnpopulatedStems = UnpopulatedStems + ( new.CreationTime is null )
+            WHERE JamCID = new.OwnerJamCID;
+        END;)";
+    static constexpr char createTrigger_StemDelete[] = R"(
+        CREATE TRIGGER IF NOT EXISTS "JamContents_StemDelete" AFTER DELETE ON "Stems"
+        BEGIN
+            UPDATE JamContents SET
+                PopulatedStems   = PopulatedStems   - ( old.CreationTime is not null ),
+                UnpopulatedStems = UnpopulatedStems - ( old.CreationTime is null )
+            WHERE JamCID = old.OwnerJamCID;
+        END;)";
+    static constexpr char createTrigger_StemUpdate[] = R"(
+        CREATE TRIGGER IF NOT EXISTS "JamContents_StemUpdate" AFTER UPDATE OF CreationTime, OwnerJamCID ON "Stems"
+        WHEN ( old.CreationTime is null ) is not ( new.CreationTime is null ) OR old.OwnerJamCID is not new.OwnerJamCID
+        BEGIN
+            UPDATE JamContents SET
+                PopulatedStems   = PopulatedStems   - ( old.CreationTime is not null ),
+                UnpopulatedStems = UnpopulatedStems - ( old.CreationTime is null )
+            WHERE JamCID = old.OwnerJamCID;
+            INSERT OR IGNORE INTO JamContents( JamCID ) VALUES( new.OwnerJamCID );
+            UPDATE JamContents SET
+                PopulatedStems   = PopulatedStems   + ( new.CreationTime is not null ),
+                UnpopulatedStems = UnpopulatedStems + ( new.CreationTime is null )
+            WHERE JamCID = new.OwnerJamCID;
+        END;)";
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // recompute the whole table from scratch; only needed when the table is first added to an existing database
+    static void rebuild()
+    {
+        spacetime::ScopedTimer rebuildTiming( "contents::rebuild" );
+
+        static constexpr char _sqlClearContents[] = R"(
+            delete from JamContents;
+        )";
+        static constexpr char _sqlRebuildContents[] = R"(
+            INSERT INTO JamContents( JamCID, PopulatedRiffs, UnpopulatedRiffs, PopulatedStems, UnpopulatedStems )
+            SELECT OwnerJamCID, sum( PR ), sum( UR ), sum( PS ), sum( US )
+            FROM
+            (
+                SELECT OwnerJamCID,
+                    ( AppVersion is not null ) as PR,
+                    ( AppVersion is null )     as UR,
+                    0 as PS,
+                    0 as US
+                FROM Riffs
+                UNION ALL
+                SELECT OwnerJamCID,
+                    0 as PR,
+                    0 as UR,
+                    ( CreationTime is not null ) as PS,
+                    ( CreationTime is null )     as US
+                FROM Stems
+            )
+            GROUP BY OwnerJamCID;
+        )";
+
+        Warehouse::SqlDB::query<_sqlClearContents>();
+        Warehouse::SqlDB::query<_sqlRebuildContents>();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // must run after the riffs & stems tables have been created
+    static void runInit()
+    {
+        static constexpr char _sqlContentsTableExists[] = R"(
+            select count(1) from sqlite_master where type = 'table' and name = 'JamContents';
+        )";
+
+        int64_t existingTables = 0;
+        {
+            auto query = Warehouse::SqlDB::query<_sqlContentsTableExists>();
+            query( existingTables );
+        }
+
+        Warehouse::SqlDB::query<createTable>();
+
+        Warehouse::SqlDB::query<createTrigger_RiffInsert>();
+        Warehouse::SqlDB::query<createTrigger_RiffDelete>();
+        Warehouse::SqlDB::query<createTrigger_RiffUpdate>();
+        Warehouse::SqlDB::query<createTrigger_StemInsert>();
+        Warehouse::SqlDB::query<createTrigger_StemDelete>();
+        Warehouse::SqlDB::query<createTrigger_StemUpdate>();
+
+        // new table on an existing database, backfill the counts from what's already stored
+        if ( existingTables == 0 )
+        {
+            blog::database( FMTX( "building initial jam contents table" ) );
+            rebuild();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------
+    static void removeJam( const types::JamCouchID& jamCID )
+    {
+        static constexpr char _sqlDeleteContents[] = R"(
+            delete from JamContents where JamCID = ?1;
+        )";
+
+        Warehouse::SqlDB::query<_sqlDeleteContents>( jamCID.value() );
+    }
+
+} // namespace contents
+
 namespace constants {
 } // namespace constants
 
 } // namespace sql
 
 // ---------------------------------------------------------------------------------------------------------------------
-// add a custom seeded RANDOM function to sqlite, allowing us to feed through specific random sequences
+// on-disk JamSlice snapshots; the SoA arrays are written out one column after another, each aligned to 16 bytes. the
+// loader pulls the whole file in with a single read and copies each column straight out of that buffer into the slice.
+// strings are stored as offset tables + packed text, and usernames are dictionary-encoded then re-hashed on load, as
+// absl::Hash values are not stable from one run to the next
 //
-static void sqlite_SEEDED_RANDOM_dtor( void* p )
-{
-    math::RNG32* pRNG = static_cast<math::RNG32*>(p);
-    delete pRNG;
-}
+namespace jamslice {
 
-static void sqlite_SEEDED_RANDOM( sqlite3_context* context, int argc, sqlite3_value** argv )
+// cheap summary of the rows that feed a slice; the change index is only tracked in memory, so this is what lets us
+// decide if a snapshot written by a previous session still matches the database
+struct Fingerprint
 {
-    if ( argc == 1 && sqlite3_value_type( argv[0] ) == SQLITE_INTEGER )
-    {
-        // fetch the current RNG state from db context
-        math::RNG32* pRNG = static_cast<math::RNG32*>( sqlite3_get_auxdata( context, 0 ) );
-        if ( !pRNG )
-        {
-            // .. first time through, create the RNG state, stash it
-            const int32_t seed = sqlite3_value_int( argv[0] );
-            pRNG = new math::RNG32( static_cast<uint32_t>(seed) );
-            sqlite3_set_auxdata( context, 0, pRNG, sqlite_SEEDED_RANDOM_dtor );
-        }
+    int64_t     m_populatedRiffs = 0;
+    int64_t     m_populatedStems = 0;
+    int64_t     m_latestRiffTime = 0;
 
-        // produce the next number in the sequence
-        const int64_t result = pRNG->genInt32();
+    bool operator==( const Fingerprint& rhs ) const = default;
 
-        sqlite3_result_int64( context, result );
-    }
-    else
+    static Fingerprint fetch( const types::JamCouchID& jamCID )
     {
-        sqlite3_result_error( context, "Invalid", 0 );
+        static constexpr char _sqlFingerprint[] = R"(
+            select ( select count(*)                         from riffs where OwnerJamCID is ?1 and AppVersion is not null ),
+                   ( select count(*)                         from stems where OwnerJamCID is ?1 and CreationTime is not null ),
+                   ( select coalesce( max(CreationTime), 0 ) from riffs where OwnerJamCID is ?1 and AppVersion is not null );
+        )";
+
+        Fingerprint result;
+
+        auto query = Warehouse::SqlDB::query<_sqlFingerprint>( jamCID.value() );
+        query( result.m_populatedRiffs, result.m_populatedStems, result.m_latestRiffTime );
+
+        return result;
     }
+};
+
+struct Header
+{
+    static constexpr uint32_t cMagic   = 0x4C534A4F;   // 'OJSL'
+    static constexpr uint32_t cVersion = 1;
+
+    uint32_t        m_magic             = cMagic;
+    uint32_t        m_version           = cVersion;
+    uint32_t        m_changeIndex       = 0;
+    uint32_t        m_riffCount         = 0;
+    Fingerprint     m_fingerprint;
+    uint32_t        m_userCount         = 0;
+    uint32_t        m_riffIDBytes       = 0;
+    uint32_t        m_userNameBytes     = 0;
+    uint32_t        m_reserved          = 0;
+};
+
+static constexpr std::size_t cColumnAlignment = 16;
+
+inline std::size_t alignColumn( const std::size_t offset )
+{
+    return ( offset + ( cColumnAlignment - 1 ) ) & ~( cColumnAlignment - 1 );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-Warehouse::Warehouse( const app::StoragePaths& storagePaths, api::NetConfiguration::Shared& networkConfig, base::EventBusClient eventBus )
-    : m_networkConfiguration( networkConfig )
-    , m_eventBusClient( eventBus )
-    , m_workerThreadPaused( false )
+// username -> index table built up during extraction, so each unique name is only hashed once
+struct UserDictionary
 {
-    blog::database( FMTX("sqlite version {}"), SQLITE_VERSION );
+    using UserIndices = std::array< uint32_t, 8 >;
 
-    // create the lockless queues that manages the warehouse TODO list
+    uint32_t intern( const std::string_view name )
     {
-        m_taskSchedule = std::make_unique<TaskSchedule>();
-        m_taskSchedule->signal();
-        m_taskSchedulePriority = std::make_unique<TaskSchedule>();
+        const auto lookupIt = m_lookup.find( name );
+        if ( lookupIt != m_lookup.end() )
+            return lookupIt->second;
+
+        const uint32_t newIndex = static_cast<uint32_t>( m_names.size() );
+        m_names.emplace_back( name );
+        m_hashes.emplace_back( m_hasher( name ) );
+        m_lookup.emplace( m_names.back(), newIndex );
+
+        return newIndex;
     }
 
-    m_databaseFile = ( storagePaths.cacheCommon / "warehouse.db3" ).string();
-    SqlDB::post_connection_hook = []( sqlite3* db_handle )
-    {
-        blog::database( FMTX( "post_connection_hook( 0x{:x} )" ), (uint64_t)db_handle );
+    ouro_nodiscard uint64_t getHash( const uint32_t index ) const { return m_hashes[index]; }
 
-        // https://www.sqlite.org/pragma.html#pragma_temp_store
-        sqlite3_exec( db_handle, "pragma temp_store = memory", nullptr, nullptr, nullptr );
+    // hashing used for usernames, matching what the apps use too
+    absl::Hash< std::string_view >                  m_hasher;
 
-        // add our RANDOM variant that takes a seed to allow for deterministic random queries
-        int32_t seededRes = sqlite3_create_function( db_handle, "SEEDED_RANDOM", 1, SQLITE_UTF8, NULL, &sqlite_SEEDED_RANDOM, NULL, NULL );
-        blog::database( FMTX( "sqlite3_create_function(SEEDED_RANDOM) = {} ({})" ), seededRes == SQLITE_OK ? "OK" : "Error", seededRes );
-        
-        // bolt in carray extension
-        int32_t carrayRes = sqlite3_carray_init( db_handle, nullptr, nullptr );
-        blog::database( FMTX( "sqlite3_carray_init = {} ({})" ), carrayRes == SQLITE_OK ? "OK" : "Error", carrayRes );
-    };
+    absl::flat_hash_map< std::string, uint32_t >    m_lookup;
+    std::vector< std::string >                      m_names;
+    std::vector< uint64_t >                         m_hashes;
 
-    // set the database up; creating tables & indices if we're starting fresh
+    // per-riff and per-stem indices into m_names, parallel to the slice arrays
+    std::vector< uint32_t >                         m_riffUsers;
+    std::vector< UserIndices >                      m_stemUsers;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct ColumnWriter
+{
+    std::vector< char > m_buffer;
+
+    template< typename _Type >
+    void column( const _Type* data, const std::size_t count )
     {
-        Warehouse::SqlDB::TransactionGuard txn;
+        m_buffer.resize( alignColumn( m_buffer.size() ), 0 );
 
-        sql::jams::runInit();
-        sql::riffs::runInit();
-        sql::tags::runInit();
-        sql::stems::runInit();
-        sql::ledger::runInit();
+        const char* bytes = reinterpret_cast<const char*>( data );
+        m_buffer.insert( m_buffer.end(), bytes, bytes + ( sizeof( _Type ) * count ) );
     }
 
-
-    // optimize on startup
+    // offset table (count + 1 entries) followed by the packed text
+    template< typename _StringIter, typename _Getter >
+    uint32_t strings( _StringIter begin, _StringIter end, _Getter&& getter )
     {
-        spacetime::ScopedTimer stemTiming( "warehouse [optimize]" );
-        static constexpr char sqlOptimize[] = R"(pragma optimize;)";
-        SqlDB::query<sqlOptimize>();
-    }
+        std::vector< uint32_t > offsets;
+        std::string packed;
 
-    m_workerThreadAlive = true;
-    m_workerThread      = std::make_unique<std::thread>( &Warehouse::threadWorker, this );
+        offsets.reserve( std::distance( begin, end ) + 1 );
+        offsets.push_back( 0 );
+        for ( auto it = begin; it != end; ++it )
+        {
+            packed += getter( *it );
+            offsets.push_back( static_cast<uint32_t>( packed.size() ) );
+        }
 
-    APP_EVENT_BIND_TO( RiffTagAction );
+        column( offsets.data(), offsets.size() );
+        column( packed.data(), packed.size() );
 
-#if OURO_PLATFORM_WIN
-    ::SetThreadPriority( m_workerThread->native_handle(), THREAD_PRIORITY_BELOW_NORMAL );
-#endif
-}
+        return static_cast<uint32_t>( packed.size() );
+    }
+};
 
-// ---------------------------------------------------------------------------------------------------------------------
-Warehouse::~Warehouse()
+struct ColumnReader
 {
-    APP_EVENT_UNBIND( RiffTagAction );
+    const char*     m_data;
+    std::size_t     m_size;
+    std::size_t     m_offset = 0;
 
-    m_workerThreadAlive = false;
+    // returns nullptr if the column would run off the end of the data
+    template< typename _Type >
+    const _Type* column( const std::size_t count )
+    {
+        m_offset = alignColumn( m_offset );
 
-    // unblock the thread, wait for it to die out
-    m_taskSchedule->signal();
-    m_workerThread->join();
-    m_workerThread.reset();
-}
+        const std::size_t columnBytes = sizeof( _Type ) * count;
+        if ( m_offset + columnBytes > m_size )
+            return nullptr;
+
+        const _Type* result = reinterpret_cast<const _Type*>( m_data + m_offset );
+        m_offset += columnBytes;
+        return result;
+    }
+};
 
 // ---------------------------------------------------------------------------------------------------------------------
-void Warehouse::setCallbackWorkReport( const WorkUpdateCallback& cb )
+absl::Status write(
+    const fs::path& snapshotFile,
+    const Warehouse::ChangeIndex changeIndex,
+    const Fingerprint& fingerprint,
+    const Warehouse::JamSlice& slice,
+    const UserDictionary& users )
 {
+    const std::size_t riffCount = slice.m_ids.size();
+    ABSL_ASSERT( users.m_riffUsers.size() == riffCount );
+    ABSL_ASSERT( users.m_stemUsers.size() == riffCount );
+
+    Header header;
+    header.m_changeIndex    = changeIndex.get();
+    header.m_riffCount      = static_cast<uint32_t>( riffCount );
+    header.m_fingerprint    = fingerprint;
+    header.m_userCount      = static_cast<uint32_t>( users.m_names.size() );
+
+    ColumnWriter writer;
+    writer.m_buffer.reserve( sizeof( Header ) + ( riffCount * 128 ) );
+
+    // header is patched once we know the string table sizes
+    writer.column( &header, 1 );
+
+    header.m_riffIDBytes = writer.strings( slice.m_ids.begin(), slice.m_ids.end(), []( const types::RiffCouchID& riffID ) -> const std::string& { return riffID.value(); } );
+
     {
-        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
-        m_cbWorkUpdateToInstall = cb;
+        std::vector< int64_t > timestamps;
+        timestamps.reserve( riffCount );
+        for ( const auto& timestamp : slice.m_timestamps )
+            timestamps.push_back( timestamp.time_since_epoch().count() );
+
+        writer.column( timestamps.data(), riffCount );
     }
-    m_taskSchedule->signal();
-}
+    writer.column( users.m_riffUsers.data(),    riffCount );
+    writer.column( slice.m_roots.data(),        riffCount );
+    writer.column( slice.m_scales.data(),       riffCount );
+    writer.column( slice.m_bpms.data(),         riffCount );
+    writer.column( users.m_stemUsers.data(),    riffCount );
+    writer.column( slice.m_deltaSeconds.data(), riffCount );
+    writer.column( slice.m_deltaStem.data(),    riffCount );
 
-// ---------------------------------------------------------------------------------------------------------------------
-void Warehouse::setCallbackContentsReport( const ContentsReportCallback& cb )
-{
+    header.m_userNameBytes = writer.strings( users.m_names.begin(), users.m_names.end(), []( const std::string& name ) -> const std::string& { return name; } );
+
+    memcpy( writer.m_buffer.data(), &header, sizeof( Header ) );
+
+    // write to a temporary file and then swap it into place, so a concurrent reader never sees a half-written snapshot
+    fs::path snapshotFileTemp = snapshotFile;
+    snapshotFileTemp += ".tmp";
     {
-        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
-        m_cbContentsReportToInstall = cb;
+        std::basic_ofstream<char> ofs( snapshotFileTemp, std::ios::out | std::ios::binary | std::ios::trunc );
+        if ( !ofs.is_open() )
+        {
+            return absl::PermissionDeniedError( fmt::format( FMTX( "unable to open [{}] for writing" ), snapshotFileTemp.string() ) );
+        }
+
+        ofs.write( writer.m_buffer.data(), writer.m_buffer.size() );
+
+        if ( !ofs.good() )
+        {
+            ofs.close();
+            std::error_code removeError;
+            fs::remove( snapshotFileTemp, removeError );
+
+            return absl::DataLossError( fmt::format( FMTX( "failed while writing [{}]" ), snapshotFileTemp.string() ) );
+        }
     }
-    m_taskSchedule->signal();
-}
 
-// ---------------------------------------------------------------------------------------------------------------------
-void Warehouse::setCallbackTagUpdate( const TagUpdateCallback& cbUpdate, const TagBatchingCallback& cbBatch )
-{
+    std::error_code renameError;
+    fs::rename( snapshotFileTemp, snapshotFile, renameError );
+    if ( renameError )
     {
-        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
-        m_cbTagUpdate = cbUpdate;
-        m_cbTagBatching = cbBatch;
+        std::error_code removeError;
+        fs::remove( snapshotFileTemp, removeError );
+
+        return absl::AbortedError( fmt::format( FMTX( "unable to move [{}] into place, {}" ), snapshotFile.string(), renameError.message() ) );
     }
-    m_taskSchedule->signal();
+
+    return absl::OkStatus();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-void Warehouse::setCallbackTagRemoved( const TagRemovedCallback& cb )
+// load a snapshot back into a fresh JamSlice; fails with FailedPrecondition if the snapshot exists but no longer
+// matches the given change index / fingerprint
+absl::StatusOr< Warehouse::JamSlicePtr > read(
+    const fs::path& snapshotFile,
+    const types::JamCouchID& jamCID,
+    const Warehouse::ChangeIndex changeIndex,
+    const Fingerprint& fingerprint )
 {
+    std::error_code sizeError;
+    const auto fileSize = fs::file_size( snapshotFile, sizeError );
+    if ( sizeError )
     {
-        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
-        m_cbTagRemoved = cb;
+        return absl::NotFoundError( fmt::format( FMTX( "unable to stat [{}], {}" ), snapshotFile.string(), sizeError.message() ) );
     }
-    m_taskSchedule->signal();
+    if ( fileSize < sizeof( Header ) )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "truncated header in [{}]" ), snapshotFile.string() ) );
+    }
+
+    // pull the whole thing in with one read; the slice owns its arrays so there's nothing to gain from keeping a view open
+    std::vector< char > fileData( fileSize );
+    {
+        std::basic_ifstream<char> ifs( snapshotFile, std::ios::in | std::ios::binary );
+        if ( !ifs.is_open() )
+        {
+            return absl::NotFoundError( fmt::format( FMTX( "unable to open [{}]" ), snapshotFile.string() ) );
+        }
+
+        ifs.read( fileData.data(), fileSize );
+        if ( !ifs.good() )
+        {
+            return absl::DataLossError( fmt::format( FMTX( "failed while reading [{}]" ), snapshotFile.string() ) );
+        }
+    }
+
+    ColumnReader reader{ fileData.data(), fileData.size() };
+
+    Header header;
+    memcpy( &header, reader.column< Header >( 1 ), sizeof( Header ) );
+
+    if ( header.m_magic != Header::cMagic || header.m_version != Header::cVersion )
+    {
+        return absl::FailedPreconditionError( fmt::format( FMTX( "header in [{}] is invalid or outdated (v{})" ), snapshotFile.string(), header.m_version ) );
+    }
+    // a valid change index means the jam has been touched this session; the snapshot has to have been written at that point
+    if ( changeIndex != Warehouse::ChangeIndex::invalid() && header.m_changeIndex != changeIndex.get() )
+    {
+        return absl::FailedPreconditionError( fmt::format( FMTX( "change index moved on ({} -> {})" ), header.m_changeIndex, changeIndex.get() ) );
+    }
+    if ( !( header.m_fingerprint == fingerprint ) )
+    {
+        return absl::FailedPreconditionError( fmt::format( FMTX( "database changed (riffs {} -> {}, stems {} -> {})" ),
+            header.m_fingerprint.m_populatedRiffs, fingerprint.m_populatedRiffs,
+            header.m_fingerprint.m_populatedStems, fingerprint.m_populatedStems ) );
+    }
+
+    const std::size_t riffCount = header.m_riffCount;
+    const std::size_t userCount = header.m_userCount;
+
+    const auto* riffIDOffsets   = reader.column< uint32_t >( riffCount + 1 );
+    const auto* riffIDText      = reader.column< char >( header.m_riffIDBytes );
+    const auto* timestamps      = reader.column< int64_t >( riffCount );
+    const auto* riffUsers       = reader.column< uint32_t >( riffCount );
+    const auto* roots           = reader.column< uint8_t >( riffCount );
+    const auto* scales          = reader.column< uint8_t >( riffCount );
+    const auto* bpms            = reader.column< float >( riffCount );
+    const auto* stemUsers       = reader.column< UserDictionary::UserIndices >( riffCount );
+    const auto* deltaSeconds    = reader.column< int32_t >( riffCount );
+    const auto* deltaStem       = reader.column< int8_t >( riffCount );
+    const auto* userOffsets     = reader.column< uint32_t >( userCount + 1 );
+    const auto* userText        = reader.column< char >( header.m_userNameBytes );
+
+    if ( riffIDOffsets == nullptr || riffIDText == nullptr || timestamps == nullptr || riffUsers == nullptr ||
+         roots == nullptr || scales == nullptr || bpms == nullptr || stemUsers == nullptr ||
+         deltaSeconds == nullptr || deltaStem == nullptr || userOffsets == nullptr || userText == nullptr )
+    {
+        return absl::DataLossError( fmt::format( FMTX( "columns overrun the end of [{}]" ), snapshotFile.string() ) );
+    }
+
+    // re-hash the username dictionary for this run
+    absl::Hash< std::string_view > nameHasher;
+    std::vector< uint64_t > userHashes;
+    userHashes.reserve( userCount );
+    for ( std::size_t userI = 0; userI < userCount; userI++ )
+    {
+        if ( userOffsets[userI] > userOffsets[userI + 1] || userOffsets[userI + 1] > header.m_userNameBytes )
+            return absl::DataLossError( fmt::format( FMTX( "damaged username table in [{}]" ), snapshotFile.string() ) );
+
+        userHashes.push_back( nameHasher( std::string_view( userText + userOffsets[userI], userOffsets[userI + 1] - userOffsets[userI] ) ) );
+    }
+
+    auto resultSlice = std::make_unique<Warehouse::JamSlice>( jamCID, riffCount );
+
+    for ( std::size_t riffI = 0; riffI < riffCount; riffI++ )
+    {
+        if ( riffIDOffsets[riffI] > riffIDOffsets[riffI + 1] || riffIDOffsets[riffI + 1] > header.m_riffIDBytes )
+            return absl::DataLossError( fmt::format( FMTX( "damaged riff ID table in [{}]" ), snapshotFile.string() ) );
+
+        resultSlice->m_ids.emplace_back( std::string_view( riffIDText + riffIDOffsets[riffI], riffIDOffsets[riffI + 1] - riffIDOffsets[riffI] ) );
+        resultSlice->m_timestamps.emplace_back( std::chrono::seconds{ timestamps[riffI] } );
+
+        if ( riffUsers[riffI] >= userCount )
+            return absl::DataLossError( fmt::format( FMTX( "damaged user index in [{}]" ), snapshotFile.string() ) );
+        resultSlice->m_userhash.emplace_back( userHashes[riffUsers[riffI]] );
+
+        Warehouse::JamSlice::StemUserHashes& stemUserHashes = resultSlice->m_stemUserHashes.emplace_back();
+        for ( auto stemI = 0; stemI < 8; stemI++ )
+        {
+            if ( stemUsers[riffI][stemI] >= userCount )
+                return absl::DataLossError( fmt::format( FMTX( "damaged stem user index in [{}]" ), snapshotFile.string() ) );
+            stemUserHashes[stemI] = userHashes[stemUsers[riffI][stemI]];
+        }
+    }
+
+    // the plain numeric columns can go across wholesale
+    resultSlice->m_roots.assign( roots, roots + riffCount );
+    resultSlice->m_scales.assign( scales, scales + riffCount );
+    resultSlice->m_bpms.assign( bpms, bpms + riffCount );
+    resultSlice->m_deltaSeconds.assign( deltaSeconds, deltaSeconds + riffCount );
+    resultSlice->m_deltaStem.assign( deltaStem, deltaStem + riffCount );
+
+    return resultSlice;
+}
+
+} // namespace jamslice
+
+// ---------------------------------------------------------------------------------------------------------------------
+// binary jam archives, the compact alternative to the YAML export. a small header is followed by a stream of blocks, each
+// holding up to cRowsPerBlock riffs or stems as zstd-compressed columns (laid out with the jamslice column helpers).
+// every string - IDs, usernames, presets, file keys - is dictionary-encoded across the whole archive; a block only carries
+// the strings it introduces, appended to the running table, so both the writer and reader work one block at a time.
+// the jam's stem cache directory can optionally be bundled on the end as an uncompressed TAR block
+//
+namespace jamarchive {
+
+struct Header
+{
+    static constexpr uint32_t cMagic   = 0x4D414A4F;   // 'OJAM'
+    static constexpr uint32_t cVersion = 1;
+
+    uint32_t        m_magic             = cMagic;
+    uint32_t        m_version           = cVersion;
+    uint64_t        m_exportTimeUnix    = 0;
+};
+
+enum class BlockType : uint32_t
+{
+    Meta    = 0x4154454D,   // 'META'   jam CID, jam name, exporting version
+    Riffs   = 0x46464952,   // 'RIFF'
+    Stems   = 0x4D455453,   // 'STEM'
+    Tar     = 0x53524154,   // 'TARS'   raw TAR of the stem cache for this jam, not compressed or dictionary-encoded
+    End     = 0x20444E45,   // 'END '   total row counts, to validate against
+};
+
+struct BlockHeader
+{
+    BlockType       m_type;
+    uint32_t        m_rowCount;
+    uint64_t        m_rawBytes;
+    uint64_t        m_storedBytes;
+};
+
+static constexpr uint32_t    cRowsPerBlock       = 4096;
+static constexpr int32_t     cCompressionLevel   = 6;
+static constexpr uint64_t    cMaximumBlockBytes  = 256 * 1024 * 1024;   // refuse to allocate more than this for a damaged block
+
+// rows marked unpopulated only carry their ID, they are imported as empty skeletons for the sync process to fill in
+static constexpr uint8_t     cRowPopulated       = 1 << 0;
+
+using StemIndices   = std::array< uint32_t, 8 >;
+using StemGains     = std::array< float, 8 >;
+
+// all uint32 fields that name strings are indices into the archive dictionary
+struct RiffRow
+{
+    uint32_t        m_id;
+    uint32_t        m_user;
+    StemIndices     m_stems;
+    int64_t         m_creationTime;
+    float           m_bps;
+    float           m_bpmRnd;
+    float           m_magnitude;
+    StemGains       m_gains;
+    uint32_t        m_barLength;
+    uint32_t        m_appVersion;
+    uint8_t         m_root;
+    uint8_t         m_scale;
+    uint8_t         m_flags;
+};
+
+struct StemRow
+{
+    uint32_t        m_id;
+    uint32_t        m_fileEndpoint;
+    uint32_t        m_fileBucket;
+    uint32_t        m_fileKey;
+    uint32_t        m_fileMIME;
+    uint32_t        m_preset;
+    uint32_t        m_user;
+    uint32_t        m_colour;
+    int64_t         m_creationTime;
+    int64_t         m_fileLength;
+    uint32_t        m_sampleRate;
+    float           m_bps;
+    float           m_bpmRnd;
+    float           m_length16s;
+    float           m_originalPitch;
+    float           m_barLength;
+    uint8_t         m_instrument;
+    uint8_t         m_flags;
+};
+
+// column order on disk; append to the end (and bump the version) if new fields are required
+static constexpr auto cRiffColumns = std::make_tuple(
+    &RiffRow::m_id,
+    &RiffRow::m_flags,
+    &RiffRow::m_user,
+    &RiffRow::m_creationTime,
+    &RiffRow::m_root,
+    &RiffRow::m_scale,
+    &RiffRow::m_bps,
+    &RiffRow::m_bpmRnd,
+    &RiffRow::m_barLength,
+    &RiffRow::m_appVersion,
+    &RiffRow::m_magnitude,
+    &RiffRow::m_stems,
+    &RiffRow::m_gains );
+
+static constexpr auto cStemColumns = std::make_tuple(
+    &StemRow::m_id,
+    &StemRow::m_flags,
+    &StemRow::m_creationTime,
+    &StemRow::m_fileEndpoint,
+    &StemRow::m_fileBucket,
+    &StemRow::m_fileKey,
+    &StemRow::m_fileMIME,
+    &StemRow::m_fileLength,
+    &StemRow::m_bps,
+    &StemRow::m_bpmRnd,
+    &StemRow::m_instrument,
+    &StemRow::m_length16s,
+    &StemRow::m_originalPitch,
+    &StemRow::m_barLength,
+    &StemRow::m_preset,
+    &StemRow::m_user,
+    &StemRow::m_sampleRate,
+    &StemRow::m_colour );
+
+// ---------------------------------------------------------------------------------------------------------------------
+// transpose rows into / out of columns, one tuple entry at a time
+template< typename _Row, typename... _Members >
+void writeColumns( jamslice::ColumnWriter& writer, const std::vector< _Row >& rows, const std::tuple< _Members... >& columns )
+{
+    std::apply( [&]( auto... member )
+        {
+            ( [&]( auto rowMember )
+            {
+                using ValueType = std::remove_cvref_t< decltype( rows.front().*rowMember ) >;
+
+                std::vector< ValueType > values;
+                values.reserve( rows.size() );
+                for ( const auto& row : rows )
+                    values.push_back( row.*rowMember );
+
+                writer.column( values.data(), values.size() );
+            }( member ), ... );
+        }, columns );
+}
+
+template< typename _Row, typename... _Members >
+bool readColumns( jamslice::ColumnReader& reader, std::vector< _Row >& rows, const std::tuple< _Members... >& columns )
+{
+    return std::apply( [&]( auto... member )
+        {
+            return ( [&]( auto rowMember ) -> bool
+            {
+                using ValueType = std::remove_cvref_t< decltype( rows.front().*rowMember ) >;
+
+                const ValueType* values = reader.column< ValueType >( rows.size() );
+                if ( values == nullptr )
+                    return false;
+
+                for ( std::size_t rowI = 0; rowI < rows.size(); rowI++ )
+                    rows[rowI].*rowMember = values[rowI];
+
+                return true;
+            }( member ) && ... );
+        }, columns );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// string -> index table shared by every block in an archive; index 0 is always the empty string
+struct StringDictionary
+{
+    uint32_t intern( const std::string_view text )
+    {
+        if ( text.empty() )
+            return 0;
+
+        const auto lookupIt = m_lookup.find( text );
+        if ( lookupIt != m_lookup.end() )
+            return lookupIt->second;
+
+        const uint32_t newIndex = static_cast<uint32_t>( m_lookup.size() + 1 );
+        m_lookup.emplace( text, newIndex );
+        m_pending.emplace_back( text );
+
+        return newIndex;
+    }
+
+    absl::flat_hash_map< std::string, uint32_t >    m_lookup;
+    std::vector< std::string >                      m_pending;      // introduced since the last block was written
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct ArchiveWriter
+{
+    ArchiveWriter()
+    {
+        // frame checksums let the reader reject damaged blocks before trying to decode any columns
+        m_compressionContext = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter( m_compressionContext, ZSTD_c_compressionLevel, cCompressionLevel );
+        ZSTD_CCtx_setParameter( m_compressionContext, ZSTD_c_checksumFlag, 1 );
+    }
+
+    ~ArchiveWriter()
+    {
+        ZSTD_freeCCtx( m_compressionContext );
+    }
+
+    std::basic_ofstream<char>   m_output;
+    StringDictionary            m_dictionary;
+    std::vector< char >         m_compressed;
+    ZSTD_CCtx*                  m_compressionContext = nullptr;
+
+    absl::Status writeRaw( const void* data, const std::size_t bytes )
+    {
+        m_output.write( static_cast<const char*>( data ), bytes );
+        if ( !m_output.good() )
+            return absl::DataLossError( "failed while writing archive data" );
+
+        return absl::OkStatus();
+    }
+
+    // compress and write a block; the payload is prefixed with any strings first seen while building these columns
+    absl::Status writeBlock( const BlockType blockType, const uint32_t rowCount, const jamslice::ColumnWriter& columns )
+    {
+        jamslice::ColumnWriter payload;
+        payload.m_buffer.reserve( columns.m_buffer.size() + 1024 );
+
+        const uint32_t newStringCount = static_cast<uint32_t>( m_dictionary.m_pending.size() );
+        payload.column( &newStringCount, 1 );
+        payload.strings( m_dictionary.m_pending.begin(), m_dictionary.m_pending.end(), []( const std::string& text ) -> const std::string& { return text; } );
+        m_dictionary.m_pending.clear();
+
+        // data columns were aligned relative to their own buffer, so start them on an aligned offset to keep that true
+        payload.m_buffer.resize( jamslice::alignColumn( payload.m_buffer.size() ), 0 );
+        payload.m_buffer.insert( payload.m_buffer.end(), columns.m_buffer.begin(), columns.m_buffer.end() );
+
+        const std::size_t compressedCapacity = ZSTD_compressBound( payload.m_buffer.size() );
+        m_compressed.resize( compressedCapacity );
+
+        const std::size_t compressedBytes = ZSTD_compress2( m_compressionContext, m_compressed.data(), compressedCapacity, payload.m_buffer.data(), payload.m_buffer.size() );
+        if ( ZSTD_isError( compressedBytes ) )
+        {
+            return absl::InternalError( fmt::format( FMTX( "zstd compression failed, {}" ), ZSTD_getErrorName( compressedBytes ) ) );
+        }
+
+        const BlockHeader blockHeader{ blockType, rowCount, payload.m_buffer.size(), compressedBytes };
+
+        if ( const auto headerStatus = writeRaw( &blockHeader, sizeof( BlockHeader ) ); !headerStatus.ok() )
+            return headerStatus;
+
+        return writeRaw( m_compressed.data(), compressedBytes );
+    }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct ArchiveReader
+{
+    std::basic_ifstream<char>   m_input;
+    std::vector< std::string >  m_strings{ std::string() };
+    std::vector< char >         m_compressed;
+    std::vector< char >         m_payload;
+
+    absl::Status readRaw( void* data, const std::size_t bytes )
+    {
+        m_input.read( static_cast<char*>( data ), bytes );
+        if ( !m_input.good() )
+            return absl::DataLossError( "archive data truncated" );
+
+        return absl::OkStatus();
+    }
+
+    // returns false for an index that isn't in the dictionary (yet); results are handed out as C strings, ready for binding
+    bool lookup( const uint32_t index, const char*& result ) const
+    {
+        if ( index >= m_strings.size() )
+            return false;
+
+        result = m_strings[index].c_str();
+        return true;
+    }
+
+    // decompress a block body and absorb the strings it introduces; the returned reader is left at the first data column
+    absl::StatusOr< jamslice::ColumnReader > readBlock( const BlockHeader& blockHeader )
+    {
+        if ( blockHeader.m_rawBytes > cMaximumBlockBytes || blockHeader.m_storedBytes > cMaximumBlockBytes || blockHeader.m_rowCount > cRowsPerBlock )
+        {
+            return absl::DataLossError( fmt::format( FMTX( "block size out of range ({} bytes, {} rows)" ), blockHeader.m_rawBytes, blockHeader.m_rowCount ) );
+        }
+
+        m_compressed.resize( blockHeader.m_storedBytes );
+        m_payload.resize( blockHeader.m_rawBytes );
+
+        if ( const auto readStatus = readRaw( m_compressed.data(), m_compressed.size() ); !readStatus.ok() )
+            return readStatus;
+
+        const std::size_t decompressedBytes = ZSTD_decompress( m_payload.data(), m_payload.size(), m_compressed.data(), m_compressed.size() );
+        if ( ZSTD_isError( decompressedBytes ) )
+        {
+            return absl::DataLossError( fmt::format( FMTX( "zstd decompression failed, {}" ), ZSTD_getErrorName( decompressedBytes ) ) );
+        }
+        if ( decompressedBytes != m_payload.size() )
+        {
+            return absl::DataLossError( fmt::format( FMTX( "block decompressed to {} bytes, expected {}" ), decompressedBytes, m_payload.size() ) );
+        }
+
+        jamslice::ColumnReader reader{ m_payload.data(), m_payload.size() };
+
+        const uint32_t* newStringCount = reader.column< uint32_t >( 1 );
+        if ( newStringCount == nullptr || *newStringCount >= m_payload.size() )
+            return absl::DataLossError( "damaged block string table" );
+
+        const uint32_t* stringOffsets = reader.column< uint32_t >( *newStringCount + 1 );
+        if ( stringOffsets == nullptr )
+            return absl::DataLossError( "damaged block string table" );
+
+        const uint32_t stringBytes = stringOffsets[*newStringCount];
+        const char* stringText = reader.column< char >( stringBytes );
+        if ( stringText == nullptr )
+            return absl::DataLossError( "damaged block string table" );
+
+        m_strings.reserve( m_strings.size() + *newStringCount );
+        for ( uint32_t stringI = 0; stringI < *newStringCount; stringI++ )
+        {
+            if ( stringOffsets[stringI] > stringOffsets[stringI + 1] || stringOffsets[stringI + 1] > stringBytes )
+                return absl::DataLossError( "damaged block string table" );
+
+            m_strings.emplace_back( stringText + stringOffsets[stringI], stringOffsets[stringI + 1] - stringOffsets[stringI] );
+        }
+
+        reader.m_offset = jamslice::alignColumn( reader.m_offset );
+        return reader;
+    }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct WriteResult
+{
+    std::size_t     m_riffCount         = 0;
+    std::size_t     m_stemCount         = 0;
+    std::size_t     m_bundledTarBytes   = 0;
+};
+
+// write the database records for a jam out to an archive file; if stemDirectory is not empty and exists, it is bundled
+// into the archive as a TAR
+absl::StatusOr< WriteResult > write(
+    const fs::path& archiveFile,
+    const types::JamCouchID& jamCID,
+    const std::string_view jamName,
+    const fs::path& stemDirectory )
+{
+    static constexpr char _sqlExportRiffs[] = R"(
+        select RiffCID,
+               AppVersion is not null,
+               coalesce( UserName,     '' ),
+               coalesce( CreationTime, 0 ),
+               coalesce( Root,         0 ),
+               coalesce( Scale,        0 ),
+               coalesce( BPS,          0 ),
+               coalesce( BPMrnd,       0 ),
+               coalesce( BarLength,    0 ),
+               coalesce( AppVersion,   0 ),
+               coalesce( Magnitude,    0 ),
+               coalesce( StemCID_1,    '' ),
+               coalesce( StemCID_2,    '' ),
+               coalesce( StemCID_3,    '' ),
+               coalesce( StemCID_4,    '' ),
+               coalesce( StemCID_5,    '' ),
+               coalesce( StemCID_6,    '' ),
+               coalesce( StemCID_7,    '' ),
+               coalesce( StemCID_8,    '' ),
+               coalesce( GainsJSON,    '' )
+            from riffs where OwnerJamCID = ?1 order by CreationTime asc;
+    )";
+
+    static constexpr char _sqlExportStems[] = R"(
+        select StemCID,
+               CreationTime is not null,
+               coalesce( CreationTime,    0 ),
+               coalesce( FileEndpoint,    '' ),
+               coalesce( FileBucket,      '' ),
+               coalesce( FileKey,         '' ),
+               coalesce( FileMIME,        '' ),
+               coalesce( FileLength,      0 ),
+               coalesce( BPS,             0 ),
+               coalesce( BPMrnd,          0 ),
+               coalesce( Instrument,      0 ),
+               coalesce( Length16s,       0 ),
+               coalesce( OriginalPitch,   0 ),
+               coalesce( BarLength,       0 ),
+               coalesce( PresetName,      '' ),
+               coalesce( CreatorUserName, '' ),
+               coalesce( SampleRate,      0 ),
+               coalesce( PrimaryColour,   '' )
+            from stems where OwnerJamCID = ?1 order by CreationTime asc;
+    )";
+
+    WriteResult result;
+
+    // write to a temporary file and then swap it into place, a failed export shouldn't leave a plausible-looking archive
+    fs::path archiveFileTemp = archiveFile;
+    archiveFileTemp += ".tmp";
+
+    absl::Cleanup removeTempOnFailure = [&]() noexcept
+        {
+            std::error_code removeError;
+            fs::remove( archiveFileTemp, removeError );
+        };
+
+    ArchiveWriter writer;
+    writer.m_output.open( archiveFileTemp, std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( !writer.m_output.is_open() )
+    {
+        return absl::PermissionDeniedError( fmt::format( FMTX( "unable to open [{}] for writing" ), archiveFileTemp.string() ) );
+    }
+
+#define RETURN_IF_FAILED( _expr )                                       \
+    if ( const absl::Status _status = ( _expr ); !_status.ok() )        \
+        return _status;
+
+    {
+        Header header;
+        header.m_exportTimeUnix = spacetime::getUnixTimeNow().count();
+        RETURN_IF_FAILED( writer.writeRaw( &header, sizeof( Header ) ) );
+
+        const std::array< uint32_t, 3 > metaStrings{
+            writer.m_dictionary.intern( jamCID.value() ),
+            writer.m_dictionary.intern( jamName ),
+            writer.m_dictionary.intern( OURO_FRAMEWORK_VERSION ) };
+
+        jamslice::ColumnWriter columns;
+        columns.column( metaStrings.data(), metaStrings.size() );
+        RETURN_IF_FAILED( writer.writeBlock( BlockType::Meta, 0, columns ) );
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------
+    {
+        std::vector< RiffRow > rows;
+        rows.reserve( cRowsPerBlock );
+
+        const auto flushRows = [&]() -> absl::Status
+            {
+                if ( rows.empty() )
+                    return absl::OkStatus();
+
+                jamslice::ColumnWriter columns;
+                writeColumns( columns, rows, cRiffColumns );
+
+                result.m_riffCount += rows.size();
+                const uint32_t rowCount = static_cast<uint32_t>( rows.size() );
+                rows.clear();
+
+                return writer.writeBlock( BlockType::Riffs, rowCount, columns );
+            };
+
+        auto query = Warehouse::SqlDB::query<_sqlExportRiffs>( jamCID.value() );
+
+        std::string_view riffCID, userName, gainsJson;
+        std::array< std::string_view, 8 > stemCIDs;
+        int32_t populated;
+        uint32_t root, scale;
+
+        RiffRow row;
+        while ( query( riffCID, populated, userName, row.m_creationTime, root, scale, row.m_bps, row.m_bpmRnd, row.m_barLength, row.m_appVersion, row.m_magnitude,
+                       stemCIDs[0], stemCIDs[1], stemCIDs[2], stemCIDs[3], stemCIDs[4], stemCIDs[5], stemCIDs[6], stemCIDs[7], gainsJson ) )
+        {
+            row.m_id    = writer.m_dictionary.intern( riffCID );
+            row.m_user  = writer.m_dictionary.intern( userName );
+            row.m_root  = static_cast<uint8_t>( root );
+            row.m_scale = static_cast<uint8_t>( scale );
+            row.m_flags = ( populated != 0 ) ? cRowPopulated : 0;
+
+            for ( std::size_t stemI = 0; stemI < 8; stemI++ )
+                row.m_stems[stemI] = writer.m_dictionary.intern( stemCIDs[stemI] );
+
+            row.m_gains.fill( 0 );
+            if ( !gainsJson.empty() )
+            {
+                try
+                {
+                    // const operator[] doesn't bounds-check; anything short or oddly shaped leaves the remaining gains at 0
+                    const nlohmann::json gains = nlohmann::json::parse( gainsJson );
+                    if ( gains.is_array() )
+                    {
+                        const std::size_t gainCount = std::min< std::size_t >( gains.size(), 8 );
+                        for ( std::size_t stemI = 0; stemI < gainCount; stemI++ )
+                            row.m_gains[stemI] = gains.at( stemI ).get<float>();
+                    }
+                }
+                catch ( const nlohmann::json::exception& je )
+                {
+                    return absl::DataLossError( fmt::format( FMTX( "unable to parse gains for [R:{}], {}" ), riffCID, je.what() ) );
+                }
+            }
+
+            rows.emplace_back( row );
+
+            if ( rows.size() >= cRowsPerBlock )
+                RETURN_IF_FAILED( flushRows() );
+        }
+        RETURN_IF_FAILED( flushRows() );
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------
+    {
+        std::vector< StemRow > rows;
+        rows.reserve( cRowsPerBlock );
+
+        const auto flushRows = [&]() -> absl::Status
+            {
+                if ( rows.empty() )
+                    return absl::OkStatus();
+
+                jamslice::ColumnWriter columns;
+                writeColumns( columns, rows, cStemColumns );
+
+                result.m_stemCount += rows.size();
+                const uint32_t rowCount = static_cast<uint32_t>( rows.size() );
+                rows.clear();
+
+                return writer.writeBlock( BlockType::Stems, rowCount, columns );
+            };
+
+        auto query = Warehouse::SqlDB::query<_sqlExportStems>( jamCID.value() );
+
+        std::string_view stemCID, fileEndpoint, fileBucket, fileKey, fileMIME, presetName, userName, colour;
+        int32_t populated, instrument;
+
+        StemRow row;
+        while ( query( stemCID, populated, row.m_creationTime, fileEndpoint, fileBucket, fileKey, fileMIME, row.m_fileLength, row.m_bps, row.m_bpmRnd, instrument,
+                       row.m_length16s, row.m_originalPitch, row.m_barLength, presetName, userName, row.m_sampleRate, colour ) )
+        {
+            row.m_id            = writer.m_dictionary.intern( stemCID );
+            row.m_fileEndpoint  = writer.m_dictionary.intern( fileEndpoint );
+            row.m_fileBucket    = writer.m_dictionary.intern( fileBucket );
+            row.m_fileKey       = writer.m_dictionary.intern( fileKey );
+            row.m_fileMIME      = writer.m_dictionary.intern( fileMIME );
+            row.m_preset        = writer.m_dictionary.intern( presetName );
+            row.m_user          = writer.m_dictionary.intern( userName );
+            row.m_colour        = writer.m_dictionary.intern( colour );
+            row.m_instrument    = static_cast<uint8_t>( instrument );
+            row.m_flags         = ( populated != 0 ) ? cRowPopulated : 0;
+
+            rows.emplace_back( row );
+
+            if ( rows.size() >= cRowsPerBlock )
+                RETURN_IF_FAILED( flushRows() );
+        }
+        RETURN_IF_FAILED( flushRows() );
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // stem files go in verbatim; they're already compressed audio, zstd would only be burning time on them
+    std::error_code stemDirectoryError;
+    if ( !stemDirectory.empty() && fs::is_directory( stemDirectory, stemDirectoryError ) )
+    {
+        fs::path tarStagingFile = archiveFile;
+        tarStagingFile += ".tar.tmp";
+
+        absl::Cleanup removeStagingOnExit = [&]() noexcept
+            {
+                std::error_code removeError;
+                fs::remove( tarStagingFile, removeError );
+            };
+
+        RETURN_IF_FAILED( io::archiveFilesInDirectoryToTAR( stemDirectory, tarStagingFile, nullptr ) );
+
+        std::error_code sizeError;
+        const auto tarBytes = fs::file_size( tarStagingFile, sizeError );
+        if ( sizeError )
+        {
+            return absl::InternalError( fmt::format( FMTX( "unable to stat [{}], {}" ), tarStagingFile.string(), sizeError.message() ) );
+        }
+
+        const BlockHeader blockHeader{ BlockType::Tar, 0, tarBytes, tarBytes };
+        RETURN_IF_FAILED( writer.writeRaw( &blockHeader, sizeof( BlockHeader ) ) );
+
+        std::basic_ifstream<char> tarInput( tarStagingFile, std::ios::in | std::ios::binary );
+        if ( !tarInput.is_open() )
+        {
+            return absl::NotFoundError( fmt::format( FMTX( "unable to open [{}]" ), tarStagingFile.string() ) );
+        }
+
+        std::vector< char > ioBuffer( 1 * 1024 * 1024 );
+        std::size_t bytesRemaining = tarBytes;
+        while ( bytesRemaining > 0 )
+        {
+            const std::size_t chunkBytes = std::min( bytesRemaining, ioBuffer.size() );
+            if ( !tarInput.read( ioBuffer.data(), chunkBytes ) )
+            {
+                return absl::DataLossError( fmt::format( FMTX( "failed while reading [{}]" ), tarStagingFile.string() ) );
+            }
+            RETURN_IF_FAILED( writer.writeRaw( ioBuffer.data(), chunkBytes ) );
+
+            bytesRemaining -= chunkBytes;
+        }
+
+        result.m_bundledTarBytes = tarBytes;
+    }
+
+    {
+        const std::array< uint32_t, 2 > totals{ static_cast<uint32_t>( result.m_riffCount ), static_cast<uint32_t>( result.m_stemCount ) };
+
+        jamslice::ColumnWriter columns;
+        columns.column( totals.data(), totals.size() );
+        RETURN_IF_FAILED( writer.writeBlock( BlockType::End, 0, columns ) );
+    }
+
+#undef RETURN_IF_FAILED
+
+    writer.m_output.close();
+
+    std::error_code renameError;
+    fs::rename( archiveFileTemp, archiveFile, renameError );
+    if ( renameError )
+    {
+        return absl::AbortedError( fmt::format( FMTX( "unable to move [{}] into place, {}" ), archiveFile.string(), renameError.message() ) );
+    }
+
+    std::move( removeTempOnFailure ).Cancel();
+    return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// true if the file starts with the archive magic number; used to tell binary archives from YAML exports on import
+bool isArchive( const fs::path& archiveFile )
+{
+    std::basic_ifstream<char> ifs( archiveFile, std::ios::in | std::ios::binary );
+    if ( !ifs.is_open() )
+        return false;
+
+    uint32_t magic = 0;
+    ifs.read( reinterpret_cast<char*>( &magic ), sizeof( magic ) );
+
+    return ifs.good() && magic == Header::cMagic;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+struct ReadResult
+{
+    types::JamCouchID   m_jamCID;
+    std::string         m_jamName;
+    std::string         m_exportVersion;
+    uint64_t            m_exportTimeUnix    = 0;
+    std::size_t         m_riffCount         = 0;
+    std::size_t         m_stemCount         = 0;
+    bool                m_stemsExtracted    = false;
+};
+
+// stream an archive into the database, block by block; expects to be called inside a transaction, which the caller
+// should roll back if this fails. bundled stems are unpacked under stemCacheRoot, or skipped if that is empty
+absl::StatusOr< ReadResult > read( const fs::path& archiveFile, const fs::path& stemCacheRoot )
+{
+    static constexpr char _sqlInjectRiff[] = R"(
+        INSERT OR IGNORE INTO riffs(
+            riffCID,
+            OwnerJamCID ) VALUES( ?1, ?2 );
+    )";
+
+    static constexpr char _sqlPopulateRiff[] = R"(
+        UPDATE riffs SET
+            CreationTime=?2,
+            Root=?3,
+            Scale=?4,
+            BPS=?5,
+            BPMrnd=?6,
+            BarLength=?7,
+            AppVersion=?8,
+            Magnitude=?9,
+            UserName=?10,
+            StemCID_1=?11,
+            StemCID_2=?12,
+            StemCID_3=?13,
+            StemCID_4=?14,
+            StemCID_5=?15,
+            StemCID_6=?16,
+            StemCID_7=?17,
+            StemCID_8=?18,
+            GainsJSON=?19
+            WHERE riffCID=?1
+    )";
+
+    static constexpr char _sqlInjectStem[] = R"(
+        INSERT OR IGNORE INTO stems(
+            stemCID, OwnerJamCID ) VALUES( ?1, ?2 );
+    )";
+
+    static constexpr char _sqlPopulateStem[] = R"(
+        UPDATE stems SET
+            CreationTime=?2,
+            FileEndpoint=?3,
+            FileBucket=?4,
+            FileKey=?5,
+            FileMIME=?6,
+            FileLength=?7,
+            BPS=?8,
+            BPMrnd=?9,
+            Instrument=?10,
+            Length16s=?11,
+            OriginalPitch=?12,
+            BarLength=?13,
+            PresetName=?14,
+            CreatorUserName=?15,
+            SampleRate=?16,
+            PrimaryColour=?17
+            WHERE stemCID=?1
+    )";
+
+    ReadResult result;
+
+    ArchiveReader reader;
+    reader.m_input.open( archiveFile, std::ios::in | std::ios::binary );
+    if ( !reader.m_input.is_open() )
+    {
+        return absl::NotFoundError( fmt::format( FMTX( "unable to open [{}]" ), archiveFile.string() ) );
+    }
+
+#define RETURN_IF_FAILED( _expr )                                       \
+    if ( const absl::Status _status = ( _expr ); !_status.ok() )        \
+        return _status;
+
+    const auto damaged = [&]( const std::string_view what )
+        {
+            return absl::DataLossError( fmt::format( FMTX( "{} in [{}]" ), what, archiveFile.string() ) );
+        };
+
+    {
+        Header header;
+        RETURN_IF_FAILED( reader.readRaw( &header, sizeof( Header ) ) );
+
+        if ( header.m_magic != Header::cMagic )
+            return absl::InvalidArgumentError( fmt::format( FMTX( "[{}] is not a jam archive" ), archiveFile.string() ) );
+        if ( header.m_version != Header::cVersion )
+            return absl::UnimplementedError( fmt::format( FMTX( "[{}] is archive version {}, only version {} is supported" ), archiveFile.string(), header.m_version, Header::cVersion ) );
+
+        result.m_exportTimeUnix = header.m_exportTimeUnix;
+    }
+
+    std::string jamCID;
+    std::vector< RiffRow > riffRows;
+    std::vector< StemRow > stemRows;
+
+    bool bEndReached = false;
+    while ( !bEndReached )
+    {
+        BlockHeader blockHeader;
+        RETURN_IF_FAILED( reader.readRaw( &blockHeader, sizeof( BlockHeader ) ) );
+
+        // TAR blocks don't go through the dictionary, deal with them before anything tries to decompress them
+        if ( blockHeader.m_type == BlockType::Tar )
+        {
+            if ( stemCacheRoot.empty() )
+            {
+                reader.m_input.seekg( static_cast<std::streamoff>( blockHeader.m_storedBytes ), std::ios::cur );
+                continue;
+            }
+
+            fs::path tarStagingFile = stemCacheRoot / fmt::format( FMTX( "{}.import.tar.tmp" ), jamCID );
+
+            absl::Cleanup removeStagingOnExit = [&]() noexcept
+                {
+                    std::error_code removeError;
+                    fs::remove( tarStagingFile, removeError );
+                };
+            {
+                std::basic_ofstream<char> tarOutput( tarStagingFile, std::ios::out | std::ios::binary | std::ios::trunc );
+                if ( !tarOutput.is_open() )
+                {
+                    return absl::PermissionDeniedError( fmt::format( FMTX( "unable to open [{}] for writing" ), tarStagingFile.string() ) );
+                }
+
+                std::vector< char > ioBuffer( 1 * 1024 * 1024 );
+                std::size_t bytesRemaining = blockHeader.m_storedBytes;
+                while ( bytesRemaining > 0 )
+                {
+                    const std::size_t chunkBytes = std::min( bytesRemaining, ioBuffer.size() );
+                    RETURN_IF_FAILED( reader.readRaw( ioBuffer.data(), chunkBytes ) );
+
+                    tarOutput.write( ioBuffer.data(), chunkBytes );
+                    bytesRemaining -= chunkBytes;
+                }
+            }
+
+            RETURN_IF_FAILED( io::unarchiveTARIntoDirectory( tarStagingFile, stemCacheRoot, nullptr ) );
+            result.m_stemsExtracted = true;
+            continue;
+        }
+
+        auto blockReader = reader.readBlock( blockHeader );
+        if ( !blockReader.ok() )
+            return blockReader.status();
+
+        switch ( blockHeader.m_type )
+        {
+            case BlockType::Meta:
+            {
+                const uint32_t* metaStrings = blockReader->column< uint32_t >( 3 );
+                const char* jamCIDText  = nullptr;
+                const char* jamNameText = nullptr;
+                const char* versionText = nullptr;
+
+                if ( metaStrings == nullptr ||
+                     !reader.lookup( metaStrings[0], jamCIDText ) ||
+                     !reader.lookup( metaStrings[1], jamNameText ) ||
+                     !reader.lookup( metaStrings[2], versionText ) ||
+                     jamCIDText[0] == '\0' )
+                {
+                    return damaged( "invalid metadata block" );
+                }
+
+                jamCID                  = jamCIDText;
+                result.m_jamCID         = types::JamCouchID{ jamCID };
+                result.m_jamName        = jamNameText;
+                result.m_exportVersion  = versionText;
+            }
+            break;
+
+            case BlockType::Riffs:
+            {
+                if ( jamCID.empty() )
+                    return damaged( "riff data before metadata" );
+
+                riffRows.resize( blockHeader.m_rowCount );
+                if ( !readColumns( blockReader.value(), riffRows, cRiffColumns ) )
+                    return damaged( "riff columns overrun block" );
+
+                const char* riffCID  = nullptr;
+                const char* userName = nullptr;
+                std::array< const char*, 8 > stemCIDs;
+
+                for ( const RiffRow& row : riffRows )
+                {
+                    if ( !reader.lookup( row.m_id, riffCID ) || !reader.lookup( row.m_user, userName ) )
+                        return damaged( "invalid riff string index" );
+
+                    for ( std::size_t stemI = 0; stemI < 8; stemI++ )
+                    {
+                        if ( !reader.lookup( row.m_stems[stemI], stemCIDs[stemI] ) )
+                            return damaged( "invalid riff stem index" );
+                    }
+
+                    Warehouse::SqlDB::query<_sqlInjectRiff>( riffCID, jamCID );
+
+                    if ( ( row.m_flags & cRowPopulated ) == 0 )
+                        continue;
+
+                    const auto gainsJsonText = fmt::format( R"([ {} ])", fmt::join( row.m_gains, ", " ) );
+
+                    Warehouse::SqlDB::query<_sqlPopulateRiff>(
+                        riffCID,
+                        row.m_creationTime,
+                        static_cast<uint32_t>( row.m_root ),
+                        static_cast<uint32_t>( row.m_scale ),
+                        row.m_bps,
+                        row.m_bpmRnd,
+                        row.m_barLength,
+                        row.m_appVersion,
+                        row.m_magnitude,
+                        userName,
+                        stemCIDs[0],
+                        stemCIDs[1],
+                        stemCIDs[2],
+                        stemCIDs[3],
+                        stemCIDs[4],
+                        stemCIDs[5],
+                        stemCIDs[6],
+                        stemCIDs[7],
+                        gainsJsonText
+                    );
+                }
+                result.m_riffCount += riffRows.size();
+            }
+            break;
+
+            case BlockType::Stems:
+            {
+                if ( jamCID.empty() )
+                    return damaged( "stem data before metadata" );
+
+                stemRows.resize( blockHeader.m_rowCount );
+                if ( !readColumns( blockReader.value(), stemRows, cStemColumns ) )
+                    return damaged( "stem columns overrun block" );
+
+                const char* stemCID      = nullptr;
+                const char* fileEndpoint = nullptr;
+                const char* fileBucket   = nullptr;
+                const char* fileKey      = nullptr;
+                const char* fileMIME     = nullptr;
+                const char* presetName   = nullptr;
+                const char* userName     = nullptr;
+                const char* colour       = nullptr;
+
+                for ( const StemRow& row : stemRows )
+                {
+                    if ( !reader.lookup( row.m_id,           stemCID      ) ||
+                         !reader.lookup( row.m_fileEndpoint, fileEndpoint ) ||
+                         !reader.lookup( row.m_fileBucket,   fileBucket   ) ||
+                         !reader.lookup( row.m_fileKey,      fileKey      ) ||
+                         !reader.lookup( row.m_fileMIME,     fileMIME     ) ||
+                         !reader.lookup( row.m_preset,       presetName   ) ||
+                         !reader.lookup( row.m_user,         userName     ) ||
+                         !reader.lookup( row.m_colour,       colour       ) )
+                    {
+                        return damaged( "invalid stem string index" );
+                    }
+
+                    Warehouse::SqlDB::query<_sqlInjectStem>( stemCID, jamCID );
+
+                    if ( ( row.m_flags & cRowPopulated ) == 0 )
+                        continue;
+
+                    Warehouse::SqlDB::query<_sqlPopulateStem>(
+                        stemCID,
+                        row.m_creationTime,
+                        fileEndpoint,
+                        fileBucket,
+                        fileKey,
+                        fileMIME,
+                        row.m_fileLength,
+                        row.m_bps,
+                        row.m_bpmRnd,
+                        static_cast<int32_t>( row.m_instrument ),
+                        row.m_length16s,
+                        row.m_originalPitch,
+                        row.m_barLength,
+                        presetName,
+                        userName,
+                        row.m_sampleRate,
+                        colour
+                    );
+                }
+                result.m_stemCount += stemRows.size();
+            }
+            break;
+
+            case BlockType::End:
+            {
+                const uint32_t* totals = blockReader->column< uint32_t >( 2 );
+                if ( totals == nullptr || totals[0] != result.m_riffCount || totals[1] != result.m_stemCount )
+                    return damaged( "row totals mismatch" );
+
+                bEndReached = true;
+            }
+            break;
+
+            default:
+                return damaged( fmt::format( FMTX( "unknown block type {:08x}" ), static_cast<uint32_t>( blockHeader.m_type ) ) );
+        }
+    }
+
+#undef RETURN_IF_FAILED
+
+    return result;
+}
+
+} // namespace jamarchive
+
+// ---------------------------------------------------------------------------------------------------------------------
+// in-memory index of all populated riffs, bucketed by rounded BPM and packed root/scale; this lets the procedural tools
+// count and pick riffs without running a GROUP BY / ORDER BY SEEDED_RANDOM() across the entire riffs table each time.
+// built once on the worker thread at startup then kept current by the tasks that modify riff data
+//
+struct Warehouse::HarmonicIndex
+{
+    using BucketKey = uint32_t;     // ( rounded BPM << 16 ) | ( root << 8 ) | scale
+    using RowID     = uint32_t;     // sqlite rowid of the riff
+    using JamIndex  = uint32_t;     // index into m_jamIDs
+
+    static constexpr BucketKey makeBucketKey( const int64_t bpm, const int64_t rootScale )
+    {
+        return ( static_cast<uint32_t>( std::clamp< int64_t >( bpm, 0, 0xFFFF ) ) << 16 ) | static_cast<uint32_t>( rootScale & 0xFFFF );
+    }
+    static constexpr uint32_t getBPM( const BucketKey key ) { return key >> 16; }
+    static constexpr uint32_t getRootScale( const BucketKey key ) { return key & 0xFFFF; }
+
+    struct Bucket
+    {
+        std::vector< RowID >                        m_rowIDs;       // kept sorted so that picks don't depend on insertion history
+        std::vector< JamIndex >                     m_jams;         // parallel to m_rowIDs
+        absl::flat_hash_map< JamIndex, uint32_t >   m_jamCounts;    // riffs-per-jam in this bucket, for distinct jam counts
+    };
+
+    // a single riff row as pulled from the database, ready to be inserted
+    struct Row
+    {
+        RowID           m_rowID;
+        BucketKey       m_key;
+        std::string     m_jamCID;
+    };
+    using Rows = std::vector< Row >;
+
+
+    ouro_nodiscard bool isReady() const { return m_ready; }
+
+    // full rebuild from the riffs table
+    void build();
+
+    // re-read the given riffs / every riff in a jam and update their entries
+    void upsertRiffs( const std::vector< types::RiffCouchID >& riffCIDs );
+    void refreshJam( const types::JamCouchID& jamCID );
+
+    // drop everything owned by the given jam, to be called after its riffs are deleted
+    void removeJam( const types::JamCouchID& jamCID );
+
+    std::size_t countByBPM( const endlesss::constants::RootScalePairs& keySearchPairs, const BPMCountSort sortOn, std::vector< BPMCountTuple >& bpmCounts ) const;
+
+    // deterministic pick from all non-virtual riffs matching the search; the same seed against the same index contents
+    // always returns the same riff
+    std::optional< RowID > pickBySeed( const endlesss::constants::RootScalePairs& keySearchPairs, const uint32_t BPM, const int32_t seedValue ) const;
+
+private:
+
+    using RootScaleSet = absl::InlinedVector< uint32_t, 16 >;
+
+    // returns false for NoRules, meaning any root/scale is a match
+    static bool buildRootScaleSet( const endlesss::constants::RootScalePairs& keySearchPairs, RootScaleSet& rootScales );
+
+    void applyRows( const Rows& rows );
+
+    // all require m_lock held exclusively
+    JamIndex getOrAddJam( const std::string_view jamCID );
+    void insertUnlocked( const RowID rowID, const BucketKey key, const JamIndex jam );
+    void eraseUnlocked( const RowID rowID );
+
+    mutable std::shared_mutex                           m_lock;
+    std::atomic_bool                                    m_ready = false;
+
+    absl::flat_hash_map< BucketKey, Bucket >            m_buckets;
+    absl::flat_hash_map< RowID, BucketKey >             m_rowLocations;
+
+    std::vector< types::JamCouchID >                    m_jamIDs;
+    absl::flat_hash_map< types::JamCouchID, JamIndex >  m_jamLookup;
+};
+
+namespace harmonic {
+
+static constexpr char _sqlIndexAllRiffs[] = R"(
+    select rowid,
+           cast( round(BPMrnd) as integer ),
+           ( ( root << 8 ) | scale ),
+           OwnerJamCID
+    from riffs
+    where BPMrnd is not null
+    order by rowid;
+)";
+static constexpr char _sqlIndexRiffByID[] = R"(
+    select rowid,
+           cast( round(BPMrnd) as integer ),
+           ( ( root << 8 ) | scale ),
+           OwnerJamCID
+    from riffs
+    where RiffCID is ?1 and BPMrnd is not null;
+)";
+static constexpr char _sqlIndexRiffsInJam[] = R"(
+    select rowid,
+           cast( round(BPMrnd) as integer ),
+           ( ( root << 8 ) | scale ),
+           OwnerJamCID
+    from riffs
+    where OwnerJamCID is ?1 and BPMrnd is not null;
+)";
+
+template< typename _QueryResult >
+inline void collectRows( _QueryResult& query, Warehouse::HarmonicIndex::Rows& rows )
+{
+    int64_t             rowID;
+    int64_t             bpm;
+    int64_t             rootScale;
+    std::string_view    jamCID;
+
+    while ( query( rowID, bpm, rootScale, jamCID ) )
+    {
+        ABSL_ASSERT( rowID > 0 && rowID <= std::numeric_limits< uint32_t >::max() );
+
+        rows.emplace_back( Warehouse::HarmonicIndex::Row{
+            static_cast<Warehouse::HarmonicIndex::RowID>( rowID ),
+            Warehouse::HarmonicIndex::makeBucketKey( bpm, rootScale ),
+            std::string( jamCID ) } );
+    }
+}
+
+} // namespace harmonic
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::HarmonicIndex::build()
+{
+    spacetime::ScopedTimer indexTiming( "HarmonicIndex::build" );
+
+    std::size_t riffsIndexed = 0;
+    {
+        // readers don't touch the index until m_ready is set, so holding this for the duration of the scan is fine
+        std::unique_lock< std::shared_mutex > indexLock( m_lock );
+
+        m_buckets.clear();
+        m_rowLocations.clear();
+        m_jamIDs.clear();
+        m_jamLookup.clear();
+
+        int64_t             rowID;
+        int64_t             bpm;
+        int64_t             rootScale;
+        std::string_view    jamCID;
+
+        // riffs from the same jam tend to arrive together, avoid a jam lookup per row where we can
+        std::string         previousJamCID;
+        JamIndex            previousJam = 0;
+
+        // rows arrive in rowid order, so each bucket can just be appended to
+        auto query = Warehouse::SqlDB::query<harmonic::_sqlIndexAllRiffs>();
+        while ( query( rowID, bpm, rootScale, jamCID ) )
+        {
+            if ( riffsIndexed == 0 || jamCID != previousJamCID )
+            {
+                previousJamCID = jamCID;
+                previousJam    = getOrAddJam( jamCID );
+            }
+
+            const BucketKey key = makeBucketKey( bpm, rootScale );
+
+            Bucket& bucket = m_buckets[key];
+            bucket.m_rowIDs.push_back( static_cast<RowID>( rowID ) );
+            bucket.m_jams.push_back( previousJam );
+            bucket.m_jamCounts[previousJam]++;
+
+            m_rowLocations.insert_or_assign( static_cast<RowID>( rowID ), key );
+
+            riffsIndexed++;
+        }
+
+        blog::database( FMTX( "harmonic index built; {} riffs across {} buckets, {} jams" ), riffsIndexed, m_buckets.size(), m_jamIDs.size() );
+    }
+    m_ready = true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::HarmonicIndex::upsertRiffs( const std::vector< types::RiffCouchID >& riffCIDs )
+{
+    if ( !m_ready )
+        return;
+
+    Rows rows;
+    rows.reserve( riffCIDs.size() );
+    for ( const auto& riffCID : riffCIDs )
+    {
+        auto query = Warehouse::SqlDB::query<harmonic::_sqlIndexRiffByID>( riffCID.value() );
+        harmonic::collectRows( query, rows );
+    }
+
+    applyRows( rows );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::HarmonicIndex::refreshJam( const types::JamCouchID& jamCID )
+{
+    if ( !m_ready )
+        return;
+
+    Rows rows;
+    {
+        auto query = Warehouse::SqlDB::query<harmonic::_sqlIndexRiffsInJam>( jamCID.value() );
+        harmonic::collectRows( query, rows );
+    }
+
+    applyRows( rows );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::HarmonicIndex::applyRows( const Rows& rows )
+{
+    if ( rows.empty() )
+        return;
+
+    std::unique_lock< std::shared_mutex > indexLock( m_lock );
+
+    for ( const Row& row : rows )
+    {
+        insertUnlocked( row.m_rowID, row.m_key, getOrAddJam( row.m_jamCID ) );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::HarmonicIndex::removeJam( const types::JamCouchID& jamCID )
+{
+    if ( !m_ready )
+        return;
+
+    std::unique_lock< std::shared_mutex > indexLock( m_lock );
+
+    const auto jamIt = m_jamLookup.find( jamCID );
+    if ( jamIt == m_jamLookup.end() )
+        return;
+
+    const JamIndex jamToRemove = jamIt->second;
+
+    // this walks the whole index, but purges are rare
+    for ( auto bucketIt = m_buckets.begin(); bucketIt != m_buckets.end(); )
+    {
+        Bucket& bucket = bucketIt->second;
+        if ( bucket.m_jamCounts.erase( jamToRemove ) > 0 )
+        {
+            std::size_t writeI = 0;
+            for ( std::size_t readI = 0; readI < bucket.m_rowIDs.size(); readI++ )
+            {
+                if ( bucket.m_jams[readI] == jamToRemove )
+                {
+                    m_rowLocations.erase( bucket.m_rowIDs[readI] );
+                    continue;
+                }
+                bucket.m_rowIDs[writeI] = bucket.m_rowIDs[readI];
+                bucket.m_jams[writeI]   = bucket.m_jams[readI];
+                writeI++;
+            }
+            bucket.m_rowIDs.resize( writeI );
+            bucket.m_jams.resize( writeI );
+        }
+
+        if ( bucket.m_rowIDs.empty() )
+            m_buckets.erase( bucketIt++ );
+        else
+            ++bucketIt;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Warehouse::HarmonicIndex::JamIndex Warehouse::HarmonicIndex::getOrAddJam( const std::string_view jamCID )
+{
+    const types::JamCouchID jamID{ jamCID };
+
+    const auto jamIt = m_jamLookup.find( jamID );
+    if ( jamIt != m_jamLookup.end() )
+        return jamIt->second;
+
+    const JamIndex newIndex = static_cast<JamIndex>( m_jamIDs.size() );
+    m_jamIDs.emplace_back( jamID );
+    m_jamLookup.emplace( jamID, newIndex );
+
+    return newIndex;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::HarmonicIndex::insertUnlocked( const RowID rowID, const BucketKey key, const JamIndex jam )
+{
+    // riff may already be indexed, potentially in a different bucket or under a different owner
+    eraseUnlocked( rowID );
+
+    Bucket& bucket = m_buckets[key];
+
+    const auto insertIt = std::lower_bound( bucket.m_rowIDs.begin(), bucket.m_rowIDs.end(), rowID );
+    const auto insertIndex = std::distance( bucket.m_rowIDs.begin(), insertIt );
+
+    bucket.m_rowIDs.insert( insertIt, rowID );
+    bucket.m_jams.insert( bucket.m_jams.begin() + insertIndex, jam );
+    bucket.m_jamCounts[jam]++;
+
+    m_rowLocations.insert_or_assign( rowID, key );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::HarmonicIndex::eraseUnlocked( const RowID rowID )
+{
+    const auto locationIt = m_rowLocations.find( rowID );
+    if ( locationIt == m_rowLocations.end() )
+        return;
+
+    const auto bucketIt = m_buckets.find( locationIt->second );
+    m_rowLocations.erase( locationIt );
+
+    if ( bucketIt == m_buckets.end() )
+        return;
+
+    Bucket& bucket = bucketIt->second;
+
+    const auto rowIt = std::lower_bound( bucket.m_rowIDs.begin(), bucket.m_rowIDs.end(), rowID );
+    if ( rowIt == bucket.m_rowIDs.end() || *rowIt != rowID )
+        return;
+
+    const auto rowIndex = std::distance( bucket.m_rowIDs.begin(), rowIt );
+    const JamIndex jam = bucket.m_jams[rowIndex];
+
+    bucket.m_rowIDs.erase( rowIt );
+    bucket.m_jams.erase( bucket.m_jams.begin() + rowIndex );
+
+    const auto jamCountIt = bucket.m_jamCounts.find( jam );
+    if ( jamCountIt != bucket.m_jamCounts.end() && --jamCountIt->second == 0 )
+        bucket.m_jamCounts.erase( jamCountIt );
+
+    if ( bucket.m_rowIDs.empty() )
+        m_buckets.erase( bucketIt );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Warehouse::HarmonicIndex::buildRootScaleSet( const endlesss::constants::RootScalePairs& keySearchPairs, RootScaleSet& rootScales )
+{
+    rootScales.clear();
+
+    if ( keySearchPairs.searchMode == endlesss::constants::HarmonicSearch::NoRules )
+        return false;
+
+    // matching how they are encoded in the SQL : ((root << 8) | scale)
+    for ( const auto rspair : keySearchPairs.pairs )
+        rootScales.emplace_back( ( rspair.root << 8 ) | rspair.scale );
+
+    std::sort( rootScales.begin(), rootScales.end() );
+    rootScales.erase( std::unique( rootScales.begin(), rootScales.end() ), rootScales.end() );
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+std::size_t Warehouse::HarmonicIndex::countByBPM( const endlesss::constants::RootScalePairs& keySearchPairs, const BPMCountSort sortOn, std::vector< BPMCountTuple >& bpmCounts ) const
+{
+    RootScaleSet rootScales;
+    const bool filterRootScale = buildRootScaleSet( keySearchPairs, rootScales );
+
+    struct Accumulator
+    {
+        uint32_t                                m_riffCount = 0;
+        absl::flat_hash_set< JamIndex >         m_jams;
+    };
+    absl::flat_hash_map< uint32_t, Accumulator > perBPM;
+
+    {
+        std::shared_lock< std::shared_mutex > indexLock( m_lock );
+
+        for ( const auto& [ key, bucket ] : m_buckets )
+        {
+            if ( filterRootScale && !std::binary_search( rootScales.begin(), rootScales.end(), getRootScale( key ) ) )
+                continue;
+
+            Accumulator& accumulator = perBPM[getBPM( key )];
+            accumulator.m_riffCount += static_cast<uint32_t>( bucket.m_rowIDs.size() );
+            for ( const auto& jamCount : bucket.m_jamCounts )
+                accumulator.m_jams.emplace( jamCount.first );
+        }
+    }
+
+    bpmCounts.clear();
+    bpmCounts.reserve( perBPM.size() );
+    for ( const auto& [ bpm, accumulator ] : perBPM )
+        bpmCounts.emplace_back( BPMCountTuple{ bpm, accumulator.m_riffCount, static_cast<uint32_t>( accumulator.m_jams.size() ) } );
+
+    // match the ordering of the original SQL queries; BPM breaks ties in count to keep results stable
+    if ( sortOn == BPMCountSort::ByBPM )
+    {
+        std::sort( bpmCounts.begin(), bpmCounts.end(), []( const BPMCountTuple& lhs, const BPMCountTuple& rhs )
+            {
+                return lhs.m_BPM > rhs.m_BPM;
+            });
+    }
+    else
+    {
+        std::sort( bpmCounts.begin(), bpmCounts.end(), []( const BPMCountTuple& lhs, const BPMCountTuple& rhs )
+            {
+                if ( lhs.m_riffCount == rhs.m_riffCount )
+                    return lhs.m_BPM > rhs.m_BPM;
+                return lhs.m_riffCount > rhs.m_riffCount;
+            });
+    }
+
+    return bpmCounts.size();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+std::optional< Warehouse::HarmonicIndex::RowID > Warehouse::HarmonicIndex::pickBySeed( const endlesss::constants::RootScalePairs& keySearchPairs, const uint32_t BPM, const int32_t seedValue ) const
+{
+    RootScaleSet rootScales;
+    const bool filterRootScale = buildRootScaleSet( keySearchPairs, rootScales );
+
+    std::shared_lock< std::shared_mutex > indexLock( m_lock );
+
+    // gather the buckets in a fixed order so the same seed always walks the same candidate list
+    absl::InlinedVector< BucketKey, 16 > candidateKeys;
+    if ( filterRootScale )
+    {
+        for ( const auto rootScale : rootScales )
+        {
+            const BucketKey key = makeBucketKey( BPM, rootScale );
+            if ( m_buckets.contains( key ) )
+                candidateKeys.push_back( key );
+        }
+    }
+    else
+    {
+        for ( const auto& bucketPair : m_buckets )
+        {
+            if ( getBPM( bucketPair.first ) == BPM )
+                candidateKeys.push_back( bucketPair.first );
+        }
+        std::sort( candidateKeys.begin(), candidateKeys.end() );
+    }
+
+    absl::InlinedVector< const Bucket*, 16 > candidates;
+    std::size_t totalCandidates = 0;
+    for ( const auto key : candidateKeys )
+    {
+        const Bucket& bucket = m_buckets.find( key )->second;
+        candidates.push_back( &bucket );
+        totalCandidates += bucket.m_rowIDs.size();
+    }
+    if ( totalCandidates == 0 )
+        return std::nullopt;
+
+    const auto virtualJamIt = m_jamLookup.find( types::JamCouchID{ cVirtualJamName } );
+    const JamIndex virtualJam = ( virtualJamIt == m_jamLookup.end() ) ? std::numeric_limits< JamIndex >::max() : virtualJamIt->second;
+
+    math::RNG32 rng( static_cast<uint32_t>( seedValue ) );
+    std::size_t pickIndex = rng.genUInt32() % totalCandidates;
+
+    // step forward past any of our own virtual riffs, which are never picked
+    for ( std::size_t attempt = 0; attempt < totalCandidates; attempt++ )
+    {
+        std::size_t localIndex = pickIndex;
+        for ( const Bucket* bucket : candidates )
+        {
+            if ( localIndex < bucket->m_rowIDs.size() )
+            {
+                if ( bucket->m_jams[localIndex] != virtualJam )
+                    return bucket->m_rowIDs[localIndex];
+                break;
+            }
+            localIndex -= bucket->m_rowIDs.size();
+        }
+        pickIndex = ( pickIndex + 1 ) % totalCandidates;
+    }
+
+    return std::nullopt;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// riff / stem population, split into a network-only fetch step and a database-only insert step so that the two can
+// run on different threads; see SyncEngine below
+//
+namespace sync {
+
+// a stem found to be invalid during a riff fetch, noted in the ledger once the batch gets written out
+struct LedgerNote
+{
+    types::StemCouchID          m_stemCID;
+    Warehouse::StemLedgerType   m_type;
+    std::string                 m_note;
+};
+
+struct RiffBatch
+{
+    types::JamCouchID                   m_jamCID;
+    std::vector< types::RiffCouchID >   m_riffCIDs;
+
+    endlesss::api::RiffDetails          m_riffDetails;
+    StemSet                             m_invalidStems;
+    std::vector< LedgerNote >           m_ledgerNotes;
+};
+
+struct StemBatch
+{
+    types::JamCouchID                   m_jamCID;
+    std::vector< types::StemCouchID >   m_stemCIDs;
+
+    endlesss::api::StemDetails          m_stemDetails;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+static bool fetch( const api::NetConfiguration& ncfg, RiffBatch& batch, const std::string_view logTag )
+{
+    blog::database( "[{}] collecting riff data ..", logTag );
+
+    // grab all the riff data
+    if ( !batch.m_riffDetails.fetchBatch( ncfg, batch.m_jamCID, batch.m_riffCIDs ) )
+    {
+        blog::error::database( "[{}] Failed to fetch riff details from jam [{}]", logTag, batch.m_jamCID );
+        return false;
+    }
+
+    // produce unique list of stem couch IDs from this batch of riffs; we can then mass-fetch the data to ensure its valid
+    std::vector< endlesss::types::StemCouchID > stemsToValidate;
+    StemSet uniqueStemCIDs;
+    uniqueStemCIDs.reserve( batch.m_riffDetails.rows.size() * 8 );
+    stemsToValidate.reserve( batch.m_riffDetails.rows.size() * 8 );
+    for ( const auto& netRiffData : batch.m_riffDetails.rows )
+    {
+        types::Riff riffData{ batch.m_jamCID, netRiffData.doc };
+        for ( auto stemI = 0; stemI < 8; stemI++ )
+        {
+            const auto& stemCID = riffData.stems[stemI];
+            if ( !stemCID.empty() )
+            {
+                const auto setInsert = uniqueStemCIDs.emplace( stemCID );
+                if ( setInsert.second )
+                {
+                    stemsToValidate.emplace_back( stemCID );
+                }
+            }
+        }
+    }
+    blog::database( "[{}] validating {} stems ..", logTag, stemsToValidate.size() );
+
+    // collect the type data for all the stems; there is a strange situation where some stem IDs turn out to
+    // be .. chat messages? so we need to remove those early on
+    endlesss::api::StemTypeCheck stemValidation;
+    if ( !stemValidation.fetchBatch( ncfg, batch.m_jamCID, stemsToValidate ) )
+    {
+        blog::error::database( "[{}] Failed to validate stem details [{}]", logTag, batch.m_jamCID );
+        return false;
+    }
+
+    // gather any stems that are found to be problematic
+    StemSet& invalidStems = batch.m_invalidStems;
+    invalidStems.clear();
+    for ( const auto& stemCheck : stemValidation.rows )
+    {
+        // missing key entirely, presumably moderated away
+        if ( !stemCheck.error.empty() )
+        {
+            invalidStems.emplace( stemCheck.key );
+            blog::database( "[{}] Found stem with a retreival error ({}), ignoring ID [{}]", logTag, stemCheck.error, stemCheck.key );
+
+            batch.m_ledgerNotes.emplace_back( LedgerNote{
+                stemCheck.key,
+                Warehouse::StemLedgerType::REMOVED_ID,
+                fmt::format( "[{}]", stemCheck.error ) } );
+
+            continue;
+        }
+
+        // does this have vintage attachment data? if so, allow the fact it might be also missing an app version tag
+        const bool bThisIsAnOldButValidStem = !stemCheck.doc._attachments.oggAudio.content_type.empty();
+
+        // check for invalid app version - this is usually a red flag for invalid stems but on very old jams this was the norm 
+        const bool ignoreForMissingAppData = ( stemCheck.doc.app_version == 0 && bThisIsAnOldButValidStem == false );
+
+        // stem is lacking app versioning (and isn't just old)
+        if ( ignoreForMissingAppData )
+        {
+            invalidStems.emplace( stemCheck.key );
+            blog::database( "[{}] Found stem without app version ({}), ignoring ID [{}]", logTag, stemCheck.doc._attachments.oggAudio.digest, stemCheck.key );
+
+            batch.m_ledgerNotes.emplace_back( LedgerNote{
+                stemCheck.key,
+                Warehouse::StemLedgerType::REMOVED_ID,
+                fmt::format( "[{}]", stemCheck.error ) } );
+
+            continue;
+        }
+        // stem was destroyed?
+        if ( stemCheck.value.deleted )
+        {
+            invalidStems.emplace( stemCheck.key );
+            blog::database( "[{}] Found stem that was deleted ({}), ignoring ID [{}]", logTag, stemCheck.error, stemCheck.key );
+
+            batch.m_ledgerNotes.emplace_back( LedgerNote{
+                stemCheck.key,
+                Warehouse::StemLedgerType::REMOVED_ID,
+                fmt::format( "[{}]", stemCheck.error ) } );
+
+            continue;
+        }
+
+        // this isn't a stem? 
+        if ( stemCheck.doc.type != "Loop" )
+        {
+            invalidStems.emplace( stemCheck.doc._id );
+            blog::database( "[{}] Found stem that isn't a stem ({}), ignoring ID [{}]", logTag, stemCheck.doc.type, stemCheck.doc._id );
+
+            batch.m_ledgerNotes.emplace_back( LedgerNote{
+                stemCheck.doc._id,
+                Warehouse::StemLedgerType::DAMAGED_REFERENCE,
+                fmt::format( "[Ver:{}] Wrong type [{}]", stemCheck.doc.app_version, stemCheck.doc.type ) } );
+
+            continue;
+        }
+        // this stem was damaged and has no audio data
+        if ( stemCheck.doc.cdn_attachments.oggAudio.endpoint.empty() &&
+             stemCheck.doc.cdn_attachments.flacAudio.endpoint.empty() )
+        {
+            invalidStems.emplace( stemCheck.doc._id );
+            blog::database( "[{}] Found stem that is damaged, ignoring ID [{}]", logTag, stemCheck.doc._id );
+
+            batch.m_ledgerNotes.emplace_back( LedgerNote{
+                stemCheck.doc._id,
+                Warehouse::StemLedgerType::MISSING_OGG,   // previously this only happened with OGG sources.. potentially we could have missing FLAC here too
+                fmt::format( "[Ver:{}]", stemCheck.doc.app_version ) } );
+
+            continue;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// expects to be run inside a transaction
+static void insert( const RiffBatch& batch, const std::string_view logTag )
+{
+    static constexpr char updateRiffDetails[] = R"(
+        UPDATE riffs SET CreationTime=?2,
+                         Root=?3,
+                         Scale=?4,
+                         BPS=?5,
+                         BPMrnd=?6,
+                         BarLength=?7,
+                         AppVersion=?8,
+                         Magnitude=?9,
+                         UserName=?10,
+                         StemCID_1=?11,
+                         StemCID_2=?12,
+                         StemCID_3=?13,
+                         StemCID_4=?14,
+                         StemCID_5=?15,
+                         StemCID_6=?16,
+                         StemCID_7=?17,
+                         StemCID_8=?18,
+                         GainsJSON=?19
+                         WHERE riffCID=?1
+    )";
+    // only add stem skeletons if the owning riff is still present; a batch fetched in the background may land
+    // after its jam was purged or its sync aborted
+    static constexpr char insertOrIgnoreNewStemSkeleton[] = R"(
+        INSERT OR IGNORE INTO stems( stemCID, OwnerJamCID )
+            SELECT ?1, ?2 WHERE EXISTS ( SELECT 1 FROM riffs WHERE riffCID = ?3 );
+    )";
+
+    for ( const auto& ledgerNote : batch.m_ledgerNotes )
+    {
+        sql::ledger::storeStemNote( ledgerNote.m_stemCID, ledgerNote.m_type, ledgerNote.m_note );
+    }
+
+    blog::database( "[{}] inserting {} rows of riff detail", logTag, batch.m_riffDetails.rows.size() );
+
+    for ( const auto& netRiffData : batch.m_riffDetails.rows )
+    {
+        types::Riff riffData{ batch.m_jamCID, netRiffData.doc };
+
+        for ( auto stemI = 0; stemI < 8; stemI++ )
+        {
+            const auto& stemCID = riffData.stems[stemI];
+            if ( stemCID.empty() )
+                continue;
+
+            // check if this stem is meant to be ignored from the validation phase earlier
+            auto stemIter = batch.m_invalidStems.find( stemCID );
+            if ( stemIter != batch.m_invalidStems.end() )
+            {
+                blog::database( "[{}] Removing stem {} from [{}] as it was marked as invalid", logTag, stemI, riffData.couchID );
+
+                riffData.stemsOn[stemI] = false;
+                riffData.stems[stemI] = endlesss::types::StemCouchID{ "" };
+            }
+            else
+            {
+                // as we walk the stems, poke the couch ID into the stems table if it doesn't already exist
+                // so that any new ones will be found and filled in later
+                Warehouse::SqlDB::query<insertOrIgnoreNewStemSkeleton>( stemCID.value(), batch.m_jamCID.value(), riffData.couchID.value() );
+            }
+        }
+
+        auto gainsJson = fmt::format( R"([ {} ])", fmt::join( riffData.gains, ", " ) );
+
+        Warehouse::SqlDB::query<updateRiffDetails>(
+            riffData.couchID.value(),
+            riffData.creationTimeUnix,
+            riffData.root,
+            riffData.scale,
+            riffData.BPS,
+            riffData.BPMrnd,
+            riffData.barLength,
+            riffData.appVersion,
+            riffData.magnitude,
+            riffData.user,
+            riffData.stems[0].value(),
+            riffData.stems[1].value(),
+            riffData.stems[2].value(),
+            riffData.stems[3].value(),
+            riffData.stems[4].value(),
+            riffData.stems[5].value(),
+            riffData.stems[6].value(),
+            riffData.stems[7].value(),
+            gainsJson
+        );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+static bool fetch( const api::NetConfiguration& ncfg, StemBatch& batch, const std::string_view logTag )
+{
+    blog::database( "[{}] collecting stem data ..", logTag );
+
+    if ( !batch.m_stemDetails.fetchBatch( ncfg, batch.m_jamCID, batch.m_stemCIDs ) )
+    {
+        blog::error::database( "[{}] Failed to fetch stem details from jam [{}]", logTag, batch.m_jamCID );
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// expects to be run inside a transaction
+static void insert( const StemBatch& batch, const std::string_view logTag )
+{
+    static constexpr char updateStemDetails[] = R"(
+        UPDATE stems SET CreationTime=?2,
+                         FileEndpoint=?3,
+                         FileBucket=?4,
+                         FileKey=?5,
+                         FileMIME=?6,
+                         FileLength=?7,
+                         BPS=?8,
+                         BPMrnd=?9,
+                         Instrument=?10,
+                         Length16s=?11,
+                         OriginalPitch=?12,
+                         BarLength=?13,
+                         PresetName=?14,
+                         CreatorUserName=?15,
+                         SampleRate=?16,
+                         PrimaryColour=?17
+                         WHERE stemCID=?1
+    )";
+
+    blog::database( "[{}] inserting {} rows of stem detail", logTag, batch.m_stemDetails.rows.size() );
+
+    for ( const auto& stemData : batch.m_stemDetails.rows )
+    {
+        const auto unixTime = (uint32_t)(stemData.doc.created / 1000); // from unix nano
+
+        int32_t instrumentMask = 0;
+        if ( stemData.doc.isDrum )
+            instrumentMask |= 1 << 1;
+        if ( stemData.doc.isNote )
+            instrumentMask |= 1 << 2;
+        if ( stemData.doc.isBass )
+            instrumentMask |= 1 << 3;
+        if ( stemData.doc.isMic )
+            instrumentMask |= 1 << 4;
+
+        const endlesss::api::IStemAudioFormat& audioFormat = stemData.doc.cdn_attachments.getAudioFormat();
+
+        Warehouse::SqlDB::query<updateStemDetails>(
+            stemData.id.value(),
+            unixTime,
+            audioFormat.getEndpoint().data(),
+            audioFormat.getBucket().data(),
+            audioFormat.getKey().data(),
+            audioFormat.getMIME().data(),
+            audioFormat.getLength(),
+            stemData.doc.bps,
+            types::BPStoRoundedBPM( stemData.doc.bps ),
+            instrumentMask,
+            stemData.doc.length16ths,
+            stemData.doc.originalPitch,
+            stemData.doc.barLength,
+            stemData.doc.presetName,
+            stemData.doc.creatorUserName,
+            (int32_t)stemData.doc.sampleRate,
+            stemData.doc.primaryColour
+        );
+    }
+}
+
+} // namespace sync
+
+// ---------------------------------------------------------------------------------------------------------------------
+// keeps a number of riff / stem batch fetches in flight on dedicated network threads; the warehouse worker thread
+// dispatches new batches as slots free up and writes completed ones into the database in bulk, so syncing a large jam
+// is no longer bound by the latency of one request at a time
+//
+struct Warehouse::SyncEngine
+{
+    DECLARE_NO_COPY_NO_MOVE( SyncEngine );
+
+    // upper bound on rAPI::syncConcurrentFetches; fetch threads are started on demand up to the configured count
+    static constexpr int32_t cMaximumFetchThreads = 8;
+
+    static constexpr std::string_view TagRiffs = "RIFFSYNC";
+    static constexpr std::string_view TagStems = "STEMSYNC";
+
+    struct Job
+    {
+        bool                m_isRiffBatch = false;
+        sync::RiffBatch     m_riffs;
+        sync::StemBatch     m_stems;
+
+        bool                m_fetchOk = false;
+        double              m_fetchSeconds = 0;
+    };
+    using JobPtr    = std::unique_ptr< Job >;
+    using JobQueue  = mcc::ConcurrentQueue< JobPtr >;
+    using Jobs      = std::vector< JobPtr >;
+
+    // additive increase while fetches come back comfortably inside the target time, multiplicative decrease when
+    // they run long or fail outright
+    struct BatchSizer
+    {
+        int32_t     m_size = 40;    // matches the old fixed batch size
+
+        ouro_nodiscard int32_t get( const config::endlesss::rAPI& api );
+
+        void onSuccess( const config::endlesss::rAPI& api, const double fetchSeconds );
+        void onFailure( const config::endlesss::rAPI& api );
+    };
+
+
+    SyncEngine( api::NetConfiguration::Shared networkConfiguration, moodycamel::LightweightSemaphore& workerWaitSema );
+    ~SyncEngine();
+
+    // everything below is only to be called from the warehouse worker thread
+
+    ouro_nodiscard std::size_t getInFlightCount() const { return m_jobsInFlight; }
+
+    // true if there is a free fetch slot and we aren't backing off after a failure
+    ouro_nodiscard bool canDispatch() const;
+
+    // look for unpopulated stems / riffs in the given jam that aren't already in flight and kick off a fetch for them;
+    // returns false if there was nothing new to fetch
+    bool dispatchStems( const types::JamCouchID& jamCID );
+    bool dispatchRiffs( const types::JamCouchID& jamCID );
+
+    // move any successfully fetched jobs into the output; failed jobs are dropped (their rows stay unpopulated so
+    // will be found again) and counted towards the consecutive failure limit
+    void collectCompleted( Jobs& fetchedJobs );
+
+    // true once enough fetches have failed back-to-back - each one after exhausting NetConfiguration::attempt() - that
+    // we should stop and let the user look into it
+    ouro_nodiscard bool hasHitFailureLimit() const;
+    void resetFailures() { m_consecutiveFailures = 0; }
+
+private:
+
+    ouro_nodiscard int32_t getConcurrency() const;
+
+    void enqueueJob( JobPtr&& job );
+    void fetchThread();
+
+    api::NetConfiguration::Shared       m_networkConfiguration;
+    moodycamel::LightweightSemaphore&   m_workerWaitSema;
+
+    // worker thread state
+    std::size_t                         m_jobsInFlight = 0;
+    RiffSet                             m_riffsInFlight;
+    StemSet                             m_stemsInFlight;
+    BatchSizer                          m_riffSizer;
+    BatchSizer                          m_stemSizer;
+    int32_t                             m_consecutiveFailures = 0;
+    spacetime::Moment                   m_backoffUntil;
+
+    JobQueue                            m_pendingJobs;      // written by the worker, read by the fetch threads
+    JobQueue                            m_completedJobs;    // written by the fetch threads, read by the worker
+    std::vector< std::thread >          m_fetchThreads;
+    std::atomic_bool                    m_fetchThreadRun = true;
+    mcc::LightweightSemaphore           m_fetchJobSema;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+int32_t Warehouse::SyncEngine::BatchSizer::get( const config::endlesss::rAPI& api )
+{
+    const int32_t sizeMinimum = std::max( api.syncBatchSizeMinimum, 1 );
+    const int32_t sizeMaximum = std::max( api.syncBatchSizeMaximum, sizeMinimum );
+
+    m_size = std::clamp( m_size, sizeMinimum, sizeMaximum );
+    return m_size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::SyncEngine::BatchSizer::onSuccess( const config::endlesss::rAPI& api, const double fetchSeconds )
+{
+    const double targetSeconds = static_cast<double>( std::max( api.syncBatchTargetSeconds, 1 ) );
+
+    if ( fetchSeconds < targetSeconds )
+        m_size += std::max( m_size / 4, 1 );
+    else if ( fetchSeconds > targetSeconds * 2.0 )
+        m_size = ( m_size * 3 ) / 4;
+
+    get( api );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::SyncEngine::BatchSizer::onFailure( const config::endlesss::rAPI& api )
+{
+    m_size /= 2;
+    get( api );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Warehouse::SyncEngine::SyncEngine( api::NetConfiguration::Shared networkConfiguration, moodycamel::LightweightSemaphore& workerWaitSema )
+    : m_networkConfiguration( std::move( networkConfiguration ) )
+    , m_workerWaitSema( workerWaitSema )
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Warehouse::SyncEngine::~SyncEngine()
+{
+    // fetch threads may be stuck in a network call, this will wait for them to time out
+    m_fetchThreadRun = false;
+    m_fetchJobSema.signal( static_cast<int>( m_fetchThreads.size() ) );
+    for ( auto& fetchThread : m_fetchThreads )
+        fetchThread.join();
+    m_fetchThreads.clear();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+int32_t Warehouse::SyncEngine::getConcurrency() const
+{
+    return std::clamp( m_networkConfiguration->api().syncConcurrentFetches, 1, cMaximumFetchThreads );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Warehouse::SyncEngine::canDispatch() const
+{
+    return ( m_jobsInFlight < static_cast<std::size_t>( getConcurrency() ) ) && m_backoffUntil.hasPassed();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Warehouse::SyncEngine::dispatchStems( const types::JamCouchID& jamCID )
+{
+    std::vector< types::StemCouchID > stemCIDs;
+    if ( !sql::stems::findUnpopulatedBatch( jamCID, m_stemSizer.get( m_networkConfiguration->api() ), stemCIDs, &m_stemsInFlight ) )
+        return false;
+
+    for ( const auto& stemCID : stemCIDs )
+        m_stemsInFlight.emplace( stemCID );
+
+    auto job = std::make_unique< Job >();
+    job->m_isRiffBatch       = false;
+    job->m_stems.m_jamCID    = jamCID;
+    job->m_stems.m_stemCIDs  = std::move( stemCIDs );
+
+    enqueueJob( std::move( job ) );
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Warehouse::SyncEngine::dispatchRiffs( const types::JamCouchID& jamCID )
+{
+    std::vector< types::RiffCouchID > riffCIDs;
+    if ( !sql::riffs::findUnpopulatedBatch( jamCID, m_riffSizer.get( m_networkConfiguration->api() ), riffCIDs, &m_riffsInFlight ) )
+        return false;
+
+    for ( const auto& riffCID : riffCIDs )
+        m_riffsInFlight.emplace( riffCID );
+
+    auto job = std::make_unique< Job >();
+    job->m_isRiffBatch       = true;
+    job->m_riffs.m_jamCID    = jamCID;
+    job->m_riffs.m_riffCIDs  = std::move( riffCIDs );
+
+    enqueueJob( std::move( job ) );
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::SyncEngine::enqueueJob( JobPtr&& job )
+{
+    // spin up more fetch threads if the configured concurrency has gone up
+    while ( m_fetchThreads.size() < static_cast<std::size_t>( getConcurrency() ) )
+        m_fetchThreads.emplace_back( &SyncEngine::fetchThread, this );
+
+    m_jobsInFlight++;
+    m_pendingJobs.enqueue( std::move( job ) );
+    m_fetchJobSema.signal();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::SyncEngine::collectCompleted( Jobs& fetchedJobs )
+{
+    JobPtr job;
+    while ( m_completedJobs.try_dequeue( job ) )
+    {
+        const config::endlesss::rAPI& api = m_networkConfiguration->api();
+
+        ABSL_ASSERT( m_jobsInFlight > 0 );
+        m_jobsInFlight--;
+
+        if ( job->m_isRiffBatch )
+        {
+            for ( const auto& riffCID : job->m_riffs.m_riffCIDs )
+                m_riffsInFlight.erase( riffCID );
+        }
+        else
+        {
+            for ( const auto& stemCID : job->m_stems.m_stemCIDs )
+                m_stemsInFlight.erase( stemCID );
+        }
+
+        BatchSizer& sizer = job->m_isRiffBatch ? m_riffSizer : m_stemSizer;
+
+        if ( job->m_fetchOk )
+        {
+            sizer.onSuccess( api, job->m_fetchSeconds );
+            m_consecutiveFailures = 0;
+
+            fetchedJobs.emplace_back( std::move( job ) );
+        }
+        else
+        {
+            sizer.onFailure( api );
+            m_consecutiveFailures++;
+
+            // hold off on anything new for a little while, doubling up with each failure in a row
+            const auto backoffTime = std::chrono::milliseconds( std::min( 250 << std::min( m_consecutiveFailures, 5 ), 8000 ) );
+            m_backoffUntil.setToFuture( backoffTime );
+
+            blog::error::database( FMTX( "[{}] batch fetch failed ({} in a row), backing off for {}" ),
+                job->m_isRiffBatch ? TagRiffs : TagStems,
+                m_consecutiveFailures,
+                backoffTime );
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Warehouse::SyncEngine::hasHitFailureLimit() const
+{
+    return m_consecutiveFailures > m_networkConfiguration->getRequestRetries();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::SyncEngine::fetchThread()
+{
+    OuroveonThreadScope ots( OURO_THREAD_PREFIX "Warehouse::Sync" );
+
+    while ( m_fetchThreadRun )
+    {
+        if ( !m_fetchJobSema.wait( 100000 ) )
+            continue;
+
+        JobPtr job;
+        if ( !m_pendingJobs.try_dequeue( job ) )
+            continue;
+
+        const std::string_view jobTag = job->m_isRiffBatch ? TagRiffs : TagStems;
+        {
+            base::instr::ScopedEvent se( "SYNC", jobTag.data(), base::instr::PresetColour::Orange );
+
+            spacetime::Moment fetchTimer;
+
+            if ( job->m_isRiffBatch )
+                job->m_fetchOk = sync::fetch( *m_networkConfiguration, job->m_riffs, jobTag );
+            else
+                job->m_fetchOk = sync::fetch( *m_networkConfiguration, job->m_stems, jobTag );
+
+            job->m_fetchSeconds = static_cast<double>( fetchTimer.delta< std::chrono::milliseconds >().count() ) * 0.001;
+        }
+
+        m_completedJobs.enqueue( std::move( job ) );
+        m_workerWaitSema.signal();
+
+        // each fetch thread still pauses between requests to avoid hitting the endlesss servers too hard
+        Warehouse::INetworkTask::addNetworkPause( jobTag );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// add a custom seeded RANDOM function to sqlite, allowing us to feed through specific random sequences
+//
+static void sqlite_SEEDED_RANDOM_dtor( void* p )
+{
+    math::RNG32* pRNG = static_cast<math::RNG32*>(p);
+    delete pRNG;
+}
+
+static void sqlite_SEEDED_RANDOM( sqlite3_context* context, int argc, sqlite3_value** argv )
+{
+    if ( argc == 1 && sqlite3_value_type( argv[0] ) == SQLITE_INTEGER )
+    {
+        // fetch the current RNG state from db context
+        math::RNG32* pRNG = static_cast<math::RNG32*>( sqlite3_get_auxdata( context, 0 ) );
+        if ( !pRNG )
+        {
+            // .. first time through, create the RNG state, stash it
+            const int32_t seed = sqlite3_value_int( argv[0] );
+            pRNG = new math::RNG32( static_cast<uint32_t>(seed) );
+            sqlite3_set_auxdata( context, 0, pRNG, sqlite_SEEDED_RANDOM_dtor );
+        }
+
+        // produce the next number in the sequence
+        const int64_t result = pRNG->genInt32();
+
+        sqlite3_result_int64( context, result );
+    }
+    else
+    {
+        sqlite3_result_error( context, "Invalid", 0 );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Warehouse::Warehouse( const app::StoragePaths& storagePaths, api::NetConfiguration::Shared& networkConfig, base::EventBusClient eventBus )
+    : m_networkConfiguration( networkConfig )
+    , m_eventBusClient( eventBus )
+    , m_workerThreadPaused( false )
+{
+    blog::database( FMTX("sqlite version {}"), SQLITE_VERSION );
+
+    // create the lockless queues that manages the warehouse TODO list
+    {
+        m_taskSchedule = std::make_unique<TaskSchedule>();
+        m_taskSchedule->signal();
+        m_taskSchedulePriority = std::make_unique<TaskSchedule>();
+    }
+
+    m_databaseFile = ( storagePaths.cacheCommon / "warehouse.db3" ).string();
+
+    // columnar JamSlice snapshots live alongside the database; failing to create the directory just disables them
+    {
+        const fs::path snapshotPath = storagePaths.cacheCommon / "jamslice";
+
+        std::error_code createError;
+        fs::create_directories( snapshotPath, createError );
+        if ( createError )
+            blog::error::database( FMTX( "unable to create jam slice snapshot directory [{}], {}" ), snapshotPath.string(), createError.message() );
+        else
+            m_jamSliceSnapshotPath = snapshotPath;
+    }
+
+    const auto postConnectionHook = []( sqlite3* db_handle )
+    {
+        blog::database( FMTX( "post_connection_hook( 0x{:x} )" ), (uint64_t)db_handle );
+
+        // https://www.sqlite.org/pragma.html#pragma_temp_store
+        sqlite3_exec( db_handle, "pragma temp_store = memory", nullptr, nullptr, nullptr );
+
+        // in WAL mode, normal sync is still durable against app crashes and avoids an fsync on every commit
+        // https://www.sqlite.org/pragma.html#pragma_synchronous
+        sqlite3_exec( db_handle, "pragma synchronous = normal", nullptr, nullptr, nullptr );
+
+        // add our RANDOM variant that takes a seed to allow for deterministic random queries
+        int32_t seededRes = sqlite3_create_function( db_handle, "SEEDED_RANDOM", 1, SQLITE_UTF8, NULL, &sqlite_SEEDED_RANDOM, NULL, NULL );
+        blog::database( FMTX( "sqlite3_create_function(SEEDED_RANDOM) = {} ({})" ), seededRes == SQLITE_OK ? "OK" : "Error", seededRes );
+        
+        // bolt in carray extension
+        int32_t carrayRes = sqlite3_carray_init( db_handle, nullptr, nullptr );
+        blog::database( FMTX( "sqlite3_carray_init = {} ({})" ), carrayRes == SQLITE_OK ? "OK" : "Error", carrayRes );
+    };
+    SqlDB::post_connection_hook       = postConnectionHook;
+    SqlDBReader::post_connection_hook = postConnectionHook;
+
+    // switch to write-ahead logging so that readers on other threads don't block on (or block) the worker thread's
+    // writes; this is persistent, stored in the database file, so only really does anything the first time around
+    // https://www.sqlite.org/wal.html
+    {
+        static constexpr char sqlJournalWAL[] = R"(pragma journal_mode = wal;)";
+
+        std::string_view journalMode;
+        auto query = SqlDB::query<sqlJournalWAL>();
+        if ( query( journalMode ) )
+            blog::database( FMTX( "journal_mode = {}" ), journalMode );
+    }
+
+    // set the database up; creating tables & indices if we're starting fresh
+    {
+        Warehouse::SqlDB::TransactionGuard txn;
+
+        sql::jams::runInit();
+        sql::riffs::runInit();
+        sql::tags::runInit();
+        sql::stems::runInit();
+        sql::ledger::runInit();
+        sql::contents::runInit();
+    }
+
+
+    // optimize on startup
+    {
+        spacetime::ScopedTimer stemTiming( "warehouse [optimize]" );
+        static constexpr char sqlOptimize[] = R"(pragma optimize;)";
+        SqlDB::query<sqlOptimize>();
+    }
+
+    // first job for the worker is to scan the riffs table into the harmonic index; until that's done, the procedural
+    // queries fall back to running against the database directly
+    m_harmonicIndex = std::make_unique<HarmonicIndex>();
+    m_taskSchedule->enqueueWorkTask<HarmonicIndexTask>( *m_harmonicIndex );
+
+    m_syncEngine = std::make_unique<SyncEngine>( m_networkConfiguration, m_taskSchedule->m_workerWaitSema );
+
+    m_workerThreadAlive = true;
+    m_workerThread      = std::make_unique<std::thread>( &Warehouse::threadWorker, this );
+
+    APP_EVENT_BIND_TO( RiffTagAction );
+
+#if OURO_PLATFORM_WIN
+    ::SetThreadPriority( m_workerThread->native_handle(), THREAD_PRIORITY_BELOW_NORMAL );
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+Warehouse::~Warehouse()
+{
+    APP_EVENT_UNBIND( RiffTagAction );
+
+    m_workerThreadAlive = false;
+
+    // unblock the thread, wait for it to die out
+    m_taskSchedule->signal();
+    m_workerThread->join();
+    m_workerThread.reset();
+
+    // after the worker, as it's the only thing talking to the sync engine
+    m_syncEngine.reset();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::setCallbackWorkReport( const WorkUpdateCallback& cb )
+{
+    {
+        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
+        m_cbWorkUpdateToInstall = cb;
+    }
+    m_taskSchedule->signal();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::setCallbackContentsReport( const ContentsReportCallback& cb )
+{
+    {
+        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
+        m_cbContentsReportToInstall = cb;
+    }
+    m_taskSchedule->signal();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::setCallbackTagUpdate( const TagUpdateCallback& cbUpdate, const TagBatchingCallback& cbBatch )
+{
+    {
+        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
+        m_cbTagUpdate = cbUpdate;
+        m_cbTagBatching = cbBatch;
+    }
+    m_taskSchedule->signal();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void Warehouse::setCallbackTagRemoved( const TagRemovedCallback& cb )
+{
+    {
+        std::scoped_lock<std::mutex> cbLock( m_cbMutex );
+        m_cbTagRemoved = cb;
+    }
+    m_taskSchedule->signal();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -1337,7 +4009,7 @@ void Warehouse::extractJamDictionary( types::JamIDToNameMap& jamDictionary ) con
                 select JamCID, PublicName from jams;
             )";
 
-    auto query = Warehouse::SqlDB::query<_extractJamData>();
+    auto query = SqlDBReader::query<_extractJamData>();
 
     jamDictionary.clear();
 
@@ -1383,7 +4055,11 @@ void Warehouse::addJamSliceRequest( const types::JamCouchID& jamCouchID, const J
         return;
     }
 
-    m_taskSchedule->enqueueWorkTask<JamSliceTask>( jamCouchID, callbackOnCompletion );
+    m_taskSchedule->enqueueWorkTask<JamSliceTask>(
+        jamCouchID,
+        getChangeIndexForJam( jamCouchID ),
+        getJamSliceSnapshotFile( jamCouchID ),
+        callbackOnCompletion );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -1411,7 +4087,12 @@ void Warehouse::requestJamSyncAbort( const types::JamCouchID& jamCouchID )
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-base::OperationID Warehouse::requestJamDataExport( const types::JamCouchID& jamCouchID, const fs::path exportFolder, std::string_view jamTitle )
+base::OperationID Warehouse::requestJamDataExport(
+    const types::JamCouchID& jamCouchID,
+    const fs::path exportFolder,
+    std::string_view jamTitle,
+    const ExportFormat exportFormat,
+    const fs::path stemCacheRootToBundle )
 {
     const auto operationID = base::Operations::newID( OV_ExportAction );
 
@@ -1421,17 +4102,17 @@ base::OperationID Warehouse::requestJamDataExport( const types::JamCouchID& jamC
         return base::OperationID::invalid();
     }
 
-    m_taskSchedule->enqueueWorkTask<JamExportTask>( m_eventBusClient, jamCouchID, exportFolder, jamTitle, operationID );
+    m_taskSchedule->enqueueWorkTask<JamExportTask>( m_eventBusClient, jamCouchID, exportFolder, jamTitle, exportFormat, stemCacheRootToBundle, operationID );
 
     return operationID;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-base::OperationID Warehouse::requestJamDataImport( const fs::path pathToData )
+base::OperationID Warehouse::requestJamDataImport( const fs::path pathToData, const fs::path stemCacheRoot )
 {
     const auto operationID = base::Operations::newID( OV_ImportAction );
 
-    m_taskSchedule->enqueueWorkTask<JamImportTask>( m_eventBusClient, pathToData, operationID );
+    m_taskSchedule->enqueueWorkTask<JamImportTask>( m_eventBusClient, pathToData, stemCacheRoot, operationID );
 
     return operationID;
 }
@@ -1439,12 +4120,12 @@ base::OperationID Warehouse::requestJamDataImport( const fs::path pathToData )
 // ---------------------------------------------------------------------------------------------------------------------
 bool Warehouse::fetchSingleRiffByID( const endlesss::types::RiffCouchID& riffID, endlesss::types::RiffComplete& result ) const
 {
-    if ( !sql::riffs::getSingleByID( riffID, result.riff ) )
+    if ( !sql::riffs::getSingleByID<SqlDBReader>( riffID, result.riff ) )
         return false;
 
     result.jam.couchID = result.riff.jamCouchID;
 
-    if ( sql::jams::getPublicNameForID( result.jam.couchID, result.jam.displayName ) == false )
+    if ( sql::jams::getPublicNameForID<SqlDBReader>( result.jam.couchID, result.jam.displayName ) == false )
     {
         // on failure, check if the couch ID does NOT start with "band..." indicating this is probably a personal jam
         // (at time of writing there's no other variants we support at this level)
@@ -1464,7 +4145,7 @@ bool Warehouse::fetchSingleRiffByID( const endlesss::types::RiffCouchID& riffID,
     {
         if ( result.riff.stemsOn[stemI] )
         {
-            if ( !sql::stems::getSingleStemByID( result.riff.stems[stemI], result.stems[stemI] ) )
+            if ( !sql::stems::getSingleStemByID<SqlDBReader>( result.riff.stems[stemI], result.stems[stemI] ) )
                 return false;
         }
     }
@@ -1517,7 +4198,11 @@ bool Warehouse::patchRiffStemRecord(
 // ---------------------------------------------------------------------------------------------------------------------
 std::size_t Warehouse::filterRiffsByBPM( const endlesss::constants::RootScalePairs& keySearchPairs, const BPMCountSort sortOn, std::vector< BPMCountTuple >& bpmCounts ) const
 {
-    Warehouse::SqlDB::TransactionGuard txn;
+    // answer from the in-memory index if it's been built, otherwise fall through to the GROUP BY queries
+    if ( m_harmonicIndex->isReady() )
+        return m_harmonicIndex->countByBPM( keySearchPairs, sortOn, bpmCounts );
+
+    SqlDBReader::TransactionGuard txn;
 
     bpmCounts.clear();
 
@@ -1556,7 +4241,7 @@ std::size_t Warehouse::filterRiffsByBPM( const endlesss::constants::RootScalePai
 
             if ( sortOn == BPMCountSort::ByBPM )
             {
-                auto query = Warehouse::SqlDB::query<_bpmGroupsByScaleAndRoot_ByBPM_NoRules>();
+                auto query = SqlDBReader::query<_bpmGroupsByScaleAndRoot_ByBPM_NoRules>();
                 while ( query( bpmRange, bpmCount, jamCount ) )
                 {
                     bpmCounts.emplace_back( BPMCountTuple{ (uint32_t)std::round( bpmRange ), bpmCount, jamCount } );
@@ -1564,7 +4249,7 @@ std::size_t Warehouse::filterRiffsByBPM( const endlesss::constants::RootScalePai
             }
             else
             {
-                auto query = Warehouse::SqlDB::query<_bpmGroupsByScaleAndRoot_ByRiffCount_NoRules>();
+                auto query = SqlDBReader::query<_bpmGroupsByScaleAndRoot_ByRiffCount_NoRules>();
                 while ( query( bpmRange, bpmCount, jamCount ) )
                 {
                     bpmCounts.emplace_back( BPMCountTuple{ (uint32_t)std::round( bpmRange ), bpmCount, jamCount } );
@@ -1626,7 +4311,7 @@ std::size_t Warehouse::filterRiffsByBPM( const endlesss::constants::RootScalePai
 
             if ( sortOn == BPMCountSort::ByBPM )
             {
-                auto query = Warehouse::SqlDB::query<_bpmGroupsByScaleAndRoot_ByBPM>( rootScalePtr, rootScaleCount );
+                auto query = SqlDBReader::query<_bpmGroupsByScaleAndRoot_ByBPM>( rootScalePtr, rootScaleCount );
                 while ( query( bpmRange, _hash, bpmCount, jamCount ) )
                 {
                     bpmCounts.emplace_back( BPMCountTuple{ (uint32_t)std::round( bpmRange ), bpmCount, jamCount } );
@@ -1634,7 +4319,7 @@ std::size_t Warehouse::filterRiffsByBPM( const endlesss::constants::RootScalePai
             }
             else
             {
-                auto query = Warehouse::SqlDB::query<_bpmGroupsByScaleAndRoot_ByRiffCount>( rootScalePtr, rootScaleCount );
+                auto query = SqlDBReader::query<_bpmGroupsByScaleAndRoot_ByRiffCount>( rootScalePtr, rootScaleCount );
                 while ( query( bpmRange, _hash, bpmCount, jamCount ) )
                 {
                     bpmCounts.emplace_back( BPMCountTuple{ (uint32_t)std::round( bpmRange ), bpmCount, jamCount } );
@@ -1681,11 +4366,32 @@ bool Warehouse::fetchRandomRiffBySeed( const endlesss::constants::RootScalePairs
         )";
 
 
+    // pick straight from the index if it's ready, which avoids sorting the entire candidate set by SEEDED_RANDOM
+    if ( m_harmonicIndex->isReady() )
+    {
+        static constexpr char _riffIDFromRowID[] = R"(
+            select RiffCID from riffs where rowid = ?1;
+        )";
+
+        const auto pickedRowID = m_harmonicIndex->pickBySeed( keySearchPairs, BPM, seedValue );
+        if ( !pickedRowID.has_value() )
+            return false;
+
+        auto query = SqlDBReader::query<_riffIDFromRowID>( static_cast<int64_t>( pickedRowID.value() ) );
+
+        std::string_view riffCID;
+        if ( query( riffCID ) )
+        {
+            return fetchSingleRiffByID( endlesss::types::RiffCouchID{ riffCID }, result );
+        }
+        return false;
+    }
+
     if ( keySearchPairs.searchMode == endlesss::constants::HarmonicSearch::NoRules )
     {
-        Warehouse::SqlDB::TransactionGuard txn;
+        SqlDBReader::TransactionGuard txn;
 
-        auto query = Warehouse::SqlDB::query<_randomFilteredRiff_NoRules>( BPM, cVirtualJamName.data(), seedValue );
+        auto query = SqlDBReader::query<_randomFilteredRiff_NoRules>( BPM, cVirtualJamName.data(), seedValue );
 
         float bpmRange;
         std::string_view riffCID;
@@ -1723,9 +4429,9 @@ bool Warehouse::fetchRandomRiffBySeed( const endlesss::constants::RootScalePairs
 #endif
 
         {
-            Warehouse::SqlDB::TransactionGuard txn;
+            SqlDBReader::TransactionGuard txn;
 
-            auto query = Warehouse::SqlDB::query<_randomFilteredRiff>( rootScalePtr, rootScaleCount, BPM, cVirtualJamName.data(), seedValue );
+            auto query = SqlDBReader::query<_randomFilteredRiff>( rootScalePtr, rootScaleCount, BPM, cVirtualJamName.data(), seedValue );
 
             float bpmRange;
             int32_t _hash;
@@ -1782,10 +4488,10 @@ bool Warehouse::batchFindJamIDForStem( const endlesss::types::StemCouchIDs& stem
 
     endlesss::types::JamCouchID emptyResult;
 
-    Warehouse::SqlDB::TransactionGuard txn;
+    SqlDBReader::TransactionGuard txn;
     for ( const auto& stemID : stems )
     {
-        auto query = Warehouse::SqlDB::query<_ownerJamForStemID>( stemID.value() );
+        auto query = SqlDBReader::query<_ownerJamForStemID>( stemID.value() );
 
         std::string_view jamCID;
         if ( query( jamCID ) )
@@ -1811,7 +4517,7 @@ bool Warehouse::fetchAllStemsForJam( const types::JamCouchID& jamCouchID, endles
             select count(*) from stems where OwnerJamCID = ?1;
         )";
 
-        auto query = Warehouse::SqlDB::query<_countStemsInJam>( jamCouchID.value() );
+        auto query = SqlDBReader::query<_countStemsInJam>( jamCouchID.value() );
         if ( !query( stemCount ) )
         {
             blog::database( FMTX( "unable to get stem count from jam [{}]" ), jamCouchID );
@@ -1831,7 +4537,7 @@ bool Warehouse::fetchAllStemsForJam( const types::JamCouchID& jamCouchID, endles
             select StemCID, FileLength from stems where OwnerJamCID = ?1 order by CreationTime asc;
         )";
 
-        auto query = Warehouse::SqlDB::query<_allStemsInJam>( jamCouchID.value() );
+        auto query = SqlDBReader::query<_allStemsInJam>( jamCouchID.value() );
 
         std::string_view stemCID;
         uint64_t stemFileLengthBytes = 0;
@@ -1849,7 +4555,7 @@ bool Warehouse::fetchAllStemsForJam( const types::JamCouchID& jamCouchID, endles
 // ---------------------------------------------------------------------------------------------------------------------
 bool Warehouse::fetchSingleStemByID( const types::StemCouchID& stemCouchID, endlesss::types::Stem& result ) const
 {
-    return sql::stems::getSingleStemByID( stemCouchID, result );
+    return sql::stems::getSingleStemByID<SqlDBReader>( stemCouchID, result );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -1864,7 +4570,7 @@ bool Warehouse::fetchAllStems( endlesss::types::StemCouchIDs& result, std::size_
             select count(*) from stems;
         )";
 
-        auto query = Warehouse::SqlDB::query<_countAllStems>();
+        auto query = SqlDBReader::query<_countAllStems>();
         if ( !query( stemCount ) )
         {
             blog::database( FMTX( "unable to get stem count for entire database" ) );
@@ -1884,7 +4590,7 @@ bool Warehouse::fetchAllStems( endlesss::types::StemCouchIDs& result, std::size_
             select StemCID, FileLength from stems;
         )";
 
-        auto query = Warehouse::SqlDB::query<_allStems>();
+        auto query = SqlDBReader::query<_allStems>();
 
         std::string_view stemCID;
         uint64_t stemFileLengthBytes = 0;
@@ -2026,6 +4732,8 @@ endlesss::types::RiffIdentity Warehouse::createNewVirtualRiff( const endlesss::t
         gainsJsonText.c_str()
     );
 
+    m_harmonicIndex->upsertRiffs( { endlesss::types::RiffCouchID{ baseRiffCID } } );
+
     return { 
         endlesss::types::JamCouchID{ cVirtualJamName },
         endlesss::types::RiffCouchID{ baseRiffCID }
@@ -2043,6 +4751,8 @@ void Warehouse::clearOutVirtualJamStorage()
         Warehouse::SqlDB::TransactionGuard txn;
         Warehouse::SqlDB::query<deleteRiffs>( cVirtualJamName.data() );
     }
+
+    m_harmonicIndex->removeJam( endlesss::types::JamCouchID{ cVirtualJamName } );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -2114,6 +4824,13 @@ void Warehouse::threadWorker()
             continue;
         }
 
+        // write out anything the sync fetch threads have finished with before picking up new work
+        if ( insertCompletedSyncFetches() )
+            tryEnqueueReport( false );
+
+        if ( m_workerThreadPaused )
+            continue;
+
         Task nextTask;
         
         // something to do? check the priority pile first in case we have stuff that needs running before
@@ -2159,99 +4876,138 @@ void Warehouse::threadWorker()
                 {
                     incrementChangeIndexForJam( jamToIncrement );
                 }
+
+                nextTask->updateHarmonicIndex( *m_harmonicIndex );
             }
         }
         // go looking for holes to fill
         else
         {
-            const bool hasEndlesssNetwork = hasFullEndlesssNetworkAccess();
+            // keep the sync fetch threads busy; if anything is in flight, go back to waiting - completed fetches
+            // signal the worker so they get written out promptly at the top of the loop
+            if ( hasFullEndlesssNetworkAccess() && dispatchSyncFetches() )
+            {
+                scrapingIsRunning = true;
+                continue;
+            }
+
+            // if we were running scraping tasks and we just finished, kick off a final report generation
+            if ( scrapingIsRunning )
+            {
+                scrapingIsRunning = false;
+                tryEnqueueReport( true );
+            }
+
+            if ( m_cbWorkUpdate )
+                m_cbWorkUpdate( false, "Database Idle" );
+        }
+    }
+
+    if ( m_cbWorkUpdate )
+        m_cbWorkUpdate( false, "" );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool Warehouse::dispatchSyncFetches()
+{
+    base::instr::ScopedEvent se( "FILL", base::instr::PresetColour::Orange );
+
+    // fill every free slot; stems take priority over riffs, as before, given that new riffs just bring in more stems
+    while ( m_syncEngine->canDispatch() )
+    {
+        types::JamCouchID owningJamCID;
+
+        // how about some stems?
+        types::StemCouchID emptyStemCID;
+        if ( sql::stems::findUnpopulated( owningJamCID, emptyStemCID ) && m_syncEngine->dispatchStems( owningJamCID ) )
+            continue;
+
+        // can we find some juicy new riffs?
+        types::RiffCouchID emptyRiffCID;
+        if ( sql::riffs::findUnpopulated( owningJamCID, emptyRiffCID ) )
+        {
+            if ( m_syncEngine->dispatchRiffs( owningJamCID ) )
+                continue;
 
-            // fill in empty stems
-            if ( hasEndlesssNetwork )
+            // with nothing in flight to exclude, the batch query should have found at least the one riff we just did
+            if ( m_syncEngine->getInFlightCount() == 0 )
             {
-                base::instr::ScopedEvent se( "FILL", "Stems", base::instr::PresetColour::Orange );
-
-                types::JamCouchID owningJamCID;
-                types::StemCouchID emptyStemCID;
-                if ( sql::stems::findUnpopulated( owningJamCID, emptyStemCID ) )
-                {
-                    if ( m_cbWorkUpdate )
-                        m_cbWorkUpdate( true, "Finding unpopulated stems..." );
+                const std::string errorReport = fmt::format( FMTX( "we found one empty riff ({}, in jam {}) but failed during batch?" ), emptyRiffCID, owningJamCID );
+                blog::error::database( FMTX("Riff Sync Error : {}"), errorReport );
 
-                    // how about some stems?
-                    std::vector<types::StemCouchID> emptyStems;
-                    if ( sql::stems::findUnpopulatedBatch( owningJamCID, 40, emptyStems ) )
-                    {
-                        incrementChangeIndexForJam( owningJamCID );
-
-                        // stem me up
-                        m_taskSchedule->enqueueWorkTask<GetStemData>( *m_networkConfiguration, owningJamCID, emptyStems );
+                m_eventBusClient.Send<::events::AddToastNotification>(
+                    ::events::AddToastNotification::Type::Error,
+                    "Warehouse Riff Sync Error",
+                    errorReport );
+            }
+        }
+        break;
+    }
 
-                        tryEnqueueReport( false );
+    const std::size_t fetchesInFlight = m_syncEngine->getInFlightCount();
+    if ( fetchesInFlight > 0 && m_cbWorkUpdate )
+        m_cbWorkUpdate( true, fmt::format( FMTX( "Syncing riffs & stems, {} fetches in flight ..." ), fetchesInFlight ) );
 
-                        scrapingIsRunning = true;
-                        continue;
-                    }
-                    else
-                    {
-                        blog::error::database( FMTX( "stems::findUnpopulatedBatch() failed" ) );
-                    }
-                }
-            }
-            // scour for empty riffs
-            if ( hasEndlesssNetwork )
-            {
-                base::instr::ScopedEvent se( "FILL", "Riffs", base::instr::PresetColour::Red );
+    return fetchesInFlight > 0;
+}
 
-                types::JamCouchID owningJamCID;
-                types::RiffCouchID emptyRiffCID;
-                if ( sql::riffs::findUnpopulated( owningJamCID, emptyRiffCID ) )
-                {
-                    if ( m_cbWorkUpdate )
-                        m_cbWorkUpdate( true, "Finding unpopulated riffs..." );
+// ---------------------------------------------------------------------------------------------------------------------
+bool Warehouse::insertCompletedSyncFetches()
+{
+    SyncEngine::Jobs fetchedJobs;
+    m_syncEngine->collectCompleted( fetchedJobs );
 
-                    // can we find some juicy new riffs?
-                    std::vector<types::RiffCouchID> emptyRiffs;
-                    if ( sql::riffs::findUnpopulatedBatch( owningJamCID, 40, emptyRiffs ) )
-                    {
-                        incrementChangeIndexForJam( owningJamCID );
+    // every fetch has its own retries inside NetConfiguration::attempt(); if whole batches keep failing regardless,
+    // halt the worker in the same way a failed task would
+    if ( m_syncEngine->hasHitFailureLimit() )
+    {
+        m_syncEngine->resetFailures();
 
-                        // off to riff town
-                        m_taskSchedule->enqueueWorkTask<GetRiffDataTask>( *m_networkConfiguration, owningJamCID, emptyRiffs );
+        if ( m_cbWorkUpdate )
+            m_cbWorkUpdate( false, "Paused due to sync errors" );
 
-                        tryEnqueueReport( false );
+        m_eventBusClient.Send<::events::AddToastNotification>(
+            ::events::AddToastNotification::Type::Error,
+            "Warehouse Update Halted",
+            "Repeated failures fetching riff & stem data" );
 
-                        scrapingIsRunning = true;
-                        continue;
-                    }
-                    else
-                    {
-                        const std::string errorReport = fmt::format( FMTX( "we found one empty riff ({}, in jam {}) but failed during batch?" ), emptyRiffCID, owningJamCID );
-                        blog::error::database( FMTX("Riff Sync Error : {}"), errorReport );
+        m_workerThreadPaused = true;
+    }
 
-                        m_eventBusClient.Send<::events::AddToastNotification>(
-                            ::events::AddToastNotification::Type::Error,
-                            "Warehouse Riff Sync Error",
-                            errorReport );
-                    }
-                }
-            }
+    if ( fetchedJobs.empty() )
+        return false;
 
+    absl::flat_hash_set< types::JamCouchID > changedJams;
+    std::vector< types::RiffCouchID > changedRiffs;
+    {
+        base::instr::ScopedEvent se( "SYNC", "Insert", base::instr::PresetColour::Indigo );
 
-            // if we were running scraping tasks and we just finished, kick off a final report generation
-            if ( scrapingIsRunning )
+        // everything that's landed goes in as one transaction
+        Warehouse::SqlDB::TransactionGuard txn;
+        for ( const auto& job : fetchedJobs )
+        {
+            if ( job->m_isRiffBatch )
             {
-                scrapingIsRunning = false;
-                tryEnqueueReport( true );
+                sync::insert( job->m_riffs, SyncEngine::TagRiffs );
+
+                changedJams.emplace( job->m_riffs.m_jamCID );
+                changedRiffs.insert( changedRiffs.end(), job->m_riffs.m_riffCIDs.begin(), job->m_riffs.m_riffCIDs.end() );
             }
+            else
+            {
+                sync::insert( job->m_stems, SyncEngine::TagStems );
 
-            if ( m_cbWorkUpdate )
-                m_cbWorkUpdate( false, "Database Idle" );
+                changedJams.emplace( job->m_stems.m_jamCID );
+            }
         }
     }
 
-    if ( m_cbWorkUpdate )
-        m_cbWorkUpdate( false, "" );
+    for ( const auto& jamCID : changedJams )
+        incrementChangeIndexForJam( jamCID );
+
+    m_harmonicIndex->upsertRiffs( changedRiffs );
+
+    return true;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -2276,6 +5032,24 @@ void Warehouse::incrementChangeIndexForJam( const ::endlesss::types::JamCouchID&
     {
         m_changeIndexMap[jamID] = ChangeIndex( cIt->second.get() + 1 );
     }
+
+    // any slice snapshot is now out of date; drop it so that it can't be picked up by a later session where the
+    // change index has been reset. this runs on the worker thread, same as the slice tasks that write them
+    const fs::path snapshotFile = getJamSliceSnapshotFile( jamID );
+    if ( !snapshotFile.empty() )
+    {
+        std::error_code removeError;
+        fs::remove( snapshotFile, removeError );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+fs::path Warehouse::getJamSliceSnapshotFile( const ::endlesss::types::JamCouchID& jamID ) const
+{
+    if ( m_jamSliceSnapshotPath.empty() )
+        return {};
+
+    return m_jamSliceSnapshotPath / fmt::format( FMTX( "{}.jamslice" ), jamID.value() );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -2301,6 +5075,12 @@ void Warehouse::event_RiffTagAction( const events::RiffTagAction* eventData )
     }
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+void JamSnapshotTask::updateHarmonicIndex( Warehouse::HarmonicIndex& harmonicIndex ) const
+{
+    harmonicIndex.refreshJam( m_jamCID );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 bool JamSnapshotTask::Work( TaskQueue& currentTasks )
 {
@@ -2392,6 +5172,12 @@ bool JamSnapshotTask::Work( TaskQueue& currentTasks )
     return true;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+void JamPurgeTask::updateHarmonicIndex( Warehouse::HarmonicIndex& harmonicIndex ) const
+{
+    harmonicIndex.removeJam( m_jamCID );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 bool JamPurgeTask::Work( TaskQueue& currentTasks )
 {
@@ -2416,6 +5202,7 @@ bool JamPurgeTask::Work( TaskQueue& currentTasks )
         Warehouse::SqlDB::query<deleteJam>( m_jamCID.value() );
         Warehouse::SqlDB::query<deleteRiffs>( m_jamCID.value() );
         Warehouse::SqlDB::query<deleteStems>( m_jamCID.value() );
+        sql::contents::removeJam( m_jamCID );
     }
 
     blog::database( "[{}] wiped [{}] from Db", Tag, m_jamCID.value() );
@@ -2442,6 +5229,9 @@ bool JamExportTask::Work( TaskQueue& currentTasks )
 {
     OperationCompleteOnScopeExit( m_operationID );
 
+    if ( m_exportFormat == Warehouse::ExportFormat::Binary )
+        return writeBinaryArchive();
+
     const std::string exportFilenameYaml = Warehouse::createExportFilenameForJam( m_jamCID, m_jamName, "yaml" );
 
     const fs::path finalOutputFile = m_exportFolder / exportFilenameYaml;
@@ -2574,12 +5364,58 @@ bool JamExportTask::Work( TaskQueue& currentTasks )
     return true;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+bool JamExportTask::writeBinaryArchive()
+{
+    const std::string exportFilename = Warehouse::createExportFilenameForJam( m_jamCID, m_jamName, Warehouse::cBinaryArchiveExtension );
+
+    const fs::path finalOutputFile = m_exportFolder / exportFilename;
+    blog::database( FMTX( "Binary export process for [{}] to [{}]" ), m_jamName, finalOutputFile.string() );
+
+    fs::path stemDirectory;
+    if ( !m_stemCacheRoot.empty() )
+        stemDirectory = m_stemCacheRoot / fs::path( m_jamCID.value() );
+
+    spacetime::ScopedTimer exportTiming( "JamExportTask::writeBinaryArchive" );
+
+    const auto writeResult = jamarchive::write( finalOutputFile, m_jamCID, m_jamName, stemDirectory );
+    if ( !writeResult.ok() )
+    {
+        blog::error::database( FMTX( "[{}] binary export failed, {}" ), Tag, writeResult.status().ToString() );
+
+        m_eventBusClient.Send<::events::AddToastNotification>( ::events::AddToastNotification::Type::Error,
+            ICON_FA_BOX " Jam Export Error",
+            writeResult.status().ToString() );
+
+        return true;
+    }
+
+    blog::database( FMTX( "[{}] archived {} riffs, {} stems, {} bytes of bundled stem data" ), Tag, writeResult->m_riffCount, writeResult->m_stemCount, writeResult->m_bundledTarBytes );
+
+    m_eventBusClient.Send<::events::AddToastNotification>( ::events::AddToastNotification::Type::Info,
+        ICON_FA_BOX " Jam Export Success",
+        fmt::format( FMTX( "Written to {}" ), exportFilename ) );
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+void JamImportTask::updateHarmonicIndex( Warehouse::HarmonicIndex& harmonicIndex ) const
+{
+    if ( !m_importedJamCID.empty() )
+        harmonicIndex.refreshJam( m_importedJamCID );
+}
 
 // ---------------------------------------------------------------------------------------------------------------------
 bool JamImportTask::Work( TaskQueue& currentTasks )
 {
     OperationCompleteOnScopeExit( m_operationID );
 
+    // binary archives are identified by their header rather than trusting the extension
+    if ( jamarchive::isArchive( m_fileToImport ) )
+        return readBinaryArchive();
+
     auto loadStatus = base::readTextFile( m_fileToImport );
 
     auto handleFailure = [this]( const absl::Status& failureStatus ) -> bool
@@ -2623,6 +5459,8 @@ bool JamImportTask::Work( TaskQueue& currentTasks )
     PARSE_AND_CHECK( headerJamName,         std::string,    "jam_name" );
     PARSE_AND_CHECK( headerJamCouchID,      std::string,    "jam_couch_id" );
 
+    m_importedJamCID = types::JamCouchID{ headerJamCouchID.value() };
+
     {
         const auto exportTimeUnix = spacetime::InSeconds( std::chrono::seconds( static_cast<uint64_t>( headerExportTimeUnix.value() ) ) );
         const auto exportTimeDelta = spacetime::calculateDeltaFromNow( exportTimeUnix ).asPastTenseString( 3 );
@@ -2821,295 +5659,53 @@ bool JamImportTask::Work( TaskQueue& currentTasks )
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-bool GetRiffDataTask::Work( TaskQueue& currentTasks )
-{
-    blog::database( "[{}] collecting riff data ..", Tag );
-
-    // grab all the riff data
-    endlesss::api::RiffDetails riffDetails;
-    if ( !riffDetails.fetchBatch( m_netConfig, m_jamCID, m_riffCIDs ) )
-    {
-        blog::error::database( "[{}] Failed to fetch riff details from jam [{}]", Tag, m_jamCID );
-        return false;
-    }
-
-    // produce unique list of stem couch IDs from this batch of riffs; we can then mass-fetch the data to ensure its valid
-    std::vector< endlesss::types::StemCouchID > stemsToValidate;
-    StemSet uniqueStemCIDs;
-    uniqueStemCIDs.reserve( riffDetails.rows.size() * 8 );
-    stemsToValidate.reserve( riffDetails.rows.size() * 8 );
-    for ( const auto& netRiffData : riffDetails.rows )
-    {
-        types::Riff riffData{ m_jamCID, netRiffData.doc };
-        for ( auto stemI = 0; stemI < 8; stemI++ )
-        {
-            const auto& stemCID = riffData.stems[stemI];
-            if ( !stemCID.empty() )
-            {
-                const auto setInsert = uniqueStemCIDs.emplace( stemCID );
-                if ( setInsert.second )
-                {
-                    stemsToValidate.emplace_back( stemCID );
-                }
-            }
-        }
-    }
-    blog::database( "[{}] validating {} stems ..", Tag, stemsToValidate.size() );
-
-    // collect the type data for all the stems; there is a strange situation where some stem IDs turn out to
-    // be .. chat messages? so we need to remove those early on
-    endlesss::api::StemTypeCheck stemValidation;
-    if ( !stemValidation.fetchBatch( m_netConfig, m_jamCID, stemsToValidate ) )
-    {
-        blog::error::database( "[{}] Failed to validate stem details [{}]", Tag );
-        return false;
-    }
-    // re-use the hash set, add in any stems that are found to be problematic
-    uniqueStemCIDs.clear();
-    for ( const auto& stemCheck : stemValidation.rows )
-    {
-        // missing key entirely, presumably moderated away
-        if ( !stemCheck.error.empty() )
-        {
-            uniqueStemCIDs.emplace( stemCheck.key );
-            blog::database( "[{}] Found stem with a retreival error ({}), ignoring ID [{}]", Tag, stemCheck.error, stemCheck.key );
-
-            sql::ledger::storeStemNote(
-                stemCheck.key,
-                Warehouse::StemLedgerType::REMOVED_ID,
-                fmt::format( "[{}]", stemCheck.error ) );
-
-            continue;
-        }
-
-        // does this have vintage attachment data? if so, allow the fact it might be also missing an app version tag
-        const bool bThisIsAnOldButValidStem = !stemCheck.doc._attachments.oggAudio.content_type.empty();
-
-        // check for invalid app version - this is usually a red flag for invalid stems but on very old jams this was the norm 
-        const bool ignoreForMissingAppData = ( stemCheck.doc.app_version == 0 && bThisIsAnOldButValidStem == false );
-
-        // stem is lacking app versioning (and isn't just old)
-        if ( ignoreForMissingAppData )
-        {
-            uniqueStemCIDs.emplace( stemCheck.key );
-            blog::database( "[{}] Found stem without app version ({}), ignoring ID [{}]", Tag, stemCheck.doc._attachments.oggAudio.digest, stemCheck.key );
-
-            sql::ledger::storeStemNote(
-                stemCheck.key,
-                Warehouse::StemLedgerType::REMOVED_ID,
-                fmt::format( "[{}]", stemCheck.error ) );
-
-            continue;
-        }
-        // stem was destroyed?
-        if ( stemCheck.value.deleted )
-        {
-            uniqueStemCIDs.emplace( stemCheck.key );
-            blog::database( "[{}] Found stem that was deleted ({}), ignoring ID [{}]", Tag, stemCheck.error, stemCheck.key );
-
-            sql::ledger::storeStemNote(
-                stemCheck.key,
-                Warehouse::StemLedgerType::REMOVED_ID,
-                fmt::format( "[{}]", stemCheck.error ) );
-
-            continue;
-        }
-
-        // this isn't a stem? 
-        if ( stemCheck.doc.type != "Loop" )
-        {
-            uniqueStemCIDs.emplace( stemCheck.doc._id );
-            blog::database( "[{}] Found stem that isn't a stem ({}), ignoring ID [{}]", Tag, stemCheck.doc.type, stemCheck.doc._id );
-
-            sql::ledger::storeStemNote(
-                stemCheck.doc._id,
-                Warehouse::StemLedgerType::DAMAGED_REFERENCE,
-                fmt::format( "[Ver:{}] Wrong type [{}]", stemCheck.doc.app_version, stemCheck.doc.type ) );
-
-            continue;
-        }
-        // this stem was damaged and has no audio data
-        if ( stemCheck.doc.cdn_attachments.oggAudio.endpoint.empty() &&
-             stemCheck.doc.cdn_attachments.flacAudio.endpoint.empty() )
-        {
-            uniqueStemCIDs.emplace( stemCheck.doc._id );
-            blog::database( "[{}] Found stem that is damaged, ignoring ID [{}]", Tag, stemCheck.doc._id );
-
-            sql::ledger::storeStemNote(
-                stemCheck.doc._id,
-                Warehouse::StemLedgerType::MISSING_OGG,   // previously this only happened with OGG sources.. potentially we could have missing FLAC here too
-                fmt::format( "[Ver:{}]", stemCheck.doc.app_version ) );
-
-            continue;
-        }
-    }
-
-
-    static constexpr char updateRiffDetails[] = R"(
-        UPDATE riffs SET CreationTime=?2,
-                         Root=?3,
-                         Scale=?4,
-                         BPS=?5,
-                         BPMrnd=?6,
-                         BarLength=?7,
-                         AppVersion=?8,
-                         Magnitude=?9,
-                         UserName=?10,
-                         StemCID_1=?11,
-                         StemCID_2=?12,
-                         StemCID_3=?13,
-                         StemCID_4=?14,
-                         StemCID_5=?15,
-                         StemCID_6=?16,
-                         StemCID_7=?17,
-                         StemCID_8=?18,
-                         GainsJSON=?19
-                         WHERE riffCID=?1
-    )";
-    static constexpr char insertOrIgnoreNewStemSkeleton[] = R"(
-        INSERT OR IGNORE INTO stems( stemCID, OwnerJamCID ) VALUES( ?1, ?2 );
-    )";
-
-    blog::database( "[{}] inserting {} rows of riff detail", Tag, riffDetails.rows.size() );
-
-    {
-        Warehouse::SqlDB::TransactionGuard txn;
-        for ( const auto& netRiffData : riffDetails.rows )
-        {
-            types::Riff riffData{ m_jamCID, netRiffData.doc };
-
-            for ( auto stemI = 0; stemI < 8; stemI++ )
-            {
-                const auto& stemCID = riffData.stems[stemI];
-                if ( stemCID.empty() )
-                    continue;
-
-                // check if this stem is meant to be ignored from the validation phase earlier
-                auto stemIter = uniqueStemCIDs.find( stemCID );
-                if ( stemIter != uniqueStemCIDs.end() )
-                {
-                    blog::database( "[{}] Removing stem {} from [{}] as it was marked as invalid", Tag, stemI, riffData.couchID );
-
-                    riffData.stemsOn[stemI] = false;
-                    riffData.stems[stemI] = endlesss::types::StemCouchID{ "" };
-                }
-                else
-                {
-                    // as we walk the stems, poke the couch ID into the stems table if it doesn't already exist
-                    // so that any new ones will be found and filled in later
-                    Warehouse::SqlDB::query<insertOrIgnoreNewStemSkeleton>( stemCID.value(), m_jamCID.value() );
-                }
-            }
-
-            auto gainsJson = fmt::format( R"([ {} ])", fmt::join( riffData.gains, ", " ) );
-
-            Warehouse::SqlDB::query<updateRiffDetails>(
-                riffData.couchID.value(),
-                riffData.creationTimeUnix,
-                riffData.root,
-                riffData.scale,
-                riffData.BPS,
-                riffData.BPMrnd,
-                riffData.barLength,
-                riffData.appVersion,
-                riffData.magnitude,
-                riffData.user,
-                riffData.stems[0].value(),
-                riffData.stems[1].value(),
-                riffData.stems[2].value(),
-                riffData.stems[3].value(),
-                riffData.stems[4].value(),
-                riffData.stems[5].value(),
-                riffData.stems[6].value(),
-                riffData.stems[7].value(),
-                gainsJson
-            );
-        }
-    }
-
-    // add an additional pause to network fetch tasks to avoid hitting Endlesss too hard
-    addNetworkPause();
-
-    return true;
-}
-
-// ---------------------------------------------------------------------------------------------------------------------
-bool GetStemData::Work( TaskQueue& currentTasks )
+bool JamImportTask::readBinaryArchive()
 {
-    blog::database( "[{}] collecting stem data ..", Tag );
+    spacetime::ScopedTimer importTiming( "JamImportTask::readBinaryArchive" );
 
-    endlesss::api::StemDetails stemDetails;
-    if ( !stemDetails.fetchBatch( m_netConfig, m_jamCID, m_stemCIDs ) )
-    {
-        blog::error::database( "[{}] Failed to fetch stem details from jam [{}]", Tag, m_jamCID );
-        return false;
-    }
-
-    static constexpr char updateStemDetails[] = R"(
-        UPDATE stems SET CreationTime=?2,
-                         FileEndpoint=?3,
-                         FileBucket=?4,
-                         FileKey=?5,
-                         FileMIME=?6,
-                         FileLength=?7,
-                         BPS=?8,
-                         BPMrnd=?9,
-                         Instrument=?10,
-                         Length16s=?11,
-                         OriginalPitch=?12,
-                         BarLength=?13,
-                         PresetName=?14,
-                         CreatorUserName=?15,
-                         SampleRate=?16,
-                         PrimaryColour=?17
-                         WHERE stemCID=?1
-    )";
+    // begin a single mass transaction for adding the whole jam; a damaged archive is rolled back rather than half-imported
+    Warehouse::SqlDB::TransactionGuard txn;
 
-    blog::database( "[{}] inserting {} rows of stem detail", Tag, stemDetails.rows.size() );
+    const auto readResult = jamarchive::read( m_fileToImport, m_stemCacheRoot );
+    if ( !readResult.ok() )
+    {
+        txn.rollback();
+
+        blog::error::database( FMTX( "Failed to import jam archive from [{}], {}" ), m_fileToImport.string(), readResult.status().ToString() );
+
+        m_eventBusClient.Send<::events::AddToastNotification>( ::events::AddToastNotification::Type::Error,
+            ICON_FA_BOX_OPEN " Jam Import Failed",
+            readResult.status().ToString() );
+
+        return true;
+    }
+
+    m_importedJamCID = readResult->m_jamCID;
 
     {
-        Warehouse::SqlDB::TransactionGuard txn;
-        for ( const auto& stemData : stemDetails.rows )
-        {
-            const auto unixTime = (uint32_t)(stemData.doc.created / 1000); // from unix nano
-
-            int32_t instrumentMask = 0;
-            if ( stemData.doc.isDrum )
-                instrumentMask |= 1 << 1;
-            if ( stemData.doc.isNote )
-                instrumentMask |= 1 << 2;
-            if ( stemData.doc.isBass )
-                instrumentMask |= 1 << 3;
-            if ( stemData.doc.isMic )
-                instrumentMask |= 1 << 4;
-
-            const endlesss::api::IStemAudioFormat& audioFormat = stemData.doc.cdn_attachments.getAudioFormat();
-
-            Warehouse::SqlDB::query<updateStemDetails>(
-                stemData.id.value(),
-                unixTime,
-                audioFormat.getEndpoint().data(),
-                audioFormat.getBucket().data(),
-                audioFormat.getKey().data(),
-                audioFormat.getMIME().data(),
-                audioFormat.getLength(),
-                stemData.doc.bps,
-                types::BPStoRoundedBPM( stemData.doc.bps ),
-                instrumentMask,
-                stemData.doc.length16ths,
-                stemData.doc.originalPitch,
-                stemData.doc.barLength,
-                stemData.doc.presetName,
-                stemData.doc.creatorUserName,
-                (int32_t)stemData.doc.sampleRate,
-                stemData.doc.primaryColour
-            );
-        }
+        const auto exportTimeUnix = spacetime::InSeconds( std::chrono::seconds( readResult->m_exportTimeUnix ) );
+        const auto exportTimeDelta = spacetime::calculateDeltaFromNow( exportTimeUnix ).asPastTenseString( 3 );
+
+        blog::database( FMTX( "Imported [{}] {}, {} riffs, {} stems{}" ),
+            readResult->m_jamName,
+            readResult->m_jamCID,
+            readResult->m_riffCount,
+            readResult->m_stemCount,
+            readResult->m_stemsExtracted ? " (with stem files)" : "" );
+        blog::database( FMTX( "Export data from v.{}; {}" ), readResult->m_exportVersion, exportTimeDelta );
     }
 
-    // add an additional pause to network fetch tasks to avoid hitting Endlesss too hard
-    addNetworkPause();
+    m_eventBusClient.Send<::events::AddToastNotification>( ::events::AddToastNotification::Type::Info,
+        ICON_FA_BOX " Jam Import Success",
+        fmt::format( FMTX( "Imported data into [{}]" ), readResult->m_jamName ) );
+
+    return true;
+}
 
+// ---------------------------------------------------------------------------------------------------------------------
+bool HarmonicIndexTask::Work( TaskQueue& currentTasks )
+{
+    m_harmonicIndex.build();
     return true;
 }
 
@@ -3118,8 +5714,29 @@ bool JamSliceTask::Work( TaskQueue& currentTasks )
 {
     spacetime::ScopedTimer stemTiming( "JamSliceTask::Work" );
 
-    // count up riffs and prepare a memory buffer to populate with the results
-    const int64_t riffCount = sql::riffs::countPopulated( m_jamCID, true );
+    const jamslice::Fingerprint fingerprint = jamslice::Fingerprint::fetch( m_jamCID );
+
+    // if the jam hasn't changed since we last built this slice, the snapshot on disk can be handed straight back
+    if ( !m_snapshotFile.empty() )
+    {
+        auto snapshotResult = jamslice::read( m_snapshotFile, m_jamCID, m_changeIndex, fingerprint );
+        if ( snapshotResult.ok() )
+        {
+            blog::database( FMTX( "[{}] jam slice for [{}] loaded from snapshot" ), Tag, m_jamCID );
+
+            if ( m_reportCallback )
+                m_reportCallback( m_jamCID, std::move( snapshotResult.value() ) );
+
+            return true;
+        }
+        if ( !absl::IsNotFound( snapshotResult.status() ) )
+        {
+            blog::database( FMTX( "[{}] rebuilding jam slice for [{}], {}" ), Tag, m_jamCID, snapshotResult.status().ToString() );
+        }
+    }
+
+    // prepare a memory buffer to populate with the results; fingerprint holds the populated riff count
+    const int64_t riffCount = fingerprint.m_populatedRiffs;
     auto resultSlice = std::make_unique<Warehouse::JamSlice>( m_jamCID, riffCount );
 
     // extract the basic riff information and weave in user data from the stems table so that we can 
@@ -3179,8 +5796,10 @@ bool JamSliceTask::Work( TaskQueue& currentTasks )
     int8_t               previousnumberOfUnseenStems = 0;
     bool                 firstRiffInSequence = true;
 
-    // hashing used for usernames, matching what the apps use too
-    absl::Hash<std::string_view> nameHasher;
+    // usernames are hashed once per unique name; the dictionary is also what gets written to the snapshot
+    jamslice::UserDictionary userDictionary;
+    userDictionary.m_riffUsers.reserve( riffCount );
+    userDictionary.m_stemUsers.reserve( riffCount );
 
     while ( query( jamCID,
                    riffCID,
@@ -3206,7 +5825,10 @@ bool JamSliceTask::Work( TaskQueue& currentTasks )
                    stemCIDs[7],
                    stemUsers[7] ) )
     {
-        const uint64_t hashedUsername = nameHasher(username);
+        const uint32_t usernameIndex = userDictionary.intern( username );
+        userDictionary.m_riffUsers.push_back( usernameIndex );
+
+        const uint64_t hashedUsername = userDictionary.getHash( usernameIndex );
 
         const auto contextTimestamp = spacetime::InSeconds{ std::chrono::seconds{ timestamp } };
 
@@ -3241,8 +5863,12 @@ bool JamSliceTask::Work( TaskQueue& currentTasks )
         // encode per-stem user names as their hashes
         {
             Warehouse::JamSlice::StemUserHashes& stemUserHashes = resultSlice->m_stemUserHashes.emplace_back();
+            jamslice::UserDictionary::UserIndices& stemUserIndices = userDictionary.m_stemUsers.emplace_back();
             for ( auto stemI = 0; stemI < 8; stemI++ )
-                stemUserHashes[stemI] = nameHasher(stemUsers[stemI]);
+            {
+                stemUserIndices[stemI] = userDictionary.intern( stemUsers[stemI] );
+                stemUserHashes[stemI]  = userDictionary.getHash( stemUserIndices[stemI] );
+            }
         }
 
         // first riff reports no deltas
@@ -3271,6 +5897,16 @@ bool JamSliceTask::Work( TaskQueue& currentTasks )
             strcpy( previousStemIDs[stemI], stemCIDs[stemI].data() );
     }
 
+    // stash the result so the next request can skip all of the above if nothing changes in the meantime
+    if ( !m_snapshotFile.empty() )
+    {
+        const absl::Status snapshotStatus = jamslice::write( m_snapshotFile, m_changeIndex, fingerprint, *resultSlice, userDictionary );
+        if ( !snapshotStatus.ok() )
+        {
+            blog::error::database( FMTX( "[{}] unable to write jam slice snapshot, {}" ), Tag, snapshotStatus.ToString() );
+        }
+    }
+
     // move the report out to the callback for it to deal with
     if ( m_reportCallback )
         m_reportCallback( m_jamCID, std::move(resultSlice) );
@@ -3286,52 +5922,17 @@ bool ContentsReportTask::Work( TaskQueue& currentTasks )
 
     Warehouse::ContentsReport reportResult;
 
-    absl::flat_hash_set< std::string > uniqueJamIDs;
-    uniqueJamIDs.reserve( 64 );
-
-    // when brand new jams arrive, they don't have any stem data initially so [gatherPopulations] returns nothing
-    // as the JOIN fails; however, to ensure we get the name of the jam into the contents report early so users don't
-    // wonder why it isn't there (before enough data is synced to magic up some empty stem entries), we first grab 
-    // a plain distinct set of jam IDs from the riff table and delete from it anything that [gatherPopulations] pulls in,
-    // leaving us with a hash set of jam IDs that have no synced data yet - which we can then emit as 0,0,0,0 in the report
-    {
-        static constexpr char gatherUniqueJams[] = R"(
-        select distinct OwnerJamCID from Riffs
-        )";
-
-        auto query = Warehouse::SqlDB::query<gatherUniqueJams>();
-
-        std::string_view jamCID;
-        while ( query( jamCID ) )
-        {
-            // ignore the magic virtual jam collection
-            if ( jamCID == Warehouse::cVirtualJamName )
-                continue;
+    // when brand new jams arrive, they don't have any stem data initially; to ensure we get the name of the jam into
+    // the contents report early so users don't wonder why it isn't there (before enough data is synced to magic up some
+    // empty stem entries), we emit these as 0,0,0,0 and flagged as awaiting sync, after all the jams with real data
+    std::vector< std::string > awaitingSyncJamIDs;
 
-            uniqueJamIDs.emplace( jamCID );
-        }
-    }
     {
-        // gather unified set of empty/not-empty counts from steams and riffs in a single blast
+        // counts are maintained by triggers on Riffs / Stems, see sql::contents
         static constexpr char gatherPopulations[] = R"(
-        SELECT a.OwnerJamCID, a.FilledRiffs, a.EmptyRiffs, b.FilledStems, b.EmptyStems
-            FROM 
-            (
-                SELECT Riffs.OwnerJamCID,
-                    count(case when Riffs.AppVersion is null then 1 end) as EmptyRiffs,
-                    count(case when Riffs.AppVersion is not null then 1 end) as FilledRiffs
-                FROM Riffs
-                GROUP BY Riffs.OwnerJamCID
-            ) as a
-            JOIN
-            (
-                SELECT Stems.OwnerJamCID,
-                    count(case when Stems.CreationTime is null then 1 end) as EmptyStems,
-                    count(case when Stems.CreationTime is not null then 1 end) as FilledStems
-                FROM Stems
-                GROUP BY Stems.OwnerJamCID
-            ) as b
-            ON a.OwnerJamCID = b.OwnerJamCID
+        SELECT JamCID, PopulatedRiffs, UnpopulatedRiffs, PopulatedStems, UnpopulatedStems
+            FROM JamContents
+            WHERE ( PopulatedRiffs + UnpopulatedRiffs ) > 0
         )";
 
         auto query = Warehouse::SqlDB::query<gatherPopulations>();
@@ -3352,7 +5953,11 @@ bool ContentsReportTask::Work( TaskQueue& currentTasks )
             if ( jamCID == Warehouse::cVirtualJamName )
                 continue;
 
-            uniqueJamIDs.erase( jamCID );   // this jam has sync data, remove it from the unique list as we'll be emitting data for it normally
+            if ( totalPopulatedStems + totalUnpopulatedStems == 0 )
+            {
+                awaitingSyncJamIDs.emplace_back( jamCID );
+                continue;
+            }
 
             reportResult.m_jamCouchIDs.emplace_back( jamCID );
 
@@ -3371,22 +5976,19 @@ bool ContentsReportTask::Work( TaskQueue& currentTasks )
         }
     }
 
-    // all remaining unique jam IDs haven't even had a single round of data sync yet but we want to show
+    // all remaining jam IDs haven't even had a single round of data sync yet but we want to show
     // the user we're going to consider them soon
-    if ( !uniqueJamIDs.empty() )
+    for ( const auto& unSyncJam : awaitingSyncJamIDs )
     {
-        for ( const auto& unSyncJam : uniqueJamIDs )
-        {
-            reportResult.m_jamCouchIDs.emplace_back( unSyncJam );
+        reportResult.m_jamCouchIDs.emplace_back( unSyncJam );
 
-            reportResult.m_populatedRiffs.emplace_back( 0 );
-            reportResult.m_unpopulatedRiffs.emplace_back( 0 );
+        reportResult.m_populatedRiffs.emplace_back( 0 );
+        reportResult.m_unpopulatedRiffs.emplace_back( 0 );
 
-            reportResult.m_populatedStems.emplace_back( 0 );
-            reportResult.m_unpopulatedStems.emplace_back( 0 );
+        reportResult.m_populatedStems.emplace_back( 0 );
+        reportResult.m_unpopulatedStems.emplace_back( 0 );
 
-            reportResult.m_awaitingInitialSync.emplace_back( true );
-        }
+        reportResult.m_awaitingInitialSync.emplace_back( true );
     }
 
     if ( m_reportCallback )
@@ -3395,5 +5997,547 @@ bool ContentsReportTask::Work( TaskQueue& currentTasks )
     return true;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+// synthetic data for Warehouse::runBenchmark(); builds api documents shaped like the ones the sync engine pulls down
+// from the network so that the real insert paths can be driven (and timed) without one
+//
+namespace bench {
+
+static constexpr std::string_view Tag = "BENCH";
+
+// 32 lowercase hex chars, same shape as a couch document ID
+static std::string generateCouchID( math::RNG32& rng )
+{
+    return fmt::format( FMTX( "{:08x}{:08x}{:08x}{:08x}" ), rng.genUInt32(), rng.genUInt32(), rng.genUInt32(), rng.genUInt32() );
+}
+
+// index into [0, count) skewed heavily towards the front; a handful of users end up making most of the riffs, much
+// like a busy public jam
+static uint32_t generateSkewedIndex( math::RNG32& rng, const uint32_t count )
+{
+    const float unit = rng.genFloat();
+    return std::min( count - 1, static_cast<uint32_t>( static_cast<float>( count ) * unit * unit * unit ) );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// walks a single jam forward one riff at a time, tracking which stems are live in each of the 8 slots
+struct JamGenerator
+{
+    JamGenerator( const Warehouse::BenchmarkSpec& spec, const uint32_t jamIndex, math::RNG32& rng )
+        : m_userCount( std::max( spec.userCount, 1U ) )
+        , m_userOffset( rng.genUInt32() % m_userCount )
+        , m_timestampMs( ( 1577836800ULL + ( jamIndex * 86400ULL ) ) * 1000ULL )     // jams start a day apart from 2020
+    {
+        m_jamCID  = types::JamCouchID{ fmt::format( FMTX( "band{:08x}" ), rng.genUInt32() ) };
+        m_jamName = fmt::format( FMTX( "benchmark jam {}" ), jamIndex );
+
+        newSession( rng );
+    }
+
+    types::JamCouchID                   m_jamCID;
+    std::string                         m_jamName;
+
+    uint32_t                            m_userCount;
+    uint32_t                            m_userOffset;       // rotates which users are the prolific ones in this jam
+    uint64_t                            m_timestampMs;
+
+    float                               m_bps           = 2.0f;
+    int32_t                             m_root          = 0;
+    int32_t                             m_scale         = 0;
+    float                               m_barLength     = 16.0f;
+
+    std::array< std::string, 8 >        m_slotStems;        // empty if the slot is off
+    std::array< float, 8 >              m_slotGains{};
+
+    std::string generateUserName( math::RNG32& rng ) const
+    {
+        return fmt::format( FMTX( "bench_user_{:05}" ), ( m_userOffset + generateSkewedIndex( rng, m_userCount ) ) % m_userCount );
+    }
+
+    // a burst of riffing usually stays in one tempo & key
+    void newSession( math::RNG32& rng )
+    {
+        m_bps       = static_cast<float>( rng.genInt32( 70, 170 ) ) / 60.0f;
+        m_root      = rng.genInt32( 0, static_cast<int32_t>( constants::cRootNames.size() ) - 1 );
+        m_scale     = rng.genInt32( 0, static_cast<int32_t>( constants::cScaleNames.size() ) - 1 );
+        m_barLength = ( rng.genInt32( 0, 3 ) == 0 ) ? 12.0f : 16.0f;
+    }
+
+    void generateStem( math::RNG32& rng, const std::string& stemCID, const std::string& userName, sync::StemBatch& stemBatch ) const
+    {
+        auto& stemRow = stemBatch.m_stemDetails.rows.emplace_back();
+        stemRow.id = types::StemCouchID{ stemCID };
+
+        auto& stemDoc = stemRow.doc;
+        stemDoc._id             = stemRow.id;
+        stemDoc.bps             = m_bps;
+        stemDoc.length16ths     = m_barLength * static_cast<float>( 1 << rng.genInt32( 0, 2 ) );
+        stemDoc.originalPitch   = 0;
+        stemDoc.barLength       = m_barLength;
+        stemDoc.presetName      = fmt::format( FMTX( "preset_{:03}" ), generateSkewedIndex( rng, 300 ) );
+        stemDoc.creatorUserName = userName;
+        stemDoc.primaryColour   = fmt::format( FMTX( "ff{:06x}" ), rng.genUInt32() & 0xffffff );
+        stemDoc.sampleRate      = ( rng.genInt32( 0, 1 ) == 0 ) ? 44100.0f : 48000.0f;
+        stemDoc.created         = m_timestampMs;
+
+        const int32_t instrument = rng.genInt32( 0, 9 );
+        stemDoc.isDrum          = instrument < 4;
+        stemDoc.isBass          = instrument == 4 || instrument == 5;
+        stemDoc.isMic           = instrument == 6;
+        stemDoc.isNote          = instrument > 6;
+
+        // newer jams are mostly lossless
+        const int32_t fileLength = rng.genInt32( 80 * 1024, 2 * 1024 * 1024 );
+        if ( rng.genInt32( 0, 3 ) != 0 )
+        {
+            auto& flac = stemDoc.cdn_attachments.flacAudio;
+            flac.endpoint   = "endlesss-dev.fra1.digitaloceanspaces.com";
+            flac.key        = fmt::format( FMTX( "attachments/flacAudio/{}/{}" ), m_jamCID, stemCID );
+            flac.url        = fmt::format( FMTX( "https://{}/{}" ), flac.endpoint, flac.key );
+            flac.length     = fileLength;
+        }
+        else
+        {
+            auto& ogg = stemDoc.cdn_attachments.oggAudio;
+            ogg.endpoint    = "ndls-att0.fra1.digitaloceanspaces.com";
+            ogg.key         = fmt::format( FMTX( "attachments/oggAudio/{}/{}" ), m_jamCID, stemCID );
+            ogg.url         = fmt::format( FMTX( "https://{}/{}" ), ogg.endpoint, ogg.key );
+            ogg.length      = fileLength / 3;
+        }
+    }
+
+    // produce the next riff in the jam, adding any stems that it introduces to the stem batch
+    void generateRiff( math::RNG32& rng, sync::RiffBatch& riffBatch, sync::StemBatch& stemBatch )
+    {
+        // riffs mostly land a few seconds to minutes apart, with the occasional gap of hours or days between sessions
+        if ( rng.genInt32( 0, 99 ) < 2 )
+        {
+            m_timestampMs += static_cast<uint64_t>( rng.genInt32( 3600, 3 * 86400 ) ) * 1000ULL;
+            newSession( rng );
+        }
+        else
+        {
+            m_timestampMs += static_cast<uint64_t>( rng.genInt32( 5, 240 ) ) * 1000ULL;
+        }
+
+        const std::string userName = generateUserName( rng );
+
+        // each riff changes one or two slots from the last, swapping in a new stem or occasionally muting one
+        const int32_t slotChanges = rng.genInt32( 1, 2 );
+        for ( int32_t change = 0; change < slotChanges; change++ )
+        {
+            const int32_t slot = rng.genInt32( 0, 7 );
+            if ( !m_slotStems[slot].empty() && rng.genInt32( 0, 3 ) == 0 )
+            {
+                m_slotStems[slot].clear();
+                continue;
+            }
+
+            m_slotStems[slot] = generateCouchID( rng );
+            m_slotGains[slot] = rng.genFloat( 0.3f, 1.0f );
+
+            generateStem( rng, m_slotStems[slot], userName, stemBatch );
+        }
+
+        const types::RiffCouchID riffCID{ generateCouchID( rng ) };
+        riffBatch.m_riffCIDs.emplace_back( riffCID );
+
+        auto& riffRow = riffBatch.m_riffDetails.rows.emplace_back();
+        riffRow.id = riffCID;
+
+        auto& riffDoc = riffRow.doc;
+        riffDoc._id             = riffCID;
+        riffDoc.userName        = userName;
+        riffDoc.created         = m_timestampMs;
+        riffDoc.root            = m_root;
+        riffDoc.scale           = m_scale;
+        riffDoc.app_version     = 1000 + rng.genInt32( 0, 200 );
+        riffDoc.magnitude       = rng.genFloat();
+        riffDoc.state.bps       = m_bps;
+        riffDoc.state.barLength = m_barLength;
+        riffDoc.state.playback.resize( 8 );
+        for ( std::size_t slot = 0; slot < 8; slot++ )
+        {
+            auto& current = riffDoc.state.playback[slot].slot.current;
+            current.on          = !m_slotStems[slot].empty();
+            current.currentLoop = m_slotStems[slot];
+            current.gain        = m_slotGains[slot];
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// keeps a uniform random sample of everything offered to it, for picking query inputs from the generated data
+template< typename _Type >
+struct Reservoir
+{
+    Reservoir( const std::size_t capacity )
+        : m_capacity( capacity )
+    {
+        m_samples.reserve( capacity );
+    }
+
+    void offer( math::RNG32& rng, const _Type& value )
+    {
+        m_offered++;
+        if ( m_samples.size() < m_capacity )
+        {
+            m_samples.emplace_back( value );
+            return;
+        }
+        const uint64_t slot = ( static_cast<uint64_t>( rng.genUInt32() ) * m_offered ) >> 32;
+        if ( slot < m_capacity )
+            m_samples[slot] = value;
+    }
+
+    std::size_t             m_capacity;
+    uint64_t                m_offered = 0;
+    std::vector< _Type >    m_samples;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// run fn once and log its duration against timing; fn returns the number of rows involved
+template< typename _Fn >
+static void sample( Warehouse::BenchmarkTiming& timing, _Fn&& fn )
+{
+    const spacetime::Moment started;
+    const uint64_t rows = fn();
+    timing.addSample( static_cast<double>( started.delta< std::chrono::microseconds >().count() ) * 1.0e-3, rows );
+}
+
+} // namespace bench
+
+// ---------------------------------------------------------------------------------------------------------------------
+absl::StatusOr< Warehouse::BenchmarkReport > Warehouse::runBenchmark( const BenchmarkSpec& spec, const fs::path& scratchFolder )
+{
+    static constexpr char _sqlCountRiffs[] = R"(
+        select count(*) from riffs;
+    )";
+    static constexpr char _sqlCountStems[] = R"(
+        select count(*) from stems;
+    )";
+    static constexpr char _sqlInsertRiffSkeleton[] = R"(
+        INSERT OR IGNORE INTO riffs( riffCID, OwnerJamCID ) VALUES( ?1, ?2 );
+    )";
+
+    {
+        int64_t existingRiffs = 0;
+        SqlDBReader::query<_sqlCountRiffs>()( existingRiffs );
+        if ( existingRiffs > 0 )
+            return absl::FailedPreconditionError( fmt::format( FMTX( "warehouse already holds {} riffs; benchmarks must run against an empty database" ), existingRiffs ) );
+    }
+    if ( spec.jamCount == 0 || spec.riffsPerJam == 0 || spec.insertBatchSize == 0 )
+        return absl::InvalidArgumentError( "benchmark spec is empty" );
+
+    BenchmarkReport report;
+    report.spec          = spec;
+    report.sqliteVersion = SQLITE_VERSION;
+
+    math::RNG32 rng( spec.seed );
+
+    bench::Reservoir< types::RiffCouchID > sampledRiffs( 4096 );
+    bench::Reservoir< types::StemCouchID > sampledStems( 4096 );
+    std::vector< types::JamCouchID >       generatedJams;
+    std::vector< std::string >             generatedJamNames;
+
+    // generation; the worker is held while we write so that nothing else sees the database half-built; a running task will
+    // finish but nothing new starts
+    const bool workerWasPaused = m_workerThreadPaused.exchange( true );
+    {
+        spacetime::ScopedTimer generationTiming( "warehouse benchmark [generation]" );
+
+        BenchmarkTiming timingSkeletons( "insert.riffSkeletons" );
+        BenchmarkTiming timingRiffs( "insert.riffBatch" );
+        BenchmarkTiming timingStems( "insert.stemBatch" );
+        BenchmarkTiming timingCommit( "insert.commit" );
+        BenchmarkTiming timingHarmonic( "harmonicIndex.upsertRiffs" );
+        BenchmarkTiming timingHarmonicBuild( "harmonicIndex.build" );
+
+        for ( uint32_t jamIndex = 0; jamIndex < spec.jamCount; jamIndex++ )
+        {
+            bench::JamGenerator jamGenerator( spec, jamIndex, rng );
+
+            upsertSingleJamIDToName( jamGenerator.m_jamCID, jamGenerator.m_jamName );
+
+            blog::database( FMTX( "[{}] generating {} riffs into [{}]" ), bench::Tag, spec.riffsPerJam, jamGenerator.m_jamCID );
+
+            for ( uint32_t riffsDone = 0; riffsDone < spec.riffsPerJam; riffsDone += spec.insertBatchSize )
+            {
+                const uint32_t riffsInBatch = std::min( spec.insertBatchSize, spec.riffsPerJam - riffsDone );
+
+                sync::RiffBatch riffBatch;
+                sync::StemBatch stemBatch;
+                riffBatch.m_jamCID = jamGenerator.m_jamCID;
+                stemBatch.m_jamCID = jamGenerator.m_jamCID;
+
+                for ( uint32_t riffI = 0; riffI < riffsInBatch; riffI++ )
+                    jamGenerator.generateRiff( rng, riffBatch, stemBatch );
+
+                for ( const auto& stemRow : stemBatch.m_stemDetails.rows )
+                {
+                    stemBatch.m_stemCIDs.emplace_back( stemRow.id );
+                    sampledStems.offer( rng, stemRow.id );
+                }
+                for ( const auto& riffCID : riffBatch.m_riffCIDs )
+                    sampledRiffs.offer( rng, riffCID );
+
+                // skeletons, as a jam snapshot would create them, then the detail fill in as a completed sync fetch
+                // would; both halves of the fill share a transaction here as there's no network gap between them
+                {
+                    SqlDB::TransactionGuard txn;
+                    bench::sample( timingSkeletons, [&]()
+                    {
+                        for ( const auto& riffCID : riffBatch.m_riffCIDs )
+                            SqlDB::query<_sqlInsertRiffSkeleton>( riffCID.value(), riffBatch.m_jamCID.value() );
+                        return riffBatch.m_riffCIDs.size();
+                    });
+                }
+                {
+                    std::optional< SqlDB::TransactionGuard > txn;
+                    txn.emplace();
+
+                    bench::sample( timingRiffs, [&]()
+                    {
+                        sync::insert( riffBatch, bench::Tag );
+                        return riffBatch.m_riffDetails.rows.size();
+                    });
+                    bench::sample( timingStems, [&]()
+                    {
+                        sync::insert( stemBatch, bench::Tag );
+                        return stemBatch.m_stemDetails.rows.size();
+                    });
+                    bench::sample( timingCommit, [&]()
+                    {
+                        txn.reset();
+                        return 0;
+                    });
+                }
+                bench::sample( timingHarmonic, [&]()
+                {
+                    m_harmonicIndex->upsertRiffs( riffBatch.m_riffCIDs );
+                    return riffBatch.m_riffCIDs.size();
+                });
+            }
+
+            // queued behind the pause, so these land before any of the task timings below get going
+            m_taskSchedule->enqueueWorkTask<JamChangedTask>( jamGenerator.m_jamCID );
+
+            generatedJams.emplace_back( jamGenerator.m_jamCID );
+            generatedJamNames.emplace_back( jamGenerator.m_jamName );
+        }
+
+        bench::sample( timingHarmonicBuild, [&]()
+        {
+            m_harmonicIndex->build();
+            return 0;
+        });
+
+        report.timings.insert( report.timings.end(), { timingSkeletons, timingRiffs, timingStems, timingCommit, timingHarmonic, timingHarmonicBuild } );
+    }
+
+    {
+        int64_t riffCount = 0, stemCount = 0;
+        SqlDBReader::query<_sqlCountRiffs>()( riffCount );
+        SqlDBReader::query<_sqlCountStems>()( stemCount );
+        report.riffCount = static_cast<uint64_t>( riffCount );
+        report.stemCount = static_cast<uint64_t>( stemCount );
+
+        std::error_code sizeError;
+        const auto databaseBytes = fs::file_size( m_databaseFile, sizeError );
+        report.databaseBytes = sizeError ? 0 : static_cast<uint64_t>( databaseBytes );
+    }
+
+    blog::database( FMTX( "[{}] generated {} riffs, {} stems, {}" ), bench::Tag, report.riffCount, report.stemCount, base::humaniseByteSize( "database ", report.databaseBytes ) );
+
+    // the synchronous queries, as called from the UI & pipeline threads
+    {
+        BenchmarkTiming timingFilterBPM( "filterRiffsByBPM" );
+        BenchmarkTiming timingRandomRiff( "fetchRandomRiffBySeed" );
+        BenchmarkTiming timingSingleRiff( "fetchSingleRiffByID" );
+        BenchmarkTiming timingFindJams( "batchFindJamIDForStem" );
+        BenchmarkTiming timingStemsForJam( "fetchAllStemsForJam" );
+
+        for ( uint32_t iteration = 0; iteration < spec.queryIterations; iteration++ )
+        {
+            constants::RootScalePairs keySearch;
+            keySearch.searchMode = constants::HarmonicSearch::NoAdditions;
+            keySearch.pairs.emplace_back(
+                static_cast<uint32_t>( rng.genInt32( 0, static_cast<int32_t>( constants::cRootNames.size() ) - 1 ) ),
+                static_cast<uint32_t>( rng.genInt32( 0, static_cast<int32_t>( constants::cScaleNames.size() ) - 1 ) ) );
+
+            std::vector< BPMCountTuple > bpmCounts;
+            bench::sample( timingFilterBPM, [&]()
+            {
+                return filterRiffsByBPM( keySearch, BPMCountSort::ByCount, bpmCounts );
+            });
+
+            if ( !bpmCounts.empty() )
+            {
+                const uint32_t chosenBPM = bpmCounts[ rng.genUInt32() % bpmCounts.size() ].m_BPM;
+                const int32_t  seedValue = rng.genInt32();
+
+                types::RiffComplete riffResult;
+                bench::sample( timingRandomRiff, [&]()
+                {
+                    return fetchRandomRiffBySeed( keySearch, chosenBPM, seedValue, riffResult ) ? 1 : 0;
+                });
+            }
+
+            if ( !sampledRiffs.m_samples.empty() )
+            {
+                const auto& riffCID = sampledRiffs.m_samples[ rng.genUInt32() % sampledRiffs.m_samples.size() ];
+
+                types::RiffComplete riffResult;
+                bench::sample( timingSingleRiff, [&]()
+                {
+                    return fetchSingleRiffByID( riffCID, riffResult ) ? 1 : 0;
+                });
+            }
+
+            // stems are looked up in batches, a random spread across all the jams
+            if ( !sampledStems.m_samples.empty() )
+            {
+                types::StemCouchIDs stemQuery;
+                for ( std::size_t stemI = 0; stemI < 64; stemI++ )
+                    stemQuery.emplace_back( sampledStems.m_samples[ rng.genUInt32() % sampledStems.m_samples.size() ] );
+
+                types::JamCouchIDs jamResults;
+                bench::sample( timingFindJams, [&]()
+                {
+                    batchFindJamIDForStem( stemQuery, jamResults );
+                    return jamResults.size();
+                });
+            }
+
+            {
+                types::StemCouchIDs stemResults;
+                std::size_t estimatedFileSize = 0;
+                bench::sample( timingStemsForJam, [&]()
+                {
+                    fetchAllStemsForJam( generatedJams[ iteration % generatedJams.size() ], stemResults, estimatedFileSize );
+                    return stemResults.size();
+                });
+            }
+        }
+
+        report.timings.insert( report.timings.end(), { timingFilterBPM, timingRandomRiff, timingSingleRiff, timingFindJams, timingStemsForJam } );
+    }
+
+    // worker tasks; these go through the task queues as normal, so the timings include the (tiny) hop onto the worker thread
+    m_workerThreadPaused = false;
+    m_taskSchedule->signal();
+    {
+        BenchmarkTiming timingContents( "task.contentsReport" );
+        BenchmarkTiming timingSliceQuery( "task.jamSlice.query" );
+        BenchmarkTiming timingSliceCached( "task.jamSlice.snapshot" );
+
+        // task callbacks land on the worker thread, we just wait here until they do
+        mcc::LightweightSemaphore taskComplete;
+        std::size_t taskRows = 0;
+
+        for ( uint32_t iteration = 0; iteration < std::min( spec.queryIterations, 10U ); iteration++ )
+        {
+            bench::sample( timingContents, [&]()
+            {
+                m_taskSchedulePriority->enqueueWorkTask<ContentsReportTask>( [&]( const ContentsReport& contents )
+                {
+                    taskRows = contents.m_jamCouchIDs.size();
+                    taskComplete.signal();
+                });
+                m_taskSchedule->signal();
+
+                taskComplete.wait();
+                return taskRows;
+            });
+        }
+
+        // first request for each jam runs the full extraction and writes a snapshot, the second should then load it
+        for ( const auto& jamCID : generatedJams )
+        {
+            for ( auto* timing : { &timingSliceQuery, &timingSliceCached } )
+            {
+                bench::sample( *timing, [&]()
+                {
+                    addJamSliceRequest( jamCID, [&]( const types::JamCouchID&, JamSlicePtr&& resultSlice )
+                    {
+                        taskRows = resultSlice ? resultSlice->m_ids.size() : 0;
+                        taskComplete.signal();
+                    });
+
+                    taskComplete.wait();
+                    return taskRows;
+                });
+            }
+        }
+
+        report.timings.insert( report.timings.end(), { timingContents, timingSliceQuery, timingSliceCached } );
+    }
+
+    // export / import, straight through the binary archive code rather than the tasks, which report back via the app event bus
+    {
+        BenchmarkTiming timingExport( "export.binary" );
+        BenchmarkTiming timingImport( "import.binary" );
+
+        for ( std::size_t jamI = 0; jamI < generatedJams.size(); jamI++ )
+        {
+            const fs::path archiveFile = scratchFolder / createExportFilenameForJam( generatedJams[jamI], generatedJamNames[jamI], cBinaryArchiveExtension );
+
+            absl::Status archiveStatus = absl::OkStatus();
+            bench::sample( timingExport, [&]() -> uint64_t
+            {
+                const auto writeResult = jamarchive::write( archiveFile, generatedJams[jamI], generatedJamNames[jamI], {} );
+                if ( !writeResult.ok() )
+                {
+                    archiveStatus = writeResult.status();
+                    return 0;
+                }
+                return writeResult->m_riffCount + writeResult->m_stemCount;
+            });
+            if ( !archiveStatus.ok() )
+            {
+                m_workerThreadPaused = workerWasPaused;
+                return archiveStatus;
+            }
+
+            // re-importing over the existing rows is a worst case for the import, every row is rewritten in place
+            bench::sample( timingImport, [&]() -> uint64_t
+            {
+                SqlDB::TransactionGuard txn;
+                const auto readResult = jamarchive::read( archiveFile, {} );
+                if ( !readResult.ok() )
+                {
+                    txn.rollback();
+                    archiveStatus = readResult.status();
+                    return 0;
+                }
+                return readResult->m_riffCount + readResult->m_stemCount;
+            });
+            if ( !archiveStatus.ok() )
+            {
+                m_workerThreadPaused = workerWasPaused;
+                return archiveStatus;
+            }
+        }
+
+        report.timings.insert( report.timings.end(), { timingExport, timingImport } );
+    }
+
+    m_workerThreadPaused = workerWasPaused;
+
+    for ( const auto& timing : report.timings )
+    {
+        blog::database( FMTX( "[{}] {:28} | {:6} samples | mean {:10.3f}ms | min {:10.3f}ms | max {:10.3f}ms | {} rows" ),
+            bench::Tag,
+            timing.name,
+            timing.samples,
+            timing.meanMs,
+            timing.minMs,
+            timing.maxMs,
+            timing.rows );
+    }
+
+    return report;
+}
+
 } // namespace toolkit
 } // namespace endlesss
@@ -33,6 +33,9 @@ struct Warehouse
     struct _change_index {};
     using ChangeIndex = base::id::Simple<_change_index, uint32_t, 1, 0>;
 
+    // internal lookup structure for the procedural riff queries, maintained by the worker thread
+    struct HarmonicIndex;
+
     struct ContentsReport
     {
         std::vector< types::JamCouchID >    m_jamCouchIDs;
@@ -179,6 +182,11 @@ struct Warehouse
     static std::string  m_databaseFile;
     using SqlDB = sqlite::Database<m_databaseFile>;
 
+    // read-only instantiation used by the synchronous fetch/filter functions that get called from UI and pipeline threads;
+    // connections are per-thread (so each calling thread effectively owns one from the pool, with its own cache of prepared
+    // statements) and as the database runs in WAL mode, these reads proceed in parallel with the worker thread's writes
+    using SqlDBReader = sqlite::Database<m_databaseFile, SQLITE_OPEN_READONLY>;
+
     // -----------------------------------------------------------------------------------------------------------------
 
 
@@ -221,7 +229,8 @@ struct Warehouse
     // insert a jam ID into the warehouse to be queried and filled
     ouro_nodiscard base::OperationID addOrUpdateJamSnapshot( const types::JamCouchID& jamCouchID );
 
-    // fetch the full stack of data for a given jam
+    // fetch the full stack of data for a given jam; if a columnar snapshot of the slice exists on disk and the jam
+    // hasn't changed since it was written, that is loaded directly instead of re-running the full extraction query
     void addJamSliceRequest( const types::JamCouchID& jamCouchID, const JamSliceCallback& callbackOnCompletion );
 
     // erase the given jam from the warehouse database entirely
@@ -238,8 +247,24 @@ struct Warehouse
     static constexpr base::OperationVariant OV_ExportAction{ 0xF1 };
     static constexpr base::OperationVariant OV_ImportAction{ 0xF2 };
 
-    ouro_nodiscard base::OperationID requestJamDataExport( const types::JamCouchID& jamCouchID, const fs::path exportFolder, std::string_view jamTitle );
-    ouro_nodiscard base::OperationID requestJamDataImport( const fs::path pathToData );
+    // Binary is a compact zstd-compressed columnar archive; the YAML form is kept for older builds and hand-inspection
+    enum class ExportFormat
+    {
+        Binary,
+        Yaml,
+    };
+    static constexpr std::string_view cBinaryArchiveExtension = "ojam";
+
+    // if stemCacheRootToBundle is set, the jam's cached stems are bundled into a Binary export alongside the database records
+    ouro_nodiscard base::OperationID requestJamDataExport(
+        const types::JamCouchID& jamCouchID,
+        const fs::path exportFolder,
+        std::string_view jamTitle,
+        const ExportFormat exportFormat = ExportFormat::Binary,
+        const fs::path stemCacheRootToBundle = {} );
+
+    // format is detected from the file contents; any stems bundled in a binary archive are unpacked into stemCacheRoot if set
+    ouro_nodiscard base::OperationID requestJamDataImport( const fs::path pathToData, const fs::path stemCacheRoot = {} );
 
     // produce a common format filename for exported things - database stuff, stem archives, etc
     ouro_nodiscard static std::string createExportFilenameForJam(
@@ -350,6 +375,101 @@ struct Warehouse
     void clearOutVirtualJamStorage();
 
 
+    // -----------------------------------------------------------------------------------------------------------------
+    // Benchmarking
+    // fills the database with synthetic jams through the same insert paths the sync engine uses, then times the main
+    // queries and tasks against the result. this is only meant to be pointed at an empty, scratch warehouse; see the
+    // runWarehouseBenchmark option in config::Performance
+    //
+
+    struct BenchmarkSpec
+    {
+        uint32_t    jamCount            = 8;
+        uint32_t    riffsPerJam         = 250000;
+        uint32_t    userCount           = 3000;         // usernames are drawn from this pool with a heavy skew to a few
+        uint32_t    insertBatchSize     = 200;          // riffs per insert transaction, same as a sync batch
+        uint32_t    queryIterations     = 100;          // repeat count for each of the synchronous query timings
+        uint32_t    seed                = 0x4F55524F;
+
+        template<class Archive>
+        inline void serialize( Archive& archive )
+        {
+            archive( CEREAL_NVP( jamCount )
+                   , CEREAL_NVP( riffsPerJam )
+                   , CEREAL_NVP( userCount )
+                   , CEREAL_NVP( insertBatchSize )
+                   , CEREAL_NVP( queryIterations )
+                   , CEREAL_NVP( seed )
+            );
+        }
+    };
+
+    struct BenchmarkTiming
+    {
+        BenchmarkTiming() = default;
+        BenchmarkTiming( const std::string_view timingName )
+            : name( timingName )
+        {}
+
+        std::string     name;
+        uint32_t        samples     = 0;
+        uint64_t        rows        = 0;            // rows produced or consumed across all samples, where meaningful
+        double          totalMs     = 0;
+        double          meanMs      = 0;
+        double          minMs       = 0;
+        double          maxMs       = 0;
+
+        void addSample( const double sampleMs, const uint64_t sampleRows )
+        {
+            minMs    = ( samples == 0 ) ? sampleMs : std::min( minMs, sampleMs );
+            maxMs    = ( samples == 0 ) ? sampleMs : std::max( maxMs, sampleMs );
+            samples ++;
+            rows    += sampleRows;
+            totalMs += sampleMs;
+            meanMs   = totalMs / static_cast<double>( samples );
+        }
+
+        template<class Archive>
+        inline void serialize( Archive& archive )
+        {
+            archive( CEREAL_NVP( name )
+                   , CEREAL_NVP( samples )
+                   , CEREAL_NVP( rows )
+                   , CEREAL_NVP( totalMs )
+                   , CEREAL_NVP( meanMs )
+                   , CEREAL_NVP( minMs )
+                   , CEREAL_NVP( maxMs )
+            );
+        }
+    };
+
+    struct BenchmarkReport
+    {
+        BenchmarkSpec                   spec;
+        std::string                     sqliteVersion;
+        uint64_t                        riffCount       = 0;
+        uint64_t                        stemCount       = 0;
+        uint64_t                        databaseBytes   = 0;
+        std::vector< BenchmarkTiming >  timings;
+
+        template<class Archive>
+        inline void serialize( Archive& archive )
+        {
+            archive( CEREAL_NVP( spec )
+                   , CEREAL_NVP( sqliteVersion )
+                   , CEREAL_NVP( riffCount )
+                   , CEREAL_NVP( stemCount )
+                   , CEREAL_NVP( databaseBytes )
+                   , CEREAL_NVP( timings )
+            );
+        }
+    };
+
+    // blocks until complete, so call from a background thread (and never the worker). refuses to run if the database
+    // already holds any riffs rather than mix synthetic data into real jams; scratchFolder receives exported archives
+    ouro_nodiscard absl::StatusOr< BenchmarkReport > runBenchmark( const BenchmarkSpec& spec, const fs::path& scratchFolder );
+
+
     // -----------------------------------------------------------------------------------------------------------------
 
     ouro_nodiscard ChangeIndex getChangeIndexForJam( const endlesss::types::JamCouchID& jamID ) const;
@@ -376,11 +496,20 @@ protected:
 
     friend ITask;
     struct TaskSchedule;
+    struct SyncEngine;
 
     void threadWorker();
 
+    // background riff & stem population; top up the in-flight batch fetches (returning true if any are running)
+    // and write out any that have completed (returning true if anything was written)
+    bool dispatchSyncFetches();
+    bool insertCompletedSyncFetches();
+
     void incrementChangeIndexForJam( const ::endlesss::types::JamCouchID& jamID );
 
+    // where the on-disk JamSlice snapshot for the given jam lives; empty if snapshots are unavailable
+    ouro_nodiscard fs::path getJamSliceSnapshotFile( const ::endlesss::types::JamCouchID& jamID ) const;
+
 
     // handle riff tag actions, do database operations to add/remove as requested
     void event_RiffTagAction( const events::RiffTagAction* eventData );
@@ -392,8 +521,11 @@ protected:
 
     std::unique_ptr<TaskSchedule>           m_taskSchedule;
     std::unique_ptr<TaskSchedule>           m_taskSchedulePriority;     // parallel queue used to stage tasks that should be run before the default queue gets a look in
+    std::unique_ptr<SyncEngine>             m_syncEngine;               // concurrent batch fetching of unpopulated riffs & stems
 
     ChangeIndexMap                          m_changeIndexMap;
+    std::unique_ptr<HarmonicIndex>          m_harmonicIndex;            // BPM / root / scale buckets of riffs for filterRiffsByBPM and fetchRandomRiffBySeed
+    fs::path                                m_jamSliceSnapshotPath;
 
     WorkUpdateCallback                      m_cbWorkUpdate              = nullptr;
     WorkUpdateCallback                      m_cbWorkUpdateToInstall     = nullptr;
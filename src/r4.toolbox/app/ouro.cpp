@@ -47,7 +47,6 @@ struct AdvancedOptionsBlock
 {
     bool    bShow = false;
     bool    bEnableNetworkLogging = false;
-    bool    bEnableLastMinuteQuirkFixes = false;
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -141,6 +140,7 @@ int OuroApp::EntrypointGUI()
         const auto networkState = fmt::format( FMTX( "{}  {:>6.1f} Kb/s " ), pulseOverview, kbAvgPayload );
 
         ImGui::TextUnformatted( networkState );
+        ImGui::CompactTooltip( fmt::format( FMTX( "Connections opened : {}\nConnections reused : {}" ), m_netConnectionsOpened, m_netConnectionsReused ) );
     });
 
 
@@ -303,7 +303,6 @@ int OuroApp::EntrypointGUI()
                     {
                         ImGui::TextUnformatted( "Advanced Toggles" );
                         ImGui::Checkbox( " Enable Network Diagnostics", &advancedOptionsBlock.bEnableNetworkLogging );
-                        ImGui::Checkbox( " Enable Last Minute Fixes", &advancedOptionsBlock.bEnableLastMinuteQuirkFixes );
                         ImGui::Checkbox( " Cache Management Tools", &bEnableCacheManagementMenu );
                     }
                     else
@@ -848,9 +847,54 @@ int OuroApp::EntrypointGUI()
                                 "If possible, some riffs are kept alive in memory to speed-up transitions / avoid re-loading from disk.\nThis value controls how many we aim to limit that to.\nIncrease if you got RAM to burn."
                             );
                             ImGui::InputInt( "##riff_live_inst", &m_configPerf.liveRiffInstancePoolSize, 8, 16 );
+
+                            NicerIntEditPreamble(
+                                "Riff Live Instance Pool Memory",
+                                "Also limit the riff pool by roughly how much memory the riffs in it keep alive.\nThe oldest riffs are dropped once this is exceeded, regardless of pool size.\nSet to 0 to only limit by pool size."
+                            );
+                            if ( ImGui::InputInt( " Mb##riff_live_mem", &m_configPerf.liveRiffInstancePoolMemoryMb, 256, 512 ) )
+                            {
+                                m_configPerf.clampLimits();
+                            }
                         }
                         ImGui::PopItemWidth();
 
+                        {
+                            ImGui::AlignTextToFramePadding();
+                            ImGui::TextDisabled( "[?]" );
+                            ImGui::CompactTooltip( "Store a second copy of each stem in the cache, fully\ndecoded at the current sample rate. Loading riffs becomes\nmuch faster, but this uses roughly 4-5x more disk space\nthan the original stems" );
+                            ImGui::SameLine();
+
+                            ImGui::Checkbox( " Enable Decoded Stem Cache", &m_configPerf.enableDecodedStemCache );
+                        }
+
+                        {
+                            ImGui::AlignTextToFramePadding();
+                            ImGui::TextDisabled( "[?]" );
+                            ImGui::CompactTooltip( "Encode FLAC recordings and riff exports in chunks spread\nacross several CPU cores rather than one stream at a time.\nMuch faster for long sessions and big exports on machines\nwith cores to spare; output is a standard, seekable FLAC file" );
+                            ImGui::SameLine();
+
+                            ImGui::Checkbox( " Parallel FLAC Encoding", &m_configPerf.flacChunkedEncoding );
+                        }
+                        {
+                            ImGui::AlignTextToFramePadding();
+                            ImGui::TextDisabled( "[?]" );
+                            ImGui::CompactTooltip( "Decode every FLAC frame again as it is written to check\nthe encoder's output. Costs roughly twice the CPU time" );
+                            ImGui::SameLine();
+
+                            ImGui::Checkbox( " Verify FLAC Encoding", &m_configPerf.flacVerifyEncoding );
+                        }
+                        {
+                            ImGui::AlignTextToFramePadding();
+                            ImGui::TextDisabled( "[?]" );
+                            ImGui::CompactTooltip( "0 is fastest, 8 produces the smallest files.\nThe default of 4 is a good balance" );
+                            ImGui::SameLine();
+
+                            ImGui::PushItemWidth( 150.0f );
+                            ImGui::SliderInt( " FLAC Compression Level", &m_configPerf.flacCompressionLevel, 0, 8 );
+                            ImGui::PopItemWidth();
+                        }
+
 
                         ImGui::Unindent( perBlockIndent );
                         ImGui::Spacing();
@@ -964,8 +1008,6 @@ int OuroApp::EntrypointGUI()
     {
         if ( advancedOptionsBlock.bEnableNetworkLogging )
             m_networkConfiguration->enableFullNetworkDiagnostics();
-        if ( advancedOptionsBlock.bEnableLastMinuteQuirkFixes )
-            m_networkConfiguration->enableLastMinuteQuirkFixes();
     }
 
     // save any config data blocks
@@ -982,12 +1024,16 @@ int OuroApp::EntrypointGUI()
             blog::error::cfg( "Unable to save performance configuration" );
         }
     }
+    applyPerformanceConfig();
 
     m_taskExecutor.wait_for_all();
 
     if ( m_mdFrontEnd->wasQuitRequested() )
         return 0;
 
+    if ( m_configPerf.runWarehouseBenchmark )
+        return runWarehouseBenchmarkPass();
+
 
     // unplug status bar bits
     unregisterStatusBarBlock( sbbTimeStatusLeftID );
@@ -1025,13 +1071,21 @@ int OuroApp::EntrypointGUI()
             }
 
             // boot stem cache now we have paths & audio configured
-            const auto stemCacheStatus = m_stemCache.initialise( m_storagePaths->cacheCommon, m_mdAudio->getSampleRate() );
+            const auto stemCacheStatus = m_stemCache.initialise(
+                m_storagePaths->cacheCommon,
+                m_mdAudio->getSampleRate(),
+                m_configPerf.enableDecodedStemCache );
             if ( !stemCacheStatus.ok() )
             {
                 return stemCacheStatus;
             }
             m_stemCacheLastPruneCheck.setToFuture( c_stemCachePruneCheckDuration );
-            m_stemCachePruneTask.emplace( [this]() { m_stemCache.lockAndPrune( false ); } );
+            m_stemCachePruneTask.emplace( [this]()
+            {
+                // trim a chunk below the trigger point so we aren't back in here again straight away
+                const auto stemMemoryTriggerMb = (std::size_t)m_configPerf.stemCacheAutoPruneAtMemoryUsageMb;
+                m_stemCache.pruneToBudget( ( stemMemoryTriggerMb * 1024 * 1024 / 4 ) * 3, false );
+            });
 
             // create universal warehouse instance
             {
@@ -1042,6 +1096,7 @@ int OuroApp::EntrypointGUI()
 
                 m_warehouse->upsertJamDictionaryFromCache( m_jamLibrary );              // update warehouse list of jam IDs -> names from the current cache
                 m_warehouse->upsertJamDictionaryFromBNS( m_jamNameService );            // .. and same with the BNS entries
+
                 m_warehouse->extractJamDictionary( m_jamHistoricalFromWarehouse );      // pull full list of jam IDs -> names from warehouse as "historical" list
             }
 
@@ -1137,7 +1192,7 @@ int OuroApp::EntrypointGUI()
                 if ( ImGui::MenuItem( "Trim / Repair ..." ) )
                 {
                     activateModalPopup( "Stem Cache Trim / Repair", [
-                            state = ux::createCacheTrimState( m_storagePaths->cacheCommon )](const char* title)
+                            state = ux::createCacheTrimState( m_storagePaths->cacheCommon, m_stemCache.getAnalysisHash() )](const char* title)
                         {
                             ux::modalCacheTrim( title, *state );
                         } );
@@ -1211,6 +1266,118 @@ int OuroApp::EntrypointGUI()
     return appResult;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+int OuroApp::runWarehouseBenchmarkPass()
+{
+    // the sqlite wrapper binds the database path on the first connection and keeps it for the life of the process, so once
+    // the scratch warehouse is open there is no going back to the real one; hence this runs instead of a session, and the
+    // option is cleared up front so that the next launch is a normal session against the real database again
+    m_configPerf.runWarehouseBenchmark = false;
+    if ( config::save( *this, m_configPerf ) != config::SaveResult::Success )
+    {
+        blog::error::cfg( "Unable to save performance configuration" );
+    }
+
+    const fs::path scratchPath = m_storagePaths->cacheCommon / "warehouse.benchmark";
+
+    auto benchmarkFuture = m_taskExecutor.async( "warehouse_benchmark", [this, scratchPath]() -> absl::StatusOr< fs::path >
+        {
+            std::error_code benchDirError;
+            fs::remove_all( scratchPath, benchDirError );
+            fs::create_directories( scratchPath, benchDirError );
+            if ( benchDirError )
+                return absl::UnavailableError( fmt::format( FMTX( "unable to create warehouse benchmark directory [{}], {}" ), scratchPath.string(), benchDirError.message() ) );
+
+            blog::app( FMTX( "running warehouse benchmark using scratch database in [{}]" ), scratchPath.string() );
+
+            app::StoragePaths scratchPaths = m_storagePaths.value();
+            scratchPaths.cacheCommon = scratchPath;
+
+            endlesss::toolkit::Warehouse::BenchmarkSpec benchmarkSpec;
+            benchmarkSpec.jamCount      = (uint32_t)m_configPerf.warehouseBenchmarkJams;
+            benchmarkSpec.riffsPerJam   = (uint32_t)m_configPerf.warehouseBenchmarkRiffsPerJam;
+
+            const auto scratchWarehouse = std::make_unique<endlesss::toolkit::Warehouse>(
+                scratchPaths,
+                m_networkConfiguration,
+                m_appEventBus );
+
+            const auto benchmarkResult = scratchWarehouse->runBenchmark( benchmarkSpec, scratchPath );
+            if ( !benchmarkResult.ok() )
+                return benchmarkResult.status();
+
+            const fs::path benchmarkFile = m_storagePaths->outputApp / fmt::format( FMTX( "{}warehouse.benchmark.json" ), spacetime::createPrefixTimestampForFile() );
+            try
+            {
+                std::ofstream benchmarkStream( benchmarkFile );
+                cereal::JSONOutputArchive archive( benchmarkStream );
+                archive( cereal::make_nvp( "benchmark", benchmarkResult.value() ) );
+            }
+            catch ( cereal::Exception& cEx )
+            {
+                return absl::UnavailableError( fmt::format( FMTX( "unable to write warehouse benchmark results to '{}', {}" ), benchmarkFile.string(), cEx.what() ) );
+            }
+            return benchmarkFile;
+        });
+
+    // wait it out, then show where the results went (or what broke) until the user quits
+    std::optional< absl::StatusOr< fs::path > > benchmarkResult;
+    bool bRunBenchmarkWaitLoop = true;
+    while ( bRunBenchmarkWaitLoop && beginInterfaceLayout( CoreGUI::VF_WithStatusBar ) )
+    {
+        const ImVec2 benchmarkWindowSize    = ImVec2( 400.0f, 160.0f );
+        const char* benchmarkTitle          = ICON_FA_GAUGE_HIGH " Warehouse Benchmark###benchmark";
+
+        if ( !benchmarkResult.has_value() && benchmarkFuture.wait_for( 8ms ) == std::future_status::ready )
+        {
+            benchmarkResult = benchmarkFuture.get();
+            if ( benchmarkResult->ok() )
+                blog::app( FMTX( "warehouse benchmark results written to '{}'" ), benchmarkResult->value().string() );
+            else
+                blog::error::app( FMTX( "warehouse benchmark failed, {}" ), benchmarkResult->status().ToString() );
+        }
+
+        if ( ImGui::BeginFixedCenteredWindow( benchmarkTitle, benchmarkWindowSize ) )
+        {
+            if ( !benchmarkResult.has_value() )
+            {
+                ImGui::Spinner( "##waiting", true, ImGui::GetTextLineHeight() * 0.3f, 3.0f, 0.0f, ImGui::GetColorU32( ImGuiCol_Text ) );
+                ImGui::SameLine( 0, 16.0f );
+                ImGui::TextUnformatted( "Running, this can take a while ..." );
+            }
+            else
+            {
+                if ( benchmarkResult->ok() )
+                {
+                    ImGui::TextUnformatted( "Results written to" );
+                    ImGui::TextWrapped( "%s", benchmarkResult->value().string().c_str() );
+                }
+                else
+                {
+                    ImGui::TextColored( colour::shades::errors.light(), "Benchmark Failed" );
+                    ImGui::TextWrapped( "%s", benchmarkResult->status().ToString().c_str() );
+                }
+                ImGui::Separator();
+                ImGui::TextDisabled( "Restart to run a normal session" );
+                if ( ImGui::Button( "  Quit  " ) )
+                {
+                    bRunBenchmarkWaitLoop = false;
+                }
+            }
+        }
+        ImGui::End();
+
+        // dispatch the UI for rendering
+        finishInterfaceLayoutAndRender();
+    }
+
+    // closing the window mid-run still has to let the benchmark finish before the app can tear down
+    if ( !benchmarkResult.has_value() )
+        benchmarkResult = benchmarkFuture.get();
+
+    return benchmarkResult->ok() ? 0 : -1;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 void OuroApp::ensureStemCacheChecksComplete()
 {
@@ -1275,9 +1442,8 @@ void OuroApp::maintainStemCacheAsync()
         {
             ensureStemCacheChecksComplete();
 
-            // the prune is usually measured in 10s of milliseconds, but we may as well 
-            // toss it into the job queue; it locks the cache to do the work, worst case very briefly delaying 
-            // async background loading
+            // the prune works in small steps and only holds the cache lock for a few entries at a time, but
+            // freeing a lot of stem memory can still take a moment so toss it into the job queue
             m_stemCachePruneFuture = m_taskExecutor.run( m_stemCachePruneTask );
         }
         m_stemCacheLastPruneCheck.setToFuture( c_stemCachePruneCheckDuration );
@@ -1293,6 +1459,10 @@ void OuroApp::event_ExportRiff( const events::ExportRiff* eventData )
         m_configExportOutput.spec
     );
 
+    // riffs headed for playback may have been fetched progressively and still be decoding in the background
+    if ( eventData->m_riff )
+        eventData->m_riff->waitForAllStems();
+
     auto netCfg = getNetworkConfiguration();
     const auto exportedFiles = endlesss::toolkit::xp::exportRiff(
         *netCfg,
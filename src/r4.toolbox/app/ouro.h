@@ -87,6 +87,9 @@ protected:
     // instance of the endlesss data warehouse, holding all locally synced jam/riff/stem data
     endlesss::toolkit::Warehouse::Instance  m_warehouse;
 
+    // runWarehouseBenchmark; runs instead of a session, against a scratch warehouse, and the app exits once it's done
+    int runWarehouseBenchmarkPass();
+
     // jam ID -> public name data that has been cached in the Warehouse database, used as secondary lookup
     // for IDs that we don't recognise as the normal jam library might be missing jams the user has left etc
     endlesss::types::JamIDToNameMap         m_jamHistoricalFromWarehouse;
@@ -9,6 +9,7 @@
 
 #include "mix/preview.h"
 
+#include "base/mathematics.h"
 #include "base/paging.h"
 #include "math/rng.h"
 
@@ -107,6 +108,51 @@ Preview::~Preview()
     m_abletonLinkControl = nullptr;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+// maps a position in the riff onto a read position in a stem, taking time-stretch and playback nudge into account;
+// positions are monotonic in the riff sample, so we can use this to find contiguous runs of stem samples that don't
+// need any wrapping, letting the mixer copy each run in one go without per-sample modulo & branching
+//
+namespace {
+struct StemReadMapping
+{
+    StemReadMapping( const float timeStretch, const int32_t playbackNudge )
+        : m_timeStretch( timeStretch )
+        , m_stretched( timeStretch != 1.0f )
+        , m_offset( m_stretched ? (int64_t)( (double)playbackNudge * timeStretch ) : playbackNudge )
+    {
+        ABSL_ASSERT( timeStretch > 0 );
+    }
+
+    // unwrapped stem position for a riff sample
+    ouro_nodiscard inline int64_t unwrapped( const int64_t riffSample ) const
+    {
+        if ( m_stretched )
+            return (int64_t)( (double)riffSample * m_timeStretch ) + m_offset;
+        return riffSample + m_offset;
+    }
+
+    // find the first riff sample after [riffSample] whose unwrapped stem position reaches [stemLimit]
+    ouro_nodiscard inline int64_t riffSampleReaching( const int64_t riffSample, const int64_t stemLimit ) const
+    {
+        if ( !m_stretched )
+            return stemLimit - m_offset;
+
+        // estimate, then nudge to match the exact truncation used in unwrapped()
+        int64_t result = std::max( riffSample + 1, (int64_t)std::ceil( (double)( stemLimit - m_offset ) / (double)m_timeStretch ) );
+        while ( result > riffSample + 1 && unwrapped( result - 1 ) >= stemLimit )
+            result--;
+        while ( unwrapped( result ) < stemLimit )
+            result++;
+        return result;
+    }
+
+    double      m_timeStretch;
+    bool        m_stretched;
+    int64_t     m_offset;
+};
+} // anonymous namespace
+
 // ---------------------------------------------------------------------------------------------------------------------
 void Preview::renderCurrentRiff(
     const uint32_t      outputOffset,
@@ -134,7 +180,7 @@ void Preview::renderCurrentRiff(
     }
 
     // keep note of where we are mixing in terms of the 0..N sample count of the current riff
-    const auto riffLengthInSamples      = currentRiff->m_timingDetails.m_lengthInSamples;
+    const int64_t riffLengthInSamples   = currentRiff->m_timingDetails.m_lengthInSamples;
 
     // ensure the current playback sample position for the riff isn't off the end
     while ( m_riffPlaybackSample >= riffLengthInSamples )
@@ -149,80 +195,125 @@ void Preview::renderCurrentRiff(
         const auto  stemInst = stemPtr[stemI];
         const float stemGain = stemGains[stemI];
 
-        float permGain = m_permutationCurrent.m_layerGainMultiplier[stemI];
+        const float permGainStart = m_permutationCurrent.m_layerGainMultiplier[stemI];
+        const float permGainDelta = m_permutationSampleGainDelta[stemI];
 
         m_txBlendCacheLeft[stemI]  = 0;
         m_txBlendCacheRight[stemI] = 0;
 
+        // last gain value actually applied, stored back as the running permutation gain
+        m_permutationCurrent.m_layerGainMultiplier[stemI] = permGainStart + ( permGainDelta * (float)( samplesToWrite - 1 ) );
+
+        float* outputLeft  = &m_mixChannelLeft[stemI][outputOffset];
+        float* outputRight = &m_mixChannelRight[stemI][outputOffset];
+
         // any stem problem -> silence
         if ( stemInst == nullptr || 
-             stemInst->hasFailed() )
+             stemInst->hasFailed() ||
+             stemInst->m_sampleCount <= 0 )
         {
-            for ( auto sI = 0U; sI < samplesToWrite; sI++ )
-            {
-                m_mixChannelLeft[stemI][outputOffset + sI] = 0;
-                m_mixChannelRight[stemI][outputOffset + sI] = 0;
-            }
-
-            permGain += m_permutationSampleGainDelta[stemI] * samplesToWrite;
-            m_permutationCurrent.m_layerGainMultiplier[stemI] = permGain - m_permutationSampleGainDelta[stemI];
-
+            std::fill_n( outputLeft,  samplesToWrite, 0.0f );
+            std::fill_n( outputRight, samplesToWrite, 0.0f );
             continue;
         }
 
-        // get sample position in context of the riff
-        uint64_t riffSample = riffWrappedSampleStart;
+        const int64_t        sampleCount = stemInst->m_sampleCount;
+        const int64_t        sampleReady = stemInst->getSamplesReady();     // < sampleCount if still streaming in
+        const float*         stemLeft    = stemInst->m_channel[0];
+        const float*         stemRight   = stemInst->m_channel[1];
+        const auto&          stemAnalysis = stemInst->getAnalysisData();
 
-        float lastSampleLeft  = 0;
-        float lastSampleRight = 0;
+        const StemReadMapping readMapping( stemTimeStretch[stemI], m_riffPlaybackNudge );
 
-        auto& stemAnalysis = stemInst->getAnalysisData();
+        // analysis data is accumulated per span; track the largest raw u8 values seen and scale by the largest
+        // gain at the end, rather than doing the LUT lookup + multiply + max per sample
+        std::array< uint8_t, 4 > amalgamMaxU8 = { 0, 0, 0, 0 };
 
-        for ( auto sI = 0U; sI < samplesToWrite; sI++ )
+        // get sample position in context of the riff
+        int64_t  riffSample = riffWrappedSampleStart;
+        uint32_t written    = 0;
+
+        while ( written < samplesToWrite )
         {
-            const auto sampleCount = stemInst->m_sampleCount;
-            uint64_t finalSampleIdx = riffSample;
+            // figure out where in the stem this span starts, and how far it can run before either the riff or the stem wrap
+            const int64_t stemUnwrapped = readMapping.unwrapped( riffSample );
+            const int64_t stemWrapBase  = stemUnwrapped - base::wrapMax( stemUnwrapped, sampleCount );
+
+            const int64_t riffSpanLimit = std::min(
+                riffLengthInSamples,
+                readMapping.riffSampleReaching( riffSample, stemWrapBase + sampleCount ) );
+
+            const uint32_t spanLength = (uint32_t)std::min< int64_t >( samplesToWrite - written, riffSpanLimit - riffSample );
+            ABSL_ASSERT( spanLength > 0 );
 
-            int32_t sampleOffset = m_riffPlaybackNudge;
+            const float spanGainStart = permGainStart + ( permGainDelta * (float)written );
 
-            if (stemTimeStretch[stemI] != 1.0f)
+            if ( readMapping.m_stretched )
             {
-                finalSampleIdx  = (uint64_t)( (double)finalSampleIdx * stemTimeStretch[stemI] );
-                sampleOffset    = (int32_t)( (double)sampleOffset * stemTimeStretch[stemI] );
-            }
-            finalSampleIdx += sampleOffset;
-            finalSampleIdx %= sampleCount;
+                for ( uint32_t sI = 0; sI < spanLength; sI++ )
+                {
+                    const int64_t stemIndex = readMapping.unwrapped( riffSample + sI ) - stemWrapBase;
+                    const bool    decoded   = ( stemIndex < sampleReady );
+                    const float   gain      = stemGain * ( spanGainStart + ( permGainDelta * (float)sI ) );
 
-            // contribute data from the stem analysis to amalgamated block of data as we go
-            if ( stemAnalysed[stemI] && permGain > 0 )
+                    outputLeft[written + sI]  = decoded ? stemLeft[stemIndex]  * gain : 0.0f;
+                    outputRight[written + sI] = decoded ? stemRight[stemIndex] * gain : 0.0f;
+                }
+            }
+            else
             {
-                const float stemWave = stemAnalysis.getWaveF( finalSampleIdx ) * permGain;
-                const float stemBeat = stemAnalysis.getBeatF( finalSampleIdx ) * permGain;
-                const float stemLow  = stemAnalysis.getLowFreqF( finalSampleIdx ) * permGain;
-                const float stemHigh = stemAnalysis.getHighFreqF( finalSampleIdx ) * permGain;
-
-                m_stemDataAmalgam.m_wave[stemI] = std::max( m_stemDataAmalgam.m_wave[stemI], stemWave );
-                m_stemDataAmalgam.m_beat[stemI] = std::max( m_stemDataAmalgam.m_beat[stemI], stemBeat );
-                m_stemDataAmalgam.m_low[stemI]  = std::max( m_stemDataAmalgam.m_low[stemI],  stemLow  );
-                m_stemDataAmalgam.m_high[stemI] = std::max( m_stemDataAmalgam.m_high[stemI], stemHigh );
+                // straight gain-ramped copy
+                const float* spanLeft  = &stemLeft[stemUnwrapped - stemWrapBase];
+                const float* spanRight = &stemRight[stemUnwrapped - stemWrapBase];
+
+                // only copy what has been decoded so far, the rest of the span is silence until it arrives
+                const uint32_t spanDecoded = (uint32_t)std::clamp< int64_t >( sampleReady - ( stemUnwrapped - stemWrapBase ), 0, spanLength );
+
+                for ( uint32_t sI = 0; sI < spanDecoded; sI++ )
+                {
+                    const float gain = stemGain * ( spanGainStart + ( permGainDelta * (float)sI ) );
+
+                    outputLeft[written + sI]  = spanLeft[sI]  * gain;
+                    outputRight[written + sI] = spanRight[sI] * gain;
+                }
+                std::fill_n( &outputLeft[written + spanDecoded],  spanLength - spanDecoded, 0.0f );
+                std::fill_n( &outputRight[written + spanDecoded], spanLength - spanDecoded, 0.0f );
             }
 
-            lastSampleLeft  = stemInst->m_channel[0][finalSampleIdx] * stemGain * permGain;
-            lastSampleRight = stemInst->m_channel[1][finalSampleIdx] * stemGain * permGain;
-            m_mixChannelLeft[stemI][outputOffset + sI]  = lastSampleLeft;
-            m_mixChannelRight[stemI][outputOffset + sI] = lastSampleRight;
+            if ( stemAnalysed[stemI] )
+            {
+                // for stretched stems this visits the stem samples covered by the span, near enough for visualisation
+                const int64_t stemSpanStart = stemUnwrapped - stemWrapBase;
+                const int64_t stemSpanEnd   = std::min( sampleCount, readMapping.unwrapped( riffSample + spanLength - 1 ) - stemWrapBase + 1 );
+
+                for ( int64_t aI = stemSpanStart; aI < stemSpanEnd; aI++ )
+                {
+                    amalgamMaxU8[0] = std::max( amalgamMaxU8[0], stemAnalysis.getWaveU8( aI ) );
+                    amalgamMaxU8[1] = std::max( amalgamMaxU8[1], stemAnalysis.getBeatU8( aI ) );
+                    amalgamMaxU8[2] = std::max( amalgamMaxU8[2], stemAnalysis.getLowFreqU8( aI ) );
+                    amalgamMaxU8[3] = std::max( amalgamMaxU8[3], stemAnalysis.getHighFreqU8( aI ) );
+                }
+            }
 
-            riffSample++;
+            written    += spanLength;
+            riffSample += spanLength;
             if ( riffSample >= riffLengthInSamples )
                 riffSample -= riffLengthInSamples;
-
-            permGain += m_permutationSampleGainDelta[stemI];
         }
 
-        m_txBlendCacheLeft[stemI]  = lastSampleLeft;
-        m_txBlendCacheRight[stemI] = lastSampleRight;
+        // contribute data from the stem analysis to amalgamated block of data; gain ramps are linear, so the
+        // largest gain across the block is at one end or the other
+        const float permGainPeak = std::max( permGainStart, m_permutationCurrent.m_layerGainMultiplier[stemI] );
+        if ( stemAnalysed[stemI] && permGainPeak > 0 )
+        {
+            m_stemDataAmalgam.m_wave[stemI] = std::max( m_stemDataAmalgam.m_wave[stemI], base::LUT::u8_to_float[amalgamMaxU8[0]] * permGainPeak );
+            m_stemDataAmalgam.m_beat[stemI] = std::max( m_stemDataAmalgam.m_beat[stemI], base::LUT::u8_to_float[amalgamMaxU8[1]] * permGainPeak );
+            m_stemDataAmalgam.m_low[stemI]  = std::max( m_stemDataAmalgam.m_low[stemI],  base::LUT::u8_to_float[amalgamMaxU8[2]] * permGainPeak );
+            m_stemDataAmalgam.m_high[stemI] = std::max( m_stemDataAmalgam.m_high[stemI], base::LUT::u8_to_float[amalgamMaxU8[3]] * permGainPeak );
+        }
 
-        m_permutationCurrent.m_layerGainMultiplier[stemI] = permGain - m_permutationSampleGainDelta[stemI];
+        m_txBlendCacheLeft[stemI]  = outputLeft[samplesToWrite - 1];
+        m_txBlendCacheRight[stemI] = outputRight[samplesToWrite - 1];
     }
 
     m_riffPlaybackSample += samplesToWrite;
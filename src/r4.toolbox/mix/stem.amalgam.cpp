@@ -44,12 +44,9 @@ absl::Status StemDataProcessor::disconnect( base::EventBusPtr appEventBus )
 // ---------------------------------------------------------------------------------------------------------------------
 void StemDataProcessor::handleNewStemAmalgam( const base::IEvent& eventPtr )
 {
-    ABSL_ASSERT( eventPtr.getID() == events::StemDataAmalgamGenerated::ID );
+    const auto& stemDataEvent = base::event_cast< events::StemDataAmalgamGenerated >( eventPtr );
 
-    const events::StemDataAmalgamGenerated* stemDataEvent = dynamic_cast<const events::StemDataAmalgamGenerated*>(&eventPtr);
-    ABSL_ASSERT( stemDataEvent != nullptr );
-
-    m_stemAmalgam = stemDataEvent->m_stemDataAmalgam;
+    m_stemAmalgam = stemDataEvent.m_stemDataAmalgam;
 
     int32_t simultaneousBeats = 0;
     for ( auto stemI = 0U; stemI < 8; stemI++ )
@@ -71,6 +71,8 @@ void modalCacheMigration( const char* title, endlesss::toolkit::Warehouse& wareh
             ImGui::Spacing();
             ImGui::TextWrapped( "Click [Run Migration] and wait for it to complete. You only need do this process once." );
             ImGui::Spacing();
+            ImGui::TextWrapped( "The decoded stem cache is never migrated, it is rebuilt on demand; outdated versions can be removed with the Trim / Repair tool." );
+            ImGui::Spacing();
             ImGui::SeparatorBreak();
 
             {
@@ -11,25 +11,162 @@
 #include "ux/cache.trim.h"
 #include "app/imgui.ext.h"
 
+#include "base/text.h"
 #include "filesys/fsutil.h"
 #include "xp/open.url.h"
 
 #include "endlesss/cache.stems.h"
+#include "endlesss/live.stem.h"
 
 namespace ux {
 
+// ---------------------------------------------------------------------------------------------------------------------
+// incremental walk over one of the derived-data caches, deleting any file the validator rejects; these caches can always
+// be rebuilt from the stems so there's no need to be precious about anything that doesn't check out
+struct DerivedCacheWalk
+{
+    using recursive_iterator = fs::recursive_directory_iterator;
+
+    // return true and set the byte size for files that should be kept
+    using ValidateFn = std::function< bool( const fs::path& file, uint64_t& fileBytes ) >;
+
+    DerivedCacheWalk( const fs::path& root, const char* name, ValidateFn&& validateFn )
+        : m_root( root )
+        , m_name( name )
+        , m_validateFn( std::move( validateFn ) )
+    {}
+
+    // returns true if the walk is running and other cache operations should be held off
+    bool imgui( const ImVec2& buttonSize );
+
+    fs::path            m_root;
+    const char*         m_name;
+    ValidateFn          m_validateFn;
+    recursive_iterator  m_iterator;
+
+    uint32_t            m_filesTouched = 0;
+    uint32_t            m_filesRemoved = 0;
+    uint64_t            m_bytesValid = 0;
+
+    bool                m_running = false;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+bool DerivedCacheWalk::imgui( const ImVec2& buttonSize )
+{
+    if ( !fs::exists( m_root ) )
+    {
+        ImGui::TextDisabled( "No %s cache found", m_name );
+        return false;
+    }
+
+    if ( m_running == false )
+    {
+        if ( ImGui::Button( fmt::format( FMTX( "Validate {} Cache" ), m_name ).c_str(), buttonSize ) )
+        {
+            m_iterator      = recursive_iterator( m_root, std::filesystem::directory_options::skip_permission_denied );
+            m_filesTouched  = 0;
+            m_filesRemoved  = 0;
+            m_bytesValid    = 0;
+            m_running       = true;
+        }
+        ImGui::SameLine( 0, 12.0f );
+        if ( ImGui::Button( fmt::format( FMTX( "Delete {} Cache" ), m_name ).c_str(), buttonSize ) )
+        {
+            std::error_code removeError;
+            fs::remove_all( m_root, removeError );
+            if ( removeError )
+                blog::error::cache( FMTX( "unable to remove [{}] : {}" ), m_root.string(), removeError.message() );
+        }
+    }
+
+    ImGui::Text( "%s files processed: %u, removed: %u", m_name, m_filesTouched, m_filesRemoved );
+    ImGui::SameLine();
+    ImGui::TextUnformatted( base::humaniseByteSize( " | valid : ", m_bytesValid ).c_str() );
+
+    if ( !m_running )
+        return false;
+
+    int32_t filesPerTick = 100;
+
+    try
+    {
+        std::error_code osError;
+        auto i = fs::begin( m_iterator );
+        for ( ; i != fs::end( m_iterator ); i = i.increment( osError ) )
+        {
+            if ( osError )
+                break;
+
+            if ( i->is_directory() )
+                continue;
+
+            if ( filesPerTick <= 0 )
+                break;
+            filesPerTick--;
+
+            m_filesTouched++;
+
+            const fs::path cacheFile = i->path();
+
+            uint64_t fileBytes = 0;
+            if ( m_validateFn( cacheFile, fileBytes ) )
+            {
+                m_bytesValid += fileBytes;
+            }
+            else
+            {
+                blog::cache( FMTX( "removing invalid {} cache file : {}" ), m_name, cacheFile.string() );
+
+                std::error_code removeError;
+                if ( fs::remove( cacheFile, removeError ) )
+                    m_filesRemoved++;
+            }
+        }
+        if ( i == fs::end( m_iterator ) )
+            m_running = false;
+    }
+    catch ( std::exception& cEx )
+    {
+        blog::error::cache( FMTX( "stopping {} cache walk on exception : {}" ), m_name, cEx.what() );
+        m_running = false;
+    }
+
+    return m_running;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 struct CacheTrimState
 {
     using recursive_iterator = fs::recursive_directory_iterator;
 
-    CacheTrimState( const fs::path& cacheCommonRootPath )
-        : m_cacheRoot( cacheCommonRootPath / endlesss::cache::Stems::getCachePathRoot( endlesss::cache::Stems::CacheVersion::Version2 ) )
+    CacheTrimState( const fs::path& cacheCommonRootPath, const uint64_t analysisHash )
+        : m_cacheCommonRoot( cacheCommonRootPath )
+        , m_cacheRoot( cacheCommonRootPath / endlesss::cache::Stems::getCachePathRoot( endlesss::cache::Stems::CacheVersion::Version2 ) )
+        , m_decodedRoot( cacheCommonRootPath / endlesss::cache::Stems::getDecodedCachePathRoot( endlesss::cache::Stems::cCurrentDecodedCacheVersion ) )
+        , m_decodedWalk( m_decodedRoot, "Decoded", &CacheTrimState::validateDecodedFile )
+        , m_analysisWalk( cacheCommonRootPath / endlesss::cache::Stems::getAnalysisCachePathRoot(), "Analysis",
+            [analysisHash]( const fs::path& analysisFile, uint64_t& fileBytes )
+            {
+                // this also catches files written with older analysis settings, which would otherwise never be loaded again
+                return analysisFile.extension() == ".psa" &&
+                       endlesss::live::StemAnalysisData::validateFile( analysisFile, analysisHash, fileBytes ).ok();
+            })
     {
+        findOutdatedDecodedRoots();
     }
 
     void imgui();
 
+    // decoded stem cache maintenance; as it only holds derived data, anything that doesn't validate is simply deleted
+    void imguiDecoded();
+    void findOutdatedDecodedRoots();
+
+    // anything that isn't a complete, current-version decoded file is tossed; this includes
+    // any .tmp files left behind from an interrupted write
+    static bool validateDecodedFile( const fs::path& decodedFile, uint64_t& fileBytes );
+
+    fs::path            m_cacheCommonRoot;
     fs::path            m_cacheRoot;
     recursive_iterator  m_iterator;
     
@@ -37,8 +174,88 @@ struct CacheTrimState
 
     bool                m_initialisedSearch = false;
     bool                m_runningSearch = false;
+
+
+    fs::path                m_decodedRoot;
+    std::vector< fs::path > m_decodedRootsOutdated;     // decoded caches from previous versions, safe to delete
+
+    DerivedCacheWalk        m_decodedWalk;
+    DerivedCacheWalk        m_analysisWalk;
 };
 
+// ---------------------------------------------------------------------------------------------------------------------
+bool CacheTrimState::validateDecodedFile( const fs::path& decodedFile, uint64_t& fileBytes )
+{
+    if ( decodedFile.extension() != ".pcm" )
+        return false;
+
+    endlesss::cache::DecodedStemHeader decodedHeader;
+    if ( !endlesss::cache::Stems::readDecodedStemHeader( decodedFile, decodedHeader ).ok() ||
+         !decodedHeader.isValidFor( decodedHeader.m_sampleRate ) )
+        return false;
+
+    std::error_code sizeError;
+    fileBytes = fs::file_size( decodedFile, sizeError );
+
+    return ( !sizeError && fileBytes == decodedHeader.expectedFileSize() );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void CacheTrimState::findOutdatedDecodedRoots()
+{
+    m_decodedRootsOutdated.clear();
+
+    std::error_code osError;
+    for ( const auto& entry : fs::directory_iterator( m_cacheCommonRoot, fs::directory_options::skip_permission_denied, osError ) )
+    {
+        if ( !entry.is_directory() )
+            continue;
+
+        const std::string directoryName = entry.path().filename().string();
+        if ( directoryName.starts_with( endlesss::cache::Stems::cDecodedCachePathRootPrefix ) &&
+             entry.path() != m_decodedRoot )
+        {
+            m_decodedRootsOutdated.emplace_back( entry.path() );
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+void CacheTrimState::imguiDecoded()
+{
+    const ImVec2 buttonSize( 240.0f, 32.0f );
+
+    ImGui::SeparatorBreak();
+
+    for ( const auto& outdatedRoot : m_decodedRootsOutdated )
+    {
+        ImGui::TextColored( colour::shades::callout.neutral(), "Outdated decoded cache : %s", outdatedRoot.string().c_str() );
+    }
+    if ( !m_decodedRootsOutdated.empty() )
+    {
+        ImGui::Scoped::Disabled sd( m_decodedWalk.m_running );
+        if ( ImGui::Button( "Delete Outdated", buttonSize ) )
+        {
+            for ( const auto& outdatedRoot : m_decodedRootsOutdated )
+            {
+                std::error_code removeError;
+                fs::remove_all( outdatedRoot, removeError );
+                if ( removeError )
+                    blog::error::cache( FMTX( "unable to remove [{}] : {}" ), outdatedRoot.string(), removeError.message() );
+                else
+                    blog::cache( FMTX( "removed outdated decoded cache [{}]" ), outdatedRoot.string() );
+            }
+            findOutdatedDecodedRoots();
+        }
+    }
+
+    m_decodedWalk.imgui( buttonSize );
+
+    ImGui::SeparatorBreak();
+
+    m_analysisWalk.imgui( buttonSize );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 void CacheTrimState::imgui()
 {
@@ -131,6 +348,8 @@ void CacheTrimState::imgui()
         }
     }
 
+    imguiDecoded();
+
     if ( ImGui::BottomRightAlignedButton( "Close", buttonSize ) )
     {
         ImGui::CloseCurrentPopup();
@@ -138,15 +357,15 @@ void CacheTrimState::imgui()
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
-std::shared_ptr< CacheTrimState > createCacheTrimState( const fs::path& cacheCommonRootPath )
+std::shared_ptr< CacheTrimState > createCacheTrimState( const fs::path& cacheCommonRootPath, const uint64_t analysisHash )
 {
-    return std::make_shared< CacheTrimState >( cacheCommonRootPath );
+    return std::make_shared< CacheTrimState >( cacheCommonRootPath, analysisHash );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 void modalCacheTrim( const char* title, CacheTrimState& jamValidateState )
 {
-    const ImVec2 configWindowSize = ImVec2( 830.0f, 120.0f );
+    const ImVec2 configWindowSize = ImVec2( 830.0f, 300.0f );
     ImGui::SetNextWindowContentSize( configWindowSize );
 
     ImGui::PushStyleColor( ImGuiCol_PopupBg, ImGui::GetStyleColorVec4( ImGuiCol_ChildBg ) );
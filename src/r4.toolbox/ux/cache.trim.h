@@ -15,7 +15,8 @@
 namespace ux {
 
     struct CacheTrimState;
-    std::shared_ptr< CacheTrimState > createCacheTrimState( const fs::path& cacheCommonRootPath );
+    // analysisHash should come from cache::Stems::getAnalysisHash(), persisted analysis files not matching it are removed
+    std::shared_ptr< CacheTrimState > createCacheTrimState( const fs::path& cacheCommonRootPath, const uint64_t analysisHash );
 
     // 
     void modalCacheTrim(
@@ -1,38 +1,30 @@
-//   _______ _______ ______ _______ ___ ___ _______ _______ _______ 
+//   _______ _______ ______ _______ ___ ___ _______ _______ _______
 //  |       |   |   |   __ \       |   |   |    ___|       |    |  |
 //  |   -   |   |   |      <   -   |   |   |    ___|   -   |       |
 //  |_______|_______|___|__|_______|\_____/|_______|_______|__|____|
 //  \\ harry denholm \\ ishani            ishani.org/shelf/ouroveon/
 //
-//  
+//
 //
 
 #include "pch.h"
 #include "ux/jam.precache.h"
 
-#include "spacetime/chronicle.h"
-
 #include "app/imgui.ext.h"
 
-#include "endlesss/cache.stems.h"
-#include "endlesss/live.stem.h"
+#include "endlesss/toolkit.precache.h"
 #include "endlesss/toolkit.warehouse.h"
 
 namespace ux {
 
 struct JamPrecacheState
 {
-    static constexpr std::size_t cSyncSamples = 16;
-
-    using Instance = std::shared_ptr<JamPrecacheState>;
-
     enum class State
     {
         Intro,
         Aborted,
         Preflight,
-        Download,
-        Complete
+        Monitor
     };
 
     JamPrecacheState() = delete;
@@ -41,55 +33,31 @@ struct JamPrecacheState
     {
     }
 
-#if OURO_DEBUG
-    ~JamPrecacheState()
-    {
-        if ( m_failureDiagnosticLog != nullptr )
-        {
-            fclose( m_failureDiagnosticLog );
-        }
-    }
-#endif // OURO_DEBUG
-
     void imgui(
         const endlesss::toolkit::Warehouse& warehouse,
-        endlesss::services::RiffFetchProvider& fetchProvider,
-        tf::Executor& taskExecutor );
+        endlesss::toolkit::Precache& precache );
 
-    endlesss::types::JamCouchID     m_jamCouchID;
-    endlesss::types::StemCouchIDs   m_stemIDs;
+    void imguiProgress(
+        const endlesss::toolkit::Precache::Progress& progress );
 
-    bool                            m_enableSiphonMode = false;
-    bool                            m_enableDryRun = false;
+    endlesss::types::JamCouchID             m_jamCouchID;
+    endlesss::toolkit::Precache::Workload   m_workload;
+
+    bool                                    m_enableSiphonMode = false;
+    bool                                    m_enableDryRun = false;
 
     // debug tool that writes out all failed download URLs; for giving them to Endlesss to see if they can fix the
     // access control issues on the CDN
 #if OURO_DEBUG
-    bool                            m_enableFailureLog = false;
-    
-    std::mutex                      m_failureDiagnosticMutex;
-    FILE*                           m_failureDiagnosticLog = nullptr;
+    bool                                    m_enableFailureLog = false;
 #endif // OURO_DEBUG
 
-    int32_t                         m_maximumDownloadsInFlight = OURO_THREAD_LIMIT;
-
-    State                           m_state = State::Intro;
-    std::size_t                     m_currentStemIndex = 0;
-
-    std::size_t                     m_stemPayloadFileSizeEstimation = 0;
-    std::string                     m_stemPayloadFileSizeEstimationString;
+    int32_t                                 m_maximumDownloadsInFlight = OURO_THREAD_LIMIT;
+    int32_t                                 m_maximumKilobytesPerSecond = 0;
 
-    std::atomic_uint32_t            m_statsStemsAlreadyInCache = 0;
-    std::atomic_uint32_t            m_statsStemsDownloaded = 0;
-    std::atomic_uint32_t            m_statsStemsMissingFromDb = 0;
-    std::atomic_uint32_t            m_statsStemsFailedToDownload = 0;
-
-    std::atomic_uint32_t            m_downloadsDispatched = 0;
-
-    spacetime::Moment               m_syncTimer;
-    base::RollingAverage< cSyncSamples >
-                                    m_averageSyncTimeMillis;
-    std::size_t                     m_averageSyncMeasurements = 0;
+    State                                   m_state = State::Intro;
+    std::string                             m_stemPayloadFileSizeEstimationString;
+    std::string                             m_startError;
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -102,18 +70,17 @@ std::shared_ptr< JamPrecacheState > createJamPrecacheState( const endlesss::type
 void modalJamPrecache(
     const char* title,
     JamPrecacheState& jamPrecacheState,
-    const struct endlesss::toolkit::Warehouse& warehouse,
-    endlesss::services::RiffFetchProvider& fetchProvider,
-    tf::Executor& taskExecutor )
+    const endlesss::toolkit::Warehouse& warehouse,
+    endlesss::toolkit::Precache& precache )
 {
-    const ImVec2 configWindowSize = ImVec2( 830.0f, 260.0f );
+    const ImVec2 configWindowSize = ImVec2( 830.0f, 300.0f );
     ImGui::SetNextWindowContentSize( configWindowSize );
 
     ImGui::PushStyleColor( ImGuiCol_PopupBg, ImGui::GetStyleColorVec4( ImGuiCol_ChildBg ) );
 
     if ( ImGui::BeginPopupModal( title, nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoResize ) )
     {
-        jamPrecacheState.imgui( warehouse, fetchProvider, taskExecutor );
+        jamPrecacheState.imgui( warehouse, precache );
 
         ImGui::EndPopup();
     }
@@ -123,11 +90,16 @@ void modalJamPrecache(
 // ---------------------------------------------------------------------------------------------------------------------
 void JamPrecacheState::imgui(
     const endlesss::toolkit::Warehouse& warehouse,
-    endlesss::services::RiffFetchProvider& fetchProvider,
-    tf::Executor& taskExecutor )
+    endlesss::toolkit::Precache& precache )
 {
     const ImVec2 buttonSize( 240.0f, 32.0f );
 
+    const endlesss::toolkit::Precache::Progress progress = precache.getProgress();
+
+    // only one job runs at a time; if one is already going (this jam or otherwise) all we can do is watch it
+    if ( progress.isActive() )
+        m_state = State::Monitor;
+
     switch ( m_state )
     {
         // lay out how the tool works; when ready, do a synchronous pull of all the stem IDs to examine from Warehouse
@@ -176,13 +148,13 @@ void JamPrecacheState::imgui(
                 bool bFoundStems = false;
                 if ( m_enableSiphonMode )
                 {
-                    bFoundStems = warehouse.fetchAllStems( m_stemIDs, m_stemPayloadFileSizeEstimation );
+                    bFoundStems = m_workload.fromEntireWarehouse( warehouse );
                 }
                 else
                 {
-                    bFoundStems = warehouse.fetchAllStemsForJam( m_jamCouchID, m_stemIDs, m_stemPayloadFileSizeEstimation );
+                    bFoundStems = m_workload.fromJam( warehouse, m_jamCouchID );
                 }
-                m_stemPayloadFileSizeEstimationString = base::humaniseByteSize( "", m_stemPayloadFileSizeEstimation );
+                m_stemPayloadFileSizeEstimationString = base::humaniseByteSize( "", m_workload.m_estimatedBytes );
 
                 if ( bFoundStems )
                     m_state = State::Preflight;
@@ -202,10 +174,10 @@ void JamPrecacheState::imgui(
         // present the work to do, allow tuning of download limits
         case State::Preflight:
         {
-            ImGui::TextColored( colour::shades::callout.light(),   "        Total stems : %u", static_cast<uint32_t>( m_stemIDs.size() ) );
+            ImGui::TextColored( colour::shades::callout.light(),   "        Total stems : %u", static_cast<uint32_t>( m_workload.m_stemIDs.size() ) );
             ImGui::TextColored( colour::shades::callout.neutral(), "Disk space estimate : %s", m_stemPayloadFileSizeEstimationString.c_str() );
             ImGui::Spacing();
-            ImGui::TextWrapped( "Note that you may already have some of these stems in your cache - they will not be re-downloaded. Abort the download at any point by clicking [Close] - it may pause briefly to finish all active downloads." );
+            ImGui::TextWrapped( "Note that you may already have some of these stems in your cache - they will not be re-downloaded. Downloading continues in the background if this window is closed; if it is stopped or the app exits, starting it again will resume where it left off." );
             ImGui::Spacing();
             ImGui::SeparatorBreak();
             {
@@ -216,192 +188,161 @@ void JamPrecacheState::imgui(
                 ImGui::SetNextItemWidth( 200.0f );
                 ImGui::SliderInt( "##simd", &m_maximumDownloadsInFlight, 1, OURO_THREAD_LIMIT );
             }
+            {
+                // .. and optionally cap the bandwidth, for long jobs left running alongside other things
+                ImGui::AlignTextToFramePadding();
+                ImGui::TextUnformatted( "      Download Rate Limit (KB/s) : " );
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth( 200.0f );
+                ImGui::SliderInt( "##rate", &m_maximumKilobytesPerSecond, 0, 16384, m_maximumKilobytesPerSecond == 0 ? "Unlimited" : "%d", ImGuiSliderFlags_Logarithmic );
+            }
             ImGui::Spacing();
             if ( ImGui::Button( "Begin Download", buttonSize ) )
             {
-                ABSL_ASSERT( m_currentStemIndex == 0 );
-
+                endlesss::toolkit::Precache::Options options;
+                options.m_maximumDownloadsInFlight  = static_cast<uint32_t>( m_maximumDownloadsInFlight );
+                options.m_maximumKilobytesPerSecond = static_cast<uint32_t>( m_maximumKilobytesPerSecond );
+                options.m_dryRun                    = m_enableDryRun;
 #if OURO_DEBUG
                 if ( m_enableFailureLog )
+                    options.m_failureLogFile = "precache_failures.txt";
+#endif // OURO_DEBUG
+
+                const absl::Status startStatus = precache.start( warehouse, std::move( m_workload ), options );
+                if ( startStatus.ok() )
                 {
-                    m_failureDiagnosticLog = fopen( "precache_failures.txt", "wt" );
+                    m_startError.clear();
+                }
+                else
+                {
+                    m_startError = startStatus.ToString();
+                    blog::error::app( FMTX( "unable to start precache : {}" ), m_startError );
                 }
-#endif // OURO_DEBUG
 
-                m_syncTimer.setToNow();
-                m_state = State::Download;
+                m_state = State::Monitor;
             }
         }
         break;
 
-        // do the actual work; this runs through and triggers more download tasks if we don't have enough in-flight
-        case State::Download:
+        // watch whatever the service is doing
+        case State::Monitor:
         {
-            const auto stemCount = m_stemIDs.size();
-
-            if ( m_currentStemIndex >= stemCount )
+            if ( !m_startError.empty() )
             {
-                taskExecutor.wait_for_all();
-                m_state = State::Complete;
-                break;
+                ImGui::TextColored( colour::shades::errors.light(), "Unable to start : %s", m_startError.c_str() );
+                ImGui::SeparatorBreak();
             }
 
-            // show progress
-            {
-                const float progressFraction = (1.0f / static_cast<float>(stemCount)) * static_cast<float>(m_currentStemIndex);
-                ImGui::ProgressBar( progressFraction, ImVec2( -1, 26.0f ), fmt::format( FMTX( "{} of {}" ), m_currentStemIndex + 1, m_stemIDs.size() ).c_str() );
-            }
+            imguiProgress( progress );
+        }
+        break;
+    }
 
-            // how many fs::exists() checks we can do in a sequence, otherwise we would do one per frame and 
-            // that means iterating through larger jams that are already on-disk would be a chore
-            int32_t fileOpsBurstCount = 100;
+    ImGui::SeparatorBreak();
 
-            // if there are not enough live tasks running, kick some off
-            while ( m_downloadsDispatched < static_cast<uint32_t>(m_maximumDownloadsInFlight) && fileOpsBurstCount > 0 )
-            {
-                const endlesss::types::StemCouchID stemID = m_stemIDs[ ( stemCount - 1 ) - m_currentStemIndex ];
+    if ( progress.m_state == endlesss::toolkit::Precache::State::Running )
+    {
+        if ( ImGui::Button( "Stop", buttonSize ) )
+        {
+            precache.requestStop();
+        }
+        ImGui::CompactTooltip( "Halt the job once the current downloads finish; starting it again later will pick up from here" );
+        ImGui::SameLine();
+    }
 
-                // pull the full stem data we have on file
-                endlesss::types::Stem stemData;
-                bool bFoundStemData = warehouse.fetchSingleStemByID( stemID, stemData );
-                if ( bFoundStemData )
-                {
-                    const fs::path stemCachePath = fetchProvider->getStemCache().getCachePathForStem( stemData );
-
-                    // early out if the stem already exists in the cache -- although this is checked in the stem-live code,
-                    // saves on allocation and work if we check it here too
-                    if ( fs::exists( stemCachePath / stemData.couchID.value() ) )
-                    {
-                        m_statsStemsAlreadyInCache++;
-                        fileOpsBurstCount--;
-                    }
-                    else
-                    {
-                        if ( !m_enableDryRun )
-                        {
-                            ++m_downloadsDispatched;
-                            fileOpsBurstCount = -1;
-
-                            // keep timer on how long it takes to cycle through to dispatching new tasks; this gives
-                            // a rough idea of how long the whole process will take
-                            {
-                                const auto downloadTimeMillis = m_syncTimer.delta< std::chrono::milliseconds >();
-                                m_averageSyncTimeMillis.update( static_cast<double>(downloadTimeMillis.count()) );
-                                m_syncTimer.setToNow();
-                                ++m_averageSyncMeasurements;
-                            }
-
-                            // kick out an untethered async task to initialise a live Stem object
-                            // doing so will go through the default machinery of downloading / validating it, same as
-                            // when we do this for playing riffs back in the rest of the app - difference being that 
-                            // we don't keep the live Stem around, it's just immediately tossed
-                            taskExecutor.silent_async( [=, this]()
-                                {
-                                    auto stemLivePtr = std::make_shared<endlesss::live::Stem>( stemData, 8000 );   // any sample rate is fine, we aren't keeping the data
-                                    stemLivePtr->fetch(
-                                        fetchProvider->getNetConfiguration(),
-                                        stemCachePath );
-
-                                    if ( stemLivePtr->hasFailed() )
-                                    {
-#if OURO_DEBUG
-                                        if ( m_enableFailureLog )
-                                        {
-                                            const auto failedEndpoint = stemData.fullEndpoint();
-                                            fprintf( m_failureDiagnosticLog, "%s/%s\n", failedEndpoint.c_str(), stemData.fileKey.c_str() );
-                                            fflush( m_failureDiagnosticLog );
-                                        }
-#endif // OURO_DEBUG
-                                        blog::error::app( FMTX( "failed to download stem to cache : [{}]" ), stemID );
-                                        ++m_statsStemsFailedToDownload;
-                                    }
-                                    else
-                                    {
-                                        ++m_statsStemsDownloaded;
-                                    }
-
-                                    // tag that we are done with this task so that the cycle can kick more off
-                                    --m_downloadsDispatched;
-                                });
-                        }
-                    }
-                }
-                else
-                {
-                    blog::error::app( FMTX( "was unable to fetch stem data from warehouse during precache : [{}]" ), stemID );
-                    ++m_statsStemsMissingFromDb;
-                }
+    if ( ImGui::BottomRightAlignedButton( "Close", buttonSize ) )
+    {
+        ImGui::CloseCurrentPopup();
+    }
+}
 
-                // we've done something with this one, next stem in the list...
-                ++m_currentStemIndex;
-                // break out of the burst loop if we're out of stems, it will flush the workers on the next loop round
-                if ( m_currentStemIndex >= m_stemIDs.size() )
-                    break;
-            }
+// ---------------------------------------------------------------------------------------------------------------------
+void JamPrecacheState::imguiProgress( const endlesss::toolkit::Precache::Progress& progress )
+{
+    using PrecacheState = endlesss::toolkit::Precache::State;
 
-            ImGui::Spacing();
-            ImGui::Spacing();
+    if ( progress.m_state == PrecacheState::Idle )
+    {
+        ImGui::TextDisabled( "No precache job has been run" );
+        return;
+    }
+
+    const double stemsTotal = static_cast<double>( std::max< std::size_t >( progress.m_stemsTotal, 1 ) );
+
+    // show progress
+    {
+        const float progressFraction = static_cast<float>( static_cast<double>( progress.m_stemsExamined ) / stemsTotal );
+        ImGui::ProgressBar( progressFraction, ImVec2( -1, 26.0f ), fmt::format( FMTX( "{} of {}" ), progress.m_stemsExamined, progress.m_stemsTotal ).c_str() );
+    }
 
-            // do some estimation of how long the full download will take based on how long the average download is taking
-            // based on how long each stem has taken so far
-            if ( m_averageSyncMeasurements < cSyncSamples * 2 )
+    ImGui::Spacing();
+
+    switch ( progress.m_state )
+    {
+        case PrecacheState::Running:
+        {
+            // estimate how long is left based on how quickly we've been getting through stems; stems skipped thanks
+            // to the journal are excluded, they are near enough free and would make things look rosier than they are
+            const auto stemsWorked     = progress.m_stemsExamined - progress.m_stemsResumed;
+            const auto elapsedSeconds  = progress.m_elapsed.count();
+
+            if ( elapsedSeconds < 5 || stemsWorked < 16 )
             {
                 ImGui::TextColored( colour::shades::toast.dark(), "Estimated time remaining : Calculating ..." );
             }
             else
             {
-                const uint32_t averageSyncTimeMs = static_cast<uint32_t>(m_averageSyncTimeMillis.getInt64());
-                std::chrono::milliseconds perSyncMs( averageSyncTimeMs );
-                float perSyncSecF = static_cast<float>( perSyncMs.count() ) / 1000.0f;
-                
-                // multiply per-sync time by the remaining stem count
-                perSyncMs *= m_stemIDs.size() - m_currentStemIndex;
-                std::chrono::minutes fullSyncMinutes = std::chrono::duration_cast<std::chrono::minutes>( perSyncMs );
+                const double secondsPerStem = static_cast<double>( elapsedSeconds ) / static_cast<double>( stemsWorked );
+                const double secondsLeft    = secondsPerStem * static_cast<double>( progress.m_stemsTotal - progress.m_stemsExamined );
 
                 ImGui::TextColored( colour::shades::toast.light(), "Estimated time remaining : ~%u minute(s) (~%.1f seconds per stem)",
-                    static_cast<uint32_t>( fullSyncMinutes.count() ),
-                    perSyncSecF
+                    static_cast<uint32_t>( secondsLeft / 60.0 ),
+                    static_cast<float>( secondsPerStem )
                     );
             }
         }
-        // fallthrough: always show the current stats as we are working
+        break;
 
-        case State::Complete:
-        {
-            if ( m_state == State::Complete )
-            {
-                ImGui::TextColored( colour::shades::green.light(), "Process complete" );
-            }
+        case PrecacheState::Stopping:
+            ImGui::TextColored( colour::shades::toast.dark(), "Stopping, waiting for %u download(s) to finish ...", progress.m_downloadsInFlight );
+            break;
 
-            // work out percentages for how many stems are found on disk and how many have come down over the wire
-            const auto stemsInCache         = m_statsStemsAlreadyInCache.load();
-            const auto stemsDownloaded      = m_statsStemsDownloaded.load();
-            const double totalStemsRecpPct  = 100.0 / static_cast<double>( m_stemIDs.size() );
-            const double stemsInCachePct    = totalStemsRecpPct * static_cast<double>(stemsInCache);
-            const double downloadedPct      = totalStemsRecpPct * static_cast<double>(stemsDownloaded);
+        case PrecacheState::Stopped:
+            ImGui::TextColored( colour::shades::callout.light(), "Stopped; progress has been saved, run this again to resume" );
+            break;
 
-            // display stats
-            ImGui::Spacing();
-            ImGui::SeparatorBreak();
-            ImGui::TextColored( colour::shades::white.light(), "[ %6i ] Total stems in jam", static_cast<int32_t>( m_stemIDs.size() ) );
-            ImGui::SeparatorBreak();
-            ImGui::TextColored( colour::shades::toast.light(), "[ %6i ] Stems already in cache (%.1f%%)", stemsInCache, stemsInCachePct );
-            ImGui::TextColored( colour::shades::callout.light(), "[ %6i ] Stems downloaded (%.1f%%)", stemsDownloaded, downloadedPct );
-            if ( m_statsStemsFailedToDownload > 0 )
-                ImGui::TextColored( colour::shades::errors.light(), "[ %6i ] Stems failed to download", m_statsStemsFailedToDownload.load() );
-            if ( m_statsStemsMissingFromDb > 0 )
-                ImGui::TextColored( colour::shades::errors.light(), "[ %6i ] Stems missing from Warehouse", m_statsStemsMissingFromDb.load() );
-        }
-        break;
+        case PrecacheState::Complete:
+            ImGui::TextColored( colour::shades::green.light(), "Process complete" );
+            break;
+
+        default:
+            break;
     }
 
-    ImGui::SeparatorBreak();
+    // work out percentages for how many stems are found on disk and how many have come down over the wire
+    const auto   stemsInCache       = progress.m_stemsAlreadyInCache + progress.m_stemsResumed;
+    const auto   stemsDownloaded    = progress.m_stemsDownloaded;
+    const double totalStemsRecpPct  = 100.0 / stemsTotal;
+    const double stemsInCachePct    = totalStemsRecpPct * static_cast<double>(stemsInCache);
+    const double downloadedPct      = totalStemsRecpPct * static_cast<double>(stemsDownloaded);
 
-    if ( ImGui::BottomRightAlignedButton( "Close", buttonSize ) )
-    {
-        taskExecutor.wait_for_all();
-        ImGui::CloseCurrentPopup();
-    }
+    const auto   downloadRate       = progress.m_elapsed.count() > 0 ? ( progress.m_bytesDownloaded / progress.m_elapsed.count() ) : 0;
+
+    // display stats
+    ImGui::Spacing();
+    ImGui::SeparatorBreak();
+    ImGui::TextColored( colour::shades::white.light(), "[ %6i ] Total stems in %s", static_cast<int32_t>( progress.m_stemsTotal ), progress.m_workloadName.c_str() );
+    ImGui::SeparatorBreak();
+    ImGui::TextColored( colour::shades::toast.light(), "[ %6i ] Stems already in cache (%.1f%%)", stemsInCache, stemsInCachePct );
+    ImGui::TextColored( colour::shades::callout.light(), "[ %6i ] Stems downloaded (%.1f%%), %s at %s/s", stemsDownloaded, downloadedPct,
+        base::humaniseByteSize( "", progress.m_bytesDownloaded ).c_str(),
+        base::humaniseByteSize( "", downloadRate ).c_str() );
+    if ( progress.m_stemsDamagedInCache > 0 )
+        ImGui::TextColored( colour::shades::errors.light(), "[ %6i ] Damaged stems found in cache", progress.m_stemsDamagedInCache );
+    if ( progress.m_stemsFailedToDownload > 0 )
+        ImGui::TextColored( colour::shades::errors.light(), "[ %6i ] Stems failed to download", progress.m_stemsFailedToDownload );
+    if ( progress.m_stemsMissingFromDb > 0 )
+        ImGui::TextColored( colour::shades::errors.light(), "[ %6i ] Stems missing from Warehouse", progress.m_stemsMissingFromDb );
 }
 
 } // namespace ux
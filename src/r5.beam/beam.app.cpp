@@ -727,6 +727,7 @@ void MixEngine::update(
     std::array< float, 16 >         stemTimeStretch;
     std::array< float, 16 >         stemGains;
     std::array< endlesss::live::Stem*, 16 >   stemPtr;
+    std::array< int32_t, 16 >                 stemSamplesReady;     // decode watermark, for progressively fetched stems
 
     // keep note of where we are mixing in terms of the 0..N sample count of the current riff
     std::array< uint32_t, 2 >       riffLengthInSamples;
@@ -752,6 +753,7 @@ void MixEngine::update(
             stemTimeStretch[stemI]  = currentRiff->m_stemTimeScales[stemI];
             stemGains[stemI]        = currentRiff->m_stemGains[stemI] * currentPermutation.m_layerGainMultiplier[stemI];
             stemPtr[stemI]          = currentRiff->m_stemPtrs[stemI];
+            stemSamplesReady[stemI] = ( stemPtr[stemI] != nullptr ) ? stemPtr[stemI]->getSamplesReady() : 0;
         }
     };
     decodeForegroundRiffData();
@@ -772,6 +774,7 @@ void MixEngine::update(
                 stemTimeStretch[ 8 + stemI ]  = nextRiff->m_stemTimeScales[stemI];
                 stemGains[ 8 + stemI ]        = nextRiff->m_stemGains[stemI] * nextPermutation.m_layerGainMultiplier[stemI];
                 stemPtr[ 8 + stemI ]          = nextRiff->m_stemPtrs[stemI];
+                stemSamplesReady[ 8 + stemI ] = ( stemPtr[ 8 + stemI ] != nullptr ) ? stemPtr[ 8 + stemI ]->getSamplesReady() : 0;
             }
         }
     };
@@ -918,8 +921,11 @@ void MixEngine::update(
                 m_stemDataAmalgam.m_high[stemI] = std::max( m_stemDataAmalgam.m_high[stemI], stemHigh );
             }
 
-            m_mixChannelLeft[stemI][sI]  = stemInst->m_channel[0][finalSampleIdx] * stemGain;
-            m_mixChannelRight[stemI][sI] = stemInst->m_channel[1][finalSampleIdx] * stemGain;
+            // anything not yet decoded plays as silence
+            const bool stemDecoded = ( finalSampleIdx < (uint64_t)stemSamplesReady[stemI] );
+
+            m_mixChannelLeft[stemI][sI]  = stemDecoded ? stemInst->m_channel[0][finalSampleIdx] * stemGain : 0.0f;
+            m_mixChannelRight[stemI][sI] = stemDecoded ? stemInst->m_channel[1][finalSampleIdx] * stemGain : 0.0f;
         }
 
         if ( m_transitionValue > 0 )
@@ -952,8 +958,12 @@ void MixEngine::update(
                 }
                 finalSampleIdx %= sampleCount;
 
-                m_mixChannelLeft[stemI][sI]         = base::lerp( m_mixChannelLeft[stemI][sI],  stemInst->m_channel[0][finalSampleIdx] * stemGain, m_transitionValue );
-                m_mixChannelRight[stemI][sI]        = base::lerp( m_mixChannelRight[stemI][sI], stemInst->m_channel[1][finalSampleIdx] * stemGain, m_transitionValue );
+                const bool stemDecoded = ( finalSampleIdx < (uint64_t)stemSamplesReady[ 8 + stemI ] );
+                const float stemSampleL = stemDecoded ? stemInst->m_channel[0][finalSampleIdx] * stemGain : 0.0f;
+                const float stemSampleR = stemDecoded ? stemInst->m_channel[1][finalSampleIdx] * stemGain : 0.0f;
+
+                m_mixChannelLeft[stemI][sI]         = base::lerp( m_mixChannelLeft[stemI][sI],  stemSampleL, m_transitionValue );
+                m_mixChannelRight[stemI][sI]        = base::lerp( m_mixChannelRight[stemI][sI], stemSampleR, m_transitionValue );
             }
         }
     }
@@ -1136,6 +1146,7 @@ int BeamApp::EntrypointOuro()
         m_appEventBus,
         riffFetchProvider,
         32,
+        static_cast<std::size_t>( m_configPerf.liveRiffInstancePoolMemoryMb ) * 1024 * 1024,
         [this]( const endlesss::types::RiffIdentity& request, endlesss::types::RiffComplete& result) -> bool
         {
             // most requests can be serviced direct from the DB
@@ -1160,6 +1171,9 @@ int BeamApp::EntrypointOuro()
         {
         } );
 
+    // the mix engine copes with partially decoded stems, so start riffs as soon as they are playable
+    riffPipeline.setProgressiveFetch( true );
+
 
 
     // == MAIN LOOP ====================================================================================================
@@ -503,6 +503,10 @@ protected:
 
     RiffPipeline                    m_riffPipeline;
 
+    // background stem cache warming, driven from the jam precache modal; lives here so jobs survive the modal closing
+    std::unique_ptr< endlesss::toolkit::Precache >
+                                    m_precache;
+
     SyncAndPlaybackQueue            m_syncAndPlaybackQueue;         // riffs to fetch & play - written to by main thread, read from worker
     SyncAndPlaybackQueue            m_syncAndPlaybackCompletions;   // riffs that have been fetched & played - written to by worker, read by main thread
     endlesss::types::RiffCouchIDSet m_syncAndPlaybackInFlight;      // main thread list of work submitted to worker
@@ -583,12 +587,9 @@ protected:
     // ---------------------------------------------------------------------------------------------------------------------
     void onEvent_EnqueueRiffPlayback( const base::IEvent& eventRef )
     {
-        ABSL_ASSERT( eventRef.getID() == events::EnqueueRiffPlayback::ID );
-
-        const events::EnqueueRiffPlayback* enqueueRiffPlaybackEvent = dynamic_cast<const events::EnqueueRiffPlayback*>(&eventRef);
-        ABSL_ASSERT( enqueueRiffPlaybackEvent != nullptr );
+        const auto& enqueueRiffPlaybackEvent = base::event_cast< events::EnqueueRiffPlayback >( eventRef );
 
-        requestRiffPlayback( enqueueRiffPlaybackEvent->m_identity, m_riffPlaybackAbstraction.asPermutation() );
+        requestRiffPlayback( enqueueRiffPlaybackEvent.m_identity, m_riffPlaybackAbstraction.asPermutation() );
     }
 
     base::OperationID requestRiffPlayback( const endlesss::types::RiffIdentity& riffIdent, const endlesss::types::RiffPlaybackPermutation& playback )
@@ -2019,6 +2020,19 @@ int LoreApp::EntrypointOuro()
             ImGui::Separator();
 
             ImGui::TextUnformatted( m_warehouseWorkState.c_str() );
+
+            // background precache jobs can run for hours, show they're still going
+            if ( m_precache != nullptr )
+            {
+                const auto precacheProgress = m_precache->getProgress();
+                if ( precacheProgress.isActive() )
+                {
+                    ImGui::Separator();
+                    ImGui::TextColored( colour::shades::callout.neutral(), "Precache %zu / %zu",
+                        precacheProgress.m_stemsExamined,
+                        precacheProgress.m_stemsTotal );
+                }
+            }
         }
     });
 
@@ -2107,10 +2121,13 @@ int LoreApp::EntrypointOuro()
 #endif // OURO_FEATURE_NST24
 
 
+    m_precache = std::make_unique< endlesss::toolkit::Precache >( riffFetchProvider, m_storagePaths->cacheApp / "precache" );
+
     m_riffPipeline = std::make_unique< endlesss::toolkit::Pipeline >(
         m_appEventBus,
         riffFetchProvider,
         m_configPerf.liveRiffInstancePoolSize,
+        static_cast<std::size_t>( m_configPerf.liveRiffInstancePoolMemoryMb ) * 1024 * 1024,
         [this]( const endlesss::types::RiffIdentity& request, endlesss::types::RiffComplete& result) -> bool
         {
             // most requests can be serviced direct from the DB
@@ -2151,10 +2168,14 @@ int LoreApp::EntrypointOuro()
             m_riffPipelineClearInProgress = false;
         });
 
+    // the preview mixer copes with partially decoded stems, so start riffs as soon as they are playable
+    m_riffPipeline->setProgressiveFetch( true );
+
     m_riffExportPipeline = std::make_unique< endlesss::toolkit::Pipeline >(
         m_appEventBus,
         riffFetchProvider,
         0, // no internal cache - we don't want riffs saved as we can modify jam/riff descriptions during batch exports which would then be ignored
+        0,
         [this]( const endlesss::types::RiffIdentity& request, endlesss::types::RiffComplete& result ) -> bool
         {
             // most requests can be serviced direct from the DB
@@ -3616,7 +3637,7 @@ int LoreApp::EntrypointOuro()
                             fileDialog->OpenDialog(
                                 "ImpFileDlg",
                                 "Choose exported LORE metadata",
-                                ".yaml",
+                                "Jam data{.ojam,.yaml},.ojam,.yaml",
                                 cWarehouseExportPath.string().c_str(),
                                 1,
                                 nullptr,
@@ -3624,8 +3645,10 @@ int LoreApp::EntrypointOuro()
 
                             std::ignore = activateFileDialog( std::move( fileDialog ), [this]( ImGuiFileDialog& dlg )
                                 {
-                                    // ask warehouse to deal with this
-                                    const base::OperationID importOperationID = m_warehouse->requestJamDataImport( dlg.GetFilePathName() );
+                                    // ask warehouse to deal with this; any stems bundled with the data go straight into the cache
+                                    const base::OperationID importOperationID = m_warehouse->requestJamDataImport(
+                                        dlg.GetFilePathName(),
+                                        getStemCache().getCacheRootPath() );
                                 });
                         }
                         ImGui::SameLine( 0, cButtonGapSize );
@@ -3999,10 +4022,9 @@ int LoreApp::EntrypointOuro()
                                     // create and launch the precache tool w. attached state
                                     activateModalPopup( popupLabel, [
                                         this,
-                                            &riffFetchProvider,
                                             state = ux::createJamPrecacheState( iterCurrentJamID )](const char* title)
                                         {
-                                            ux::modalJamPrecache( title, *state, *m_warehouse, riffFetchProvider, getTaskExecutor() );
+                                            ux::modalJamPrecache( title, *state, *m_warehouse, *m_precache );
                                         });
                                 }
                                 ImGui::CompactTooltip( "Open a utility that allows you to download all stems for this jam,\nallowing for fully offline browsing and archival" );
@@ -4018,17 +4040,37 @@ int LoreApp::EntrypointOuro()
                                     // make sure it exists, pop an error if that fails
                                     if ( checkWarehouseExportDirectoryExists() )
                                     {
-                                        // tell warehouse to spool the database records out to disk
+                                        // tell warehouse to spool the database records out to disk; shift-click for the older YAML format
+                                        const base::OperationID exportOperationID = m_warehouse->requestJamDataExport(
+                                            iterCurrentJamID,
+                                            cWarehouseExportPath,
+                                            m_warehouseContentsReportJamTitles[jI],
+                                            ImGui::GetIO().KeyShift ? endlesss::toolkit::Warehouse::ExportFormat::Yaml : endlesss::toolkit::Warehouse::ExportFormat::Binary
+                                        );
+
+                                        addOperationToJam( iterCurrentJamID, exportOperationID );
+                                    }
+                                }
+                                ImGui::CompactTooltip( "Begin an export process to archive this jam's database records to a file on disk\nHold SHIFT to write the older YAML format instead" );
+
+                                ImGui::SameLine();
+                                if ( ImGui::Button( " " ICON_FA_BOXES_PACKING " Bundle  " ) )
+                                {
+                                    if ( checkWarehouseExportDirectoryExists() )
+                                    {
+                                        // as above, with any stems we have cached for this jam packed into the same file
                                         const base::OperationID exportOperationID = m_warehouse->requestJamDataExport(
                                             iterCurrentJamID,
                                             cWarehouseExportPath,
-                                            m_warehouseContentsReportJamTitles[jI]
+                                            m_warehouseContentsReportJamTitles[jI],
+                                            endlesss::toolkit::Warehouse::ExportFormat::Binary,
+                                            getStemCache().getCacheRootPath()
                                         );
 
                                         addOperationToJam( iterCurrentJamID, exportOperationID );
                                     }
                                 }
-                                ImGui::CompactTooltip( "Begin an export process to archive this jam's database records to a file on disk" );
+                                ImGui::CompactTooltip( "Export this jam's database records and all locally cached stems together in a single archive" );
 
                                 ImGui::SameLine();
                                 if ( ImGui::Button( " " ICON_FA_BOXES_PACKING " Stems   " ) )
@@ -4176,6 +4218,9 @@ int LoreApp::EntrypointOuro()
         m_sketchbook.reset();
     }
 
+    // any running precache job is stopped here; its journal lets it resume on the next run
+    m_precache.reset();
+
     m_riffPipeline.reset();
 
     m_discordBotUI.reset();
@@ -0,0 +1,203 @@
+#
+# OUROVEON WAREHOUSE SYNC STAND-IN
+#
+# a tiny fake of the Couch data endpoint that serves synthetic riff & stem documents for any jam asked of it, so the
+# warehouse sync pipeline can be run against something local, repeatable and deliberately slow. every request is held
+# for [--latency] seconds and the server tracks how many are in flight at once; with N concurrent sync fetches
+# configured, the peak reported here should reach N, which is the check that fetches really do overlap
+#
+# point the app at it by adding these to the rAPI config (endlesss.json), then sync any jam from the warehouse UI
+#
+#     "debugDataDomainOverride" : "localhost",
+#     "debugDataPortOverride"   : 5984,
+#     "debugDataPlainHttp"      : true,
+#
+# and compare the peak against "syncConcurrentFetches" in the same file. ctrl-c to stop and print the summary
+#
+# no audio is served; stems point at a CDN path that doesn't exist, which is fine as the sync never downloads them
+#
+
+import argparse
+import hashlib
+import json
+import threading
+import time
+
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlparse, parse_qs
+
+
+parser = argparse.ArgumentParser( description="stand-in Couch data server for testing warehouse sync" )
+parser.add_argument( "--port",    type=int,   default=5984,  help="port to listen on" )
+parser.add_argument( "--riffs",   type=int,   default=2000,  help="riffs to invent for each jam" )
+parser.add_argument( "--latency", type=float, default=0.5,   help="seconds to hold every request for" )
+args = parser.parse_args()
+
+
+# deterministic 32-character hex IDs, so repeat runs produce the same jam contents
+def make_id( *parts ):
+    return hashlib.md5( "/".join( str(p) for p in parts ).encode() ).hexdigest()
+
+# 8 slots per riff, each drawing from a small rolling pool of stems so that riffs share stems like a real jam would
+def stems_for_riff( jam, riff_index ):
+    return [ make_id( jam, "stem", ( riff_index // 4 ) + slot ) for slot in range( 8 ) ]
+
+def riff_ids( jam ):
+    return [ make_id( jam, "riff", i ) for i in range( args.riffs ) ]
+
+# newest first, as rifffLoopsByCreateTime is always asked for descending
+def riff_rows( jam ):
+    base_time = 1600000000 * 1000 * 1000 * 1000
+    return [ { "id" : make_id( jam, "riff", i ), "key" : base_time + ( i * 10 * 1000 * 1000 * 1000 ), "value" : stems_for_riff( jam, i ) }
+             for i in reversed( range( args.riffs ) ) ]
+
+
+# reverse lookup from document ID back to what it is, filled in as jams are first asked about
+documents_lock = threading.Lock()
+documents = {}
+
+def register_jam( jam ):
+    with documents_lock:
+        if ( jam, "registered" ) in documents:
+            return
+        for i in range( args.riffs ):
+            documents[ make_id( jam, "riff", i ) ] = ( "riff", jam, i )
+            for stem_id in stems_for_riff( jam, i ):
+                documents[ stem_id ] = ( "stem", jam, stem_id )
+        documents[ ( jam, "registered" ) ] = True
+
+def riff_document( jam, i ):
+    stems = stems_for_riff( jam, i )
+    return {
+        "_id"         : make_id( jam, "riff", i ),
+        "type"        : "Rifff",
+        "app_version" : 3000,
+        "userName"    : "standin_user_%d" % ( i % 5 ),
+        "created"     : 1600000000 * 1000 + ( i * 10 * 1000 ),
+        "root"        : i % 12,
+        "scale"       : i % 7,
+        "magnitude"   : 0.5,
+        "state"       : {
+            "bps"       : 2.0,
+            "barLength" : 2.0,
+            "playback"  : [ { "slot" : { "current" : { "on" : True, "currentLoop" : stem, "gain" : 0.75 } } } for stem in stems ]
+        }
+    }
+
+def stem_document( jam, stem_id ):
+    key = "attachments/oggAudio/%s/%s" % ( jam, stem_id )
+    return {
+        "_id"             : stem_id,
+        "type"            : "Loop",
+        "app_version"     : 3000,
+        "cdn_attachments" : { "oggAudio" : { "endpoint" : "standin.invalid", "key" : key, "url" : "https://standin.invalid/" + key, "length" : 65536 } },
+        "bps"             : 2.0,
+        "length16ths"     : 16.0,
+        "originalPitch"   : 0.0,
+        "barLength"       : 2.0,
+        "presetName"      : "standin",
+        "creatorUserName" : "standin_user",
+        "primaryColour"   : "ff00ffff",
+        "sampleRate"      : 44100.0,
+        "created"         : 1600000000 * 1000,
+        "isDrum"          : False,
+        "isNote"          : True,
+        "isBass"          : False,
+        "isMic"           : False
+    }
+
+
+# in-flight tracking, the whole point of the exercise
+stats_lock = threading.Lock()
+stats = { "in_flight" : 0, "peak" : 0, "requests" : 0, "docs" : 0 }
+
+class StandInHandler( BaseHTTPRequestHandler ):
+
+    # keep-alive, as the app pools its connections
+    protocol_version = "HTTP/1.1"
+
+    def log_message( self, format, *log_args ):
+        pass
+
+    def send_json( self, payload ):
+        body = json.dumps( payload ).encode()
+        self.send_response( 200 )
+        self.send_header( "Content-Type", "application/json" )
+        self.send_header( "Content-Length", str( len( body ) ) )
+        self.end_headers()
+        self.wfile.write( body )
+
+    def handle_request( self, body ):
+        with stats_lock:
+            stats["in_flight"] += 1
+            stats["requests"]  += 1
+            stats["peak"] = max( stats["peak"], stats["in_flight"] )
+            now_in_flight = stats["in_flight"]
+        try:
+            url   = urlparse( self.path )
+            query = parse_qs( url.query )
+
+            # paths look like /user_appdata$<jam>/...
+            path_parts = url.path.split( "/" )
+            jam = path_parts[1].split( "$", 1 )[-1] if len( path_parts ) > 1 else ""
+            register_jam( jam )
+
+            time.sleep( args.latency )
+
+            if url.path.endswith( "/Profile" ):
+                self.send_json( { "displayName" : "stand-in jam " + jam[:8], "app_version" : 3000 } )
+
+            elif url.path.endswith( "/_view/rifffLoopsByCreateTime" ):
+                rows = riff_rows( jam )
+                if "limit" in query:
+                    rows = rows[: int( query["limit"][0] ) ]
+                self.send_json( { "total_rows" : args.riffs, "offset" : 0, "rows" : rows } )
+
+            elif url.path.endswith( "/_view/rifffsByCreateTime" ):
+                self.send_json( { "total_rows" : args.riffs, "offset" : 0, "rows" : [] } )
+
+            elif url.path.endswith( "/_changes" ):
+                self.send_json( { "last_seq" : "%d-standin" % args.riffs, "pending" : 0, "results" : [] } )
+
+            elif url.path.endswith( "/_all_docs" ):
+                keys = json.loads( body or b"{}" ).get( "keys", [] )
+                rows = []
+                with documents_lock:
+                    for key in keys:
+                        found = documents.get( key )
+                        if found is None:
+                            rows.append( { "key" : key, "error" : "not_found" } )
+                        elif found[0] == "riff":
+                            rows.append( { "id" : key, "key" : key, "value" : { "rev" : "1-0" }, "doc" : riff_document( found[1], found[2] ) } )
+                        else:
+                            rows.append( { "id" : key, "key" : key, "value" : { "rev" : "1-0" }, "doc" : stem_document( found[1], found[2] ) } )
+                with stats_lock:
+                    stats["docs"] += len( keys )
+                print( "  _all_docs x%-4d  (%d in flight)" % ( len( keys ), now_in_flight ) )
+                self.send_json( { "total_rows" : len( documents ), "offset" : 0, "rows" : rows } )
+
+            else:
+                print( "  unhandled : %s %s" % ( self.command, self.path ) )
+                self.send_error( 404 )
+        finally:
+            with stats_lock:
+                stats["in_flight"] -= 1
+
+    def do_GET( self ):
+        self.handle_request( None )
+
+    def do_POST( self ):
+        length = int( self.headers.get( "Content-Length", 0 ) )
+        self.handle_request( self.rfile.read( length ) if length > 0 else None )
+
+
+server = ThreadingHTTPServer( ( "localhost", args.port ), StandInHandler )
+server.daemon_threads = True
+
+print( "sync stand-in on http://localhost:%d, %d riffs per jam, %.2fs latency" % ( args.port, args.riffs, args.latency ) )
+try:
+    server.serve_forever()
+except KeyboardInterrupt:
+    pass
+
+print( "served %d requests covering %d documents; peak of %d requests in flight at once" % ( stats["requests"], stats["docs"], stats["peak"] ) )